@@ -0,0 +1,699 @@
+#include <algorithm>
+#include <cstring>
+
+#include "buffer/buffer_pool_instance.h"
+#include "common/exception.h"
+
+namespace cmudb {
+
+/*
+ * BufferPoolInstance Constructor
+ * When log_manager is nullptr, logging is disabled (for test purpose)
+ */
+BufferPoolInstance::BufferPoolInstance(size_t pool_size, char *frames,
+                                       DiskManager *disk_manager,
+                                       LogManager *log_manager,
+                                       ReplacerType replacer_type)
+    : pool_size_(pool_size), disk_manager_(disk_manager),
+      log_manager_(log_manager), frame_states_(pool_size, FrameState::FREE),
+      prefetching_(0), writing_(pool_size, false), retired_(pool_size, false),
+      write_rec_lsns_(pool_size, INVALID_LSN) {
+  // page metadata, the content of frame i is frames[i * page_size, ...)
+  size_t page_size = disk_manager_->GetPageSize();
+  pages_ = new Page[pool_size_];
+  for (size_t i = 0; i < pool_size_; ++i) {
+    pages_[i].data_ = frames + i * page_size;
+    pages_[i].page_size_ = page_size;
+    pages_[i].ResetMemory();
+  }
+  page_table_ = new PageTable(pool_size_);
+  if (replacer_type == ReplacerType::CLOCK) {
+    replacer_ = new ClockReplacer<Page *>(
+        pool_size_, [this](Page *const &page) { return FrameId(page); });
+  } else if (replacer_type == ReplacerType::LRU_K) {
+    replacer_ = new LRUKReplacer<Page *>(LRUK_K, LRUK_CORRELATED_PERIOD);
+  } else {
+    replacer_ = new LRUReplacer<Page *>;
+  }
+  free_list_ = new std::list<Page *>;
+  frame_cvs_ = new std::condition_variable[pool_size_];
+
+  // put all the pages into free list
+  for (size_t i = 0; i < pool_size_; ++i) {
+    free_list_->push_back(&pages_[i]);
+  }
+}
+
+BufferPoolInstance::~BufferPoolInstance() {
+  {
+    // prefetch callbacks still to come would touch the frames
+    std::unique_lock<std::mutex> lock(latch_);
+    prefetch_cv_.wait(lock, [&] { return prefetching_ == 0; });
+  }
+  delete[] pages_;
+  delete page_table_;
+  delete replacer_;
+  delete free_list_;
+  delete[] frame_cvs_;
+}
+
+/**
+ * 1. search hash table.
+ *  1.1 if exist, pin the page, wait until it is loaded and return
+ *  1.2 if it is being written back, wait for that and search again
+ *  1.3 if no exist, find a replacement entry from either free list or lru
+ *      replacer. (NOTE: always find from free list first)
+ * 2. If the entry chosen for replacement is dirty, write it back to disk.
+ * 3. Delete the entry for the old page from the hash table and insert an
+ * entry for the new page.
+ * 4. Update page metadata, read page content from disk file and return page
+ * pointer
+ * Steps 2 and 4 run without holding latch_.
+ * A page failing its checksum is dropped again and reported with an
+ * exception; whoever waited for that read tries again.
+ */
+Page *BufferPoolInstance::FetchPage(page_id_t page_id) {
+  std::unique_lock<std::mutex> lock(latch_);
+
+  Page *page = nullptr;
+  if (page_id == INVALID_PAGE_ID) { return page; }
+
+  while (true) {
+    if (FindPage(page_id, page)) {
+      if (page->pin_count_ == 0) {
+        replacer_->Erase(page);
+      }
+      pin_page(page);
+      replacer_->RecordAccess(page);
+      if (WaitUntilResident(lock, page)) {
+        return page;
+      }
+      ReleaseDropped(page);
+      continue;
+    }
+    if (evicting_.find(page_id) == evicting_.end()) {
+      break;
+    }
+    // old content is still on its way to disk, read it after that
+    WaitUntilEvicted(lock, page_id);
+  }
+
+  page = AcquireFrame(lock, page_id);
+  if (page == nullptr) {
+    return nullptr;
+  }
+  replacer_->RecordAccess(page);
+
+  lock.unlock();
+  bool ok = disk_manager_->ReadPage(page_id, page->GetData());
+  lock.lock();
+  assert(!page->is_dirty_);
+  if (!ok) {
+    DropFrame(page);
+    throw Exception(EXCEPTION_TYPE_IO,
+                    "page " + std::to_string(page_id) + " is corrupted");
+  }
+  SetFrameState(page, FrameState::RESIDENT);
+  return page;
+}
+
+/*
+ * Implementation of unpin page
+ * if pin_count>0, decrement it and if it becomes zero, put it back to
+ * replacer if pin_count<=0 before this call, return false. is_dirty: set the
+ * dirty flag of this page
+ */
+bool BufferPoolInstance::UnpinPage(page_id_t page_id, bool is_dirty) {
+  std::unique_lock<std::mutex> lock(latch_);
+
+  Page *page = nullptr;
+  if (!FindPage(page_id, page)) {
+    return false;
+  }
+
+  if (is_dirty) {
+    page->is_dirty_ = true;
+  }
+  ReleasePin(lock, page);
+
+  return true;
+}
+
+/*
+ * Used to flush a particular page of the buffer pool to disk. Should call the
+ * write_page method of the disk manager
+ * if page is not found in page table, return false
+ * The page stays pinned while latch_ is released for the write, and the dirty
+ * flag is cleared beforehand so that a concurrent unpin(dirty) is not lost.
+ * What is written is a copy taken under the page's read latch, so the caller
+ * must not hold the page's write latch.
+ * NOTE: make sure page_id != INVALID_PAGE_ID
+ */
+bool BufferPoolInstance::FlushPage(page_id_t page_id) {
+  std::unique_lock<std::mutex> lock(latch_);
+  Page *page = nullptr;
+  if (!FindPage(page_id, page)) {
+    return false;
+  }
+  if (page->pin_count_ == 0) {
+    replacer_->Erase(page);
+  }
+  pin_page(page);
+  if (!WaitUntilResident(lock, page)) {
+    ReleaseDropped(page);
+    return false;
+  }
+  WaitUntilWritten(lock, page);
+  // writing_ keeps other flushes off write_rec_lsns_ until this one is done
+  writing_[FrameId(page)] = true;
+  page->is_dirty_ = false;
+  StartWrite(page);
+
+  lock.unlock();
+  std::vector<char> copy(page->GetPageSize());
+  CopyPage(page, copy.data());
+  disk_manager_->WritePage(page_id, copy.data());
+  lock.lock();
+  FinishWrite(page);
+  writing_[FrameId(page)] = false;
+  frame_cvs_[FrameId(page)].notify_all();
+
+  ReleasePin(lock, page);
+  return true;
+}
+
+/**
+ * Remove the page from page table, reset its metadata and put the frame back
+ * to free list. Deallocating the page id is left to BufferPoolManager.
+ * If the page is found within page table, but pin_count != 0, return false
+ * (an optimistic reader of the B+ tree may still hold a pin on a page just
+ * taken out of the tree). A write-back still in flight, by the cleaner or by
+ * an eviction, is waited for, it must not land after the page id has been
+ * handed out again.
+ */
+bool BufferPoolInstance::DeletePage(page_id_t page_id) {
+  std::unique_lock<std::mutex> lock(latch_);
+  WaitUntilEvicted(lock, page_id);
+  Page *page = nullptr;
+  auto ret = FindPage(page_id, page);
+  if (ret) {
+    WaitUntilWritten(lock, page);
+    if (page->GetPinCount() != 0) {
+      return false;
+    }
+    assert(frame_states_[FrameId(page)] == FrameState::RESIDENT);
+
+    auto erase = replacer_->Erase(page);
+    assert(erase);
+    FreeFrame(page);
+  }
+  return true;
+}
+
+/*
+ * Like DeletePage, but a pinned page is only flagged in retired_: the unpin
+ * that drops its last pin deletes it and deallocates its page id (see
+ * ReleasePin). Whoever retires a page must make sure that no new reader can
+ * find it anymore, only the ones already holding a pin.
+ */
+bool BufferPoolInstance::RetirePage(page_id_t page_id) {
+  std::unique_lock<std::mutex> lock(latch_);
+  WaitUntilEvicted(lock, page_id);
+  Page *page = nullptr;
+  if (!FindPage(page_id, page)) {
+    return true;
+  }
+  WaitUntilWritten(lock, page);
+  if (page->GetPinCount() != 0) {
+    retired_[FrameId(page)] = true;
+    return false;
+  }
+  assert(frame_states_[FrameId(page)] == FrameState::RESIDENT);
+  auto erase = replacer_->Erase(page);
+  assert(erase);
+  FreeFrame(page);
+  return true;
+}
+
+/**
+ * Choose a victim page either from free list or lru replacer(NOTE: always
+ * choose from free list first), update new page's metadata, zero out memory
+ * and add corresponding entry into page table. return nullptr if all the
+ * pages in this instance are pinned
+ * The page id may still be resident from before it was freed, read back in by
+ * a late optimistic reader; that frame is taken over. Its old content may
+ * also still be on its way to disk from an eviction, which is waited for, so
+ * that it cannot overwrite the new page's later write-back.
+ */
+Page *BufferPoolInstance::NewPage(page_id_t page_id) {
+  std::unique_lock<std::mutex> lock(latch_);
+  WaitUntilEvicted(lock, page_id);
+
+  Page *page = nullptr;
+  if (FindPage(page_id, page)) {
+    if (page->pin_count_ == 0) {
+      replacer_->Erase(page);
+    }
+    pin_page(page);
+    if (!WaitUntilResident(lock, page)) {
+      ReleaseDropped(page);
+      page = nullptr;
+    }
+  }
+  if (page == nullptr && (page = AcquireFrame(lock, page_id)) == nullptr) {
+    return nullptr;
+  }
+
+  replacer_->RecordAccess(page);
+  page->ResetMemory();
+  page->is_dirty_ = true;
+  SetFrameState(page, FrameState::RESIDENT);
+  return page;
+}
+
+/*
+ * Give each page that is neither resident nor on its way to disk a frame and
+ * read them all in one batch. The frames stay pinned by the reads, not by the
+ * caller. Stops early rather than take more than half the pool.
+ * Pages not allocated yet are left out, a later NewPage must not find them.
+ */
+void BufferPoolInstance::Prefetch(const std::vector<page_id_t> &page_ids) {
+  std::vector<DiskRequest> requests;
+  {
+    std::unique_lock<std::mutex> lock(latch_);
+    for (page_id_t page_id : page_ids) {
+      if (prefetching_ >= pool_size_ / 2) {
+        break;
+      }
+      Page *page = nullptr;
+      if (FindPage(page_id, page) || evicting_.count(page_id) != 0 ||
+          !disk_manager_->IsAllocated(page_id)) {
+        continue;
+      }
+      page = AcquireFrame(lock, page_id);
+      if (page == nullptr) {
+        break;
+      }
+      prefetching_++;
+      requests.push_back(DiskRequest{false, page_id, page->GetData(),
+                                     [this, page](bool ok) {
+                                       FinishPrefetch(page, ok);
+                                     }});
+    }
+  }
+  if (!requests.empty()) {
+    disk_manager_->SubmitBatch(std::move(requests));
+  }
+}
+
+/*
+ * Completion of a prefetch read, runs on a disk manager thread. A page that
+ * did not read back intact is dropped, a FetchPage will find out about it
+ */
+void BufferPoolInstance::FinishPrefetch(Page *page, bool ok) {
+  std::lock_guard<std::mutex> guard(latch_);
+  assert(!page->is_dirty_);
+  if (!ok) {
+    DropFrame(page);
+  } else {
+    SetFrameState(page, FrameState::RESIDENT);
+    page->pin_count_--;
+    if (page->pin_count_ == 0) {
+      replacer_->Insert(page);
+    }
+  }
+  if (--prefetching_ == 0) {
+    prefetch_cv_.notify_all();
+  }
+}
+
+/*
+ * Dirty pages nobody has pinned, see WriteDirtyPages
+ */
+size_t BufferPoolInstance::CleanPages() { return WriteDirtyPages(false); }
+
+/*
+ * All dirty pages, see WriteDirtyPages. Like FlushPage, a pinned page is
+ * copied under its read latch, the caller must not hold any page's write latch
+ */
+void BufferPoolInstance::FlushAllPages() { WriteDirtyPages(true); }
+
+/*
+ * Write the dirty resident pages in one batch sorted by page id, so that the
+ * disk sees them in file order. Pages already being written are skipped. The
+ * dirty flag is cleared up front, a page dirtied again meanwhile is written
+ * next time.
+ * Nothing keeps other threads from pinning and changing a page while its
+ * write is on its way, so each page is copied under its read latch with
+ * latch_ released (CopyPage), and the copies are written. With logging on, a
+ * copy whose LSN is not persistent yet is not written (WAL); its page stays
+ * dirty.
+ * @return: number of pages written
+ */
+size_t BufferPoolInstance::WriteDirtyPages(bool include_pinned) {
+  std::unique_lock<std::mutex> lock(latch_);
+  std::vector<Page *> pages;
+  for (size_t i = 0; i < pool_size_; ++i) {
+    Page *page = &pages_[i];
+    if (frame_states_[i] != FrameState::RESIDENT || !page->is_dirty_ ||
+        writing_[i] || (!include_pinned && page->pin_count_ != 0)) {
+      continue;
+    }
+    pages.push_back(page);
+  }
+  if (pages.empty()) {
+    return 0;
+  }
+  std::sort(pages.begin(), pages.end(), [](Page *a, Page *b) {
+    return a->page_id_ < b->page_id_;
+  });
+  // writing_ keeps the frames from being given to other pages
+  std::vector<page_id_t> page_ids;
+  for (Page *page : pages) {
+    writing_[FrameId(page)] = true;
+    page->is_dirty_ = false;
+    StartWrite(page);
+    page_ids.push_back(page->page_id_);
+  }
+  lock.unlock();
+
+  bool check_lsn = log_manager_ != nullptr && ENABLE_LOGGING;
+  lsn_t persistent_lsn =
+      check_lsn ? log_manager_->GetPersistentLSN() : INVALID_LSN;
+  size_t page_size = disk_manager_->GetPageSize();
+  std::vector<char> copies(pages.size() * page_size);
+  std::vector<bool> written(pages.size(), false);
+  std::vector<DiskRequest> requests;
+  for (size_t i = 0; i < pages.size(); i++) {
+    char *copy = copies.data() + i * page_size;
+    CopyPage(pages[i], copy);
+    if (check_lsn && Page::GetLSN(copy) > persistent_lsn) {
+      continue;
+    }
+    written[i] = true;
+    requests.push_back(DiskRequest{true, page_ids[i], copy, nullptr});
+  }
+  size_t count = requests.size();
+  disk_manager_->SubmitBatch(std::move(requests)).wait();
+  lock.lock();
+  for (size_t i = 0; i < pages.size(); i++) {
+    Page *page = pages[i];
+    writing_[FrameId(page)] = false;
+    if (written[i]) {
+      FinishWrite(page);
+    } else {
+      CancelWrite(page);
+    }
+    frame_cvs_[FrameId(page)].notify_all();
+  }
+  return count;
+}
+
+/*
+ * Pages with logged changes that may not be on disk: resident pages with a
+ * recovery LSN (the smaller one if a write-back is in flight) and pages whose
+ * eviction write is still going on
+ */
+void BufferPoolInstance::GetDirtyPages(DirtyPageTable &dirty_pages) {
+  std::lock_guard<std::mutex> guard(latch_);
+  for (size_t i = 0; i < pool_size_; ++i) {
+    if (frame_states_[i] != FrameState::RESIDENT) {
+      continue;
+    }
+    lsn_t rec_lsn = pages_[i].rec_lsn_;
+    if (write_rec_lsns_[i] != INVALID_LSN &&
+        (rec_lsn == INVALID_LSN || write_rec_lsns_[i] < rec_lsn)) {
+      rec_lsn = write_rec_lsns_[i];
+    }
+    if (rec_lsn != INVALID_LSN) {
+      dirty_pages.emplace_back(pages_[i].page_id_, rec_lsn);
+    }
+  }
+  for (auto &evicting : evicting_) {
+    lsn_t rec_lsn = write_rec_lsns_[FrameId(evicting.second)];
+    if (rec_lsn != INVALID_LSN) {
+      dirty_pages.emplace_back(evicting.first, rec_lsn);
+    }
+  }
+}
+
+/*
+ * Find a frame for page_id, free list first and then the replacer. The frame
+ * is registered in page table under page_id, pinned once and left in LOADING
+ * state; the caller fills it and marks it RESIDENT.
+ * A dirty victim is written back (after the log covering it, if logging is
+ * on) with latch_ released; meanwhile its old page id is kept in evicting_ so
+ * that nobody reads a stale copy from disk.
+ * Caller must hold latch_ through lock, which is held again on return.
+ * @return: nullptr if all the pages in this instance are pinned
+ */
+Page *BufferPoolInstance::AcquireFrame(std::unique_lock<std::mutex> &lock,
+                                       page_id_t page_id) {
+  Page *page = nullptr;
+  if (!free_list_->empty()) {
+    page = *free_list_->begin();
+    free_list_->pop_front();
+    assert(page->pin_count_ == 0);
+    assert(page->page_id_ == INVALID_PAGE_ID);
+    assert(!page->is_dirty_);
+    assert(frame_states_[FrameId(page)] == FrameState::FREE);
+  } else if ((page = Victim(lock)) == nullptr) {
+    return nullptr;
+  }
+  assert(page->pin_count_ == 0);
+
+  page_id_t old_page_id = page->page_id_;
+  bool write_back = page->is_dirty_;
+  if (old_page_id != INVALID_PAGE_ID) {
+    page_table_->Remove(old_page_id);
+  }
+  page_table_->Insert(page_id, FrameId(page));
+  page->page_id_ = page_id;
+  page->is_dirty_ = false;
+  pin_page(page);
+
+  if (!write_back) {
+    page->rec_lsn_ = INVALID_LSN;
+    SetFrameState(page, FrameState::LOADING);
+    return page;
+  }
+
+  evicting_[old_page_id] = page;
+  StartWrite(page);
+  SetFrameState(page, FrameState::EVICTING);
+  lock.unlock();
+  if (log_manager_ != nullptr && ENABLE_LOGGING &&
+      page->GetLSN() > log_manager_->GetPersistentLSN()) {
+    // WAL: the page's last change must be on disk before the page
+    log_manager_->WaitForLSN(page->GetLSN());
+    assert(page->GetLSN() <= log_manager_->GetPersistentLSN());
+  }
+  disk_manager_->WritePage(old_page_id, page->GetData());
+  lock.lock();
+  FinishWrite(page);
+  evicting_.erase(old_page_id);
+  SetFrameState(page, FrameState::LOADING);
+  return page;
+}
+
+/*
+ * Pick an unpinned frame from the replacer, passing over the ones being
+ * written back (they go back to the replacer). If nothing else is left, wait
+ * for such a write and try again.
+ * @return: nullptr if all the pages in this instance are pinned
+ */
+Page *BufferPoolInstance::Victim(std::unique_lock<std::mutex> &lock) {
+  while (true) {
+    std::vector<Page *> skipped;
+    Page *page = nullptr;
+    while (replacer_->Victim(page) && writing_[FrameId(page)]) {
+      skipped.push_back(page);
+      page = nullptr;
+    }
+    for (Page *skipped_page : skipped) {
+      replacer_->Insert(skipped_page);
+    }
+    if (page != nullptr || skipped.empty()) {
+      return page;
+    }
+    WaitUntilWritten(lock, skipped.front());
+  }
+}
+
+/*
+ * Look page_id up in page table and translate the frame id into its Page
+ */
+bool BufferPoolInstance::FindPage(page_id_t page_id, Page *&page) {
+  size_t frame_id;
+  if (!page_table_->Find(page_id, frame_id)) {
+    return false;
+  }
+  page = &pages_[frame_id];
+  return true;
+}
+
+/*
+ * Caller must hold latch_
+ */
+void BufferPoolInstance::SetFrameState(Page *page, FrameState state) {
+  size_t frame_id = FrameId(page);
+  frame_states_[frame_id] = state;
+  frame_cvs_[frame_id].notify_all();
+}
+
+/*
+ * Block on the frame (not on the whole instance) until the I/O of whoever
+ * brought the page in has finished. Caller must hold a pin on page.
+ * @return: false if the read failed and the page was dropped, the caller
+ * then has to give its pin back with ReleaseDropped
+ */
+bool BufferPoolInstance::WaitUntilResident(std::unique_lock<std::mutex> &lock,
+                                           Page *page) {
+  size_t frame_id = FrameId(page);
+  page_id_t page_id = page->page_id_;
+  frame_cvs_[frame_id].wait(lock, [&] {
+    return frame_states_[frame_id] == FrameState::RESIDENT ||
+           page->page_id_ != page_id;
+  });
+  return page->page_id_ == page_id;
+}
+
+/*
+ * The read bringing page in failed: take the page out of the page table and
+ * give the reader's pin back. The frame returns to the free list once the
+ * threads that were waiting for the read have released theirs as well.
+ * Caller must hold latch_
+ */
+void BufferPoolInstance::DropFrame(Page *page) {
+  page_table_->Remove(page->page_id_);
+  page->page_id_ = INVALID_PAGE_ID;
+  page->rec_lsn_ = INVALID_LSN;
+  SetFrameState(page, FrameState::FREE);
+  ReleaseDropped(page);
+}
+
+/*
+ * Put a resident, unpinned frame that is not in the replacer back to the free
+ * list, taking its page out of the page table.
+ * Caller must hold latch_
+ */
+void BufferPoolInstance::FreeFrame(Page *page) {
+  replacer_->Reset(page);
+  free_list_->push_back(page);
+  auto remove = page_table_->Remove(page->page_id_);
+  assert(remove);
+  page->page_id_ = INVALID_PAGE_ID;
+  page->is_dirty_ = false;
+  page->rec_lsn_ = INVALID_LSN;
+  page->ResetMemory();
+  retired_[FrameId(page)] = false;
+  SetFrameState(page, FrameState::FREE);
+}
+
+/*
+ * Drop a pin of a resident page. An unpinned page goes back to the replacer,
+ * unless it was retired: then it is deleted, once a write-back in flight is
+ * done, and its page id deallocated. It stays out of the replacer meanwhile,
+ * so that nobody evicts it, and a pin taken meanwhile leaves the deletion to
+ * its own unpin.
+ * Caller must hold latch_ through lock
+ */
+void BufferPoolInstance::ReleasePin(std::unique_lock<std::mutex> &lock,
+                                    Page *page) {
+  if (--page->pin_count_ != 0) {
+    return;
+  }
+  size_t frame_id = FrameId(page);
+  if (!retired_[frame_id]) {
+    replacer_->Insert(page);
+    return;
+  }
+  page_id_t page_id = page->page_id_;
+  WaitUntilWritten(lock, page);
+  if (retired_[frame_id] && page->page_id_ == page_id &&
+      page->pin_count_ == 0) {
+    FreeFrame(page);
+    disk_manager_->DeallocatePage(page_id);
+  }
+}
+
+/*
+ * Caller must hold latch_
+ */
+void BufferPoolInstance::ReleaseDropped(Page *page) {
+  assert(page->page_id_ == INVALID_PAGE_ID);
+  if (--page->pin_count_ == 0) {
+    replacer_->Reset(page);
+    free_list_->push_back(page);
+  }
+}
+
+/*
+ * A write-back of page is about to start: changes made from now on get a new
+ * recovery LSN, the current one is kept until FinishWrite.
+ * Caller must hold latch_
+ */
+void BufferPoolInstance::StartWrite(Page *page) {
+  write_rec_lsns_[FrameId(page)] = page->rec_lsn_.exchange(INVALID_LSN);
+}
+
+/*
+ * Caller must hold latch_
+ */
+void BufferPoolInstance::FinishWrite(Page *page) {
+  write_rec_lsns_[FrameId(page)] = INVALID_LSN;
+}
+
+/*
+ * The write-back of page was given up: the page is dirty again, and its
+ * recovery LSN is the one taken off it, older than any set since.
+ * Caller must hold latch_
+ */
+void BufferPoolInstance::CancelWrite(Page *page) {
+  page->is_dirty_ = true;
+  lsn_t rec_lsn = write_rec_lsns_[FrameId(page)];
+  if (rec_lsn != INVALID_LSN) {
+    page->rec_lsn_ = rec_lsn;
+  }
+  write_rec_lsns_[FrameId(page)] = INVALID_LSN;
+}
+
+/*
+ * Copy the content of page under its read latch, so that the copy is one
+ * version of the page rather than a mix of two. Caller must hold a pin on
+ * page or have it flagged in writing_, and must not hold latch_: whoever holds
+ * the page latch may be waiting for latch_.
+ */
+void BufferPoolInstance::CopyPage(Page *page, char *copy) {
+  page->RLatch();
+  memcpy(copy, page->GetData(), page->GetPageSize());
+  page->RUnlatch();
+}
+
+/*
+ * Block until the old content of page_id is no longer being written back by
+ * an eviction. Caller must hold latch_ through lock.
+ */
+void BufferPoolInstance::WaitUntilEvicted(std::unique_lock<std::mutex> &lock,
+                                          page_id_t page_id) {
+  auto evicting = evicting_.find(page_id);
+  if (evicting == evicting_.end()) {
+    return;
+  }
+  Page *frame = evicting->second;
+  frame_cvs_[FrameId(frame)].wait(lock, [&] {
+    return evicting_.find(page_id) == evicting_.end();
+  });
+}
+
+/*
+ * Block until no write-back started by WriteDirtyPages or FlushPage covers the
+ * frame.
+ * Caller must hold latch_ through lock.
+ */
+void BufferPoolInstance::WaitUntilWritten(std::unique_lock<std::mutex> &lock,
+                                          Page *page) {
+  size_t frame_id = FrameId(page);
+  frame_cvs_[frame_id].wait(lock, [&] { return !writing_[frame_id]; });
+}
+} // namespace cmudb
@@ -1,3 +1,7 @@
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+
 #include "buffer/buffer_pool_manager.h"
 
 namespace cmudb {
@@ -5,137 +9,68 @@ namespace cmudb {
 /*
  * BufferPoolManager Constructor
  * When log_manager is nullptr, logging is disabled (for test purpose)
- * WARNING: Do Not Edit This Function
+ * pool_size frames are spread as evenly as possible over num_instances; 0
+ * means one instance per hardware thread, but no fewer than
+ * INSTANCE_MIN_FRAMES frames each
+ * replacer_type picks the eviction policy of every instance
+ * Frames take the page size of disk_manager's file
  */
 BufferPoolManager::BufferPoolManager(size_t pool_size,
                                      DiskManager *disk_manager,
-                                     LogManager *log_manager)
-    : pool_size_(pool_size), disk_manager_(disk_manager),
-      log_manager_(log_manager) {
-  // a consecutive memory space for buffer pool
-  pages_ = new Page[pool_size_];
-  page_table_ = new ExtendibleHash<page_id_t, Page *>(BUCKET_SIZE);
-  replacer_ = new LRUReplacer<Page *>;
-  free_list_ = new std::list<Page *>;
-
-  // put all the pages into free list
-  for (size_t i = 0; i < pool_size_; ++i) {
-    free_list_->push_back(&pages_[i]);
+                                     LogManager *log_manager,
+                                     size_t num_instances,
+                                     ReplacerType replacer_type)
+    : pool_size_(pool_size), page_size_(disk_manager->GetPageSize()),
+      disk_manager_(disk_manager), log_manager_(log_manager),
+      cleaner_thread_(nullptr), cleaner_on_(false) {
+  if (num_instances == 0) {
+    num_instances = std::max<size_t>(
+        std::min<size_t>(std::thread::hardware_concurrency(),
+                         pool_size / INSTANCE_MIN_FRAMES),
+        1);
+  }
+  assert(num_instances <= pool_size);
+  void *frames = nullptr;
+  if (posix_memalign(&frames, FRAME_ALIGNMENT, pool_size_ * page_size_) != 0) {
+    throw std::bad_alloc();
+  }
+  frames_ = static_cast<char *>(frames);
+
+  size_t first_frame = 0;
+  for (size_t i = 0; i < num_instances; ++i) {
+    size_t instance_size = pool_size / num_instances +
+                           (i < pool_size % num_instances ? 1 : 0);
+    instances_.push_back(new BufferPoolInstance(
+        instance_size, frames_ + first_frame * page_size_, disk_manager,
+        log_manager, replacer_type));
+    first_frame += instance_size;
   }
 }
 
 /*
  * BufferPoolManager Deconstructor
- * WARNING: Do Not Edit This Function
  */
 BufferPoolManager::~BufferPoolManager() {
-  delete[] pages_;
-  delete page_table_;
-  delete replacer_;
-  delete free_list_;
+  StopPageCleaner();
+  for (auto instance : instances_) {
+    delete instance;
+  }
+  free(frames_);
 }
 
-/**
- * 1. search hash table.
- *  1.1 if exist, pin the page and return immediately
- *  1.2 if no exist, find a replacement entry from either free list or lru
- *      replacer. (NOTE: always find from free list first)
- * 2. If the entry chosen for replacement is dirty, write it back to disk.
- * 3. Delete the entry for the old page from the hash table and insert an
- * entry for the new page.
- * 4. Update page metadata, read page content from disk file and return page
- * pointer
- */
 Page *BufferPoolManager::FetchPage(page_id_t page_id) {
-  std::lock_guard<std::mutex> guard(latch_);
-
-  Page *page = nullptr;
-  if (page_id == INVALID_PAGE_ID) { return page; }
-
-  if (page_table_->Find(page_id, page)) {
-    replacer_->Erase(page);
-    pin_page(page);
-    return page;
-  }
-
-  if (!free_list_->empty()) {
-    page = *free_list_->begin();
-    free_list_->pop_front();
-    assert(page->pin_count_ == 0);
-    assert(page->page_id_ == INVALID_PAGE_ID);
-    assert(!page->is_dirty_);
-  } else {
-    if (!replacer_->Victim(page)) {
-      return nullptr;
-    }
-    assert(page->pin_count_ == 0);
-    if (page->is_dirty_) {
-      if(page->GetLSN() > log_manager_->GetPersistentLSN()){
-        //flush log record until lsn >= this page's lsn is flushed to disk
-        //if two buffers in log_manager are flushed out but still cannot meet former requirement
-        //there must be something wrong
-        //for now, I think there's no need to add a method in log_manager that
-        //flush records to a given lsn. that will make group fsync less benificial.
-        log_manager_->FlushNowBlocking();
-        assert(page->GetLSN() <= log_manager_->GetPersistentLSN());
-      }
-      disk_manager_->WritePage(page->GetPageId(), page->GetData());
-      page->is_dirty_ = false;
-    }
-    page_table_->Remove(page->GetPageId());
-  }
-
-  disk_manager_->ReadPage(page_id, page->GetData());
-  page_table_->Insert(page_id, page);
-  page->page_id_ = page_id;
-  pin_page(page);
-  assert(page->pin_count_ == 1);
-  assert(!page->is_dirty_);
-  return page;
+  if (page_id == INVALID_PAGE_ID) { return nullptr; }
+  return GetInstance(page_id)->FetchPage(page_id);
 }
 
-/*
- * Implementation of unpin page
- * if pin_count>0, decrement it and if it becomes zero, put it back to
- * replacer if pin_count<=0 before this call, return false. is_dirty: set the
- * dirty flag of this page
- */
 bool BufferPoolManager::UnpinPage(page_id_t page_id, bool is_dirty) {
-  std::lock_guard<std::mutex> guard(latch_);
-
-  Page *page = nullptr;
-  if (!page_table_->Find(page_id, page)) {
-    return false;
-  }
-
-  page->pin_count_--;
-  if (page->pin_count_ == 0) {
-    replacer_->Insert(page);
-  }
-
-  if (is_dirty) {
-    page->is_dirty_ = true;
-  }
-
-  return true;
+  if (page_id == INVALID_PAGE_ID) { return false; }
+  return GetInstance(page_id)->UnpinPage(page_id, is_dirty);
 }
 
-/*
- * Used to flush a particular page of the buffer pool to disk. Should call the
- * write_page method of the disk manager
- * if page is not found in page table, return false
- * NOTE: make sure page_id != INVALID_PAGE_ID
- */
 bool BufferPoolManager::FlushPage(page_id_t page_id) {
-  std::lock_guard<std::mutex> guard(latch_);
-  Page *page = nullptr;
-  if (!page_table_->Find(page_id, page)) {
-    return false;
-  }
-
-  disk_manager_->WritePage(page_id, page->GetData());
-  page->is_dirty_ = false;
-  return true;
+  if (page_id == INVALID_PAGE_ID) { return false; }
+  return GetInstance(page_id)->FlushPage(page_id);
 }
 
 /**
@@ -147,66 +82,160 @@ bool BufferPoolManager::FlushPage(page_id_t page_id) {
  * the page is found within page table, but pin_count != 0, return false
  */
 bool BufferPoolManager::DeletePage(page_id_t page_id) {
-  std::lock_guard<std::mutex> guard(latch_);
-  Page *page = nullptr;
-  auto ret = page_table_->Find(page_id, page);
-  if (ret) {
-    if (page->GetPinCount() != 0) {
-      assert(false);
-      return false;
-    }
-
-    auto erase = replacer_->Erase(page);
-    assert(erase);
-    free_list_->insert(free_list_->end(), page);
-    auto remove = page_table_->Remove(page_id);
-    assert(remove);
-    page->page_id_ = INVALID_PAGE_ID;
-    page->is_dirty_ = false;
-    page->ResetMemory();
+  if (!GetInstance(page_id)->DeletePage(page_id)) {
+    return false;
   }
-
   disk_manager_->DeallocatePage(page_id);
   return true;
 }
 
+/*
+ * A retired page that is still pinned is deleted, and its page id
+ * deallocated, by the instance when its last pin is dropped
+ */
+void BufferPoolManager::RetirePage(page_id_t page_id) {
+  if (GetInstance(page_id)->RetirePage(page_id)) {
+    disk_manager_->DeallocatePage(page_id);
+  }
+}
+
 /**
  * User should call this method if needs to create a new page. This routine
- * will call disk manager to allocate a page.
- * Buffer pool manager should be responsible to choose a victim page either
- * from free list or lru replacer(NOTE: always choose from free list first),
- * update new page's metadata, zero out memory and add corresponding entry
- * into page table. return nullptr if all the pages in pool are pinned
+ * will call disk manager to allocate a page and let the owning instance find
+ * a frame for it. If that instance has all its pages pinned, other page ids
+ * are tried, see NewAllocatedPage; nullptr is returned only if their
+ * instances are full as well
  */
 Page *BufferPoolManager::NewPage(page_id_t &page_id) {
-  std::lock_guard<std::mutex> guard(latch_);
-
-  Page *page = nullptr;
-  if (!free_list_->empty()) {
-    page = *free_list_->begin();
-    free_list_->pop_front();
-    assert(page->pin_count_ == 0);
-    assert(page->page_id_ == INVALID_PAGE_ID);
-    assert(!page->is_dirty_);
-  } else {
-    if (!replacer_->Victim(page)) {
-      return nullptr;
+  return NewAllocatedPage(page_id, disk_manager_->AllocatePage(), false);
+}
+
+Page *BufferPoolManager::NewPage(page_id_t &page_id, page_id_t near) {
+  page_id_t new_page_id = near == INVALID_PAGE_ID
+                              ? disk_manager_->AllocateExtent()
+                              : disk_manager_->AllocatePage(near);
+  return NewAllocatedPage(page_id, new_page_id, true);
+}
+
+/*
+ * Give new_page_id a frame in its instance. While that instance has every
+ * frame pinned, another page id is allocated (in the same extent if
+ * in_extent) and tried, up to one try per instance. The ids passed over are
+ * handed back to disk manager
+ */
+Page *BufferPoolManager::NewAllocatedPage(page_id_t &page_id,
+                                          page_id_t new_page_id,
+                                          bool in_extent) {
+  std::vector<page_id_t> passed_over;
+  Page *page;
+  while ((page = GetInstance(new_page_id)->NewPage(new_page_id)) == nullptr) {
+    passed_over.push_back(new_page_id);
+    if (passed_over.size() == instances_.size()) {
+      break;
     }
-    assert(page->pin_count_ == 0);
-    if (page->is_dirty_) {
-      disk_manager_->WritePage(page->GetPageId(), page->GetData());
-      page->is_dirty_ = false;
+    new_page_id = in_extent ? disk_manager_->AllocatePage(new_page_id)
+                            : disk_manager_->AllocatePage();
+  }
+  for (page_id_t passed_over_id : passed_over) {
+    disk_manager_->DeallocatePage(passed_over_id);
+  }
+  if (page == nullptr) {
+    return nullptr;
+  }
+  page_id = new_page_id;
+  return page;
+}
+
+void BufferPoolManager::PrefetchPage(page_id_t page_id) {
+  if (page_id == INVALID_PAGE_ID) { return; }
+  GetInstance(page_id)->Prefetch({page_id});
+}
+
+/*
+ * Pages first_page_id .. first_page_id + num_pages - 1, one batch of reads
+ * per instance
+ */
+void BufferPoolManager::PrefetchRange(page_id_t first_page_id,
+                                      size_t num_pages) {
+  if (first_page_id == INVALID_PAGE_ID) { return; }
+  std::vector<std::vector<page_id_t>> page_ids(instances_.size());
+  for (size_t i = 0; i < num_pages; ++i) {
+    page_id_t page_id = first_page_id + i;
+    page_ids[page_id % instances_.size()].push_back(page_id);
+  }
+  for (size_t i = 0; i < instances_.size(); ++i) {
+    if (!page_ids[i].empty()) {
+      instances_[i]->Prefetch(page_ids[i]);
     }
-    page_table_->Remove(page->GetPageId());
   }
-  page_id = disk_manager_->AllocatePage();
+}
 
-  page_table_->Insert(page_id, page);
-  page->ResetMemory();
-  page->page_id_ = page_id;
-  page->is_dirty_ = true;
-  pin_page(page);
-  assert(page->pin_count_ == 1);
-  return page;
+/*
+ * The log is forced first, so that (with logging on) no page is held back by
+ * the WAL rule unless it was changed after the call began
+ */
+void BufferPoolManager::FlushAllPages() {
+  if (log_manager_ != nullptr && ENABLE_LOGGING) {
+    log_manager_->FlushNowBlocking();
+  }
+  for (auto instance : instances_) {
+    instance->FlushAllPages();
+  }
+}
+
+DirtyPageTable BufferPoolManager::GetDirtyPageTable() {
+  DirtyPageTable dirty_pages;
+  for (auto instance : instances_) {
+    instance->GetDirtyPages(dirty_pages);
+  }
+  return dirty_pages;
+}
+
+void BufferPoolManager::RunPageCleaner() {
+  std::lock_guard<std::mutex> guard(cleaner_latch_);
+  if (!cleaner_on_) {
+    cleaner_on_ = true;
+    cleaner_thread_ = new std::thread(&BufferPoolManager::CleanPages, this);
+  }
+}
+
+void BufferPoolManager::StopPageCleaner() {
+  {
+    std::lock_guard<std::mutex> guard(cleaner_latch_);
+    if (!cleaner_on_) {
+      return;
+    }
+    cleaner_on_ = false;
+  }
+  cleaner_cv_.notify_all();
+  cleaner_thread_->join();
+  delete cleaner_thread_;
+  cleaner_thread_ = nullptr;
+}
+
+/*
+ * Body of the page cleaner thread: every PAGE_CLEANER_TIMEOUT, let each
+ * instance write its dirty unpinned pages back
+ */
+void BufferPoolManager::CleanPages() {
+  std::unique_lock<std::mutex> lock(cleaner_latch_);
+  while (cleaner_on_) {
+    lock.unlock();
+    for (auto instance : instances_) {
+      instance->CleanPages();
+    }
+    lock.lock();
+    cleaner_cv_.wait_for(lock, PAGE_CLEANER_TIMEOUT,
+                         [&] { return !cleaner_on_; });
+  }
+}
+
+/*
+ * page ids are handed out densely by disk manager, so plain modulo spreads
+ * them evenly over the instances
+ */
+BufferPoolInstance *BufferPoolManager::GetInstance(page_id_t page_id) {
+  assert(page_id != INVALID_PAGE_ID);
+  return instances_[static_cast<size_t>(page_id) % instances_.size()];
 }
 } // namespace cmudb
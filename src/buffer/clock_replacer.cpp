@@ -0,0 +1,92 @@
+/**
+ * CLOCK implementation
+ */
+#include <cassert>
+
+#include "buffer/clock_replacer.h"
+#include "page/page.h"
+
+namespace cmudb {
+
+template<typename T>
+ClockReplacer<T>::ClockReplacer(size_t num_frames, FrameIdFunc frame_id)
+    : num_frames_(num_frames), frame_id_(frame_id), values_(num_frames),
+      size_(0), hand_(0) {
+  flags_ = new std::atomic<uint8_t>[num_frames_];
+  for (size_t i = 0; i < num_frames_; i++) {
+    flags_[i] = 0;
+  }
+}
+
+template<typename T>
+ClockReplacer<T>::~ClockReplacer() { delete[] flags_; }
+
+/*
+ * Make value evictable and mark it as recently referenced
+ */
+template<typename T>
+void ClockReplacer<T>::Insert(const T &value) {
+  size_t frame_id = frame_id_(value);
+  assert(frame_id < num_frames_);
+  // published by the exchange below, read by Victim after it claims the slot
+  values_[frame_id] = value;
+  uint8_t old = flags_[frame_id].exchange(IN_CLOCK | REFERENCED);
+  if (!(old & IN_CLOCK)) {
+    size_++;
+  }
+}
+
+/*
+ * Sweep the hand: referenced frames get their bit cleared and a second
+ * chance, the first unreferenced frame in the clock is the victim. If the
+ * clock is empty, return false
+ */
+template<typename T>
+bool ClockReplacer<T>::Victim(T &value) {
+  std::lock_guard<std::mutex> guard(hand_latch_);
+  while (size_ > 0) {
+    std::atomic<uint8_t> &flag = flags_[hand_];
+    uint8_t cur = flag.load();
+    if (cur & IN_CLOCK) {
+      if (cur & REFERENCED) {
+        // a concurrent Insert/Erase wins, the slot is looked at next round
+        flag.compare_exchange_strong(cur, cur & ~REFERENCED);
+      } else if (flag.compare_exchange_strong(cur, 0)) {
+        value = values_[hand_];
+        size_--;
+        hand_ = (hand_ + 1) % num_frames_;
+        return true;
+      }
+    }
+    hand_ = (hand_ + 1) % num_frames_;
+  }
+  return false;
+}
+
+/*
+ * Remove value from the clock. If removal is successful, return true,
+ * otherwise return false
+ */
+template<typename T>
+bool ClockReplacer<T>::Erase(const T &value) {
+  size_t frame_id = frame_id_(value);
+  assert(frame_id < num_frames_);
+  if (flags_[frame_id].exchange(0) & IN_CLOCK) {
+    size_--;
+    return true;
+  }
+  return false;
+}
+
+template<typename T>
+size_t ClockReplacer<T>::Size() {
+  return size_;
+}
+
+template
+class ClockReplacer<Page *>;
+// test only
+template
+class ClockReplacer<int>;
+
+} // namespace cmudb
@@ -0,0 +1,151 @@
+/**
+ * LRU-K implementation
+ */
+#include <cassert>
+
+#include "buffer/lru_k_replacer.h"
+#include "page/page.h"
+
+namespace cmudb {
+
+template<typename T>
+LRUKReplacer<T>::LRUKReplacer(size_t k, size_t correlated_period)
+    : k_(k), correlated_period_(correlated_period), current_time_(0) {
+  assert(k_ > 0);
+}
+
+template<typename T>
+LRUKReplacer<T>::~LRUKReplacer() {}
+
+/*
+ * Make value evictable. A value that was never accessed through RecordAccess
+ * counts as referenced now
+ */
+template<typename T>
+void LRUKReplacer<T>::Insert(const T &value) {
+  std::lock_guard<std::mutex> guard(mtx_);
+  if (evictable_keys_.find(value) != evictable_keys_.end()) {
+    return;
+  }
+  if (history_.find(value) == history_.end()) {
+    record_access(value);
+  }
+  EvictKey key = evict_key(value);
+  evictable_.insert(key);
+  evictable_keys_[value] = key;
+}
+
+/*
+ * Pop the evictable value with the largest backward K-distance and forget
+ * its history. If nothing is evictable, return false
+ */
+template<typename T>
+bool LRUKReplacer<T>::Victim(T &value) {
+  std::lock_guard<std::mutex> guard(mtx_);
+  if (evictable_.empty()) {
+    return false;
+  }
+  value = std::get<2>(*evictable_.begin());
+  evictable_.erase(evictable_.begin());
+  evictable_keys_.erase(value);
+  history_.erase(value);
+  return true;
+}
+
+/*
+ * Value is pinned: no longer evictable, its history is kept. If removal is
+ * successful, return true, otherwise return false
+ */
+template<typename T>
+bool LRUKReplacer<T>::Erase(const T &value) {
+  std::lock_guard<std::mutex> guard(mtx_);
+  auto iter = evictable_keys_.find(value);
+  if (iter == evictable_keys_.end()) {
+    return false;
+  }
+  evictable_.erase(iter->second);
+  evictable_keys_.erase(iter);
+  return true;
+}
+
+template<typename T>
+size_t LRUKReplacer<T>::Size() {
+  std::lock_guard<std::mutex> guard(mtx_);
+  return evictable_.size();
+}
+
+template<typename T>
+void LRUKReplacer<T>::RecordAccess(const T &value) {
+  std::lock_guard<std::mutex> guard(mtx_);
+  auto iter = evictable_keys_.find(value);
+  if (iter == evictable_keys_.end()) {
+    record_access(value);
+    return;
+  }
+  evictable_.erase(iter->second);
+  record_access(value);
+  iter->second = evict_key(value);
+  evictable_.insert(iter->second);
+}
+
+template<typename T>
+void LRUKReplacer<T>::Reset(const T &value) {
+  std::lock_guard<std::mutex> guard(mtx_);
+  auto iter = evictable_keys_.find(value);
+  if (iter != evictable_keys_.end()) {
+    evictable_.erase(iter->second);
+    evictable_keys_.erase(iter);
+  }
+  history_.erase(value);
+}
+
+/*
+ * Caller must hold mtx_.
+ * A reference within correlated_period_ of the previous one only moves
+ * last_. Otherwise it opens a new uncorrelated reference, and the older ones
+ * are shifted by the length of the correlated period that just closed so it
+ * does not count as distance between references.
+ */
+template<typename T>
+void LRUKReplacer<T>::record_access(const T &value) {
+  size_t now = ++current_time_;
+  auto iter = history_.find(value);
+  if (iter == history_.end()) {
+    History &history = history_[value];
+    history.last_ = now;
+    history.hist_.push_front(now);
+    return;
+  }
+
+  History &history = iter->second;
+  if (now - history.last_ <= correlated_period_) {
+    history.last_ = now;
+    return;
+  }
+  size_t correlated_span = history.last_ - history.hist_.front();
+  for (auto &time : history.hist_) {
+    time += correlated_span;
+  }
+  history.hist_.push_front(now);
+  if (history.hist_.size() > k_) {
+    history.hist_.pop_back();
+  }
+  history.last_ = now;
+}
+
+/*
+ * Caller must hold mtx_. Smaller keys are evicted first.
+ */
+template<typename T>
+typename LRUKReplacer<T>::EvictKey LRUKReplacer<T>::evict_key(const T &value) {
+  History &history = history_[value];
+  return EvictKey(history.hist_.size() >= k_, history.hist_.back(), value);
+}
+
+template
+class LRUKReplacer<Page *>;
+// test only
+template
+class LRUKReplacer<int>;
+
+} // namespace cmudb
@@ -0,0 +1,89 @@
+/**
+ * page_table.cpp
+ */
+#include <cassert>
+
+#include "buffer/page_table.h"
+
+namespace cmudb {
+
+PageTable::PageTable(size_t num_frames) : capacity_(2), shift_(63), size_(0) {
+  while (capacity_ < num_frames * 2) {
+    capacity_ <<= 1;
+    shift_--;
+  }
+  slots_ = new uint64_t[capacity_];
+  for (size_t i = 0; i < capacity_; i++) {
+    slots_[i] = EMPTY_SLOT;
+  }
+}
+
+PageTable::~PageTable() { delete[] slots_; }
+
+size_t PageTable::Probe(page_id_t page_id, uint64_t &slot) const {
+  size_t index = HomeSlot(page_id);
+  while (true) {
+    slot = slots_[index];
+    if (slot == EMPTY_SLOT || SlotPageId(slot) == page_id) {
+      return index;
+    }
+    index = NextSlot(index);
+  }
+}
+
+bool PageTable::Find(page_id_t page_id, size_t &frame_id) const {
+  uint64_t slot;
+  Probe(page_id, slot);
+  if (slot == EMPTY_SLOT) {
+    return false;
+  }
+  frame_id = SlotFrameId(slot);
+  return true;
+}
+
+bool PageTable::Insert(page_id_t page_id, size_t frame_id) {
+  assert(page_id != INVALID_PAGE_ID);
+  uint64_t slot;
+  size_t index = Probe(page_id, slot);
+  if (slot != EMPTY_SLOT) {
+    return false;
+  }
+  assert(size_ + 1 < capacity_);
+  slots_[index] = MakeSlot(page_id, frame_id);
+  size_++;
+  return true;
+}
+
+/*
+ * Backward shift deletion: entries after the hole that may live there (their
+ * home slot is not cyclically between the hole and themselves) are moved back
+ * one by one, so no tombstones are needed and probes stay short.
+ */
+bool PageTable::Remove(page_id_t page_id) {
+  uint64_t slot;
+  size_t hole = Probe(page_id, slot);
+  if (slot == EMPTY_SLOT) {
+    return false;
+  }
+
+  size_t index = hole;
+  while (true) {
+    index = NextSlot(index);
+    uint64_t next = slots_[index];
+    if (next == EMPTY_SLOT) {
+      break;
+    }
+    size_t home = HomeSlot(SlotPageId(next));
+    // distance from home to index vs from hole to index, both cyclic
+    if (((index - home) & (capacity_ - 1)) >=
+        ((index - hole) & (capacity_ - 1))) {
+      slots_[hole] = next;
+      hole = index;
+    }
+  }
+  slots_[hole] = EMPTY_SLOT;
+  size_--;
+  return true;
+}
+
+} // namespace cmudb
@@ -0,0 +1,32 @@
+/**
+ * read_ahead.cpp
+ */
+#include <algorithm>
+
+#include "buffer/read_ahead.h"
+
+namespace cmudb {
+
+void ReadAhead::Advance(page_id_t page_id, page_id_t next_page_id) {
+  if (page_id == current_page_id_) {
+    return;
+  }
+  current_page_id_ = page_id;
+  if (next_page_id == INVALID_PAGE_ID) {
+    return;
+  }
+  if (next_page_id != page_id + 1) {
+    buffer_pool_manager_->PrefetchPage(next_page_id);
+    window_end_ = 0;
+    return;
+  }
+  page_id_t extent_end = (next_page_id / EXTENT_SIZE + 1) * EXTENT_SIZE;
+  page_id_t first = std::max(next_page_id, window_end_);
+  page_id_t end = std::min(next_page_id + PREFETCH_DEPTH, extent_end);
+  if (first < end) {
+    buffer_pool_manager_->PrefetchRange(first, end - first);
+    window_end_ = end;
+  }
+}
+
+} // namespace cmudb
@@ -4,4 +4,10 @@ namespace cmudb {
   std::atomic<bool> ENABLE_LOGGING(false);  // for virtual table
   std::chrono::duration<long long int> LOG_TIMEOUT =
    std::chrono::seconds(1);
+  std::chrono::microseconds GROUP_COMMIT_WINDOW =
+   std::chrono::microseconds(0);
+  std::chrono::milliseconds PAGE_CLEANER_TIMEOUT =
+   std::chrono::milliseconds(100);
+  std::chrono::duration<long long int> CHECKPOINT_TIMEOUT =
+   std::chrono::seconds(30);
 }
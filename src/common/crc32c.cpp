@@ -0,0 +1,62 @@
+/**
+ * crc32c.cpp
+ */
+
+#include "common/crc32c.h"
+
+#include <cstring>
+
+#ifdef __SSE4_2__
+#include <nmmintrin.h>
+#endif
+
+namespace cmudb {
+
+// reflected Castagnoli polynomial
+static const uint32_t CRC32C_POLY = 0x82f63b78;
+
+static const uint32_t *Crc32cTable() {
+  static const struct Table {
+    uint32_t entries[256];
+    Table() {
+      for (uint32_t i = 0; i < 256; i++) {
+        uint32_t crc = i;
+        for (int bit = 0; bit < 8; bit++) {
+          crc = (crc >> 1) ^ ((crc & 1) ? CRC32C_POLY : 0);
+        }
+        entries[i] = crc;
+      }
+    }
+  } table;
+  return table.entries;
+}
+
+uint32_t Crc32cSoftware(const char *data, size_t size, uint32_t crc) {
+  const uint32_t *table = Crc32cTable();
+  crc = ~crc;
+  for (size_t i = 0; i < size; i++) {
+    crc = table[(crc ^ static_cast<uint8_t>(data[i])) & 0xff] ^ (crc >> 8);
+  }
+  return ~crc;
+}
+
+uint32_t Crc32c(const char *data, size_t size, uint32_t crc) {
+#ifdef __SSE4_2__
+  uint64_t crc64 = static_cast<uint32_t>(~crc);
+  size_t i = 0;
+  for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+    uint64_t word;
+    memcpy(&word, data + i, sizeof(uint64_t));
+    crc64 = _mm_crc32_u64(crc64, word);
+  }
+  uint32_t crc32 = static_cast<uint32_t>(crc64);
+  for (; i < size; i++) {
+    crc32 = _mm_crc32_u8(crc32, static_cast<uint8_t>(data[i]));
+  }
+  return ~crc32;
+#else
+  return Crc32cSoftware(data, size, crc);
+#endif
+}
+
+} // namespace cmudb
@@ -15,23 +15,68 @@ void TransactionManager::addLog(Transaction *txn, LogRecordType recordType) {
 }
 void TransactionManager::addLogAndWaitUntilFlushed(Transaction *txn, LogRecordType recordType) {
   addLog(txn, recordType);
-  log_manager_->WaitUntilBgTaskFinish();
+  log_manager_->WaitForLSN(txn->GetPrevLSN());
 }
 
 Transaction *TransactionManager::Begin() {
   Transaction *txn = new Transaction(next_txn_id_++);
 
+  std::lock_guard<std::mutex> guard(active_latch_);
   if (ENABLE_LOGGING) {
     // write log and update transaction's prev_lsn here
     addLog(txn, LogRecordType::BEGIN);
   }
+  active_txns_[txn->GetTransactionId()] =
+      std::make_pair(txn, txn->GetPrevLSN());
 
   return txn;
 }
 
+void TransactionManager::EndTransaction(Transaction *txn,
+                                        LogRecordType recordType) {
+  {
+    std::lock_guard<std::mutex> guard(active_latch_);
+    if (ENABLE_LOGGING) {
+      // write log and update transaction's prev_lsn here
+      addLog(txn, recordType);
+    }
+    active_txns_.erase(txn->GetTransactionId());
+  }
+  // outside active_latch_, so that concurrent commits share one log write
+  if (ENABLE_LOGGING) {
+    log_manager_->WaitForLSN(txn->GetPrevLSN());
+  }
+}
+
+ActiveTxnTable TransactionManager::GetActiveTxnTable() {
+  std::lock_guard<std::mutex> guard(active_latch_);
+  ActiveTxnTable active_txns;
+  for (auto &txn : active_txns_) {
+    active_txns.emplace_back(txn.first, txn.second.first->GetPrevLSN());
+  }
+  return active_txns;
+}
+
+lsn_t TransactionManager::GetOldestBeginLSN() {
+  std::lock_guard<std::mutex> guard(active_latch_);
+  lsn_t oldest = INVALID_LSN;
+  for (auto &txn : active_txns_) {
+    lsn_t begin_lsn = txn.second.second;
+    if (begin_lsn != INVALID_LSN &&
+        (oldest == INVALID_LSN || begin_lsn < oldest)) {
+      oldest = begin_lsn;
+    }
+  }
+  return oldest;
+}
+
 void TransactionManager::Commit(Transaction *txn) {
   txn->SetState(TransactionState::COMMITTED);
-  // truly delete before commit
+  EndTransaction(txn, LogRecordType::COMMIT);
+
+  // truly delete once the COMMIT is on disk: the transaction is never rolled
+  // back from here, so the cleanup is redo only and the freed slots can go to
+  // anyone
   auto write_set = txn->GetWriteSet();
   while (!write_set->empty()) {
     auto &item = write_set->back();
@@ -44,11 +89,6 @@ void TransactionManager::Commit(Transaction *txn) {
   }
   write_set->clear();
 
-  if (ENABLE_LOGGING) {
-    // write log and update transaction's prev_lsn here
-    addLogAndWaitUntilFlushed(txn, LogRecordType::COMMIT);
-  }
-
   // release all the lock
   std::unordered_set<RID> lock_set;
   for (auto item : *txn->GetSharedLockSet())
@@ -68,6 +108,8 @@ void TransactionManager::Abort(Transaction *txn) {
   while (!write_set->empty()) {
     auto &item = write_set->back();
     auto table = item.table_;
+    // the rollback is logged as a CLR, recovery goes on before this write
+    txn->SetUndoNextLSN(item.undo_next_lsn_);
     if (item.wtype_ == WType::DELETE) {
       LOG_DEBUG("rollback delete");
       table->RollbackDelete(item.rid_, txn);
@@ -82,10 +124,7 @@ void TransactionManager::Abort(Transaction *txn) {
   }
   write_set->clear();
 
-  if (ENABLE_LOGGING) {
-    // write log and update transaction's prev_lsn here
-    addLogAndWaitUntilFlushed(txn, LogRecordType::ABORT);
-  }
+  EndTransaction(txn, LogRecordType::ABORT);
 
   // release all the lock
   std::unordered_set<RID> lock_set;
@@ -0,0 +1,343 @@
+/**
+ * async_io.cpp
+ */
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
+
+#include "common/logger.h"
+#include "disk/async_io.h"
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define HAVE_IO_URING 1
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+#endif
+
+namespace cmudb {
+
+bool ReadPageAt(int fd, page_id_t page_id, char *page_data, size_t page_size) {
+  off_t offset = static_cast<off_t>(page_id) * page_size;
+  size_t done = 0;
+  while (done < page_size) {
+    ssize_t n = pread(fd, page_data + done, page_size - done, offset + done);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n < 0) {
+      LOG_DEBUG("I/O error while reading");
+      return false;
+    }
+    if (n == 0) {
+      // end of file, the rest of the page was never written
+      memset(page_data + done, 0, page_size - done);
+      break;
+    }
+    done += n;
+  }
+  return true;
+}
+
+bool WritePageAt(int fd, page_id_t page_id, const char *page_data,
+                 size_t page_size) {
+  off_t offset = static_cast<off_t>(page_id) * page_size;
+  size_t done = 0;
+  while (done < page_size) {
+    ssize_t n = pwrite(fd, page_data + done, page_size - done, offset + done);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      LOG_DEBUG("I/O error while writing");
+      return false;
+    }
+    done += n;
+  }
+  return true;
+}
+
+/*****************************************************************************
+ * THREAD POOL
+ *****************************************************************************/
+ThreadPoolIO::ThreadPoolIO(int fd, size_t page_size, size_t num_threads)
+    : fd_(fd), page_size_(page_size), shutdown_(false) {
+  for (size_t i = 0; i < num_threads; i++) {
+    workers_.push_back(std::thread(&ThreadPoolIO::Work, this));
+  }
+}
+
+/*
+ * Requests already queued are still carried out before the workers exit
+ */
+ThreadPoolIO::~ThreadPoolIO() {
+  {
+    std::lock_guard<std::mutex> guard(latch_);
+    shutdown_ = true;
+  }
+  cv_.notify_all();
+  for (auto &worker : workers_) {
+    worker.join();
+  }
+}
+
+void ThreadPoolIO::Submit(std::vector<DiskRequest> &requests) {
+  {
+    std::lock_guard<std::mutex> guard(latch_);
+    for (auto &request : requests) {
+      queue_.push_back(request);
+    }
+  }
+  cv_.notify_all();
+}
+
+void ThreadPoolIO::Work() {
+  while (true) {
+    DiskRequest request;
+    {
+      std::unique_lock<std::mutex> lock(latch_);
+      cv_.wait(lock, [&] { return shutdown_ || !queue_.empty(); });
+      if (queue_.empty()) {
+        return;
+      }
+      request = queue_.front();
+      queue_.pop_front();
+    }
+    bool ok = request.is_write
+                  ? WritePageAt(fd_, request.page_id, request.data, page_size_)
+                  : ReadPageAt(fd_, request.page_id, request.data, page_size_);
+    if (request.callback) {
+      request.callback(ok);
+    }
+  }
+}
+
+/*****************************************************************************
+ * IO_URING
+ *****************************************************************************/
+#ifdef HAVE_IO_URING
+
+// a NOP carrying this tag tells the reaper to exit
+static const uint64_t SHUTDOWN_TAG = 0;
+
+/*
+ * Set up the rings with raw system calls (no liburing). Returns nullptr if
+ * the kernel has no io_uring, forbids it, or predates IORING_OP_READ/WRITE.
+ */
+IoUringIO *IoUringIO::Create(int fd, size_t page_size, unsigned entries) {
+  io_uring_params params;
+  memset(&params, 0, sizeof(params));
+  int ring_fd = syscall(__NR_io_uring_setup, entries, &params);
+  if (ring_fd < 0) {
+    LOG_DEBUG("io_uring unavailable: %s", strerror(errno));
+    return nullptr;
+  }
+  // IORING_FEAT_RW_CUR_POS came with IORING_OP_READ/WRITE in 5.6
+  if (!(params.features & IORING_FEAT_RW_CUR_POS)) {
+    close(ring_fd);
+    return nullptr;
+  }
+
+  IoUringIO *io = new IoUringIO();
+  io->fd_ = fd;
+  io->page_size_ = page_size;
+  io->ring_fd_ = ring_fd;
+  io->sq_entries_ = params.sq_entries;
+  io->in_flight_ = 0;
+  io->sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  io->cq_ring_size_ =
+      params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+  bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+  if (single_mmap) {
+    io->sq_ring_size_ = std::max(io->sq_ring_size_, io->cq_ring_size_);
+  }
+  io->sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+
+  io->sq_ring_ = mmap(nullptr, io->sq_ring_size_, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQ_RING);
+  io->cq_ring_ = single_mmap ? io->sq_ring_
+                             : mmap(nullptr, io->cq_ring_size_,
+                                    PROT_READ | PROT_WRITE,
+                                    MAP_SHARED | MAP_POPULATE, ring_fd,
+                                    IORING_OFF_CQ_RING);
+  io->sqes_ = mmap(nullptr, io->sqes_size_, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQES);
+  if (io->sq_ring_ == MAP_FAILED || io->cq_ring_ == MAP_FAILED ||
+      io->sqes_ == MAP_FAILED) {
+    LOG_DEBUG("io_uring mmap failed: %s", strerror(errno));
+    if (io->sq_ring_ != MAP_FAILED) {
+      munmap(io->sq_ring_, io->sq_ring_size_);
+    }
+    if (!single_mmap && io->cq_ring_ != MAP_FAILED) {
+      munmap(io->cq_ring_, io->cq_ring_size_);
+    }
+    if (io->sqes_ != MAP_FAILED) {
+      munmap(io->sqes_, io->sqes_size_);
+    }
+    close(ring_fd);
+    delete io;
+    return nullptr;
+  }
+
+  char *sq = static_cast<char *>(io->sq_ring_);
+  io->sq_tail_ = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+  io->sq_mask_ = reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+  io->sq_array_ = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+  char *cq = static_cast<char *>(io->cq_ring_);
+  io->cq_head_ = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+  io->cq_tail_ = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+  io->cq_mask_ = reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+  io->cqes_ = cq + params.cq_off.cqes;
+
+  io->reaper_ = std::thread(&IoUringIO::Reap, io);
+  return io;
+}
+
+/*
+ * The shutdown NOP completes after every request submitted before it, the
+ * reaper drains those first
+ */
+IoUringIO::~IoUringIO() {
+  {
+    std::unique_lock<std::mutex> lock(submit_latch_);
+    slots_cv_.wait(lock, [&] { return in_flight_ < sq_entries_; });
+    unsigned tail = *sq_tail_;
+    unsigned index = tail & *sq_mask_;
+    io_uring_sqe *sqe = static_cast<io_uring_sqe *>(sqes_) + index;
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = IORING_OP_NOP;
+    sqe->flags = IOSQE_IO_DRAIN;
+    sqe->user_data = SHUTDOWN_TAG;
+    sq_array_[index] = index;
+    __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+    in_flight_++;
+    Enter(1);
+  }
+  reaper_.join();
+
+  munmap(sqes_, sqes_size_);
+  if (cq_ring_ != sq_ring_) {
+    munmap(cq_ring_, cq_ring_size_);
+  }
+  munmap(sq_ring_, sq_ring_size_);
+  close(ring_fd_);
+}
+
+void IoUringIO::Enter(unsigned to_submit) {
+  while (to_submit > 0) {
+    int ret = syscall(__NR_io_uring_enter, ring_fd_, to_submit, 0, 0,
+                      nullptr, 0);
+    if (ret < 0) {
+      if (errno == EINTR || errno == EAGAIN || errno == EBUSY) {
+        continue;
+      }
+      LOG_DEBUG("io_uring_enter failed: %s", strerror(errno));
+      assert(false);
+      return;
+    }
+    to_submit -= ret;
+  }
+}
+
+/*
+ * Queue every request on the submission ring and hand them to the kernel in
+ * as few io_uring_enter calls as the ring size allows. At most sq_entries_
+ * requests are in flight, so the completion ring (twice as large) never
+ * overflows.
+ */
+void IoUringIO::Submit(std::vector<DiskRequest> &requests) {
+  std::unique_lock<std::mutex> lock(submit_latch_);
+  unsigned pending = 0;
+  for (auto &request : requests) {
+    if (in_flight_ == sq_entries_) {
+      Enter(pending);
+      pending = 0;
+      slots_cv_.wait(lock, [&] { return in_flight_ < sq_entries_; });
+    }
+    unsigned tail = *sq_tail_;
+    unsigned index = tail & *sq_mask_;
+    io_uring_sqe *sqe = static_cast<io_uring_sqe *>(sqes_) + index;
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = request.is_write ? IORING_OP_WRITE : IORING_OP_READ;
+    sqe->fd = fd_;
+    sqe->addr = reinterpret_cast<uint64_t>(request.data);
+    sqe->len = page_size_;
+    sqe->off = static_cast<uint64_t>(request.page_id) * page_size_;
+    // released by the reaper
+    sqe->user_data = reinterpret_cast<uint64_t>(new DiskRequest(request));
+    sq_array_[index] = index;
+    __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+    in_flight_++;
+    pending++;
+  }
+  Enter(pending);
+}
+
+void IoUringIO::Reap() {
+  while (true) {
+    int ret = syscall(__NR_io_uring_enter, ring_fd_, 0, 1,
+                      IORING_ENTER_GETEVENTS, nullptr, 0);
+    if (ret < 0 && errno != EINTR) {
+      LOG_DEBUG("io_uring_enter failed: %s", strerror(errno));
+      assert(false);
+      return;
+    }
+
+    bool shutdown = false;
+    unsigned completed = 0;
+    unsigned head = *cq_head_;
+    while (head != __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE)) {
+      io_uring_cqe *cqe =
+          static_cast<io_uring_cqe *>(cqes_) + (head & *cq_mask_);
+      if (cqe->user_data == SHUTDOWN_TAG) {
+        shutdown = true;
+      } else {
+        DiskRequest *request = reinterpret_cast<DiskRequest *>(cqe->user_data);
+        bool ok = cqe->res == static_cast<int>(page_size_);
+        if (!request->is_write && cqe->res >= 0 &&
+            cqe->res < static_cast<int>(page_size_)) {
+          // read past the end of the file
+          memset(request->data + cqe->res, 0, page_size_ - cqe->res);
+          ok = true;
+        }
+        if (!ok) {
+          LOG_DEBUG("I/O error on page %d: %d", request->page_id, cqe->res);
+        }
+        if (request->callback) {
+          request->callback(ok);
+        }
+        delete request;
+      }
+      head++;
+      completed++;
+      __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+    }
+
+    if (completed > 0) {
+      {
+        std::lock_guard<std::mutex> guard(submit_latch_);
+        in_flight_ -= completed;
+      }
+      slots_cv_.notify_all();
+    }
+    if (shutdown) {
+      return;
+    }
+  }
+}
+
+#else
+
+IoUringIO *IoUringIO::Create(int fd, size_t page_size, unsigned entries) { return nullptr; }
+IoUringIO::~IoUringIO() {}
+void IoUringIO::Submit(std::vector<DiskRequest> &requests) {}
+void IoUringIO::Reap() {}
+void IoUringIO::Enter(unsigned to_submit) {}
+
+#endif
+
+} // namespace cmudb
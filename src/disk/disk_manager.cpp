@@ -1,113 +1,417 @@
 /**
  * disk_manager.cpp
  */
+#include <algorithm>
 #include <assert.h>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
 #include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
 #include <iostream>
+#include <memory>
+#include <new>
 #include <sys/stat.h>
 #include <thread>
+#include <unistd.h>
 
+#include "common/crc32c.h"
 #include "common/logger.h"
 #include "disk/disk_manager.h"
+#include "page/header_page.h"
 
 namespace cmudb {
 
-static char *buffer_used = nullptr;
+static_assert(MIN_PAGE_SIZE % DIRECT_IO_ALIGNMENT == 0,
+              "O_DIRECT needs whole sectors per page");
+static_assert((MIN_PAGE_SIZE * 8) % EXTENT_SIZE == 0,
+              "an extent must not straddle a bitmap page");
+
+static bool IsValidPageSize(size_t page_size) {
+  return page_size >= MIN_PAGE_SIZE && page_size <= MAX_PAGE_SIZE &&
+         (page_size & (page_size - 1)) == 0;
+}
+
+// aligned scratch buffer of at least size bytes for synchronous I/O on
+// unaligned buffers
+static char *BouncePage(size_t size) {
+  static thread_local std::unique_ptr<char, decltype(&free)> page(
+      nullptr, &free);
+  static thread_local size_t capacity = 0;
+  if (capacity < size) {
+    void *p = nullptr;
+    if (posix_memalign(&p, DIRECT_IO_ALIGNMENT, size) != 0) {
+      throw std::bad_alloc();
+    }
+    page.reset(static_cast<char *>(p));
+    capacity = size;
+  }
+  return page.get();
+}
 
 /**
  * Constructor: open/create a single database file & log file
  * @input db_file: database file name
+ * @input page_size: page size if the file is new; an existing file keeps the
+ * page size recorded in its header page
+ * @input log_segment_size: bytes per log segment file
  */
-DiskManager::DiskManager(const std::string &db_file)
-    : file_name_(db_file), next_page_id_(0), num_flushes_(0), flush_log_(false),
-      flush_log_f_(nullptr) {
+DiskManager::DiskManager(const std::string &db_file, AsyncIOType async_io_type,
+                         bool direct_io, size_t page_size,
+                         size_t log_segment_size)
+    : log_segment_size_(log_segment_size), log_segment_(-1),
+      first_log_segment_(0), log_size_(0), db_fd_(-1), direct_io_(false),
+      page_size_(page_size), file_name_(db_file),
+      async_io_type_(async_io_type),
+      async_io_(nullptr), next_page_id_(0), free_hint_(0),
+      free_extent_hint_(0), num_flushes_(0),
+      flush_log_(false),
+      flush_log_f_(nullptr), buffer_used_(nullptr) {
   std::string::size_type n = file_name_.find(".");
   if (n == std::string::npos) {
     LOG_DEBUG("wrong file format");
     return;
   }
   log_name_ = file_name_.substr(0, n) + ".log";
+  LoadLogSegments();
+
+  if (direct_io) {
+    db_fd_ = OpenDbFile(true);
+    direct_io_ = db_fd_ >= 0;
+    if (!direct_io_) {
+      LOG_DEBUG("O_DIRECT not supported for %s, using buffered I/O",
+                db_file.c_str());
+    }
+  }
+  if (db_fd_ < 0) {
+    db_fd_ = OpenDbFile(false);
+  }
+  if (db_fd_ < 0) {
+    LOG_DEBUG("can't open db file %s", db_file.c_str());
+    return;
+  }
+  LoadPageSize();
+  LoadBitmaps();
+}
 
-  log_io_.open(log_name_,
-               std::ios::binary | std::ios::in | std::ios::app | std::ios::out);
-  // directory or file does not exist
-  if (!log_io_.is_open()) {
-    log_io_.clear();
-    // create a new file
-    log_io_.open(log_name_, std::ios::binary | std::ios::trunc | std::ios::app |
-                                std::ios::out);
-    log_io_.close();
-    // reopen with original mode
-    log_io_.open(log_name_, std::ios::binary | std::ios::in | std::ios::app |
-                                std::ios::out);
-  }
-
-  db_io_.open(db_file,
-              std::ios::binary | std::ios::in | std::ios::out | std::ios::out);
-  // directory or file does not exist
-  if (!db_io_.is_open()) {
-    db_io_.clear();
-    // create a new file
-    db_io_.open(db_file, std::ios::binary | std::ios::trunc | std::ios::out);
-    db_io_.close();
-    // reopen with original mode
-    db_io_.open(db_file, std::ios::binary | std::ios::in | std::ios::out);
+/*
+ * Take the page size from the header page if the file has one. Page 0 starts
+ * at offset 0 whatever the page size, so its first sector tells.
+ */
+void DiskManager::LoadPageSize() {
+  assert(IsValidPageSize(page_size_));
+  char *prefix = BouncePage(MIN_PAGE_SIZE);
+  ssize_t n = pread(db_fd_, prefix, MIN_PAGE_SIZE, 0);
+  size_t page_size;
+  if (n < static_cast<ssize_t>(HeaderPage::PREFIX_SIZE) ||
+      !HeaderPage::ReadPageSize(prefix, page_size)) {
+    return;
+  }
+  if (!IsValidPageSize(page_size)) {
+    LOG_DEBUG("bad page size %zu in %s", page_size, file_name_.c_str());
+    return;
   }
+  if (page_size != page_size_) {
+    LOG_DEBUG("%s has %zu byte pages", file_name_.c_str(), page_size);
+    page_size_ = page_size;
+  }
+}
+
+std::string DiskManager::LogSegmentName(int segment) const {
+  return segment == 0 ? log_name_ : log_name_ + "." + std::to_string(segment);
+}
+
+/*
+ * Find the segments of the log in its directory: the lowest one is where the
+ * log starts, the highest one (and its size) where it ends. A new log starts
+ * with an empty segment 0.
+ */
+void DiskManager::LoadLogSegments() {
+  std::string::size_type slash = log_name_.rfind('/');
+  std::string dir =
+      slash == std::string::npos ? "." : log_name_.substr(0, slash + 1);
+  std::string base =
+      slash == std::string::npos ? log_name_ : log_name_.substr(slash + 1);
+  int first = -1, last = -1;
+  if (DIR *d = opendir(dir.c_str())) {
+    while (struct dirent *entry = readdir(d)) {
+      std::string name = entry->d_name;
+      int segment = -1;
+      if (name == base) {
+        segment = 0;
+      } else if (name.size() > base.size() + 1 &&
+                 name.compare(0, base.size() + 1, base + ".") == 0 &&
+                 name.find_first_not_of("0123456789", base.size() + 1) ==
+                     std::string::npos) {
+        segment = std::atoi(name.c_str() + base.size() + 1);
+      }
+      if (segment >= 0) {
+        first = first < 0 ? segment : std::min(first, segment);
+        last = std::max(last, segment);
+      }
+    }
+    closedir(d);
+  }
+  if (last < 0) {
+    first = last = 0;
+  }
+  first_log_segment_ = first;
+  OpenLogSegment(last);
+  log_size_ = last * static_cast<int64_t>(log_segment_size_) +
+              std::max(GetFileSize(LogSegmentName(last)), 0);
+}
+
+/*
+ * Point log_fd_ at the end of segment, creating the file if needed
+ */
+void DiskManager::OpenLogSegment(int segment) {
+  if (log_fd_ >= 0) {
+    close(log_fd_);
+  }
+  log_fd_ = open(LogSegmentName(segment).c_str(),
+                 O_WRONLY | O_APPEND | O_CREAT, 0644);
+  if (log_fd_ < 0) {
+    LOG_DEBUG("can't open log segment %d", segment);
+  }
+  log_segment_ = segment;
+}
+
+/*
+ * Open the db file, with O_DIRECT if asked to. Some file systems (tmpfs)
+ * reject O_DIRECT at open, others only on the first transfer or for sectors
+ * bigger than DIRECT_IO_ALIGNMENT, so a direct open is probed with one read.
+ * @return: -1 if the file can't be opened that way
+ */
+int DiskManager::OpenDbFile(bool direct_io) {
+  if (!direct_io) {
+    return open(file_name_.c_str(), O_RDWR | O_CREAT, 0644);
+  }
+#ifdef O_DIRECT
+  int fd = open(file_name_.c_str(), O_RDWR | O_CREAT | O_DIRECT, 0644);
+  if (fd < 0) {
+    return -1;
+  }
+  char *probe = BouncePage(DIRECT_IO_ALIGNMENT);
+  if (pread(fd, probe, DIRECT_IO_ALIGNMENT, 0) < 0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+#else
+  return -1;
+#endif
+}
+
+/*
+ * O_DIRECT transfers need a buffer aligned to the sector size
+ */
+bool DiskManager::NeedsBounce(const char *page_data) const {
+  return direct_io_ &&
+         reinterpret_cast<uintptr_t>(page_data) % DIRECT_IO_ALIGNMENT != 0;
 }
 
 DiskManager::~DiskManager() {
-  db_io_.close();
-  log_io_.close();
+  // finishes the requests still in flight
+  delete async_io_;
+  for (auto bitmap : bitmaps_) {
+    free(bitmap);
+  }
+  if (db_fd_ >= 0) {
+    close(db_fd_);
+  }
+  if (log_fd_ >= 0) {
+    close(log_fd_);
+  }
+}
+
+/*
+ * The checksum covers the page up to its trailer
+ */
+static void SetPageChecksum(char *page_data, size_t page_size) {
+  uint32_t crc = Crc32c(page_data, page_size - PAGE_CHECKSUM_SIZE);
+  memcpy(page_data + page_size - PAGE_CHECKSUM_SIZE, &crc, PAGE_CHECKSUM_SIZE);
+}
+
+static bool PageChecksumOk(const char *page_data, size_t page_size) {
+  uint32_t crc;
+  memcpy(&crc, page_data + page_size - PAGE_CHECKSUM_SIZE, PAGE_CHECKSUM_SIZE);
+  if (crc == Crc32c(page_data, page_size - PAGE_CHECKSUM_SIZE)) {
+    return true;
+  }
+  // never written
+  return crc == 0 && std::all_of(page_data, page_data + page_size,
+                                 [](char c) { return c == 0; });
 }
 
 /**
  * Write the contents of the specified page into disk file
+ * The checksum goes into a copy of the page, which is what gets written: the
+ * bytes on disk are the bytes it covers, whatever happens to page_data
  */
 void DiskManager::WritePage(page_id_t page_id, const char *page_data) {
-  size_t offset = page_id * PAGE_SIZE;
-  // set write cursor to offset
-  db_io_.seekp(offset);
-  db_io_.write(page_data, PAGE_SIZE);
-  // check for I/O error
-  if (db_io_.bad()) {
-    LOG_DEBUG("I/O error while writing");
-    return;
-  }
-  // needs to flush to keep disk file in sync
-  db_io_.flush();
+  char *copy = BouncePage(page_size_);
+  memcpy(copy, page_data, page_size_);
+  SetPageChecksum(copy, page_size_);
+  WritePageAt(db_fd_, PhysicalPageId(page_id), copy, page_size_);
 }
 
 /**
  * Read the contents of the specified page into the given memory area
+ * A page past the end of the file reads as zeros
  */
-void DiskManager::ReadPage(page_id_t page_id, char *page_data) {
-  int offset = page_id * PAGE_SIZE;
-  // check if read beyond file length
-  if (offset > GetFileSize(file_name_)) {
-    LOG_DEBUG("I/O error while reading");
-    // std::cerr << "I/O error while reading" << std::endl;
+bool DiskManager::ReadPage(page_id_t page_id, char *page_data) {
+  if (NeedsBounce(page_data)) {
+    char *bounce = BouncePage(page_size_);
+    ReadPageAt(db_fd_, PhysicalPageId(page_id), bounce, page_size_);
+    memcpy(page_data, bounce, page_size_);
   } else {
-    // set read cursor to offset
-    db_io_.seekp(offset);
-    db_io_.read(page_data, PAGE_SIZE);
-    // if file ends before reading PAGE_SIZE
-    int read_count = db_io_.gcount();
-    if (read_count < PAGE_SIZE) {
-      LOG_DEBUG("Read less than a page");
-      // std::cerr << "Read less than a page" << std::endl;
-      memset(page_data + read_count, 0, PAGE_SIZE - read_count);
+    ReadPageAt(db_fd_, PhysicalPageId(page_id), page_data, page_size_);
+  }
+  if (!PageChecksumOk(page_data, page_size_)) {
+    LOG_DEBUG("checksum mismatch in page %d", page_id);
+    return false;
+  }
+  return true;
+}
+
+std::future<bool> DiskManager::WritePageAsync(page_id_t page_id,
+                                              char *page_data) {
+  auto promise = std::make_shared<std::promise<bool>>();
+  std::future<bool> future = promise->get_future();
+  std::vector<DiskRequest> requests{
+      DiskRequest{true, page_id, page_data,
+                  [promise](bool ok) { promise->set_value(ok); }}};
+  Submit(requests);
+  return future;
+}
+
+std::future<bool> DiskManager::ReadPageAsync(page_id_t page_id,
+                                             char *page_data) {
+  auto promise = std::make_shared<std::promise<bool>>();
+  std::future<bool> future = promise->get_future();
+  std::vector<DiskRequest> requests{
+      DiskRequest{false, page_id, page_data,
+                  [promise](bool ok) { promise->set_value(ok); }}};
+  Submit(requests);
+  return future;
+}
+
+std::future<void> DiskManager::SubmitBatch(std::vector<DiskRequest> requests) {
+  auto promise = std::make_shared<std::promise<void>>();
+  std::future<void> future = promise->get_future();
+  if (requests.empty()) {
+    promise->set_value();
+    return future;
+  }
+  auto remaining = std::make_shared<std::atomic<size_t>>(requests.size());
+  for (auto &request : requests) {
+    auto callback = request.callback;
+    request.callback = [callback, remaining, promise](bool ok) {
+      if (callback) {
+        callback(ok);
+      }
+      if (--*remaining == 0) {
+        promise->set_value();
+      }
+    };
+  }
+  Submit(requests);
+  return future;
+}
+
+/*
+ * Hand requests to the backend, addressed by file position. A write goes out
+ * from an aligned copy of its page taken here, with the checksum stamped into
+ * the copy, so the caller's page may change while the write is in flight. A
+ * read fails if its checksum does not match; in direct mode an unaligned read
+ * goes through an aligned bounce page. Copy and bounce page are freed by the
+ * request's callback, which also copies a bounced read out.
+ */
+void DiskManager::Submit(std::vector<DiskRequest> &requests) {
+  for (auto &request : requests) {
+    char *data = request.data;
+    size_t page_size = page_size_;
+    auto callback = request.callback;
+    request.page_id = PhysicalPageId(request.page_id);
+    if (!request.is_write) {
+      request.callback = [data, page_size, callback](bool ok) {
+        ok = ok && PageChecksumOk(data, page_size);
+        if (callback) {
+          callback(ok);
+        }
+      };
+      if (!NeedsBounce(data)) {
+        continue;
+      }
+      callback = request.callback;
+    }
+    void *p = nullptr;
+    if (posix_memalign(&p, DIRECT_IO_ALIGNMENT, page_size_) != 0) {
+      throw std::bad_alloc();
     }
+    char *copy = static_cast<char *>(p);
+    bool is_write = request.is_write;
+    if (is_write) {
+      memcpy(copy, data, page_size);
+      SetPageChecksum(copy, page_size);
+    }
+    request.data = copy;
+    request.callback = [copy, data, is_write, page_size, callback](bool ok) {
+      if (!is_write) {
+        memcpy(data, copy, page_size);
+      }
+      free(copy);
+      if (callback) {
+        callback(ok);
+      }
+    };
   }
+  GetAsyncIO()->Submit(requests);
+}
+
+AsyncIOType DiskManager::GetAsyncIOType() { return GetAsyncIO()->GetType(); }
+
+/**
+ * Start the asynchronous backend: io_uring unless the thread pool was asked
+ * for, and the thread pool if io_uring cannot be set up
+ */
+AsyncIO *DiskManager::GetAsyncIO() {
+  std::call_once(async_io_init_, [&] {
+    if (async_io_type_ != AsyncIOType::THREAD_POOL) {
+      async_io_ = IoUringIO::Create(db_fd_, page_size_, ASYNC_IO_DEPTH);
+    }
+    if (async_io_ == nullptr) {
+      async_io_ = new ThreadPoolIO(db_fd_, page_size_, ASYNC_IO_THREADS);
+    }
+  });
+  return async_io_;
+}
+
+/*
+ * Writes return once the kernel has the page, which may still only be in the
+ * OS page cache (or, with O_DIRECT, the drive's); this is what makes them
+ * durable
+ */
+bool DiskManager::SyncData() {
+  if (fdatasync(db_fd_) != 0) {
+    LOG_DEBUG("I/O error while syncing db file");
+    return false;
+  }
+  return true;
 }
 
 /**
  * Write the contents of the log into disk file
- * Only return when sync is done, and only perform sequence write
+ * Only return when sync is done, and only perform sequence write: each
+ * segment written to is fdatasync'ed once, so one buffer costs one sync
+ * unless it straddles two segments
  */
 void DiskManager::WriteLog(char *log_data, int size) {
   // enforce swap log buffer
-  assert(log_data != buffer_used);
-  buffer_used = log_data;
+  assert(log_data != buffer_used_);
+  buffer_used_ = log_data;
 
   if (size == 0) // no effect on num_flushes_ if log buffer is empty
     return;
@@ -120,54 +424,333 @@ void DiskManager::WriteLog(char *log_data, int size) {
            std::future_status::ready);
 
   num_flushes_ += 1;
-  // sequence write
-  log_io_.write(log_data, size);
-
-  // check for I/O error
-  if (log_io_.bad()) {
-    LOG_DEBUG("I/O error while writing log");
-    return;
+  std::lock_guard<std::mutex> guard(log_latch_);
+  // sequence write, moving on to the next segment where one is full
+  while (size > 0) {
+    int64_t segment_size = static_cast<int64_t>(log_segment_size_);
+    int segment = static_cast<int>(log_size_ / segment_size);
+    if (segment != log_segment_) {
+      OpenLogSegment(segment);
+    }
+    int chunk = static_cast<int>(
+        std::min<int64_t>(size, (segment + 1) * segment_size - log_size_));
+    for (int done = 0; done < chunk;) {
+      ssize_t written = write(log_fd_, log_data + done, chunk - done);
+      // check for I/O error
+      if (written < 0 && errno != EINTR) {
+        LOG_DEBUG("I/O error while writing log");
+        return;
+      }
+      done += std::max<ssize_t>(written, 0);
+    }
+    // the records are only durable once the segment is synced
+    auto start = std::chrono::steady_clock::now();
+    if (fdatasync(log_fd_) != 0) {
+      LOG_DEBUG("I/O error while syncing log");
+      return;
+    }
+    log_sync_time_ += std::chrono::steady_clock::now() - start;
+    log_data += chunk;
+    size -= chunk;
+    log_size_ += chunk;
   }
-  // needs to flush to keep disk file in sync
-  log_io_.flush();
   flush_log_ = false;
 }
 
 /**
  * Read the contents of the log into the given memory area
  * Always read from the beginning and perform sequence read
- * @return: false means already reach the end
+ * The read goes on into the following segments, past the end of the log the
+ * area is zero filled
+ * @return: false means already reach the end, or offset has been truncated
  */
-bool DiskManager::ReadLog(char *log_data, int size, int offset) {
-  if (offset >= GetFileSize(log_name_)) {
+bool DiskManager::ReadLog(char *log_data, int size, int64_t offset) {
+  std::lock_guard<std::mutex> guard(log_latch_);
+  int64_t segment_size = static_cast<int64_t>(log_segment_size_);
+  if (offset >= log_size_ || offset < first_log_segment_ * segment_size) {
     // LOG_DEBUG("end of log file");
-    // LOG_DEBUG("file size is %d", GetFileSize(log_name_));
     return false;
   }
-  log_io_.seekp(offset);
-  log_io_.read(log_data, size);
-  // if log file ends before reading "size"
-  int read_count = log_io_.gcount();
+  int read_count = 0;
+  while (read_count < size && offset < log_size_) {
+    int segment = static_cast<int>(offset / segment_size);
+    int chunk = static_cast<int>(std::min<int64_t>(
+        size - read_count, (segment + 1) * segment_size - offset));
+    std::ifstream segment_io(LogSegmentName(segment), std::ios::binary);
+    segment_io.seekg(offset - segment * segment_size);
+    segment_io.read(log_data + read_count, chunk);
+    // if the segment ends before reading "chunk"
+    int count = static_cast<int>(segment_io.gcount());
+    read_count += count;
+    offset += count;
+    if (count < chunk) {
+      break;
+    }
+  }
   if (read_count < size) {
-    log_io_.clear();
     memset(log_data + read_count, 0, size - read_count);
   }
 
   return true;
 }
 
+int64_t DiskManager::GetLogSize() {
+  std::lock_guard<std::mutex> guard(log_latch_);
+  return log_size_;
+}
+
+int64_t DiskManager::GetLogStart() {
+  std::lock_guard<std::mutex> guard(log_latch_);
+  return first_log_segment_ * static_cast<int64_t>(log_segment_size_);
+}
+
+/*
+ * Segments are deleted oldest first, never the one being written
+ */
+void DiskManager::TruncateLog(int64_t offset) {
+  std::lock_guard<std::mutex> guard(log_latch_);
+  int64_t segment_size = static_cast<int64_t>(log_segment_size_);
+  int end = static_cast<int>(std::min(offset, log_size_) / segment_size);
+  while (first_log_segment_ < end && first_log_segment_ < log_segment_) {
+    if (remove(LogSegmentName(first_log_segment_).c_str()) != 0) {
+      LOG_DEBUG("can't remove log segment %d", first_log_segment_);
+      return;
+    }
+    first_log_segment_++;
+  }
+}
+
+/*
+ * Later segments are deleted, the one holding offset is shortened and written
+ * from there on
+ */
+void DiskManager::CutLog(int64_t offset) {
+  std::lock_guard<std::mutex> guard(log_latch_);
+  int64_t segment_size = static_cast<int64_t>(log_segment_size_);
+  if (offset >= log_size_ || offset < first_log_segment_ * segment_size) {
+    return;
+  }
+  int segment = static_cast<int>(offset / segment_size);
+  int last = static_cast<int>((log_size_ - 1) / segment_size);
+  for (int s = last; s > segment; s--) {
+    if (remove(LogSegmentName(s).c_str()) != 0) {
+      LOG_DEBUG("can't remove log segment %d", s);
+    }
+  }
+  if (truncate(LogSegmentName(segment).c_str(),
+               offset - segment * segment_size) != 0) {
+    LOG_DEBUG("can't truncate log segment %d", segment);
+  }
+  log_size_ = offset;
+  OpenLogSegment(segment);
+}
+
 /**
  * Allocate new page (operations like create index/table)
- * For now just keep an increasing counter
+ * Take the lowest free page outside reserved extents, so freed pages are
+ * reused and the file stays dense, and only grow the file when there is none
  */
-page_id_t DiskManager::AllocatePage() { return next_page_id_++; }
+page_id_t DiskManager::AllocatePage() {
+  std::lock_guard<std::mutex> guard(alloc_latch_);
+  page_id_t page_id = free_hint_;
+  while (true) {
+    if (IsReserved(page_id)) {
+      page_id = (page_id / EXTENT_SIZE + 1) * EXTENT_SIZE;
+      continue;
+    }
+    if (page_id >= next_page_id_) {
+      break;
+    }
+    char *bitmap = GetBitmap(page_id / BitsPerBitmap());
+    size_t bit = page_id % BitsPerBitmap();
+    if (bit % 8 == 0 && static_cast<uint8_t>(bitmap[bit / 8]) == 0xFF) {
+      page_id += 8; // skip a byte of used pages at once
+      continue;
+    }
+    if (!TestBit(page_id)) {
+      break;
+    }
+    page_id++;
+  }
+  free_hint_ = page_id + 1;
+  return TakePage(page_id);
+}
+
+/**
+ * Allocate a page close to near, for objects read in page order
+ */
+page_id_t DiskManager::AllocatePage(page_id_t near) {
+  std::lock_guard<std::mutex> guard(alloc_latch_);
+  if (near >= 0) {
+    page_id_t first = near / EXTENT_SIZE * EXTENT_SIZE;
+    for (page_id_t page_id = first; page_id < first + EXTENT_SIZE; page_id++) {
+      if (!TestBit(page_id)) {
+        SetReserved(first, true);
+        return TakePage(page_id);
+      }
+    }
+  }
+  return ReserveExtent();
+}
+
+page_id_t DiskManager::AllocateExtent() {
+  std::lock_guard<std::mutex> guard(alloc_latch_);
+  return ReserveExtent();
+}
 
 /**
  * Deallocate page (operations like drop index/table)
- * Need bitmap in header page for tracking pages
+ * The page id becomes available to AllocatePage again
  */
-void DiskManager::DeallocatePage(__attribute__((unused)) page_id_t page_id) {
-  return;
+void DiskManager::DeallocatePage(page_id_t page_id) {
+  std::lock_guard<std::mutex> guard(alloc_latch_);
+  if (page_id < 0 || page_id >= next_page_id_) {
+    LOG_DEBUG("deallocating page %d that was never allocated", page_id);
+    return;
+  }
+  char *bitmap = GetBitmap(page_id / BitsPerBitmap());
+  size_t bit = page_id % BitsPerBitmap();
+  if (!(bitmap[bit / 8] & (1 << (bit % 8)))) {
+    LOG_DEBUG("page %d deallocated twice", page_id);
+    return;
+  }
+  SetAllocated(page_id, false);
+  free_hint_ = std::min(free_hint_, page_id);
+
+  // an emptied extent goes back to everybody
+  page_id_t first = page_id / EXTENT_SIZE * EXTENT_SIZE;
+  for (page_id_t id = first; id < first + EXTENT_SIZE; id++) {
+    if (TestBit(id)) {
+      return;
+    }
+  }
+  SetReserved(first, false);
+  free_hint_ = std::min(free_hint_, first);
+  free_extent_hint_ = std::min(free_extent_hint_, first);
+}
+
+bool DiskManager::IsAllocated(page_id_t page_id) {
+  std::lock_guard<std::mutex> guard(alloc_latch_);
+  if (page_id < 0 || page_id >= next_page_id_) {
+    return false;
+  }
+  return TestBit(page_id);
+}
+
+/*
+ * Lowest extent with no page in use and no owner, past the end of the file
+ * if there is none
+ */
+page_id_t DiskManager::ReserveExtent() {
+  page_id_t first = free_extent_hint_;
+  while (first < next_page_id_) {
+    bool free = !IsReserved(first);
+    for (page_id_t id = first; free && id < first + EXTENT_SIZE; id++) {
+      free = !TestBit(id);
+    }
+    if (free) {
+      break;
+    }
+    first += EXTENT_SIZE;
+  }
+  free_extent_hint_ = first + EXTENT_SIZE;
+  SetReserved(first, true);
+  return TakePage(first);
+}
+
+bool DiskManager::TestBit(page_id_t page_id) {
+  char *bitmap = GetBitmap(page_id / BitsPerBitmap());
+  size_t bit = page_id % BitsPerBitmap();
+  return bitmap[bit / 8] & (1 << (bit % 8));
+}
+
+page_id_t DiskManager::TakePage(page_id_t page_id) {
+  SetAllocated(page_id, true);
+  next_page_id_ = std::max(next_page_id_, page_id + 1);
+  return page_id;
+}
+
+bool DiskManager::IsReserved(page_id_t page_id) const {
+  size_t extent = page_id / EXTENT_SIZE;
+  return extent < reserved_.size() && reserved_[extent];
+}
+
+void DiskManager::SetReserved(page_id_t page_id, bool reserved) {
+  size_t extent = page_id / EXTENT_SIZE;
+  if (reserved_.size() <= extent) {
+    reserved_.resize(extent + 1, false);
+  }
+  reserved_[extent] = reserved;
+}
+
+/*
+ * Data page page_id sits after the bitmap pages of all the groups before it
+ */
+page_id_t DiskManager::PhysicalPageId(page_id_t page_id) const {
+  return page_id + page_id / static_cast<page_id_t>(BitsPerBitmap());
+}
+
+/*
+ * Read the bitmap of every group the file reaches into and recover
+ * next_page_id_ from the highest page in use. Bitmap pages past the end of
+ * the file read as zeros, i.e. nothing allocated.
+ */
+void DiskManager::LoadBitmaps() {
+  std::lock_guard<std::mutex> guard(alloc_latch_);
+  struct stat stat_buf;
+  if (fstat(db_fd_, &stat_buf) != 0 || stat_buf.st_size == 0) {
+    return;
+  }
+  size_t file_pages = (stat_buf.st_size + page_size_ - 1) / page_size_;
+  size_t group_pages = BitsPerBitmap() + 1;
+  size_t num_groups = (file_pages + group_pages - 1) / group_pages;
+  for (size_t group = 0; group < num_groups; group++) {
+    char *bitmap = GetBitmap(group);
+    ReadPageAt(db_fd_, group * group_pages + BitsPerBitmap(), bitmap,
+               page_size_);
+    for (size_t byte = 0; byte < page_size_; byte++) {
+      uint8_t bits = static_cast<uint8_t>(bitmap[byte]);
+      if (bits == 0) {
+        continue;
+      }
+      int high_bit = 7;
+      while (!(bits & (1 << high_bit))) {
+        high_bit--;
+      }
+      next_page_id_ = group * BitsPerBitmap() + byte * 8 + high_bit + 1;
+    }
+  }
+}
+
+/*
+ * Flip the bit of page_id and write its bitmap page through
+ */
+void DiskManager::SetAllocated(page_id_t page_id, bool allocated) {
+  size_t group = page_id / BitsPerBitmap();
+  size_t bit = page_id % BitsPerBitmap();
+  char *bitmap = GetBitmap(group);
+  if (allocated) {
+    bitmap[bit / 8] |= (1 << (bit % 8));
+  } else {
+    bitmap[bit / 8] &= ~(1 << (bit % 8));
+  }
+  WritePageAt(db_fd_, group * (BitsPerBitmap() + 1) + BitsPerBitmap(), bitmap,
+              page_size_);
+}
+
+/*
+ * In-memory copy of the bitmap of group, zeroed the first time it is asked for
+ */
+char *DiskManager::GetBitmap(size_t group) {
+  while (bitmaps_.size() <= group) {
+    void *p = nullptr;
+    if (posix_memalign(&p, DIRECT_IO_ALIGNMENT, page_size_) != 0) {
+      throw std::bad_alloc();
+    }
+    memset(p, 0, page_size_);
+    bitmaps_.push_back(static_cast<char *>(p));
+  }
+  return bitmaps_[group];
 }
 
 /**
@@ -175,6 +758,14 @@ void DiskManager::DeallocatePage(__attribute__((unused)) page_id_t page_id) {
  */
 int DiskManager::GetNumFlushes() const { return num_flushes_; }
 
+/**
+ * Time spent in fdatasync on the log so far
+ */
+std::chrono::nanoseconds DiskManager::GetLogSyncTime() {
+  std::lock_guard<std::mutex> guard(log_latch_);
+  return log_sync_time_;
+}
+
 /**
  * Returns true if the log is currently being flushed
  */
@@ -0,0 +1,399 @@
+/**
+ * disk_extendible_hash.cpp
+ */
+
+#include <new>
+
+#include "common/exception.h"
+#include "common/rid.h"
+#include "hash/disk_extendible_hash.h"
+#include "page/header_page.h"
+
+namespace cmudb {
+
+INDEX_TEMPLATE_ARGUMENTS
+DISK_EXTENDIBLE_HASH_TYPE::DiskExtendibleHash(
+    const std::string &name, BufferPoolManager *buffer_pool_manager,
+    const KeyComparator &comparator, page_id_t directory_page_id)
+    : index_name_(name), directory_page_id_(directory_page_id),
+      buffer_pool_manager_(buffer_pool_manager), comparator_(comparator) {}
+
+INDEX_TEMPLATE_ARGUMENTS
+bool DISK_EXTENDIBLE_HASH_TYPE::IsEmpty() const {
+  return directory_page_id_ == INVALID_PAGE_ID;
+}
+
+/*****************************************************************************
+ * SEARCH
+ *****************************************************************************/
+/*
+ * Return the only value that associated with input key
+ * @return : true means key exists
+ */
+INDEX_TEMPLATE_ARGUMENTS
+bool DISK_EXTENDIBLE_HASH_TYPE::GetValue(const KeyType &key,
+                                         std::vector<ValueType> &result,
+                                         Transaction *transaction) {
+  table_latch_.RLock();
+  if (IsEmpty()) {
+    table_latch_.RUnlock();
+    return false;
+  }
+  HashTableDirectoryPage *directory = FetchDirectoryPage();
+  page_id_t bucket_page_id = directory->GetBucketPageId(
+      Hash(key) & directory->GetGlobalDepthMask());
+  Page *page = buffer_pool_manager_->FetchPage(bucket_page_id);
+  assert(page != nullptr);
+
+  page->RLatch();
+  ValueType value;
+  bool found = BucketOf(page)->Lookup(key, value, comparator_);
+  page->RUnlatch();
+  buffer_pool_manager_->UnpinPage(bucket_page_id, false);
+  buffer_pool_manager_->UnpinPage(directory_page_id_, false);
+  table_latch_.RUnlock();
+
+  if (found) {
+    result.push_back(value);
+  }
+  return found;
+}
+
+/*****************************************************************************
+ * INSERTION
+ *****************************************************************************/
+/*
+ * Insert into the bucket of key under a shared table latch if it has room,
+ * otherwise retry exclusively and split
+ */
+INDEX_TEMPLATE_ARGUMENTS
+bool DISK_EXTENDIBLE_HASH_TYPE::Insert(const KeyType &key,
+                                       const ValueType &value,
+                                       Transaction *transaction) {
+  table_latch_.RLock();
+  if (!IsEmpty()) {
+    HashTableDirectoryPage *directory = FetchDirectoryPage();
+    page_id_t bucket_page_id = directory->GetBucketPageId(
+        Hash(key) & directory->GetGlobalDepthMask());
+    Page *page = buffer_pool_manager_->FetchPage(bucket_page_id);
+    assert(page != nullptr);
+
+    page->WLatch();
+    HASH_TABLE_BUCKET_TYPE *bucket = BucketOf(page);
+    bool exists = bucket->KeyIndex(key, comparator_) != -1;
+    bool inserted = !exists && bucket->Insert(key, value, comparator_);
+    page->WUnlatch();
+    buffer_pool_manager_->UnpinPage(bucket_page_id, inserted);
+    buffer_pool_manager_->UnpinPage(directory_page_id_, false);
+    if (exists || inserted) {
+      table_latch_.RUnlock();
+      return inserted;
+    }
+  }
+  table_latch_.RUnlock();
+
+  table_latch_.WLock();
+  bool inserted;
+  try {
+    if (IsEmpty()) {
+      CreateDirectory();
+    }
+    inserted = SplitInsert(key, value);
+  } catch (...) {
+    table_latch_.WUnlock();
+    throw;
+  }
+  table_latch_.WUnlock();
+  return inserted;
+}
+
+/*
+ * Allocate the directory and its first bucket and record the directory in
+ * the header page
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void DISK_EXTENDIBLE_HASH_TYPE::CreateDirectory() {
+  page_id_t directory_page_id, bucket_page_id;
+  Page *directory_page = buffer_pool_manager_->NewPage(directory_page_id);
+  if (directory_page == nullptr) {
+    throw std::bad_alloc();
+  }
+  Page *bucket_page = buffer_pool_manager_->NewPage(bucket_page_id);
+  if (bucket_page == nullptr) {
+    buffer_pool_manager_->UnpinPage(directory_page_id, false);
+    buffer_pool_manager_->DeletePage(directory_page_id);
+    throw std::bad_alloc();
+  }
+  reinterpret_cast<HashTableDirectoryPage *>(directory_page->GetData())
+      ->Init(directory_page_id, bucket_page_id,
+             directory_page->GetPageSize());
+  BucketOf(bucket_page)->Init(bucket_page_id, bucket_page->GetPageSize());
+  buffer_pool_manager_->UnpinPage(bucket_page_id, true);
+  buffer_pool_manager_->UnpinPage(directory_page_id, true);
+
+  directory_page_id_ = directory_page_id;
+  UpdateDirectoryPageId(true);
+}
+
+/*
+ * Split the bucket of key, growing the directory when the bucket is already
+ * at global depth, until key fits. Only the slots pointing at the split
+ * bucket are visited: every 2^local_depth-th slot from the lowest one.
+ * Throws if the bucket is at the directory's maximum depth and full.
+ * @return: false if key exists
+ */
+INDEX_TEMPLATE_ARGUMENTS
+bool DISK_EXTENDIBLE_HASH_TYPE::SplitInsert(const KeyType &key,
+                                            const ValueType &value) {
+  uint32_t hash = Hash(key);
+  HashTableDirectoryPage *directory = FetchDirectoryPage();
+  bool directory_dirty = false;
+  bool inserted = false;
+
+  while (true) {
+    uint32_t bucket_idx = hash & directory->GetGlobalDepthMask();
+    page_id_t bucket_page_id = directory->GetBucketPageId(bucket_idx);
+    Page *page = buffer_pool_manager_->FetchPage(bucket_page_id);
+    assert(page != nullptr);
+    HASH_TABLE_BUCKET_TYPE *bucket = BucketOf(page);
+    if (bucket->KeyIndex(key, comparator_) != -1) {
+      buffer_pool_manager_->UnpinPage(bucket_page_id, false);
+      break;
+    }
+    if (!bucket->IsFull()) {
+      inserted = bucket->Insert(key, value, comparator_);
+      buffer_pool_manager_->UnpinPage(bucket_page_id, true);
+      break;
+    }
+
+    uint32_t local_depth = directory->GetLocalDepth(bucket_idx);
+    if (local_depth == directory->GetGlobalDepth()) {
+      if (local_depth == directory->GetMaxDepth()) {
+        buffer_pool_manager_->UnpinPage(bucket_page_id, false);
+        buffer_pool_manager_->UnpinPage(directory_page_id_, directory_dirty);
+        throw Exception(EXCEPTION_TYPE_INDEX, "hash directory is full");
+      }
+      directory->IncrGlobalDepth();
+    }
+
+    page_id_t image_page_id;
+    Page *image_page = buffer_pool_manager_->NewPage(image_page_id);
+    if (image_page == nullptr) {
+      buffer_pool_manager_->UnpinPage(bucket_page_id, false);
+      buffer_pool_manager_->UnpinPage(directory_page_id_, true);
+      throw std::bad_alloc();
+    }
+    HASH_TABLE_BUCKET_TYPE *image = BucketOf(image_page);
+    image->Init(image_page_id, image_page->GetPageSize());
+
+    // entries whose next hash bit is set move to the split image
+    uint32_t high_bit = 1U << local_depth;
+    for (int i = bucket->GetSize() - 1; i >= 0; i--) {
+      if (Hash(bucket->KeyAt(i)) & high_bit) {
+        image->Insert(bucket->KeyAt(i), bucket->ValueAt(i), comparator_);
+        bucket->RemoveAt(i);
+      }
+    }
+    for (uint32_t i = bucket_idx & (high_bit - 1); i < directory->Size();
+         i += high_bit) {
+      directory->SetLocalDepth(i, local_depth + 1);
+      if (i & high_bit) {
+        directory->SetBucketPageId(i, image_page_id);
+      }
+    }
+    directory_dirty = true;
+    buffer_pool_manager_->UnpinPage(image_page_id, true);
+    buffer_pool_manager_->UnpinPage(bucket_page_id, true);
+  }
+
+  buffer_pool_manager_->UnpinPage(directory_page_id_, directory_dirty);
+  return inserted;
+}
+
+/*****************************************************************************
+ * REMOVE
+ *****************************************************************************/
+/*
+ * Remove key from its bucket under a shared table latch. A bucket left empty
+ * is then merged with its split image and the directory shrunk, exclusively.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+bool DISK_EXTENDIBLE_HASH_TYPE::Remove(const KeyType &key,
+                                       Transaction *transaction) {
+  table_latch_.RLock();
+  if (IsEmpty()) {
+    table_latch_.RUnlock();
+    return false;
+  }
+  HashTableDirectoryPage *directory = FetchDirectoryPage();
+  uint32_t bucket_idx = Hash(key) & directory->GetGlobalDepthMask();
+  page_id_t bucket_page_id = directory->GetBucketPageId(bucket_idx);
+  bool mergeable = directory->GetLocalDepth(bucket_idx) > 0;
+  Page *page = buffer_pool_manager_->FetchPage(bucket_page_id);
+  assert(page != nullptr);
+
+  page->WLatch();
+  HASH_TABLE_BUCKET_TYPE *bucket = BucketOf(page);
+  bool removed = bucket->Remove(key, comparator_);
+  mergeable = mergeable && bucket->IsEmpty();
+  page->WUnlatch();
+  buffer_pool_manager_->UnpinPage(bucket_page_id, removed);
+  buffer_pool_manager_->UnpinPage(directory_page_id_, false);
+  table_latch_.RUnlock();
+
+  if (mergeable) {
+    table_latch_.WLock();
+    Merge(key);
+    table_latch_.WUnlock();
+  }
+  return removed;
+}
+
+/*
+ * Fold the bucket of key into its split image while both have the same local
+ * depth and fit into one page, delete the emptied page, then halve the
+ * directory while no bucket uses the full global depth
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void DISK_EXTENDIBLE_HASH_TYPE::Merge(const KeyType &key) {
+  uint32_t hash = Hash(key);
+  HashTableDirectoryPage *directory = FetchDirectoryPage();
+  bool directory_dirty = false;
+
+  while (true) {
+    uint32_t bucket_idx = hash & directory->GetGlobalDepthMask();
+    uint32_t local_depth = directory->GetLocalDepth(bucket_idx);
+    if (local_depth == 0) {
+      break;
+    }
+    uint32_t image_idx = directory->GetSplitImageIndex(bucket_idx);
+    if (directory->GetLocalDepth(image_idx) != local_depth) {
+      break;
+    }
+
+    // keep the bucket whose top bit is 0, the other one goes away
+    uint32_t top_bit = 1U << (local_depth - 1);
+    uint32_t kept_idx = (bucket_idx & top_bit) ? image_idx : bucket_idx;
+    uint32_t dropped_idx = kept_idx ^ top_bit;
+    page_id_t kept_page_id = directory->GetBucketPageId(kept_idx);
+    page_id_t dropped_page_id = directory->GetBucketPageId(dropped_idx);
+    HASH_TABLE_BUCKET_TYPE *kept =
+        BucketOf(buffer_pool_manager_->FetchPage(kept_page_id));
+    HASH_TABLE_BUCKET_TYPE *dropped =
+        BucketOf(buffer_pool_manager_->FetchPage(dropped_page_id));
+    if (kept->GetSize() + dropped->GetSize() > kept->GetMaxSize()) {
+      buffer_pool_manager_->UnpinPage(dropped_page_id, false);
+      buffer_pool_manager_->UnpinPage(kept_page_id, false);
+      break;
+    }
+    for (int i = 0; i < dropped->GetSize(); i++) {
+      kept->Insert(dropped->KeyAt(i), dropped->ValueAt(i), comparator_);
+    }
+    for (uint32_t i = bucket_idx & (top_bit - 1); i < directory->Size();
+         i += top_bit) {
+      directory->SetLocalDepth(i, local_depth - 1);
+      directory->SetBucketPageId(i, kept_page_id);
+    }
+    directory_dirty = true;
+    buffer_pool_manager_->UnpinPage(dropped_page_id, false);
+    buffer_pool_manager_->UnpinPage(kept_page_id, true);
+    buffer_pool_manager_->DeletePage(dropped_page_id);
+  }
+
+  while (directory->CanShrink()) {
+    directory->DecrGlobalDepth();
+    directory_dirty = true;
+  }
+  buffer_pool_manager_->UnpinPage(directory_page_id_, directory_dirty);
+}
+
+/*****************************************************************************
+ * UTILITIES AND DEBUG
+ *****************************************************************************/
+/*
+ * FNV-1a over the key bytes, then the murmur3 finalizer to mix the low bits;
+ * GenericKey zero fills unused bytes so equal keys hash alike
+ */
+INDEX_TEMPLATE_ARGUMENTS
+uint32_t DISK_EXTENDIBLE_HASH_TYPE::Hash(const KeyType &key) const {
+  const unsigned char *data = reinterpret_cast<const unsigned char *>(&key);
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  for (size_t i = 0; i < sizeof(KeyType); i++) {
+    hash = (hash ^ data[i]) * 0x100000001b3ULL;
+  }
+  hash ^= hash >> 33;
+  hash *= 0xff51afd7ed558ccdULL;
+  hash ^= hash >> 33;
+  hash *= 0xc4ceb9fe1a85ec53ULL;
+  hash ^= hash >> 33;
+  return static_cast<uint32_t>(hash);
+}
+
+/*
+ * Fetch (and pin) the directory page, caller unpins directory_page_id_
+ */
+INDEX_TEMPLATE_ARGUMENTS
+HashTableDirectoryPage *DISK_EXTENDIBLE_HASH_TYPE::FetchDirectoryPage() {
+  Page *page = buffer_pool_manager_->FetchPage(directory_page_id_);
+  if (page == nullptr) {
+    throw std::bad_alloc();
+  }
+  return reinterpret_cast<HashTableDirectoryPage *>(page->GetData());
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+HASH_TABLE_BUCKET_TYPE *DISK_EXTENDIBLE_HASH_TYPE::BucketOf(Page *page) {
+  if (page == nullptr) {
+    throw std::bad_alloc();
+  }
+  return reinterpret_cast<HASH_TABLE_BUCKET_TYPE *>(page->GetData());
+}
+
+/*
+ * Update/Insert directory page id in header page(where page_id = 0,
+ * header_page is defined under include/page/header_page.h)
+ * Call this method everytime directory page id is changed.
+ * @parameter: insert_record default value is false. When set to true,
+ * insert a record <index_name, directory_page_id> into header page instead of
+ * updating it.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void DISK_EXTENDIBLE_HASH_TYPE::UpdateDirectoryPageId(int insert_record) {
+  HeaderPage *header_page = static_cast<HeaderPage *>(
+      buffer_pool_manager_->FetchPage(HEADER_PAGE_ID));
+  if (insert_record)
+    header_page->InsertRecord(index_name_, directory_page_id_);
+  else
+    header_page->UpdateRecord(index_name_, directory_page_id_);
+  buffer_pool_manager_->UnpinPage(HEADER_PAGE_ID, true);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+uint32_t DISK_EXTENDIBLE_HASH_TYPE::GetGlobalDepth() {
+  table_latch_.RLock();
+  uint32_t global_depth = 0;
+  if (!IsEmpty()) {
+    global_depth = FetchDirectoryPage()->GetGlobalDepth();
+    buffer_pool_manager_->UnpinPage(directory_page_id_, false);
+  }
+  table_latch_.RUnlock();
+  return global_depth;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void DISK_EXTENDIBLE_HASH_TYPE::VerifyIntegrity() {
+  table_latch_.RLock();
+  if (!IsEmpty()) {
+    FetchDirectoryPage()->VerifyIntegrity();
+    buffer_pool_manager_->UnpinPage(directory_page_id_, false);
+  }
+  table_latch_.RUnlock();
+}
+
+template class DiskExtendibleHash<GenericKey<4>, RID, GenericComparator<4>>;
+template class DiskExtendibleHash<GenericKey<8>, RID, GenericComparator<8>>;
+template class DiskExtendibleHash<GenericKey<16>, RID, GenericComparator<16>>;
+template class DiskExtendibleHash<GenericKey<32>, RID, GenericComparator<32>>;
+template class DiskExtendibleHash<GenericKey<64>, RID, GenericComparator<64>>;
+
+} // namespace cmudb
@@ -1,5 +1,6 @@
 #include <list>
 #include <cassert>
+#include <string>
 
 #include "hash/extendible_hash.h"
 #include "page/page.h"
@@ -12,7 +13,23 @@ namespace cmudb {
  */
     template<typename K, typename V>
     ExtendibleHash<K, V>::ExtendibleHash(size_t size): globalDepth(0), bucketSizeLimit(size) {
-        bucketDirectory.push_back(std::make_shared<Bucket>(0));
+        assert(bucketSizeLimit > 0);
+        bucketDirectory.push_back(new Bucket(0, bucketSizeLimit));
+    }
+
+    template<typename K, typename V>
+    ExtendibleHash<K, V>::~ExtendibleHash() {
+        // a bucket of local depth d owns 2^(global - d) slots, the lowest of
+        // them is below 2^d
+        std::vector<Bucket *> buckets;
+        for (size_t i = 0; i < bucketDirectory.size(); i++) {
+            if (i < (static_cast<size_t>(1) << bucketDirectory[i]->localDepth)) {
+                buckets.push_back(bucketDirectory[i]);
+            }
+        }
+        for (auto bucket : buckets) {
+            delete bucket;
+        }
     }
 
 /*
@@ -29,7 +46,10 @@ namespace cmudb {
  */
     template<typename K, typename V>
     int ExtendibleHash<K, V>::GetGlobalDepth() const {
-        return globalDepth;
+        directoryLatch.RLock();
+        int depth = globalDepth;
+        directoryLatch.RUnlock();
+        return depth;
     }
 
 /*
@@ -38,7 +58,10 @@ namespace cmudb {
  */
     template<typename K, typename V>
     int ExtendibleHash<K, V>::GetLocalDepth(int bucket_id) const {
-        return bucketDirectory[bucket_id]->localDepth;
+        directoryLatch.RLock();
+        int depth = bucketDirectory[bucket_id]->localDepth;
+        directoryLatch.RUnlock();
+        return depth;
     }
 
 /*
@@ -46,7 +69,10 @@ namespace cmudb {
  */
     template<typename K, typename V>
     int ExtendibleHash<K, V>::GetNumBuckets() const {
-        return static_cast<int>(bucketDirectory.size());
+        directoryLatch.RLock();
+        int num = static_cast<int>(bucketDirectory.size());
+        directoryLatch.RUnlock();
+        return num;
     }
 
 /*
@@ -54,30 +80,51 @@ namespace cmudb {
  */
     template<typename K, typename V>
     bool ExtendibleHash<K, V>::Find(const K &key, V &value) {
-        std::lock_guard<std::mutex> guard(mtx);
-        std::shared_ptr<Bucket> bucket = getBucket(key);
-        if (bucket == nullptr || bucket->contents.find(key) == bucket->contents.end()) {
-            return false;
+        size_t hashKey = HashKey(key);
+        directoryLatch.RLock();
+        Bucket *bucket = bucketDirectory[getBucketIndex(hashKey)];
+        bool found;
+        {
+            std::lock_guard<std::mutex> guard(bucket->latch);
+            size_t slot = bucket->find(key);
+            found = slot < bucket->size;
+            if (found) {
+                value = bucket->slots[slot].second;
+            }
         }
-        value = bucket->contents[key];
-        return true;
+        directoryLatch.RUnlock();
+        return found;
     }
 
 /*
  * delete <key,value> entry in hash table
- * Shrink & Combination is not required for this project
+ * A bucket left empty is merged with its split image and the directory is
+ * halved for as long as possible
  */
     template<typename K, typename V>
     bool ExtendibleHash<K, V>::Remove(const K &key) {
-        std::lock_guard<std::mutex> guard(mtx);
-
-        std::shared_ptr<Bucket> bucket = getBucket(key);
-        if (bucket->contents.find(key) == bucket->contents.end()) {
-            return false;
+        size_t hashKey = HashKey(key);
+        directoryLatch.RLock();
+        Bucket *bucket = bucketDirectory[getBucketIndex(hashKey)];
+        bool removed, emptied;
+        {
+            std::lock_guard<std::mutex> guard(bucket->latch);
+            size_t slot = bucket->find(key);
+            removed = slot < bucket->size;
+            if (removed) {
+                bucket->size--;
+                std::swap(bucket->slots[slot], bucket->slots[bucket->size]);
+            }
+            emptied = bucket->size == 0 && bucket->localDepth > 0;
         }
+        directoryLatch.RUnlock();
 
-        bucket->contents.erase(key);
-        return true;
+        if (emptied) {
+            directoryLatch.WLock();
+            merge(key);
+            directoryLatch.WUnlock();
+        }
+        return removed;
     }
 
 /*
@@ -87,56 +134,136 @@ namespace cmudb {
  */
     template<typename K, typename V>
     void ExtendibleHash<K, V>::Insert(const K &key, const V &value) {
-        std::lock_guard<std::mutex> guard(mtx);
+        size_t hashKey = HashKey(key);
+        directoryLatch.RLock();
+        Bucket *bucket = bucketDirectory[getBucketIndex(hashKey)];
+        bool inserted = false;
+        {
+            std::lock_guard<std::mutex> guard(bucket->latch);
+            size_t slot = bucket->find(key);
+            if (slot < bucketSizeLimit) {
+                if (slot == bucket->size) {
+                    bucket->slots[slot].first = key;
+                    bucket->size++;
+                }
+                bucket->slots[slot].second = value;
+                inserted = true;
+            }
+        }
+        directoryLatch.RUnlock();
+        if (inserted) {
+            return;
+        }
+
+        // the bucket is full, the directory has to change
+        directoryLatch.WLock();
+        split(key);
+        bucket = bucketDirectory[getBucketIndex(hashKey)];
+        size_t slot = bucket->find(key);
+        if (slot == bucket->size) {
+            bucket->slots[slot].first = key;
+            bucket->size++;
+        }
+        bucket->slots[slot].second = value;
+        directoryLatch.WUnlock();
+    }
 
-        std::shared_ptr<Bucket> target = getBucket(key);
-        int index = getBucketIndex(HashKey(key));
-        while (target->contents.size() == bucketSizeLimit) {
+    template<typename K, typename V>
+    size_t ExtendibleHash<K, V>::Bucket::find(const K &key) const {
+        size_t i = 0;
+        while (i < size && !(slots[i].first == key)) {
+            i++;
+        }
+        return i;
+    }
+
+    template<typename K, typename V>
+    int ExtendibleHash<K, V>::getBucketIndex(size_t hashKey) const {
+        return static_cast<int>(hashKey & ((static_cast<size_t>(1) << globalDepth) - 1));
+    }
+
+/*
+ * Split the bucket of key until it has room for one more entry (or already
+ * holds key). Only the 2^(global - local) slots pointing at a bucket are
+ * visited, they are every 2^local-th slot starting at its lowest one.
+ */
+    template<typename K, typename V>
+    void ExtendibleHash<K, V>::split(const K &key) {
+        size_t hashKey = HashKey(key);
+        Bucket *target = bucketDirectory[getBucketIndex(hashKey)];
+        while (target->size == bucketSizeLimit && target->find(key) == target->size) {
             if (target->localDepth == globalDepth) {
                 size_t length = bucketDirectory.size();
-                for(size_t i = 0; i < length; i++){
+                for (size_t i = 0; i < length; i++) {
                     bucketDirectory.push_back(bucketDirectory[i]);
                 }
                 globalDepth++;
             }
-            int mask = (1 << target->localDepth );
-
-            auto a = std::make_shared<Bucket>(target->localDepth + 1);
-            auto b = std::make_shared<Bucket>(target->localDepth + 1);
-            for(auto item : target->contents){
-                size_t newKey = HashKey(item.first);
-                if(newKey & mask){
-                    b->contents.insert(item);
-                }else{
-                    a->contents.insert(item);
+            size_t mask = static_cast<size_t>(1) << target->localDepth;
+
+            // target keeps the entries whose new bit is 0
+            Bucket *image = new Bucket(target->localDepth + 1, bucketSizeLimit);
+            target->localDepth++;
+            size_t kept = 0;
+            for (size_t i = 0; i < target->size; i++) {
+                if (HashKey(target->slots[i].first) & mask) {
+                    image->slots[image->size++] = target->slots[i];
+                } else {
+                    std::swap(target->slots[kept++], target->slots[i]);
                 }
             }
-            for(size_t i = 0; i < bucketDirectory.size(); i++){
-                if(bucketDirectory[i] == target){
-                    if(i & mask){
-                        bucketDirectory[i] = b;
-                    }else{
-                        bucketDirectory[i] = a;
-                    }
-                }
+            target->size = kept;
+            for (size_t i = (hashKey & (mask - 1)) | mask; i < bucketDirectory.size(); i += mask << 1) {
+                bucketDirectory[i] = image;
             }
-            target = getBucket(key);
-            index = getBucketIndex(HashKey(key));
+            target = bucketDirectory[getBucketIndex(hashKey)];
         }
-
-        bucketDirectory[index]->contents[key] = value;
     }
 
+/*
+ * Merge the bucket of key with its split image while both have the same local
+ * depth and fit into one bucket, then halve the directory while every bucket
+ * has a local depth below the global depth.
+ */
     template<typename K, typename V>
-    int ExtendibleHash<K, V>::getBucketIndex(size_t hashKey) const {
-        return static_cast<int>(hashKey & ((1 << globalDepth) - 1));
-    }
+    void ExtendibleHash<K, V>::merge(const K &key) {
+        size_t hashKey = HashKey(key);
+        while (true) {
+            size_t index = getBucketIndex(hashKey);
+            Bucket *bucket = bucketDirectory[index];
+            if (bucket->localDepth == 0) {
+                break;
+            }
+            size_t mask = static_cast<size_t>(1) << (bucket->localDepth - 1);
+            Bucket *image = bucketDirectory[index ^ mask];
+            if (image->localDepth != bucket->localDepth ||
+                bucket->size + image->size > bucketSizeLimit) {
+                break;
+            }
+            // keep the bucket of the lower half, it is the one owning slot i
+            Bucket *kept = (index & mask) ? image : bucket;
+            Bucket *dropped = (index & mask) ? bucket : image;
+            for (size_t i = 0; i < dropped->size; i++) {
+                kept->slots[kept->size++] = dropped->slots[i];
+            }
+            kept->localDepth--;
+            for (size_t i = (hashKey & (mask - 1)) | mask; i < bucketDirectory.size(); i += mask << 1) {
+                bucketDirectory[i] = kept;
+            }
+            delete dropped;
+        }
 
-    template<typename K, typename V>
-    std::shared_ptr<typename ExtendibleHash<K, V>::Bucket> ExtendibleHash<K, V>::getBucket(const K &key) {
-        auto ret = bucketDirectory[getBucketIndex(HashKey(key))];
-        return ret;
-    };
+        while (globalDepth > 0) {
+            size_t half = bucketDirectory.size() / 2;
+            for (size_t i = 0; i < half; i++) {
+                if (bucketDirectory[i]->localDepth == globalDepth) {
+                    return;
+                }
+            }
+            bucketDirectory.resize(half);
+            globalDepth--;
+        }
+    }
 
     template
     class ExtendibleHash<page_id_t, Page *>;
@@ -0,0 +1,146 @@
+/*
+ * buffer_pool_instance.h
+ *
+ * Functionality: One partition of the buffer pool. Every instance owns its
+ * own frames, page table, replacer, free list and latch, so operations on
+ * pages that live in different instances never contend with each other.
+ * BufferPoolManager routes every call to the instance owning the page id.
+ *
+ * Frame life cycle:
+ *
+ *   FREE -> LOADING -> RESIDENT -> EVICTING -> LOADING -> ...
+ *
+ * latch_ only protects the bookkeeping and is never held across disk I/O.
+ * A frame in LOADING (read in flight) or EVICTING (write-back of the previous
+ * occupant in flight) is pinned by the thread doing the I/O; other threads
+ * asking for either page wait on that frame's condition variable only.
+ *
+ * Prefetch loads pages with asynchronous reads. The frame stays LOADING and
+ * pinned by the read until its completion callback makes it RESIDENT and
+ * unpins it, so a FetchPage arriving meanwhile simply waits for it. At most
+ * half of the frames are taken by prefetches at any time.
+ *
+ * A read failing its checksum takes the page out of the page table again
+ * (DropFrame); threads waiting for it let go of the frame and FetchPage
+ * throws, rather than hand out a corrupted page.
+ *
+ * CleanPages and FlushAllPages write dirty frames back in page id order
+ * without pinning them, so the replacer keeps their position. Such a frame
+ * is flagged in writing_ instead: eviction passes over it, and FlushPage and
+ * DeletePage wait for the write to finish. Other threads may still pin and
+ * change the page meanwhile, so what is written is a copy taken under the
+ * page's read latch (CopyPage). A copy whose LSN is not yet persistent is
+ * not written, the page stays dirty for a later round (WAL).
+ *
+ * Every write-back takes the recovery LSN off the page up front and parks it
+ * in write_rec_lsns_ until the write is done, so a checkpoint taken meanwhile
+ * still counts the page as dirty. FlushPage flags its frame in writing_ too,
+ * so that at most one write-back per frame is in flight.
+ *
+ * A page retired while pinned (RetirePage) is flagged in retired_ and deleted
+ * by whoever drops its last pin, so nobody has to wait for the pins to go.
+ */
+
+#pragma once
+#include <condition_variable>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "buffer/clock_replacer.h"
+#include "buffer/lru_k_replacer.h"
+#include "buffer/lru_replacer.h"
+#include "buffer/page_table.h"
+#include "disk/disk_manager.h"
+#include "logging/log_manager.h"
+#include "logging/log_record.h"
+#include "page/page.h"
+
+namespace cmudb {
+enum class FrameState { FREE = 0, LOADING, RESIDENT, EVICTING };
+
+class BufferPoolInstance {
+public:
+  // frames: pool_size pages of disk_manager's page size, owned by the caller
+  BufferPoolInstance(size_t pool_size, char *frames, DiskManager *disk_manager,
+                     LogManager *log_manager = nullptr,
+                     ReplacerType replacer_type = ReplacerType::LRU);
+
+  ~BufferPoolInstance();
+
+  Page *FetchPage(page_id_t page_id);
+
+  bool UnpinPage(page_id_t page_id, bool is_dirty);
+
+  bool FlushPage(page_id_t page_id);
+
+  // page_id has already been allocated by the disk manager
+  Page *NewPage(page_id_t page_id);
+
+  bool DeletePage(page_id_t page_id);
+
+  // true if the page is deleted right away, false if that is left to its
+  // last UnpinPage
+  bool RetirePage(page_id_t page_id);
+
+  // start loading the pages that are not in the pool yet, without pinning
+  void Prefetch(const std::vector<page_id_t> &page_ids);
+
+  // write dirty unpinned pages back, return the number written
+  size_t CleanPages();
+
+  // write every dirty page back, pinned or not
+  void FlushAllPages();
+
+  // append (page id, recovery LSN) of every page with changes not on disk
+  void GetDirtyPages(DirtyPageTable &dirty_pages);
+
+  inline size_t GetPoolSize() const { return pool_size_; }
+
+private:
+  size_t pool_size_; // number of pages in this instance
+  Page *pages_;      // array of pages
+  DiskManager *disk_manager_;
+  LogManager *log_manager_;
+  PageTable *page_table_;        // page id -> frame id of resident pages
+  Replacer<Page *> *replacer_;   // to find an unpinned page for replacement
+  std::list<Page *> *free_list_; // to find a free page for replacement
+  std::mutex latch_;             // to protect shared data structure
+  std::vector<FrameState> frame_states_;     // indexed by frame id
+  std::condition_variable *frame_cvs_;       // signalled on state change
+  // page id -> frame of pages whose write-back is still in flight
+  std::unordered_map<page_id_t, Page *> evicting_;
+  size_t prefetching_;                     // prefetch reads in flight
+  std::condition_variable prefetch_cv_;    // signalled when none is left
+  std::vector<bool> writing_; // frames being written back
+  std::vector<bool> retired_;  // frames deleted on their last unpin
+  std::vector<lsn_t> write_rec_lsns_; // rec LSN of the write-back in flight
+
+  Page *AcquireFrame(std::unique_lock<std::mutex> &lock, page_id_t page_id);
+  bool FindPage(page_id_t page_id, Page *&page);
+  void SetFrameState(Page *page, FrameState state);
+  bool WaitUntilResident(std::unique_lock<std::mutex> &lock, Page *page);
+  void FinishPrefetch(Page *page, bool ok);
+  void DropFrame(Page *page);
+  void FreeFrame(Page *page);
+  void ReleasePin(std::unique_lock<std::mutex> &lock, Page *page);
+  void ReleaseDropped(Page *page);
+  Page *Victim(std::unique_lock<std::mutex> &lock);
+  size_t WriteDirtyPages(bool include_pinned);
+  void WaitUntilWritten(std::unique_lock<std::mutex> &lock, Page *page);
+  void WaitUntilEvicted(std::unique_lock<std::mutex> &lock, page_id_t page_id);
+  void CopyPage(Page *page, char *copy);
+  void StartWrite(Page *page);
+  void FinishWrite(Page *page);
+  void CancelWrite(Page *page);
+
+  inline size_t FrameId(Page *page) const {
+    return static_cast<size_t>(page - pages_);
+  }
+
+  void pin_page(Page* p){
+    p->pin_count_++;
+  }
+};
+} // namespace cmudb
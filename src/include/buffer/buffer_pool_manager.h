@@ -4,23 +4,38 @@
  * Functionality: The simplified Buffer Manager interface allows a client to
  * new/delete pages on disk, to read a disk page into the buffer pool and pin
  * it, also to unpin a page in the buffer pool.
+ *
+ * The pool is split into num_instances independent BufferPoolInstances and a
+ * page always lives in the instance selected by its page id, so threads
+ * working on different pages mostly take different latches. A new page whose
+ * instance is full gets another page id instead.
+ *
+ * The content of all frames is one FRAME_ALIGNMENT aligned arena, sliced
+ * between the instances, so every frame can be used for O_DIRECT I/O.
+ *
+ * An optional page cleaner thread writes dirty unpinned pages back every
+ * PAGE_CLEANER_TIMEOUT, so that eviction in FetchPage/NewPage mostly finds a
+ * clean victim and foreground threads rarely wait for a write (or for the
+ * log flush a write may need).
  */
 
 #pragma once
-#include <list>
+#include <condition_variable>
 #include <mutex>
+#include <thread>
+#include <vector>
 
-#include "buffer/lru_replacer.h"
-#include "disk/disk_manager.h"
-#include "hash/extendible_hash.h"
-#include "logging/log_manager.h"
-#include "page/page.h"
+#include "buffer/buffer_pool_instance.h"
 
 namespace cmudb {
 class BufferPoolManager {
 public:
+  // num_instances == 0 picks one instance per hardware thread, as long as
+  // each gets INSTANCE_MIN_FRAMES frames
   BufferPoolManager(size_t pool_size, DiskManager *disk_manager,
-                          LogManager *log_manager = nullptr);
+                    LogManager *log_manager = nullptr,
+                    size_t num_instances = 0,
+                    ReplacerType replacer_type = ReplacerType::LRU);
 
   ~BufferPoolManager();
 
@@ -32,20 +47,56 @@ public:
 
   Page *NewPage(page_id_t &page_id);
 
+  // new page in the extent of near, so that an object read in page order is
+  // contiguous on disk; near == INVALID_PAGE_ID starts a new extent
+  Page *NewPage(page_id_t &page_id, page_id_t near);
+
   bool DeletePage(page_id_t page_id);
 
+  // delete the page now if it is not pinned, otherwise on its last unpin;
+  // for pages that no new reader can find anymore
+  void RetirePage(page_id_t page_id);
+
+  // start loading pages in the background without pinning them, a later
+  // FetchPage finds them resident (or waits for the read already in flight)
+  void PrefetchPage(page_id_t page_id);
+  void PrefetchRange(page_id_t first_page_id, size_t num_pages);
+
+  // write every page dirtied before the call back to disk
+  void FlushAllPages();
+
+  // (page id, recovery LSN) of the pages with logged changes not on disk,
+  // for checkpoints
+  DirtyPageTable GetDirtyPageTable();
+
+  // spawn / stop and join the page cleaner thread
+  void RunPageCleaner();
+  void StopPageCleaner();
+
+  inline size_t GetPoolSize() const { return pool_size_; }
+
+  // page size of the database file, frames have the same size
+  inline size_t GetPageSize() const { return page_size_; }
+
+  inline size_t GetNumInstances() const { return instances_.size(); }
+
 private:
   size_t pool_size_; // number of pages in buffer pool
-  Page *pages_;      // array of pages
+  size_t page_size_;
   DiskManager *disk_manager_;
   LogManager *log_manager_;
-  HashTable<page_id_t, Page *> *page_table_; // to keep track of pages
-  Replacer<Page *> *replacer_;   // to find an unpinned page for replacement
-  std::list<Page *> *free_list_; // to find a free page for replacement
-  std::mutex latch_;             // to protect shared data structure
-
-  void pin_page(Page* p){
-    p->pin_count_++;
-  }
+  char *frames_; // aligned arena of pool_size_ * page_size_ bytes
+  std::vector<BufferPoolInstance *> instances_;
+  // page cleaner
+  std::thread *cleaner_thread_;
+  bool cleaner_on_;
+  std::mutex cleaner_latch_;
+  std::condition_variable cleaner_cv_;
+
+  void CleanPages();
+
+  BufferPoolInstance *GetInstance(page_id_t page_id);
+  Page *NewAllocatedPage(page_id_t &page_id, page_id_t new_page_id,
+                         bool in_extent);
 };
 } // namespace cmudb
@@ -0,0 +1,54 @@
+/**
+ * clock_replacer.h
+ *
+ * Functionality: CLOCK approximation of LRU. Every frame owns one slot in a
+ * fixed array holding an "in clock" bit (the frame is unpinned and may be
+ * evicted) and a reference bit. Insert/Erase are a single atomic exchange on
+ * that slot; only Victim, which sweeps the clock hand clearing reference bits
+ * until it finds an unreferenced frame, takes a latch. Nothing is allocated
+ * after construction.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+#include "buffer/replacer.h"
+
+namespace cmudb {
+
+template<typename T>
+class ClockReplacer : public Replacer<T> {
+ public:
+  // maps a value onto its frame id in [0, num_frames)
+  typedef std::function<size_t(const T &)> FrameIdFunc;
+
+  ClockReplacer(size_t num_frames, FrameIdFunc frame_id);
+
+  ~ClockReplacer();
+
+  void Insert(const T &value);
+
+  bool Victim(T &value);
+
+  bool Erase(const T &value);
+
+  size_t Size();
+
+ private:
+  static const uint8_t IN_CLOCK = 1;
+  static const uint8_t REFERENCED = 2;
+
+  size_t num_frames_;
+  FrameIdFunc frame_id_;
+  std::vector<T> values_;
+  std::atomic<uint8_t> *flags_;
+  std::atomic<size_t> size_;
+  size_t hand_;
+  std::mutex hand_latch_; // serializes sweeping threads
+};
+
+} // namespace cmudb
@@ -0,0 +1,70 @@
+/**
+ * lru_k_replacer.h
+ *
+ * Functionality: LRU-K (O'Neil et al.). The victim is the evictable frame
+ * whose K-th most recent reference is the oldest; frames referenced fewer
+ * than K times have an infinite backward K-distance and go first, oldest
+ * reference first. A page touched once by a sequential scan therefore never
+ * pushes out an index page that is referenced over and over.
+ *
+ * References closer than correlated_period (in ticks of the replacer's own
+ * access clock) to the previous one are treated as the same reference, so
+ * the repeated fetches a scan makes of one page while walking its tuples
+ * only count once.
+ *
+ * History is kept per value (frame) and dropped when the frame is victimized
+ * or Reset, i.e. when it gets a different page.
+ */
+
+#pragma once
+
+#include <deque>
+#include <mutex>
+#include <set>
+#include <tuple>
+#include <unordered_map>
+
+#include "buffer/replacer.h"
+
+namespace cmudb {
+
+template<typename T>
+class LRUKReplacer : public Replacer<T> {
+ public:
+  explicit LRUKReplacer(size_t k = 2, size_t correlated_period = 0);
+
+  ~LRUKReplacer();
+
+  void Insert(const T &value);
+
+  bool Victim(T &value);
+
+  bool Erase(const T &value);
+
+  size_t Size();
+
+  void RecordAccess(const T &value);
+
+  void Reset(const T &value);
+
+ private:
+  struct History {
+    size_t last_;             // most recent reference, correlated or not
+    std::deque<size_t> hist_; // starts of uncorrelated references, newest first
+  };
+  // (has K references, K-th most recent or oldest reference, value)
+  typedef std::tuple<bool, size_t, T> EvictKey;
+
+  void record_access(const T &value);
+  EvictKey evict_key(const T &value);
+
+  size_t k_;
+  size_t correlated_period_;
+  size_t current_time_;
+  std::unordered_map<T, History> history_;
+  std::set<EvictKey> evictable_;
+  std::unordered_map<T, EvictKey> evictable_keys_;
+  std::mutex mtx_;
+};
+
+} // namespace cmudb
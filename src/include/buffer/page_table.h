@@ -0,0 +1,75 @@
+/**
+ * page_table.h
+ *
+ * Functionality: Maps the page id of every resident page to the index of the
+ * frame holding it. The buffer pool never has more entries than frames, so
+ * the table is a fixed, flat array of open-addressed slots sized at
+ * construction (load factor <= 1/2), probed linearly and never resized.
+ *
+ * Each slot is one 64-bit word (page id, frame id). The table has no latch
+ * of its own: every call, Find included, is serialized by the caller
+ * (BufferPoolInstance::latch_, which a lookup needs anyway to pin the page).
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+
+#include "common/config.h"
+
+namespace cmudb {
+
+class PageTable {
+public:
+  explicit PageTable(size_t num_frames);
+
+  ~PageTable();
+
+  bool Find(page_id_t page_id, size_t &frame_id) const;
+
+  // return false if page_id is already in the table
+  bool Insert(page_id_t page_id, size_t frame_id);
+
+  bool Remove(page_id_t page_id);
+
+  inline size_t GetSize() const { return size_; }
+
+  inline size_t GetCapacity() const { return capacity_; }
+
+private:
+  static const uint64_t EMPTY_SLOT = ~0ULL;
+
+  size_t capacity_; // power of two
+  size_t shift_;    // 64 - log2(capacity_)
+  size_t size_;
+  uint64_t *slots_;
+
+  inline size_t HomeSlot(page_id_t page_id) const {
+    // fibonacci hashing spreads consecutive page ids over the table
+    return static_cast<size_t>(
+        (static_cast<uint32_t>(page_id) * 0x9E3779B97F4A7C15ULL) >> shift_);
+  }
+
+  inline size_t NextSlot(size_t slot) const {
+    return (slot + 1) & (capacity_ - 1);
+  }
+
+  static inline uint64_t MakeSlot(page_id_t page_id, size_t frame_id) {
+    return (static_cast<uint64_t>(static_cast<uint32_t>(page_id)) << 32) |
+           static_cast<uint32_t>(frame_id);
+  }
+
+  static inline page_id_t SlotPageId(uint64_t slot) {
+    return static_cast<page_id_t>(slot >> 32);
+  }
+
+  static inline size_t SlotFrameId(uint64_t slot) {
+    return static_cast<size_t>(slot & 0xFFFFFFFFULL);
+  }
+
+  // slot holding page_id, or the empty slot ending its probe sequence
+  size_t Probe(page_id_t page_id, uint64_t &slot) const;
+};
+
+} // namespace cmudb
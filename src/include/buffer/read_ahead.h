@@ -0,0 +1,36 @@
+/**
+ * read_ahead.h
+ *
+ * Read-ahead for scans following a NextPageId chain (table heap pages, B+ tree
+ * leaves). A scan reports each page it moves onto together with that page's
+ * successor, and the successor is prefetched while the current page is being
+ * processed. Once the chain turns out to be sequential in page id order, as
+ * extent allocation makes it, the next PREFETCH_DEPTH pages of the same extent
+ * are prefetched in one batch instead: pages of an extent belong to the object
+ * that reserved it.
+ */
+
+#pragma once
+
+#include "buffer/buffer_pool_manager.h"
+
+namespace cmudb {
+
+class ReadAhead {
+public:
+  explicit ReadAhead(BufferPoolManager *buffer_pool_manager)
+      : buffer_pool_manager_(buffer_pool_manager),
+        current_page_id_(INVALID_PAGE_ID), window_end_(0) {}
+
+  // the scan is on page_id, which is followed by next_page_id; does nothing
+  // until the scan moves to another page
+  void Advance(page_id_t page_id, page_id_t next_page_id);
+
+private:
+  BufferPoolManager *buffer_pool_manager_;
+  page_id_t current_page_id_;
+  // pages from the sequential run below this have been prefetched already
+  page_id_t window_end_;
+};
+
+} // namespace cmudb
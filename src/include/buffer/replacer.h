@@ -9,6 +9,9 @@
 
 namespace cmudb {
 
+// replacement policy used by the buffer pool
+enum class ReplacerType { LRU = 0, CLOCK, LRU_K };
+
 template <typename T> class Replacer {
 public:
   Replacer() {}
@@ -17,6 +20,10 @@ public:
   virtual bool Victim(T &value) = 0;
   virtual bool Erase(const T &value) = 0;
   virtual size_t Size() = 0;
+  // value is referenced (fetched or created), whether pinned or not
+  virtual void RecordAccess(const T &value) {}
+  // value now stands for something else, forget what was learned about it
+  virtual void Reset(const T &value) {}
 };
 
 } // namespace cmudb
@@ -14,20 +14,44 @@ namespace cmudb {
 
 extern std::chrono::duration<long long int> LOG_TIMEOUT;
 
+// how long a commit waits for others to share its log write, 0: no wait
+extern std::chrono::microseconds GROUP_COMMIT_WINDOW;
+
+extern std::chrono::milliseconds PAGE_CLEANER_TIMEOUT;
+
+extern std::chrono::duration<long long int> CHECKPOINT_TIMEOUT;
+
 extern std::atomic<bool> ENABLE_LOGGING;
 
 #define INVALID_PAGE_ID -1 // representing an invalid page id
 #define INVALID_TXN_ID -1  // representing an invalid txn id
 #define INVALID_LSN -1     // representing an invalid lsn
 #define HEADER_PAGE_ID 0   // the header page id
-#define PAGE_SIZE 512     // size of a data page in byte
-#define LOG_BUFFER_SIZE                                                            \
-  ((BUFFER_POOL_SIZE + 1) * PAGE_SIZE) // size of a log buffer in byte
+#define DEFAULT_PAGE_SIZE 512          // page size of a new db file, in byte
+#define MIN_PAGE_SIZE 512              // page sizes are powers of two in
+#define MAX_PAGE_SIZE 65536            // [MIN_PAGE_SIZE, MAX_PAGE_SIZE]
+#define PAGE_CHECKSUM_SIZE 4           // CRC32C trailer ending every data page
+#define LOG_BUFFER_PAGES 11            // size of a log buffer in pages
+#define LOG_SEGMENT_SIZE 4194304       // bytes per log segment file
+#define REDO_THREADS 4                 // workers of parallel redo, 1: serial
+#define REDO_BATCH_SIZE 64             // records per hand-off to a redo worker
 #define BUCKET_SIZE 50                 // size of extendible hash bucket
-#define BUFFER_POOL_SIZE 10            // size of buffer pool
+#define EXTENT_SIZE 64                 // pages reserved at once for an object
+#define PREFETCH_DEPTH 8               // pages a sequential scan reads ahead
+#define BULK_LOAD_FILL_FACTOR 0.9      // share of a page a bulk load fills
+#define SORT_BUFFER_SIZE 16777216      // bytes an external sort keeps in memory
+#define BUFFER_POOL_SIZE 64            // default size of buffer pool
+#define BUFFER_POOL_INSTANCES 0        // buffer pool partitions, 0: per thread
+#define INSTANCE_MIN_FRAMES 16         // frames a partition gets, by default
+#define LRUK_K 2                       // references remembered by LRU-K
+#define LRUK_CORRELATED_PERIOD 4       // LRU-K correlated window, in accesses
+#define ASYNC_IO_DEPTH 64              // io_uring submission ring entries
+#define ASYNC_IO_THREADS 4             // workers of the thread pool backend
+#define FRAME_ALIGNMENT 4096           // alignment of the buffer pool frame arena
+#define DIRECT_IO_ALIGNMENT 512        // buffer/offset granularity of O_DIRECT
 
 typedef int32_t page_id_t; // page id type
 typedef int32_t txn_id_t;  // transaction id type
-typedef int32_t lsn_t;     // log sequence number type
+typedef int64_t lsn_t;     // log sequence number type, a log byte offset
 
 } // namespace cmudb
\ No newline at end of file
@@ -0,0 +1,22 @@
+/**
+ * crc32c.h
+ *
+ * CRC32C (Castagnoli polynomial), the checksum of log records and pages. It
+ * uses the SSE4.2 crc32 instruction when the build targets it, a lookup table
+ * otherwise.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace cmudb {
+
+// checksum of data[0, size); pass the checksum of the bytes before to go on
+uint32_t Crc32c(const char *data, size_t size, uint32_t crc = 0);
+
+// the table version, whatever the build targets
+uint32_t Crc32cSoftware(const char *data, size_t size, uint32_t crc = 0);
+
+} // namespace cmudb
@@ -41,6 +41,7 @@ enum ExceptionType {
   EXCEPTION_TYPE_STAT = 20,             // stat related
   EXCEPTION_TYPE_CONNECTION = 21,       // connection related
   EXCEPTION_TYPE_SYNTAX = 22,           // syntax related
+  EXCEPTION_TYPE_IO = 23,               // disk I/O, corrupted pages
 };
 
 class Exception : public std::runtime_error {
@@ -107,6 +108,8 @@ public:
       return "Connection";
     case EXCEPTION_TYPE_SYNTAX:
       return "Syntax";
+    case EXCEPTION_TYPE_IO:
+      return "IO";
     default:
       return "Unknown";
     }
@@ -35,8 +35,10 @@ class TableHeap;
 // write set record
 class WriteRecord {
  public:
-  WriteRecord(RID rid, WType wtype, const Tuple &tuple, TableHeap *table)
-      : rid_(rid), wtype_(wtype), tuple_(tuple), table_(table) {}
+  WriteRecord(RID rid, WType wtype, const Tuple &tuple, TableHeap *table,
+              lsn_t undo_next_lsn = INVALID_LSN)
+      : rid_(rid), wtype_(wtype), tuple_(tuple), table_(table),
+        undo_next_lsn_(undo_next_lsn) {}
 
   RID rid_;
   WType wtype_;
@@ -44,6 +46,8 @@ class WriteRecord {
   Tuple tuple_;
   // which table
   TableHeap *table_;
+  // the transaction's last LSN before this write, for the CLR rolling it back
+  lsn_t undo_next_lsn_;
 };
 
 class Transaction {
@@ -52,7 +56,8 @@ class Transaction {
   Transaction(txn_id_t txn_id)
       : state_(TransactionState::GROWING),
         thread_id_(std::this_thread::get_id()),
-        txn_id_(txn_id), prev_lsn_(INVALID_LSN), shared_lock_set_{new std::unordered_set<RID>},
+        txn_id_(txn_id), prev_lsn_(INVALID_LSN), undo_next_lsn_(INVALID_LSN),
+        shared_lock_set_{new std::unordered_set<RID>},
         exclusive_lock_set_{new std::unordered_set<RID>} {
     // initialize sets
     write_set_.reset(new std::deque<WriteRecord>);
@@ -109,6 +114,14 @@ class Transaction {
 
   inline void SetPrevLSN(lsn_t prev_lsn) { prev_lsn_ = prev_lsn; }
 
+  // while an ABORTED transaction rolls back, every change it logs is a CLR
+  // pointing here
+  inline lsn_t GetUndoNextLSN() { return undo_next_lsn_; }
+
+  inline void SetUndoNextLSN(lsn_t undo_next_lsn) {
+    undo_next_lsn_ = undo_next_lsn;
+  }
+
  private:
   TransactionState state_;
   // thread id, single-threaded transactions
@@ -117,8 +130,9 @@ class Transaction {
   txn_id_t txn_id_;
   // Below are used by transaction, undo set
   std::shared_ptr<std::deque<WriteRecord>> write_set_;
-  // prev lsn
-  lsn_t prev_lsn_;
+  // prev lsn, also read by checkpoints
+  std::atomic<lsn_t> prev_lsn_;
+  lsn_t undo_next_lsn_;
 
   // Below are used by concurrent index
   // this deque contains page pointer that was latched during index operation
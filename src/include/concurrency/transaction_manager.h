@@ -5,6 +5,8 @@
 
 #pragma once
 #include <atomic>
+#include <mutex>
+#include <unordered_map>
 #include <unordered_set>
 
 #include "common/config.h"
@@ -24,10 +26,24 @@ public:
 
   void addLog(Transaction *txn, LogRecordType recordType);
   void addLogAndWaitUntilFlushed(Transaction *txn, LogRecordType recordType);
+
+  // transactions between Begin and Commit/Abort with their last LSN
+  ActiveTxnTable GetActiveTxnTable();
+  // LSN of the oldest BEGIN record of those, INVALID_LSN if there is none;
+  // undoing them may need the log from there on
+  lsn_t GetOldestBeginLSN();
 private:
   std::atomic<txn_id_t> next_txn_id_;
   LockManager *lock_manager_;
   LogManager *log_manager_;
+  // the COMMIT/ABORT record is appended and the transaction removed under
+  // active_latch_, so a transaction missing from a checkpoint's table has
+  // its end record after that checkpoint began
+  std::mutex active_latch_;
+  // txn id -> (transaction, LSN of its BEGIN record)
+  std::unordered_map<txn_id_t, std::pair<Transaction *, lsn_t>> active_txns_;
+
+  void EndTransaction(Transaction *txn, LogRecordType recordType);
 };
 
 } // namespace cmudb
@@ -0,0 +1,116 @@
+/**
+ * async_io.h
+ *
+ * Asynchronous page I/O backends used by DiskManager. A backend accepts a
+ * batch of page reads/writes against the database file and calls every
+ * request's callback, from one of its own threads, once that request is done.
+ *
+ * IoUringIO queues the whole batch on an io_uring submission ring with a
+ * single system call and reaps completions on a dedicated thread. Where the
+ * kernel does not offer io_uring (or refuses it), ThreadPoolIO runs the
+ * requests as pread/pwrite calls on a fixed pool of worker threads.
+ *
+ * Callbacks run on the backend's threads: they must be short and must never
+ * wait for another request of the same backend to complete.
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "common/config.h"
+
+namespace cmudb {
+
+enum class AsyncIOType { AUTO = 0, IO_URING, THREAD_POOL };
+
+struct DiskRequest {
+  bool is_write;
+  page_id_t page_id;
+  char *data; // one page, must stay valid until callback runs (DiskManager
+              // copies the page of a write when it is submitted)
+  // true if the whole page was transferred; reads past the end of the file
+  // succeed and zero fill
+  std::function<void(bool)> callback;
+};
+
+class AsyncIO {
+public:
+  AsyncIO() {}
+  virtual ~AsyncIO() {}
+  virtual void Submit(std::vector<DiskRequest> &requests) = 0;
+  virtual AsyncIOType GetType() const = 0;
+};
+
+class ThreadPoolIO : public AsyncIO {
+public:
+  ThreadPoolIO(int fd, size_t page_size, size_t num_threads);
+  ~ThreadPoolIO();
+
+  void Submit(std::vector<DiskRequest> &requests) override;
+  AsyncIOType GetType() const override { return AsyncIOType::THREAD_POOL; }
+
+private:
+  void Work();
+
+  int fd_;
+  size_t page_size_;
+  std::vector<std::thread> workers_;
+  std::deque<DiskRequest> queue_;
+  std::mutex latch_;
+  std::condition_variable cv_;
+  bool shutdown_;
+};
+
+class IoUringIO : public AsyncIO {
+public:
+  // nullptr if io_uring is not available
+  static IoUringIO *Create(int fd, size_t page_size, unsigned entries);
+  ~IoUringIO();
+
+  void Submit(std::vector<DiskRequest> &requests) override;
+  AsyncIOType GetType() const override { return AsyncIOType::IO_URING; }
+
+private:
+  IoUringIO() {}
+  void Reap();
+  // caller must hold submit_latch_
+  void Enter(unsigned to_submit);
+
+  int fd_;
+  size_t page_size_;
+  int ring_fd_;
+  unsigned sq_entries_;
+  // submission ring, shared with the kernel
+  unsigned *sq_tail_;
+  unsigned *sq_mask_;
+  unsigned *sq_array_;
+  void *sqes_;
+  // completion ring, shared with the kernel
+  unsigned *cq_head_;
+  unsigned *cq_tail_;
+  unsigned *cq_mask_;
+  void *cqes_;
+  void *sq_ring_;
+  void *cq_ring_;
+  size_t sq_ring_size_;
+  size_t cq_ring_size_;
+  size_t sqes_size_;
+
+  std::mutex submit_latch_;          // one producer on the submission ring
+  std::condition_variable slots_cv_; // signalled when requests complete
+  unsigned in_flight_;               // never above sq_entries_
+  std::thread reaper_;
+};
+
+// pread/pwrite a whole page, retrying short transfers
+bool ReadPageAt(int fd, page_id_t page_id, char *page_data, size_t page_size);
+bool WritePageAt(int fd, page_id_t page_id, const char *page_data,
+                 size_t page_size);
+
+} // namespace cmudb
@@ -5,49 +5,173 @@
  * database. It also performs read and write of pages to and from disk, and
  * provides a logical file layer within the context of a database management
  * system.
+ *
+ * The page size is a property of the db file: a new file takes the one asked
+ * for, an existing one the one recorded in its header page (see
+ * HeaderPage::Init), so a file is always read with the page size it was
+ * written with.
+ *
+ * Allocation is tracked by a free page bitmap kept in the db file itself. The
+ * file is a sequence of groups, each made of BitsPerBitmap() data pages
+ * followed by the bitmap page covering them:
+ *
+ *   | page 0 | ... | page N-1 | bitmap 0 | page N | ... | page 2N-1 | bitmap 1 |
+ *
+ * Page ids only name data pages; DiskManager skips the bitmap pages when it
+ * maps a page id to a file offset. Page 0 stays at offset 0. A bitmap page is
+ * written through whenever it changes, so a page id in use is never handed
+ * out twice after a restart (a crash at worst leaks a freed page).
+ *
+ * Objects that are scanned in page order (table heaps, B+ tree leaves) keep
+ * their pages together by allocating in extents of EXTENT_SIZE aligned pages:
+ * AllocateExtent reserves a free extent and AllocatePage(near) fills the
+ * extent of near before reserving a new one. Plain AllocatePage never takes a
+ * page of a reserved extent. Reservations are kept in memory only; after a
+ * restart an extent is reserved again by the first AllocatePage(near) in it.
+ *
+ * Every data page ends in a CRC32C of the rest of it (PAGE_CHECKSUM_SIZE
+ * bytes). A write copies the page passed in and stamps the checksum into the
+ * copy, which is what goes to disk, so the checksum always covers the bytes
+ * written; asynchronous writes take that copy when they are submitted. Reads
+ * check it and report a mismatch, such as a torn write, as a failed read. A
+ * page never written reads as zeros and passes. Bitmap pages are internal and
+ * go without.
+ *
+ * With direct_io the db file is opened with O_DIRECT, bypassing the OS page
+ * cache (the buffer pool already caches pages). Frames of the buffer pool are
+ * aligned for it; any other buffer goes through an aligned bounce buffer. If
+ * the file system refuses O_DIRECT, the file is opened buffered instead.
+ *
+ * The log is one byte stream (LSNs are offsets into it) stored in segment
+ * files of log_segment_size bytes: segment 0 is <db>.log, segment k is
+ * <db>.log.k and holds offsets [k * log_segment_size, (k + 1) * ...). A
+ * record may straddle two segments. TruncateLog deletes the segments wholly
+ * below an offset nobody needs any more, the rest of the stream keeps its
+ * offsets. The segment size must stay the same for the life of a log.
+ * CutLog is the other end: recovery drops a torn or corrupted tail with it.
  */
 
 #pragma once
 #include <atomic>
+#include <chrono>
 #include <fstream>
 #include <future>
+#include <mutex>
 #include <string>
+#include <vector>
 
 #include "common/config.h"
+#include "disk/async_io.h"
 
 namespace cmudb {
 
 class DiskManager {
 public:
-  DiskManager(const std::string &db_file);
-  ~DiskManager();
+  DiskManager(const std::string &db_file,
+              AsyncIOType async_io_type = AsyncIOType::AUTO,
+              bool direct_io = false, size_t page_size = DEFAULT_PAGE_SIZE,
+              size_t log_segment_size = LOG_SEGMENT_SIZE);
+  virtual ~DiskManager();
+
+  // writes a checksummed copy, page_data is left as it is
+  virtual void WritePage(page_id_t page_id, const char *page_data);
+  // false if the page read back does not match its checksum
+  bool ReadPage(page_id_t page_id, char *page_data);
 
-  void WritePage(page_id_t page_id, const char *page_data);
-  void ReadPage(page_id_t page_id, char *page_data);
+  // asynchronous page I/O, the future is true once the page is transferred;
+  // a write copies page_data before returning
+  std::future<bool> WritePageAsync(page_id_t page_id, char *page_data);
+  std::future<bool> ReadPageAsync(page_id_t page_id, char *page_data);
+  // submit a batch of requests at once; every callback runs when its request
+  // completes, the returned future is ready when all of them have
+  std::future<void> SubmitBatch(std::vector<DiskRequest> requests);
+  AsyncIOType GetAsyncIOType();
+  // whether the db file really is opened with O_DIRECT
+  inline bool IsDirectIO() const { return direct_io_; }
+  // page size of the db file, every page buffer must hold this many bytes
+  inline size_t GetPageSize() const { return page_size_; }
+  // fdatasync the db file: page writes finished before the call survive a
+  // power loss once it returns true
+  virtual bool SyncData();
 
   void WriteLog(char *log_data, int size);
-  bool ReadLog(char *log_data, int size, int offset);
+  bool ReadLog(char *log_data, int size, int64_t offset);
+  // bytes in the log so far, LSNs are offsets into it
+  int64_t GetLogSize();
+  // delete the log segments that end at or before offset
+  virtual void TruncateLog(int64_t offset);
+  // drop the log from offset on
+  void CutLog(int64_t offset);
+  // offset of the first byte still on disk
+  int64_t GetLogStart();
 
+  // lowest free page id, reusing deallocated pages before growing the file
   page_id_t AllocatePage();
+  // a page in the extent of near, or the first page of a new extent if that
+  // one is full
+  page_id_t AllocatePage(page_id_t near);
+  // reserve a free extent, the first page of it is returned allocated
+  page_id_t AllocateExtent();
   void DeallocatePage(page_id_t page_id);
+  bool IsAllocated(page_id_t page_id);
 
   int GetNumFlushes() const;
+  std::chrono::nanoseconds GetLogSyncTime();
   bool GetFlushState() const;
   inline void SetFlushLogFuture(std::future<void> *f) { flush_log_f_ = f; }
   inline bool HasFlushLogFuture() { return flush_log_f_ != nullptr; }
 
 private:
   int GetFileSize(const std::string &name);
-  // stream to write log file
-  std::fstream log_io_;
+  int OpenDbFile(bool direct_io);
+  void LoadPageSize();
+  std::string LogSegmentName(int segment) const;
+  void LoadLogSegments();
+  void OpenLogSegment(int segment);
+  bool NeedsBounce(const char *page_data) const;
+  void Submit(std::vector<DiskRequest> &requests);
+  // free page bitmap, caller must hold alloc_latch_ unless noted
+  inline size_t BitsPerBitmap() const { return page_size_ * 8; }
+  // file position, in pages, of a data page (no latch needed)
+  page_id_t PhysicalPageId(page_id_t page_id) const;
+  void LoadBitmaps();
+  void SetAllocated(page_id_t page_id, bool allocated);
+  char *GetBitmap(size_t group);
+  bool TestBit(page_id_t page_id);
+  page_id_t TakePage(page_id_t page_id);
+  page_id_t ReserveExtent();
+  bool IsReserved(page_id_t page_id) const;
+  void SetReserved(page_id_t page_id, bool reserved);
+  // appends to the last log segment, -1 if none is open
+  int log_fd_ = -1;
   std::string log_name_;
-  // stream to write db file
-  std::fstream db_io_;
+  std::mutex log_latch_;     // protects the log members below
+  size_t log_segment_size_;
+  int log_segment_;          // segment log_fd_ is open on, -1 if none
+  int first_log_segment_;    // lowest segment still on disk
+  int64_t log_size_;         // end of the log stream
+  std::chrono::nanoseconds log_sync_time_{0}; // spent in fdatasync
+  // db file, accessed with pread/pwrite only so any thread may use it
+  int db_fd_;
+  bool direct_io_;
+  size_t page_size_;
   std::string file_name_;
-  std::atomic<page_id_t> next_page_id_;
+  // asynchronous backend, started on first use
+  AsyncIOType async_io_type_;
+  AsyncIO *async_io_;
+  std::once_flag async_io_init_;
+  AsyncIO *GetAsyncIO();
+  std::mutex alloc_latch_;
+  std::vector<char *> bitmaps_;   // one aligned page per group, bit set: used
+  page_id_t next_page_id_;        // one past the highest page ever allocated
+  page_id_t free_hint_;           // no free unreserved page below this id
+  page_id_t free_extent_hint_;    // no free unreserved extent below this id
+  std::vector<bool> reserved_;    // indexed by extent
   int num_flushes_;
   bool flush_log_;
   std::future<void> *flush_log_f_;
+  // log buffer of the previous WriteLog, to check the buffers are swapped
+  char *buffer_used_;
 };
 
 } // namespace cmudb
\ No newline at end of file
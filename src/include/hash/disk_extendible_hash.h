@@ -0,0 +1,83 @@
+/**
+ * disk_extendible_hash.h
+ *
+ * Extendible hash table stored in buffer pool pages: one directory page and
+ * any number of bucket pages. An equality lookup fetches the directory and a
+ * single bucket. Only supports unique keys, like BPlusTree.
+ *
+ * The directory page id is recorded in the header page under the index name,
+ * as BPlusTree does for its root.
+ *
+ * Concurrency: table_latch_ is taken shared by lookups and by inserts/removes
+ * that stay within one bucket, which then latch that bucket page. Splitting a
+ * full bucket, merging an emptied one and shrinking the directory take
+ * table_latch_ exclusively, so the directory page itself is never latched.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "buffer/buffer_pool_manager.h"
+#include "common/rwmutex.h"
+#include "concurrency/transaction.h"
+#include "page/hash_table_bucket_page.h"
+#include "page/hash_table_directory_page.h"
+
+namespace cmudb {
+
+#define DISK_EXTENDIBLE_HASH_TYPE                                              \
+  DiskExtendibleHash<KeyType, ValueType, KeyComparator>
+
+INDEX_TEMPLATE_ARGUMENTS
+class DiskExtendibleHash {
+public:
+  explicit DiskExtendibleHash(const std::string &name,
+                              BufferPoolManager *buffer_pool_manager,
+                              const KeyComparator &comparator,
+                              page_id_t directory_page_id = INVALID_PAGE_ID);
+
+  // Returns true if no directory has been created yet
+  bool IsEmpty() const;
+
+  // Insert a key-value pair, false if key exists; throws if the bucket of key
+  // is full and the directory is at its maximum depth
+  bool Insert(const KeyType &key, const ValueType &value,
+              Transaction *transaction = nullptr);
+
+  // Remove a key and its value, false if key does not exist
+  bool Remove(const KeyType &key, Transaction *transaction = nullptr);
+
+  // return the value associated with a given key
+  bool GetValue(const KeyType &key, std::vector<ValueType> &result,
+                Transaction *transaction = nullptr);
+
+  page_id_t GetDirectoryPageId() const { return directory_page_id_; }
+
+  // expose for test purpose
+  uint32_t GetGlobalDepth();
+  void VerifyIntegrity();
+
+private:
+  uint32_t Hash(const KeyType &key) const;
+
+  HashTableDirectoryPage *FetchDirectoryPage();
+  HASH_TABLE_BUCKET_TYPE *BucketOf(Page *page);
+
+  // caller must hold table_latch_ exclusively
+  void CreateDirectory();
+  bool SplitInsert(const KeyType &key, const ValueType &value);
+  void Merge(const KeyType &key);
+
+  void UpdateDirectoryPageId(int insert_record = false);
+
+  // member variable
+  std::string index_name_;
+  page_id_t directory_page_id_;
+  BufferPoolManager *buffer_pool_manager_;
+  KeyComparator comparator_;
+  RWMutex table_latch_;
+};
+
+} // namespace cmudb
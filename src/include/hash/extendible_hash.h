@@ -5,6 +5,13 @@
  * Functionality: The buffer pool manager must maintain a page table to be able
  * to quickly map a PageId to its corresponding memory location; or alternately
  * report that the PageId does not match any currently-buffered page.
+ *
+ * Concurrency: the directory is guarded by a reader/writer latch and every
+ * bucket by its own latch. Find, Remove and an Insert that fits into its
+ * bucket hold the directory latch shared plus one bucket latch, so they only
+ * contend on the same bucket. Splitting a full bucket and merging an emptied
+ * one (then halving the directory while no bucket needs its full depth)
+ * change the directory and take its latch exclusively.
  */
 
 #pragma once
@@ -12,10 +19,10 @@
 #include <cstdlib>
 #include <vector>
 #include <string>
-#include <map>
-#include <memory>
 #include <mutex>
+#include <utility>
 
+#include "common/rwmutex.h"
 #include "hash/hash_table.h"
 
 namespace cmudb {
@@ -26,6 +33,8 @@ class ExtendibleHash : public HashTable<K, V> {
   // constructor
   ExtendibleHash(size_t size);
 
+  ~ExtendibleHash();
+
   // helper function to generate hash addressing
   size_t HashKey(const K &key);
 
@@ -48,19 +57,26 @@ class ExtendibleHash : public HashTable<K, V> {
   class Bucket {
    public:
     int localDepth;
-    std::map<K, V> contents;
+    size_t size;                          // entries in use, slots[0, size)
+    std::vector<std::pair<K, V>> slots;   // fixed capacity, never grows
+    std::mutex latch;
 
-    Bucket(int depth) : localDepth(depth) {}
+    Bucket(int depth, size_t capacity)
+        : localDepth(depth), size(0), slots(capacity) {}
+
+    // slot index of key, or size if absent
+    size_t find(const K &key) const;
   };
 
-  std::vector<std::shared_ptr<Bucket>> bucketDirectory;
+  std::vector<Bucket *> bucketDirectory;
   int globalDepth;
   const size_t bucketSizeLimit;
+  mutable RWMutex directoryLatch;
 
   int getBucketIndex(size_t hashKey) const;
 
-  std::shared_ptr<Bucket> getBucket(const K &key);
-
-  std::mutex mtx;
+  // caller must hold directoryLatch exclusively
+  void split(const K &key);
+  void merge(const K &key);
 };
 } // namespace cmudb
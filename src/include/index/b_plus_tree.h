@@ -7,10 +7,34 @@
  * (2) support insert & remove
  * (3) The structure should shrink and grow dynamically
  * (4) Implement index iterator for range scan
+ *
+ * Concurrency is optimistic latch coupling (OLC) on a B-link tree: every page
+ * links to its right sibling and knows its high key (see the page headers).
+ * Lookups take no latches: they go down holding pins only, reading each node
+ * between StableVersion and ValidateVersion (see page.h). A child that split
+ * after its pointer was read is no reason to start over, a key beyond its
+ * high key is followed to the right sibling. Only merges and redistributions,
+ * which move keys left or take pages out of the tree, make a descent start
+ * over from the root; they bump shrink_epoch_, which descents check.
+ * Insert and Remove descend the same way and then write latch only the leaf;
+ * if the leaf could split or underflow, they crab down instead (GetLeafPage),
+ * keeping the ancestors that may change write latched. Crabbing starts at the
+ * deepest page the descent saw that cannot split or underflow itself, so the
+ * root is only latched when it might change.
+ *
+ * BulkLoad builds a tree from sorted input bottom-up instead: leaves are
+ * written left to right, filled up to a fill factor, and each page is added to
+ * the level above it as soon as it is complete, so every level is built left
+ * to right at the same time. External sorting of unsorted input is left to
+ * ExternalSorter (external_sort.h).
  */
 #pragma once
 
+#include <algorithm>
+#include <deque>
+#include <functional>
 #include <queue>
+#include <thread>
 #include <vector>
 
 #include "concurrency/transaction.h"
@@ -44,6 +68,26 @@ class BPlusTree {
   bool GetValue(const KeyType &key, std::vector<ValueType> &result,
                 Transaction *transaction = nullptr);
 
+  // Build the tree at once from pairs that next hands out in ascending key
+  // order, pages filled up to fill_factor (at least half). The tree must be
+  // empty and nobody may use it meanwhile. Of equal keys the first one is kept
+  void BulkLoad(const std::function<bool(KeyType &, ValueType &)> &next,
+                double fill_factor = BULK_LOAD_FILL_FACTOR);
+  // the same from a sorted range of key & value pairs
+  template<typename Iterator>
+  void BulkLoad(Iterator begin, Iterator end,
+                double fill_factor = BULK_LOAD_FILL_FACTOR) {
+    BulkLoad([&begin, &end](KeyType &key, ValueType &value) {
+      if (begin == end) {
+        return false;
+      }
+      key = begin->first;
+      value = begin->second;
+      ++begin;
+      return true;
+    }, fill_factor);
+  }
+
   // index iterator
   INDEXITERATOR_TYPE Begin();
   INDEXITERATOR_TYPE Begin(const KeyType &key);
@@ -89,11 +133,43 @@ class BPlusTree {
 
   bool AdjustRoot(BPlusTreePage *node);
 
+  // one level of a bulk load: the page being filled and the one before it,
+  // both pinned. A page only goes up to its parent once the page after it is
+  // started, so that the last two pages can still be evened out at the end
+  struct BulkLevel {
+    Page *prev = nullptr;
+    Page *cur = nullptr;
+    // largest keys under prev and cur
+    KeyType prev_max{};
+    KeyType cur_max{};
+    // some page of this level went up already
+    bool has_parent = false;
+  };
+  struct BulkState {
+    // leaves first; a deque, so that levels stay put while the tree grows
+    std::deque<BulkLevel> levels;
+    // all pages taken, to give back if the load fails
+    std::vector<page_id_t> pages;
+    double fill_factor;
+  };
+  Page *BulkNewPage(BulkState &state, size_t level);
+  void BulkAddChild(BulkState &state, size_t level, Page *child,
+                    const KeyType &child_max);
+  void BulkPushUp(BulkState &state, size_t level);
+  void BulkEvenOut(BulkState &state, size_t level);
+  void BulkAbort(BulkState &state);
+  int BulkFill(BPlusTreePage *node, double fill_factor) const {
+    return std::max(static_cast<int>(node->GetMaxSize() * fill_factor),
+                    node->GetMaxSize() / 2);
+  }
+
   void UpdateRootPageId(int insert_record = false);
 
   // member variable
   std::string index_name_;
   std::atomic<page_id_t> root_page_id_;
+  // bumped by every merge or redistribution, before its pages are unlatched
+  std::atomic<uint64_t> shrink_epoch_{0};
   BufferPoolManager *buffer_pool_manager_;
   KeyComparator comparator_;
   mutable std::mutex mtx;//protect b plus tree instance,it's not used to protect concurrent r/w
@@ -119,54 +195,41 @@ class BPlusTree {
     return GetPageSmartPtr<BPInternalPage>(page_id, *buffer_pool_manager_);
   }
 
-  B_PLUS_TREE_LEAF_PAGE_TYPE *GetLeafPage(const KeyType &key,
-                                          Transaction *transaction = nullptr,
-                                          int findInsertDelete = 0);
-
-  void UnLockSharedPage(BPlusTreePage *bPlusTreePage) {
-    Page *tmp = buffer_pool_manager_->FetchPage(bPlusTreePage->GetPageId());
-    tmp->RUnlatch();
-    buffer_pool_manager_->UnpinPage(tmp->GetPageId(), false);
-  }
-
-  void LockExclusivePage(BPlusTreePage *bPlusTreePage) {
-    Page *tmp = buffer_pool_manager_->FetchPage(bPlusTreePage->GetPageId());
-    tmp->WLatch();
-    buffer_pool_manager_->UnpinPage(tmp->GetPageId(), false);
-  }
+  // an internal page an insert (1) or remove (2) cannot split or underflow,
+  // pinned, as an optimistic descent saw it
+  struct SafePage {
+    Page *page = nullptr;
+    uint64_t version = 0;
+  };
 
-  void UnLockExclusivePage(BPlusTreePage *bPlusTreePage) {
-    Page *tmp = buffer_pool_manager_->FetchPage(bPlusTreePage->GetPageId());
-    tmp->WUnlatch();
-    buffer_pool_manager_->UnpinPage(tmp->GetPageId(), false);
-  }
-
-  void LockSharedPage(BPlusTreePage *bPlusTreePage) {
-    Page *tmp = buffer_pool_manager_->FetchPage(bPlusTreePage->GetPageId());
-    tmp->RLatch();
-    buffer_pool_manager_->UnpinPage(tmp->GetPageId(), false);
-  }
-
-  Page *BPlusTreePageToPage(BPlusTreePage *bPlusTreePage) {
-    Page *tmp = buffer_pool_manager_->FetchPage(bPlusTreePage->GetPageId());
-    buffer_pool_manager_->UnpinPage(tmp->GetPageId(), false);
-    return tmp;
+  // latch crabbing for inserts (1) and removes (2) the leaf may not take,
+  // from start if that did not change, from the root otherwise
+  B_PLUS_TREE_LEAF_PAGE_TYPE *GetLeafPage(const KeyType &key,
+                                          Transaction *transaction,
+                                          int findInsertDelete,
+                                          SafePage &start);
+
+  // optimistic descent, the leaf comes back pinned with its version; with
+  // safe given, the deepest safe page for findInsertDelete is kept there
+  Page *FindLeafOptimistic(const KeyType &key, bool leftMost,
+                           uint64_t &version, int findInsertDelete = 0,
+                           SafePage *safe = nullptr);
+  bool IsSafe(BPlusTreePage *node, int findInsertDelete) const {
+    return findInsertDelete == 1 ? node->GetSize() < node->GetMaxSize()
+                                 : node->GetSize() > node->GetMinSize();
   }
-
-  void lockFor(int findInsertDelete, BPlusTreePage *btp) {
-    if (findInsertDelete != 0) {
-      LockExclusivePage(btp);
-    } else {
-      LockSharedPage(btp);
+  // whether key is beyond the high key of node, so it went right in a split
+  bool PastHighKey(BPlusTreePage *node, const KeyType &key) const {
+    if (node->IsLeafPage()) {
+      return reinterpret_cast<B_PLUS_TREE_LEAF_PAGE_TYPE *>(node)->PastHighKey(key, comparator_);
     }
+    return reinterpret_cast<BPInternalPage *>(node)->PastHighKey(key, comparator_);
   }
 
-  void unlockFor(int findInsertDelete, BPlusTreePage *btp) {
-    if (findInsertDelete != 0) {
-      UnLockExclusivePage(btp);
-    } else {
-      UnLockSharedPage(btp);
-    }
+  // optimistic readers and iterators may still hold a pin on a page just
+  // taken out of the tree, the last of them to unpin it frees it
+  void DeleteTreePage(page_id_t page_id) {
+    buffer_pool_manager_->RetirePage(page_id);
   }
 
   void unlockFor(int findInsertDelete, Page *page) {
@@ -194,12 +257,10 @@ class BPlusTree {
       buffer_pool_manager_->UnpinPage(toUnlock->GetPageId(), dirty);
     }
     if(findInsertDelete == 2){
+      //deleted pages are in the page set as well, unlatched by now
       std::unordered_set<page_id_t> & ref = *transaction->GetDeletedPageSet();
       for(auto iter = ref.begin(); iter !=ref.end(); iter++){
-        Page* page = buffer_pool_manager_->FetchPage(*iter);
-        unlockFor(findInsertDelete, page);
-        buffer_pool_manager_->UnpinPage(*iter, false);//unpin page
-        buffer_pool_manager_->DeletePage(*iter);//do delete
+        DeleteTreePage(*iter);//do delete
       }
       ref.clear();
     }
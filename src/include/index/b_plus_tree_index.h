@@ -9,6 +9,7 @@
 #include <vector>
 
 #include "index/b_plus_tree.h"
+#include "index/external_sort.h"
 #include "index/index.h"
 
 namespace cmudb {
@@ -34,6 +35,9 @@ public:
   void ScanKey(const Tuple &key, std::vector<RID> &result,
                Transaction *transaction = nullptr) override;
 
+  void BulkLoad(const std::function<bool(Tuple &key, RID &rid)> &next,
+                Transaction *transaction = nullptr) override;
+
 protected:
   // comparator for key
   KeyComparator comparator_;
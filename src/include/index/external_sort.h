@@ -0,0 +1,65 @@
+/**
+ * external_sort.h
+ * Sort key & value pairs that may not fit in memory, for bulk loading an index
+ *
+ * Pairs are gathered in a buffer of up to memory_limit bytes. A full buffer
+ * is sorted and written out to a temporary file as a run. Finish merges the
+ * runs, reading each through a window of its own, with a heap on the run
+ * heads. If everything fit in the buffer, nothing is written. Equal keys come
+ * out in the order they were added.
+ */
+#pragma once
+#include <cstdio>
+#include <vector>
+
+#include "common/config.h"
+#include "page/b_plus_tree_page.h"
+
+namespace cmudb {
+
+#define EXTERNALSORTER_TYPE ExternalSorter<KeyType, ValueType, KeyComparator>
+
+INDEX_TEMPLATE_ARGUMENTS
+class ExternalSorter {
+ public:
+  explicit ExternalSorter(const KeyComparator &comparator,
+                          size_t memory_limit = SORT_BUFFER_SIZE);
+  ~ExternalSorter();
+  ExternalSorter(const ExternalSorter &) = delete;
+  ExternalSorter &operator=(const ExternalSorter &) = delete;
+
+  void Add(const KeyType &key, const ValueType &value);
+  // no more Add, the pairs come out of Next in key order
+  void Finish();
+  bool Next(KeyType &key, ValueType &value);
+
+  // runs written to temporary files so far
+  size_t GetRunCount() const { return spilled_; }
+
+ private:
+  // a sorted run; the one still in memory has no file
+  struct Run {
+    FILE *file = nullptr;
+    std::vector<MappingType> window;
+    size_t pos = 0;
+  };
+
+  void SpillRun();
+  // next window of the run, false when the run is used up
+  bool Refill(Run &run);
+  // whether the head of run a goes before the head of run b
+  bool Before(size_t a, size_t b) const;
+
+  KeyComparator comparator_;
+  // pairs the buffer and, while merging, all windows together hold
+  size_t capacity_;
+  std::vector<MappingType> buffer_;
+  std::vector<Run> runs_;
+  // heap of the runs not used up yet, the next pair out on top
+  std::vector<size_t> heap_;
+  size_t window_size_ = 0;
+  size_t spilled_ = 0;
+  bool finished_ = false;
+};
+
+} // namespace cmudb
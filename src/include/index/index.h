@@ -4,6 +4,7 @@
 
 #pragma once
 
+#include <functional>
 #include <memory>
 #include <string>
 #include <vector>
@@ -133,6 +134,17 @@ public:
   virtual void ScanKey(const Tuple &key, std::vector<RID> &result,
                        Transaction *transaction = nullptr) = 0;
 
+  // fill the empty index with the entries next hands out, in any order;
+  // one InsertEntry after the other unless the index can do better
+  virtual void BulkLoad(const std::function<bool(Tuple &key, RID &rid)> &next,
+                        Transaction *transaction = nullptr) {
+    Tuple key;
+    RID rid;
+    while (next(key, rid)) {
+      InsertEntry(key, rid, transaction);
+    }
+  }
+
 private:
   //===--------------------------------------------------------------------===//
   //  Data members
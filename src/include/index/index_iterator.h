@@ -3,6 +3,7 @@
  * For range scan of b+ tree
  */
 #pragma once
+#include "buffer/read_ahead.h"
 #include "page/b_plus_tree_leaf_page.h"
 
 namespace cmudb {
@@ -15,14 +16,20 @@ class IndexIterator {
  public:
   // you may define your own constructor based on your member variables
   IndexIterator(page_id_t page_id, int idx, BufferPoolManager &buff) :
-      index(idx), bufferPoolManager(buff) {
+      index(idx), bufferPoolManager(buff), readAhead(&buff) {
     leafPage = GetLeafPage(page_id);
+    // the tree is empty
+    if (leafPage == nullptr) {
+      noMoreRecords = true;
+      return;
+    }
+    readAhead.Advance(page_id, leafPage->GetNextPageId());
     assert(index >= 0);
     noMoreRecords = leafPage->GetSize() <= index;
   }
   ~IndexIterator();
 
-  IndexIterator(const IndexIterator &from) : IndexIterator(from.leafPage->GetPageId(),
+  IndexIterator(const IndexIterator &from) : IndexIterator(from.leafPage ? from.leafPage->GetPageId() : INVALID_PAGE_ID,
                                                            from.index,
                                                            from.bufferPoolManager) {
   }
@@ -49,6 +56,8 @@ class IndexIterator {
         bufferPoolManager.UnpinPage(leafPage->GetPageId(), false);
         leafPage =
             reinterpret_cast<B_PLUS_TREE_LEAF_PAGE_TYPE *> (bufferPoolManager.FetchPage(next)->GetData());
+        // overlap the read of the following leaves with this one
+        readAhead.Advance(next, leafPage->GetNextPageId());
       }
     }
     return *this;
@@ -59,6 +68,7 @@ class IndexIterator {
   B_PLUS_TREE_LEAF_PAGE_TYPE *leafPage;
   int index;
   BufferPoolManager &bufferPoolManager;
+  ReadAhead readAhead;
   bool noMoreRecords;
 
   B_PLUS_TREE_LEAF_PAGE_TYPE *GetLeafPage(page_id_t page_id) {
@@ -0,0 +1,62 @@
+/**
+ * checkpoint_manager.h
+ * Fuzzy checkpoints: a BEGIN_CHECKPOINT record, then an END_CHECKPOINT record
+ * carrying the active transaction table and the dirty page table, taken while
+ * transactions keep running (several END_CHECKPOINT records if the tables do
+ * not fit in one log buffer). Once they are on disk the master record in the
+ * header page is pointed at the begin record, so recovery analyses from there
+ * and redoes from the smallest recovery LSN instead of the start of the log.
+ * The log segments before that point (and before any transaction recovery
+ * may have to undo) are deleted then, so the log does not grow forever.
+ * Can run in a separate thread that checkpoints every CHECKPOINT_TIMEOUT.
+ */
+
+#pragma once
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "buffer/buffer_pool_manager.h"
+#include "concurrency/transaction_manager.h"
+#include "logging/log_manager.h"
+
+namespace cmudb {
+
+class CheckpointManager {
+public:
+  CheckpointManager(DiskManager *disk_manager,
+                    TransactionManager *transaction_manager,
+                    LogManager *log_manager,
+                    BufferPoolManager *buffer_pool_manager)
+      : disk_manager_(disk_manager),
+        transaction_manager_(transaction_manager), log_manager_(log_manager),
+        buffer_pool_manager_(buffer_pool_manager),
+        checkpoint_thread_(nullptr), checkpoint_thread_on_(false) {}
+
+  ~CheckpointManager() { StopCheckpointThread(); }
+
+  // @return: LSN of the begin checkpoint record, INVALID_LSN if logging is off
+  lsn_t Checkpoint();
+
+  void RunCheckpointThread();
+  void StopCheckpointThread();
+
+private:
+  DiskManager *disk_manager_;
+  TransactionManager *transaction_manager_;
+  LogManager *log_manager_;
+  BufferPoolManager *buffer_pool_manager_;
+  // serializes checkpoints
+  std::mutex checkpoint_latch_;
+  // checkpoint thread
+  std::thread *checkpoint_thread_;
+  bool checkpoint_thread_on_;
+  std::mutex thread_latch_;
+  std::condition_variable thread_cv_;
+
+  lsn_t AppendEndCheckpoint(lsn_t begin_lsn, const ActiveTxnTable &active_txns,
+                            const DirtyPageTable &dirty_pages);
+  void CheckpointPeriodically();
+};
+
+} // namespace cmudb
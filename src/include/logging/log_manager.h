@@ -3,6 +3,21 @@
  * log manager maintain a separate thread that is awaken when the log buffer is
  * full or time out(every X second) to write log buffer's content into disk log
  * file.
+ *
+ * Group commit: a committer only waits until its own record is on disk
+ * (WaitForLSN). Whoever waits wakes the flush thread, which may hold on for
+ * GROUP_COMMIT_WINDOW so that more committers join, and then writes all they
+ * appended at once; one write makes every record up to its end persistent.
+ *
+ * Appending takes no lock. The two buffers take turns; reserve_state_ packs
+ * the generation of the one being filled (its index is the generation's low
+ * bit) with the bytes reserved in it. An appender reserves its bytes with a
+ * compare-and-swap, which gives it its LSN (the buffer's base LSN plus the
+ * offset), serializes the record there in parallel with the others and adds
+ * its size to the buffer's filled count. The flush thread seals the buffer by
+ * moving reserve_state_ to the next generation, waits until everything
+ * reserved is filled and writes it out. An appender whose record does not fit
+ * waits for that switch.
  */
 
 #pragma once
@@ -19,28 +34,33 @@ namespace cmudb {
 class LogManager {
  public:
   LogManager(DiskManager *disk_manager)
-      : next_lsn_(0), persistent_lsn_(INVALID_LSN),
-        disk_manager_(disk_manager) {
-    log_buffer_ = new char[LOG_BUFFER_SIZE];
-    flush_buffer_ = new char[LOG_BUFFER_SIZE];
+      : persistent_lsn_(disk_manager->GetLogSize() - 1),
+        disk_manager_(disk_manager),
+        log_buffer_capacity_(LOG_BUFFER_PAGES * disk_manager->GetPageSize()),
+        reserve_state_(0) {
+    for (int i = 0; i < 2; ++i) {
+      log_buffers_[i] = new char[log_buffer_capacity_];
+      filled_[i] = 0;
+    }
+    base_lsn_[0] = disk_manager->GetLogSize();
+    base_lsn_[1] = INVALID_LSN;
     flush_thread_on = false;
   }
 
   ~LogManager() {
     StopFlushThread();
-    delete[] log_buffer_;
-    delete[] flush_buffer_;
-    log_buffer_ = nullptr;
-    flush_buffer_ = nullptr;
+    for (int i = 0; i < 2; ++i) {
+      delete[] log_buffers_[i];
+      log_buffers_[i] = nullptr;
+    }
   }
   // spawn a separate thread to wake up periodically to flush
   void RunFlushThread();
   void StopFlushThread();
+  // block until every record up to and including lsn is on disk
+  void WaitForLSN(lsn_t lsn);
+  // block until every record appended so far is on disk
   void FlushNowBlocking();
-  void SwapBuffer();
-  void GetBgTaskToWork();
-  void WaitUntilBgTaskFinish();
-  int lastLsn(char* buff, int size);
 
   // guess this is the SerializeLogRecord mentioned project brief but doesn't show up in code base
   // append a log record into log buffer
@@ -49,20 +69,29 @@ class LogManager {
   // get/set helper functions
   inline lsn_t GetPersistentLSN() { return persistent_lsn_; }
   inline void SetPersistentLSN(lsn_t lsn) { persistent_lsn_ = lsn; }
-  inline char *GetLogBuffer() { return log_buffer_; }
+  lsn_t GetNextLSN();
+  // no record can be larger than a log buffer
+  inline int GetBufferCapacity() { return log_buffer_capacity_; }
+  // the log ends before lsn, drop the rest; nothing may be appended yet
+  void CutLog(lsn_t lsn);
 
   void bgFsync();
  private:
-  // TODO: you may add your own member variables
-  // also remember to change constructor accordingly
+  void Flush(std::unique_lock<std::mutex> &lock);
+  void SerializeLogRecord(char *data, LogRecord &log_record);
 
-  // atomic counter, record the next log sequence number
-  std::atomic<lsn_t> next_lsn_;
-  // log records before & include persistent_lsn_ have been written to disk
+  static inline uint64_t Generation(uint64_t state) { return state >> 32; }
+  static inline int Reserved(uint64_t state) {
+    return static_cast<int>(state & 0xffffffff);
+  }
+  static inline uint64_t MakeState(uint64_t generation, int reserved) {
+    return (generation << 32) | static_cast<uint32_t>(reserved);
+  }
+
+  // log records before & include persistent_lsn_ have been written to disk;
+  // the LSN of a record is its byte offset in the log file, so LSNs keep
+  // growing across restarts and recovery can seek straight to one
   std::atomic<lsn_t> persistent_lsn_;
-  // log buffer related
-  char *log_buffer_;
-  char *flush_buffer_;
   // latch to protect shared member variables
   std::mutex latch_;
   // flush thread
@@ -71,13 +100,24 @@ class LogManager {
   std::condition_variable cv_;
   // disk manager
   DiskManager *disk_manager_;
+  // size of each log buffer, LOG_BUFFER_PAGES pages of the db file
+  int log_buffer_capacity_;
 
   //========new member==========
   std::atomic<bool> flush_thread_on;
+  // signalled when a buffer has been sealed or persistent_lsn_ moved on
   std::condition_variable flushed;
-  std::mutex log_mtx_;
-  int flush_buffer_size_{0};
-  int log_buffer_size_{0};
+  // generation of the buffer being filled << 32 | bytes reserved in it
+  std::atomic<uint64_t> reserve_state_;
+  char *log_buffers_[2];
+  // LSN of the first byte of each buffer, set before its generation opens
+  std::atomic<lsn_t> base_lsn_[2];
+  // bytes of each buffer whose records are serialized
+  std::atomic<int> filled_[2];
+  // largest LSN somebody waits for to become persistent
+  lsn_t wait_lsn_{INVALID_LSN};
+  // an appender waits for the buffer being filled to be sealed
+  bool buffer_full_{false};
 };
 
 } // namespace cmudb
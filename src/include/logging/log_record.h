@@ -2,32 +2,54 @@
  * log_record.h
  * For every write operation on table page, you should write ahead a
  * corresponding log record.
- * For EACH log record, HEADER is like (5 fields in common, 20 bytes in total)
- *-------------------------------------------------------------
- * | size | LSN | transID | prevLSN | LogType |
- *-------------------------------------------------------------
+ * For EACH log record, HEADER is like (6 fields in common, 32 bytes in total)
+ *------------------------------------------------------------------------------
+ * | size(4) | transID(4) | LSN(8) | prevLSN(8) | LogType(4) | checksum(4) |
+ *------------------------------------------------------------------------------
+ * checksum is the CRC32C of the whole record but itself: a record torn by a
+ * crash, or any garbage after the last one, fails it and marks the end of log
  * For insert type log record
  *-------------------------------------------------------------
  * | HEADER | tuple_rid | tuple_size | tuple_data(char[] array) |
  *-------------------------------------------------------------
- * For delete type(including markdelete, rollbackdelete, applydelete)
+ * For markdelete and rollbackdelete type log record, only flipping a flag,
+ * and applydelete, which follows the COMMIT and is never undone
  *-------------------------------------------------------------
- * | HEADER | tuple_rid | tuple_size | tuple_data(char[] array) |
+ * | HEADER | tuple_rid |
  *-------------------------------------------------------------
- * For update type log record
+ * For update type log record, only the bytes that change: both tuples share
+ * the first prefix and the last suffix bytes, the ones between follow
  *------------------------------------------------------------------------------
- * | HEADER | tuple_rid | tuple_size | old_tuple_data | tuple_size |
- * | new_tuple_data |
+ * | HEADER | tuple_rid | prefix | suffix | size | old_bytes | size |
+ * | new_bytes |
  *------------------------------------------------------------------------------
  * For new page type log record
  *-------------------------------------------------------------
  * | HEADER | prev_page_id |
  *-------------------------------------------------------------
+ * For compensation log record (CLR), written when rolling back the change of
+ * an earlier record. undone_type is that record's type, the tuple is the one
+ * the rollback puts in place (or removes)
+ *------------------------------------------------------------------------------
+ * | HEADER | undo_next_lsn | undone_type | tuple_rid | tuple_size |
+ * | tuple_data |
+ *------------------------------------------------------------------------------
+ * For begin checkpoint type log record, only the HEADER
+ * For end checkpoint type log record (prevLSN is the begin checkpoint's LSN)
+ *------------------------------------------------------------------------------
+ * | HEADER | txn_count | (txn_id, last_lsn) * txn_count | page_count |
+ * | (page_id, rec_lsn) * page_count |
+ *------------------------------------------------------------------------------
  */
 #pragma once
+#include <algorithm>
 #include <cassert>
+#include <cstring>
+#include <utility>
+#include <vector>
 
 #include "common/config.h"
+#include "common/crc32c.h"
 #include "table/tuple.h"
 
 namespace cmudb {
@@ -44,63 +66,121 @@ enum class LogRecordType {
   ABORT,
   // when create a new page in heap table
   NEWPAGE,
+  // fuzzy checkpoint
+  BEGIN_CHECKPOINT,
+  END_CHECKPOINT,
+  // compensation, rolling back an earlier record (redo only)
+  CLR,
 };
 
+// active transaction table: txn id -> LSN of its last log record
+typedef std::vector<std::pair<txn_id_t, lsn_t>> ActiveTxnTable;
+// dirty page table: page id -> LSN of the first change not on disk yet
+typedef std::vector<std::pair<page_id_t, lsn_t>> DirtyPageTable;
+
 class LogRecord {
   friend class LogManager;
   friend class LogRecovery;
 
 public:
   LogRecord()
-      : size_(0), lsn_(INVALID_LSN), txn_id_(INVALID_TXN_ID),
+      : size_(0), txn_id_(INVALID_TXN_ID), lsn_(INVALID_LSN),
         prev_lsn_(INVALID_LSN), log_record_type_(LogRecordType::INVALID) {}
 
   // constructor for Transaction type(BEGIN/COMMIT/ABORT)
   LogRecord(txn_id_t txn_id, lsn_t prev_lsn, LogRecordType log_record_type)
-      : size_(HEADER_SIZE), lsn_(INVALID_LSN), txn_id_(txn_id),
+      : size_(HEADER_SIZE), txn_id_(txn_id), lsn_(INVALID_LSN),
         prev_lsn_(prev_lsn), log_record_type_(log_record_type) {}
 
-  // constructor for INSERT/DELETE type
+  // constructor for INSERT type
   LogRecord(txn_id_t txn_id, lsn_t prev_lsn, LogRecordType log_record_type,
             const RID &rid, const Tuple &tuple)
-      : lsn_(INVALID_LSN), txn_id_(txn_id), prev_lsn_(prev_lsn),
-        log_record_type_(log_record_type) {
-    if (log_record_type == LogRecordType::INSERT) {
-      insert_rid_ = rid;
-      insert_tuple_ = tuple;
-    } else {
-      assert(log_record_type == LogRecordType::APPLYDELETE ||
-             log_record_type == LogRecordType::MARKDELETE ||
-             log_record_type == LogRecordType::ROLLBACKDELETE);
-      delete_rid_ = rid;
-      delete_tuple_ = tuple;
-    }
+      : txn_id_(txn_id), lsn_(INVALID_LSN), prev_lsn_(prev_lsn),
+        log_record_type_(log_record_type), insert_rid_(rid),
+        insert_tuple_(tuple) {
+    assert(log_record_type == LogRecordType::INSERT);
     // calculate log record size
     size_ = HEADER_SIZE + sizeof(RID) + sizeof(int32_t) + tuple.GetLength();
   }
 
+  // constructor for MARKDELETE/APPLYDELETE/ROLLBACKDELETE type
+  LogRecord(txn_id_t txn_id, lsn_t prev_lsn, LogRecordType log_record_type,
+            const RID &rid)
+      : txn_id_(txn_id), lsn_(INVALID_LSN), prev_lsn_(prev_lsn),
+        log_record_type_(log_record_type), delete_rid_(rid) {
+    assert(log_record_type == LogRecordType::MARKDELETE ||
+           log_record_type == LogRecordType::APPLYDELETE ||
+           log_record_type == LogRecordType::ROLLBACKDELETE);
+    // calculate log record size
+    size_ = HEADER_SIZE + sizeof(RID);
+  }
+
   // constructor for UPDATE type
   LogRecord(txn_id_t txn_id, lsn_t prev_lsn, LogRecordType log_record_type,
             const RID &update_rid, const Tuple &old_tuple,
             const Tuple &new_tuple)
-      : lsn_(INVALID_LSN), txn_id_(txn_id), prev_lsn_(prev_lsn),
-        log_record_type_(log_record_type), update_rid_(update_rid),
-        old_tuple_(old_tuple), new_tuple_(new_tuple) {
+      : txn_id_(txn_id), lsn_(INVALID_LSN), prev_lsn_(prev_lsn),
+        log_record_type_(log_record_type), update_rid_(update_rid) {
+    const char *old_data = old_tuple.GetData();
+    const char *new_data = new_tuple.GetData();
+    int32_t old_size = old_tuple.GetLength(), new_size = new_tuple.GetLength();
+    int32_t common = std::min(old_size, new_size);
+    while (update_prefix_ < common &&
+           old_data[update_prefix_] == new_data[update_prefix_]) {
+      update_prefix_++;
+    }
+    while (update_suffix_ < common - update_prefix_ &&
+           old_data[old_size - 1 - update_suffix_] ==
+               new_data[new_size - 1 - update_suffix_]) {
+      update_suffix_++;
+    }
+    old_bytes_.assign(old_data + update_prefix_,
+                      old_data + old_size - update_suffix_);
+    new_bytes_.assign(new_data + update_prefix_,
+                      new_data + new_size - update_suffix_);
     // calculate log record size
-    size_ = HEADER_SIZE + sizeof(RID) + old_tuple.GetLength() +
-            new_tuple.GetLength() + 2 * sizeof(int32_t);
+    size_ = HEADER_SIZE + sizeof(RID) + 4 * sizeof(int32_t) +
+            old_bytes_.size() + new_bytes_.size();
   }
 
   // constructor for NEWPAGE type
   LogRecord(txn_id_t txn_id, lsn_t prev_lsn, LogRecordType log_record_type,
             page_id_t page_id)
-      : size_(HEADER_SIZE), lsn_(INVALID_LSN), txn_id_(txn_id),
+      : size_(HEADER_SIZE), txn_id_(txn_id), lsn_(INVALID_LSN),
         prev_lsn_(prev_lsn), log_record_type_(log_record_type),
         prev_page_id_(page_id) {
     // calculate log record size
     size_ = HEADER_SIZE + sizeof(page_id_t);
   }
 
+  // constructor for CLR type: undo_next_lsn is the prevLSN of the record
+  // undone, where rolling back goes on
+  LogRecord(txn_id_t txn_id, lsn_t prev_lsn, LogRecordType log_record_type,
+            lsn_t undo_next_lsn, LogRecordType undone_type, const RID &rid,
+            const Tuple &tuple)
+      : txn_id_(txn_id), lsn_(INVALID_LSN), prev_lsn_(prev_lsn),
+        log_record_type_(log_record_type), undo_next_lsn_(undo_next_lsn),
+        undone_type_(undone_type), clr_rid_(rid), clr_tuple_(tuple) {
+    assert(log_record_type == LogRecordType::CLR);
+    // calculate log record size
+    size_ = HEADER_SIZE + sizeof(lsn_t) + sizeof(int32_t) + sizeof(RID) +
+            sizeof(int32_t) + tuple.GetLength();
+  }
+
+  // constructor for END_CHECKPOINT type
+  LogRecord(lsn_t begin_lsn, LogRecordType log_record_type,
+            const ActiveTxnTable &active_txns,
+            const DirtyPageTable &dirty_pages)
+      : txn_id_(INVALID_TXN_ID), lsn_(INVALID_LSN), prev_lsn_(begin_lsn),
+        log_record_type_(log_record_type), active_txns_(active_txns),
+        dirty_pages_(dirty_pages) {
+    assert(log_record_type == LogRecordType::END_CHECKPOINT);
+    // calculate log record size
+    size_ = HEADER_SIZE + 2 * sizeof(int32_t) +
+            active_txns.size() * (sizeof(txn_id_t) + sizeof(lsn_t)) +
+            dirty_pages.size() * (sizeof(page_id_t) + sizeof(lsn_t));
+  }
+
   ~LogRecord() {}
 
   inline RID &GetDeleteRID() { return delete_rid_; }
@@ -111,6 +191,26 @@ public:
 
   inline page_id_t GetNewPageRecord() { return prev_page_id_; }
 
+  inline RID &GetUpdateRID() { return update_rid_; }
+
+  // the tuple an update turned old_tuple into
+  inline Tuple GetNewTuple(const Tuple &old_tuple) {
+    return PatchTuple(old_tuple, new_bytes_);
+  }
+
+  // the tuple an update turned into new_tuple
+  inline Tuple GetOldTuple(const Tuple &new_tuple) {
+    return PatchTuple(new_tuple, old_bytes_);
+  }
+
+  inline lsn_t GetUndoNextLSN() { return undo_next_lsn_; }
+
+  inline LogRecordType GetUndoneType() { return undone_type_; }
+
+  inline ActiveTxnTable &GetActiveTxns() { return active_txns_; }
+
+  inline DirtyPageTable &GetDirtyPages() { return dirty_pages_; }
+
   inline int32_t GetSize() { return size_; }
 
   inline lsn_t GetLSN() { return lsn_; }
@@ -121,6 +221,12 @@ public:
 
   inline LogRecordType &GetLogRecordType() { return log_record_type_; }
 
+  // checksum of a serialized record of size bytes, skipping its checksum field
+  static uint32_t Checksum(const char *data, int size) {
+    uint32_t crc = Crc32c(data, CHECKSUM_OFFSET);
+    return Crc32c(data + HEADER_SIZE, size - HEADER_SIZE, crc);
+  }
+
   // For debug purpose
   inline std::string ToString() const {
     std::ostringstream os;
@@ -135,30 +241,61 @@ public:
   }
 
 private:
+  // tuple with the bytes between the update's prefix and suffix replaced
+  Tuple PatchTuple(const Tuple &tuple, const std::vector<char> &bytes) {
+    int32_t size = update_prefix_ + bytes.size() + update_suffix_;
+    assert(tuple.GetLength() >= update_prefix_ + update_suffix_);
+    std::vector<char> storage(sizeof(int32_t) + size);
+    char *data = storage.data() + sizeof(int32_t);
+    memcpy(storage.data(), &size, sizeof(int32_t));
+    memcpy(data, tuple.GetData(), update_prefix_);
+    std::copy(bytes.begin(), bytes.end(), data + update_prefix_);
+    memcpy(data + size - update_suffix_,
+           tuple.GetData() + tuple.GetLength() - update_suffix_,
+           update_suffix_);
+    Tuple patched;
+    patched.DeserializeFrom(storage.data());
+    return patched;
+  }
+
   // the length of log record(for serialization, in bytes)
   int32_t size_ = 0;
   // must have fields
-  lsn_t lsn_ = INVALID_LSN;
   txn_id_t txn_id_ = INVALID_TXN_ID;
+  lsn_t lsn_ = INVALID_LSN;
   lsn_t prev_lsn_ = INVALID_LSN;
   LogRecordType log_record_type_ = LogRecordType::INVALID;
+  // set while serializing
+  uint32_t checksum_ = 0;
 
-  // case1: for delete operation, delete_tuple_ for UNDO operation
+  // case1: for delete operation
   RID delete_rid_;
-  Tuple delete_tuple_;
 
   // case2: for insert operation
   RID insert_rid_;
   Tuple insert_tuple_;
 
-  // case3: for update operation
+  // case3: for update operation, the changed bytes of both tuples
   RID update_rid_;
-  Tuple old_tuple_;
-  Tuple new_tuple_;
+  int32_t update_prefix_ = 0;
+  int32_t update_suffix_ = 0;
+  std::vector<char> old_bytes_;
+  std::vector<char> new_bytes_;
 
   // case4: for new page operation
   page_id_t prev_page_id_ = INVALID_PAGE_ID;
-  const static int HEADER_SIZE = 20;
+
+  // case5: for compensation
+  lsn_t undo_next_lsn_ = INVALID_LSN;
+  LogRecordType undone_type_ = LogRecordType::INVALID;
+  RID clr_rid_;
+  Tuple clr_tuple_;
+
+  // case6: for end checkpoint
+  ActiveTxnTable active_txns_;
+  DirtyPageTable dirty_pages_;
+  const static int HEADER_SIZE = 32;
+  const static int CHECKSUM_OFFSET = 28;
 }; // namespace cmudb
 
 } // namespace cmudb
@@ -1,27 +1,58 @@
 /**
  * recovery_manager.h
- * Read log file from disk, redo and undo
+ * Read log file from disk, redo and undo (ARIES)
+ *
+ * Redo first runs the analysis pass from the last checkpoint, rebuilding the
+ * losers (transactions without COMMIT/ABORT) and the dirty page table and
+ * finding the end of the log: the first record failing its checksum ends it,
+ * and whatever follows is cut off before anything new is logged. Redo then
+ * repeats history from the smallest recovery LSN, CLRs included, skipping
+ * pages the dirty page table says have the change on disk. Redo is page
+ * local: with more than one redo thread the log is still parsed once, here,
+ * and each record goes to the worker owning its page (page id modulo the
+ * number of workers), so the records of a page are applied in LSN order.
+ * A page that can't be fetched, e.g. failing its checksum, stops every worker
+ * and Redo throws, naming the page.
+ *
+ * Undo rolls all losers back in one sweep, always taking the largest LSN
+ * left, so the log is read backwards window by window. Every change undone is
+ * logged as a CLR whose undo next LSN skips what it compensated, and each
+ * loser finally gets its ABORT record: after a crash during Undo the next
+ * recovery redoes the CLRs and carries on where it stopped.
  */
 
 #pragma once
 #include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
 #include <mutex>
+#include <thread>
 #include <unordered_map>
+#include <vector>
 
 #include "buffer/buffer_pool_manager.h"
 #include "concurrency/lock_manager.h"
+#include "logging/log_manager.h"
 #include "logging/log_record.h"
+#include "page/table_page.h"
 
 namespace cmudb {
 
 class LogRecovery {
 public:
-  LogRecovery(DiskManager *disk_manager,
-                    BufferPoolManager *buffer_pool_manager)
+  // Undo logs its CLRs through log_manager and leaves its flush thread running
+  LogRecovery(DiskManager *disk_manager, BufferPoolManager *buffer_pool_manager,
+              LogManager *log_manager, size_t redo_threads = REDO_THREADS)
       : disk_manager_(disk_manager), buffer_pool_manager_(buffer_pool_manager),
-        offset_(0) {
+        log_manager_(log_manager),
+        redo_threads_(std::max<size_t>(redo_threads, 1)),
+        buffer_offset_(0), buffer_size_(0),
+        log_buffer_size_(LOG_BUFFER_PAGES * disk_manager->GetPageSize()) {
     // global transaction through recovery phase
-    log_buffer_ = new char[LOG_BUFFER_SIZE];
+    log_buffer_ = new char[log_buffer_size_];
   }
 
   ~LogRecovery() {
@@ -34,16 +65,44 @@ public:
   bool DeserializeLogRecord(const char *data, int size, LogRecord &log_record);
 
 private:
-  // TODO: you can add whatever member variable here
-  // Don't forget to initialize newly added variable in constructor
+  // batches of records for one redo worker; at most two wait, so parsing
+  // does not run far ahead of the workers
+  struct RedoQueue {
+    std::mutex latch;
+    std::condition_variable cv;
+    std::deque<std::vector<LogRecord>> batches;
+    bool closed = false;
+    bool stopped = false;     // the worker is gone, batches are not taken
+    std::exception_ptr error; // why the worker's redo failed, if it did
+  };
+
+  lsn_t Analyze();
+  bool ScanLog(lsn_t checkpoint_lsn);
+  bool ReadLogRecord(lsn_t lsn, LogRecord &record);
+  bool BufferedLogRecord(lsn_t lsn, LogRecord &record);
+  void RedoPage(page_id_t page_id, LogRecord &record);
+  void RedoWorker(RedoQueue *queue);
+  void RedoRecord(TablePage *page, LogRecord &record);
+  void UndoRecord(Transaction *txn, LogRecord &record);
+  static page_id_t GetPageId(LogRecord &record);
+
   DiskManager *disk_manager_;
   BufferPoolManager *buffer_pool_manager_;
+  LogManager *log_manager_;
+  size_t redo_threads_;
+  // set by the first redo worker that fails, the others stop as well
+  std::atomic<bool> redo_failed_{false};
   // maintain active transactions and its corresponds latest lsn
   std::unordered_map<txn_id_t, lsn_t> active_txn_;
-  // mapping log sequence number to log file offset, for undo purpose
-  std::unordered_map<lsn_t, int> lsn_mapping_;
-  // log buffer related
-  int offset_;
+  // page id -> LSN of the first change that may not be on disk
+  std::unordered_map<page_id_t, lsn_t> dirty_pages_;
+  // just past the last valid record
+  lsn_t log_end_ = INVALID_LSN;
+  // log buffer related: log_buffer_ holds buffer_size_ bytes of the log
+  // from buffer_offset_ on
+  lsn_t buffer_offset_;
+  int buffer_size_;
+  int log_buffer_size_;
   char *log_buffer_;
 };
 
@@ -10,8 +10,14 @@
  *
  * Internal page format (keys are stored in increasing order):
  *  --------------------------------------------------------------------------
- * | HEADER | KEY(1)+PAGE_ID(1) | KEY(2)+PAGE_ID(2) | ... | KEY(n)+PAGE_ID(n) |
+ * | HEADER | NextPageId (4) | HighKey | KEY(1)+PAGE_ID(1) | ... | KEY(n)+PAGE_ID(n) |
  *  --------------------------------------------------------------------------
+ *
+ * Like leaves, internal pages are linked to their right sibling on the same
+ * level (B-link tree). The high key bounds the keys of the subtree from above:
+ * it is the key the parent keeps for the right sibling, and a key larger than
+ * it has moved right by a split. The rightmost page of a level has no right
+ * sibling and no high key.
  */
 
 #pragma once
@@ -30,8 +36,9 @@ namespace cmudb {
 INDEX_TEMPLATE_ARGUMENTS
 class BPlusTreeInternalPage : public BPlusTreePage {
  public:
-  // must call initialize method after "create" a new node
-  void Init(page_id_t page_id, page_id_t parent_id = INVALID_PAGE_ID);
+  // must call initialize method after "create" a new node, max size follows
+  // from page_size
+  void Init(page_id_t page_id, page_id_t parent_id, size_t page_size);
 
   KeyType KeyAt(int index) const;
   void SetKeyAt(int index, const KeyType &key);
@@ -39,6 +46,15 @@ class BPlusTreeInternalPage : public BPlusTreePage {
   ValueType ValueAt(int index) const;
 
   ValueType Lookup(const KeyType &key, const KeyComparator &comparator) const;
+
+  page_id_t GetNextPageId() const { return next_page_id_; }
+  void SetNextPageId(page_id_t next_page_id) { next_page_id_ = next_page_id; }
+  KeyType GetHighKey() const { return high_key_; }
+  void SetHighKey(const KeyType &key) { high_key_ = key; }
+  // key belongs to a page further right on this level
+  bool PastHighKey(const KeyType &key, const KeyComparator &comparator) const {
+    return next_page_id_ != INVALID_PAGE_ID && comparator(key, high_key_) > 0;
+  }
   void PopulateNewRoot(const ValueType &old_value, const KeyType &new_key,
                        const ValueType &new_value);
   int InsertNodeAfter(const ValueType &old_value, const KeyType &new_key,
@@ -86,6 +102,8 @@ class BPlusTreeInternalPage : public BPlusTreePage {
     return GetPageSmartPtr<B_PLUS_TREE_INTERNAL_PAGE_TYPE >(page_id, bufferPoolManager);
   }
 
+  page_id_t next_page_id_;
+  KeyType high_key_;
   MappingType array[0];
 };
 
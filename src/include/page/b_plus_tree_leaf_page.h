@@ -10,15 +10,19 @@
  * | HEADER | KEY(1) + RID(1) | KEY(2) + RID(2) | ... | KEY(n) + RID(n)
  *  ----------------------------------------------------------------------
  *
- *  Header format (size in byte, 28 bytes in total):
+ *  Header format (size in byte, 36 bytes in total):
  *  ---------------------------------------------------------------------
- * | PageType (4) | lsn(4) | CurrentSize (4) | MaxSize (4) | ParentPageId (4) |
+ * | PageType (4) | CurrentSize (4) | lsn(8) | MaxSize (4) | ParentPageId (4) |
  *  ---------------------------------------------------------------------
- *  ------------------------------
- * | PageId (4) | NextPageId (4) | PreviousPageId (4)
- *  ------------------------------
+ *  ----------------------------------------------
+ * | PageId (4) | NextPageId (4) | PreviousPageId (4) | HighKey |
+ *  ----------------------------------------------
  *
- *  there is lsn in base class. so this should be 32bytes.
+ *  there is lsn in base class. so this should be 36bytes, plus the high key.
+ *
+ *  The high key is the key the parent keeps for the next leaf: every key of
+ *  this leaf is at most the high key, larger ones have moved right by a split.
+ *  The last leaf has no high key.
  */
 #pragma once
 #include <utility>
@@ -35,13 +39,19 @@ INDEX_TEMPLATE_ARGUMENTS
 class BPlusTreeLeafPage : public BPlusTreePage {
  public:
   // After creating a new leaf page from buffer pool, must call initialize
-  // method to set default values
-  void Init(page_id_t page_id, page_id_t parent_id = INVALID_PAGE_ID);
+  // method to set default values, max size follows from page_size
+  void Init(page_id_t page_id, page_id_t parent_id, size_t page_size);
   // helper methods
   page_id_t GetNextPageId() const;
   page_id_t GetPreviousPageId() const;
   void SetNextPageId(page_id_t next_page_id);
   void SetPreviousPageId(page_id_t prev_page_id);
+  KeyType GetHighKey() const { return high_key_; }
+  void SetHighKey(const KeyType &key) { high_key_ = key; }
+  // key belongs to a leaf further right
+  bool PastHighKey(const KeyType &key, const KeyComparator &comparator) const {
+    return next_page_id_ != INVALID_PAGE_ID && comparator(key, high_key_) > 0;
+  }
   KeyType KeyAt(int index) const;
   int KeyIndex(const KeyType &key, const KeyComparator &comparator) const;
   const MappingType &GetItem(int index);
@@ -79,6 +89,7 @@ class BPlusTreeLeafPage : public BPlusTreePage {
   }
   page_id_t next_page_id_;
   page_id_t prev_page_id_;
+  KeyType high_key_;
   MappingType array[0];
 
   bool isFull() {
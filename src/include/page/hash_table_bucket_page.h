@@ -0,0 +1,69 @@
+/**
+ * hash_table_bucket_page.h
+ *
+ * Bucket of a disk resident extendible hash table. Holds unique keys and
+ * their values, unordered; removal moves the last entry into the hole.
+ *
+ * Format (size in byte):
+ *  -------------------------------------------------------------------
+ * | PageId (4) | CurrentSize (4) | LSN (8) | MaxSize (4) | KEY(1) + VALUE(1) | ...
+ *  -------------------------------------------------------------------
+ */
+
+#pragma once
+
+#include <string>
+#include <utility>
+
+#include "common/config.h"
+#include "index/generic_key.h"
+
+namespace cmudb {
+
+#define MappingType std::pair<KeyType, ValueType>
+
+#define INDEX_TEMPLATE_ARGUMENTS                                               \
+  template <typename KeyType, typename ValueType, typename KeyComparator>
+
+#define HASH_TABLE_BUCKET_TYPE                                                 \
+  HashTableBucketPage<KeyType, ValueType, KeyComparator>
+
+INDEX_TEMPLATE_ARGUMENTS
+class HashTableBucketPage {
+public:
+  // After creating a new bucket page from buffer pool, must call initialize
+  // method to set default values, max size follows from page_size
+  void Init(page_id_t page_id, size_t page_size);
+
+  page_id_t GetPageId() const;
+  int GetSize() const;
+  int GetMaxSize() const;
+  bool IsFull() const;
+  bool IsEmpty() const;
+
+  KeyType KeyAt(int index) const;
+  ValueType ValueAt(int index) const;
+  const MappingType &GetItem(int index) const;
+  // index of key, -1 if it is not in this bucket
+  int KeyIndex(const KeyType &key, const KeyComparator &comparator) const;
+
+  bool Lookup(const KeyType &key, ValueType &value,
+              const KeyComparator &comparator) const;
+  // return false if the bucket is full or already holds key
+  bool Insert(const KeyType &key, const ValueType &value,
+              const KeyComparator &comparator);
+  bool Remove(const KeyType &key, const KeyComparator &comparator);
+  void RemoveAt(int index);
+
+  // Debug
+  std::string ToString() const;
+
+private:
+  page_id_t page_id_;
+  int size_;
+  lsn_t lsn_;
+  int max_size_;
+  MappingType array_[0];
+};
+
+} // namespace cmudb
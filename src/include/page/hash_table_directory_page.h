@@ -0,0 +1,80 @@
+/**
+ * hash_table_directory_page.h
+ *
+ * Directory of a disk resident extendible hash table. Slot i of the directory
+ * points to the bucket page holding every key whose hash ends with the low
+ * global_depth bits of i, and records the local depth of that bucket.
+ *
+ * Format (size in byte):
+ *  -----------------------------------------------------------------------
+ * | PageId (4) | GlobalDepth (4) | LSN (8) | MaxDepth (4) | LocalDepth (1) * N
+ *  -----------------------------------------------------------------------
+ *  --------------------------
+ * | BucketPageId (4) * N |
+ *  --------------------------
+ * N = 2^MaxDepth is the largest power of two whose slots fit in the page, set
+ * by Init from the page size: a 4 KB page holds 512 slots (global depth 9).
+ */
+
+#pragma once
+
+#include <cstdint>
+
+#include "common/config.h"
+
+namespace cmudb {
+
+class HashTableDirectoryPage {
+public:
+  // After creating a new directory page from buffer pool, must call
+  // initialize method to set default values, max depth follows from page_size
+  void Init(page_id_t page_id, page_id_t bucket_page_id, size_t page_size);
+
+  page_id_t GetPageId() const;
+
+  uint32_t GetGlobalDepth() const;
+  uint32_t GetGlobalDepthMask() const;
+  uint32_t GetMaxDepth() const;
+  // number of slots in use, 2^global_depth
+  uint32_t Size() const;
+
+  page_id_t GetBucketPageId(uint32_t bucket_idx) const;
+  void SetBucketPageId(uint32_t bucket_idx, page_id_t bucket_page_id);
+
+  uint32_t GetLocalDepth(uint32_t bucket_idx) const;
+  void SetLocalDepth(uint32_t bucket_idx, uint32_t local_depth);
+  // slot the bucket at bucket_idx was split from / would merge with
+  uint32_t GetSplitImageIndex(uint32_t bucket_idx) const;
+
+  // double the directory, the new upper half mirrors the lower half
+  void IncrGlobalDepth();
+  // halve the directory, caller must have checked CanShrink
+  void DecrGlobalDepth();
+  bool CanShrink() const;
+
+  // assert that every bucket is pointed to by exactly 2^(global - local)
+  // slots that agree on its local depth
+  void VerifyIntegrity() const;
+
+private:
+  inline uint8_t *LocalDepths() {
+    return reinterpret_cast<uint8_t *>(array_);
+  }
+  inline const uint8_t *LocalDepths() const {
+    return reinterpret_cast<const uint8_t *>(array_);
+  }
+  inline page_id_t *BucketPageIds() {
+    return reinterpret_cast<page_id_t *>(array_ + (1U << max_depth_));
+  }
+  inline const page_id_t *BucketPageIds() const {
+    return reinterpret_cast<const page_id_t *>(array_ + (1U << max_depth_));
+  }
+
+  page_id_t page_id_;
+  uint32_t global_depth_;
+  lsn_t lsn_;
+  uint32_t max_depth_;
+  char array_[0];
+};
+
+} // namespace cmudb
@@ -3,12 +3,16 @@
  *
  * Database use the first page (page_id = 0) as header page to store metadata, in
  * our case, we will contain information about table/index name (length less than
- * 32 bytes) and their corresponding root_id
+ * 32 bytes) and their corresponding root_id. It also records the page size
+ * of the database file, which DiskManager reads back when the file is opened,
+ * and the master record: the LSN of the last complete checkpoint.
  *
  * Format (size in byte):
- *  -----------------------------------------------------------------
- * | RecordCount (4) | Entry_1 name (32) | Entry_1 root_id (4) | ... |
- *  -----------------------------------------------------------------
+ *  ---------------------------------------------------------------------
+ * | RecordCount (4) | Magic (4) | LSN (8) | PageSize (4) | CheckpointLSN (8) |
+ *  ---------------------------------------------------------------------
+ * | Entry_1 name (32) | Entry_1 root_id (4) | ... |
+ *  ---------------------------------------------------------------------
  */
 
 #pragma once
@@ -21,7 +25,7 @@ namespace cmudb {
 
 class HeaderPage : public Page {
 public:
-  void Init() { SetRecordCount(0); }
+  void Init();
   /**
    * Record related
    */
@@ -33,7 +37,26 @@ public:
   bool GetRootId(const std::string &name, page_id_t &root_id);
   int GetRecordCount();
 
+  /**
+   * Master record, the begin checkpoint LSN recovery starts its analysis
+   * from; INVALID_LSN if no checkpoint has been taken
+   */
+  lsn_t GetCheckpointLSN();
+  void SetCheckpointLSN(lsn_t lsn);
+  // whether the page has been initialized as a header page
+  bool IsHeaderPage();
+
+  // page size recorded in a header page image, false if data holds none
+  static bool ReadPageSize(const char *data, size_t &page_size);
+  // bytes of a header page image ReadPageSize looks at
+  static constexpr size_t PREFIX_SIZE = 20;
+
 private:
+  static constexpr uint32_t MAGIC = 0x48544442; // "BDTH"
+  static constexpr int CHECKPOINT_LSN_OFFSET = 20;
+  static constexpr int RECORDS_OFFSET = 28;
+  static constexpr int RECORD_SIZE = 36;
+
   /**
    * helper functions
    */
@@ -4,12 +4,29 @@
  * Wrapper around actual data page in main memory and also contains bookkeeping
  * information used by buffer pool manager like pin_count/dirty_flag/page_id.
  * Use page as a basic unit within the database system
+ *
+ * The page content is not part of this object: it lives in the buffer pool's
+ * aligned frame arena (so it can be handed to O_DIRECT I/O as is) and data_
+ * points at this frame's slot. Always go through GetData(), never cast a
+ * Page * to a page layout.
+ *
+ * The last PAGE_CHECKSUM_SIZE bytes of every page belong to DiskManager, which
+ * keeps the page's checksum there; page layouts end before them. Every page
+ * layout keeps the page LSN, sizeof(lsn_t) bytes, at LSN_OFFSET.
+ *
+ * Besides the latch, a page has a version for optimistic readers: it is odd
+ * while the page is write latched and moves on with every write latch. A
+ * reader takes StableVersion(), reads without latching and keeps what it read
+ * only if ValidateVersion() still finds the same version afterwards. Such a
+ * reader must hold a pin, so that the frame is not given to another page.
  */
 
 #pragma once
 
+#include <atomic>
 #include <cstring>
 #include <iostream>
+#include <thread>
 
 #include "common/config.h"
 #include "common/rwmutex.h"
@@ -17,35 +34,83 @@
 namespace cmudb {
 
 class Page {
-  friend class BufferPoolManager;
+  friend class BufferPoolInstance;
 
 public:
-  Page() { ResetMemory(); }
+  Page() : data_(nullptr) {}
   ~Page(){};
   // get actual data page content
   inline char *GetData() { return data_; }
   // get page id
   inline page_id_t GetPageId() { return page_id_; }
+  // size of the content, the page size of the buffer pool
+  inline size_t GetPageSize() { return page_size_; }
   // get page pin count
   inline int GetPinCount() { return pin_count_; }
   // method use to latch/unlatch page content
-  inline void WUnlatch() { rwlatch_.WUnlock(); }
-  inline void WLatch() { rwlatch_.WLock(); }
+  inline void WUnlatch() {
+    version_.fetch_add(1, std::memory_order_release);
+    rwlatch_.WUnlock();
+  }
+  inline void WLatch() {
+    rwlatch_.WLock();
+    version_.fetch_add(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+  }
   inline void RUnlatch() { rwlatch_.RUnlock(); }
   inline void RLatch() { rwlatch_.RLock(); }
 
-  inline lsn_t GetLSN() { return *reinterpret_cast<lsn_t *>(GetData() + 4); }
-  inline void SetLSN(lsn_t lsn) { memcpy(GetData() + 4, &lsn, 4); }
+  // optimistic reads: the version once no writer holds the page
+  inline uint64_t StableVersion() {
+    uint64_t version;
+    while ((version = version_.load(std::memory_order_acquire)) & 1) {
+      std::this_thread::yield();
+    }
+    return version;
+  }
+  // whether nobody has write latched the page since version was taken
+  inline bool ValidateVersion(uint64_t version) {
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return version_.load(std::memory_order_relaxed) == version;
+  }
+  // write latch the page if it is still at version, false otherwise
+  inline bool UpgradeToWLatch(uint64_t version) {
+    WLatch();
+    if (version_.load(std::memory_order_relaxed) == version + 1) {
+      return true;
+    }
+    WUnlatch();
+    return false;
+  }
+
+  static constexpr size_t LSN_OFFSET = 8;
+  inline lsn_t GetLSN() { return GetLSN(GetData()); }
+  // LSN of a copy of a page's content
+  static inline lsn_t GetLSN(const char *data) {
+    lsn_t lsn;
+    memcpy(&lsn, data + LSN_OFFSET, sizeof(lsn_t));
+    return lsn;
+  }
+  // the first LSN set since the page was last written also becomes its
+  // recovery LSN, the point redo has to start from for this page
+  inline void SetLSN(lsn_t lsn) {
+    memcpy(GetData() + LSN_OFFSET, &lsn, sizeof(lsn_t));
+    lsn_t invalid = INVALID_LSN;
+    rec_lsn_.compare_exchange_strong(invalid, lsn);
+  }
 
 private:
   // method used by buffer pool manager
-  inline void ResetMemory() { memset(data_, 0, PAGE_SIZE); }
+  inline void ResetMemory() { memset(data_, 0, page_size_); }
   // members
-  char data_[PAGE_SIZE]; // actual data
+  char *data_; // actual data, page_size_ bytes in the frame arena
+  size_t page_size_ = 0;
   page_id_t page_id_ = INVALID_PAGE_ID;
   int pin_count_ = 0;
   bool is_dirty_ = false;
+  std::atomic<lsn_t> rec_lsn_{INVALID_LSN}; // INVALID_LSN if nothing to redo
   RWMutex rwlatch_;
+  std::atomic<uint64_t> version_{0}; // odd while write latched
 };
 
 } // namespace cmudb
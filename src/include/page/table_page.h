@@ -2,15 +2,15 @@
  * table_page.h
  *
  * Slotted page format:
- *  ---------------------------------------
- * | HEADER | ... FREE SPACES ... | TUPLES |
- *  ---------------------------------------
+ *  --------------------------------------------------
+ * | HEADER | ... FREE SPACES ... | TUPLES | CHECKSUM |
+ *  --------------------------------------------------
  *                                 ^
  *                         free space pointer
  *
  *  Header format (size in byte):
  *  --------------------------------------------------------------------------
- * | PageId (4)| LSN (4)| PrevPageId (4)| NextPageId (4)| FreeSpacePointer(4) |
+ * | PageId (4)| PrevPageId (4)| LSN (8)| NextPageId (4)| FreeSpacePointer(4) |
  *  --------------------------------------------------------------------------
  *  --------------------------------------------------------------
  * | TupleCount (4) | Tuple_1 offset (4) | Tuple_1 size (4) | ... |
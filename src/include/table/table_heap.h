@@ -44,6 +44,7 @@ public:
 
   bool GetTuple(const RID &rid, Tuple &tuple, Transaction *txn);
 
+  // drop the table, freeing all its pages
   bool DeleteTableHeap();
 
   TableIterator begin(Transaction *txn);
@@ -8,6 +8,7 @@
 
 #include <cassert>
 
+#include "buffer/read_ahead.h"
 #include "common/rid.h"
 #include "table/tuple.h"
 
@@ -43,6 +44,7 @@ private:
   TableHeap *table_heap_;
   Tuple *tuple_;
   Transaction *txn_;
+  ReadAhead read_ahead_;
 };
 
 } // namespace cmudb
\ No newline at end of file
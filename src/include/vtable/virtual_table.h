@@ -8,6 +8,7 @@
 #include "catalog/schema.h"
 #include "concurrency/transaction_manager.h"
 #include "index/b_plus_tree_index.h"
+#include "logging/checkpoint_manager.h"
 #include "logging/log_manager.h"
 #include "sqlite/sqlite3ext.h"
 #include "table/table_heap.h"
@@ -62,28 +63,39 @@ int VtabBegin(sqlite3_vtab *pVTab);
 // storage engine
 class StorageEngine {
 public:
-  StorageEngine(std::string db_file_name) {
+  // page_size only applies to a new db file, an existing one keeps its own
+  StorageEngine(std::string db_file_name,
+                size_t buffer_pool_size = BUFFER_POOL_SIZE,
+                size_t page_size = DEFAULT_PAGE_SIZE) {
     ENABLE_LOGGING = false;
 
     // storage related
-    disk_manager_ = new DiskManager(db_file_name);
+    disk_manager_ = new DiskManager(db_file_name, AsyncIOType::AUTO, false,
+                                    page_size);
 
     // log related
     log_manager_ = new LogManager(disk_manager_);
 
     buffer_pool_manager_ =
-        new BufferPoolManager(BUFFER_POOL_SIZE, disk_manager_, log_manager_);
+        new BufferPoolManager(buffer_pool_size, disk_manager_, log_manager_,
+                              BUFFER_POOL_INSTANCES);
+    buffer_pool_manager_->RunPageCleaner();
 
     // txn related
     lock_manager_ = new LockManager(true); // S2PL
     transaction_manager_ = new TransactionManager(lock_manager_, log_manager_);
+    checkpoint_manager_ =
+        new CheckpointManager(disk_manager_, transaction_manager_,
+                              log_manager_, buffer_pool_manager_);
   }
 
   ~StorageEngine() {
+    delete checkpoint_manager_;
     if (ENABLE_LOGGING)
       log_manager_->StopFlushThread();
-    delete disk_manager_;
+    // the page cleaner goes with the pool, before the disk it writes to
     delete buffer_pool_manager_;
+    delete disk_manager_;
     delete log_manager_;
     delete lock_manager_;
     delete transaction_manager_;
@@ -94,6 +106,7 @@ public:
   LockManager *lock_manager_;
   TransactionManager *transaction_manager_;
   LogManager *log_manager_;
+  CheckpointManager *checkpoint_manager_;
 };
 
 StorageEngine *storage_engine_;
@@ -136,13 +149,28 @@ public:
   inline void InsertEntry(const Tuple &tuple, const RID &rid) {
     if (index_ == nullptr)
       return;
-    // construct indexed key tuple
-    std::vector<Value> key_values;
+    index_->InsertEntry(IndexKey(tuple), rid, GetTransaction());
+  }
 
-    for (auto &i : index_->GetKeyAttrs())
-      key_values.push_back(tuple.GetValue(schema_, i));
-    Tuple key(key_values, index_->GetKeySchema());
-    index_->InsertEntry(key, rid, GetTransaction());
+  // fill the empty index with the rows already in the table: the entries
+  // are sorted and the index built bottom-up, not inserted one by one
+  inline void BuildIndex() {
+    if (index_ == nullptr)
+      return;
+    Transaction *txn = storage_engine_->transaction_manager_->Begin();
+    TableIterator it = table_heap_->begin(txn);
+    TableIterator last = table_heap_->end();
+    index_->BulkLoad(
+        [this, &it, &last](Tuple &key, RID &rid) {
+          if (it == last)
+            return false;
+          key = IndexKey(*it);
+          rid = it->GetRid();
+          ++it;
+          return true;
+        },
+        txn);
+    storage_engine_->transaction_manager_->Commit(txn);
   }
 
   // delete from table heap
@@ -157,13 +185,7 @@ public:
       return;
     Tuple deleted_tuple(rid);
     table_heap_->GetTuple(rid, deleted_tuple, GetTransaction());
-    // construct indexed key tuple
-    std::vector<Value> key_values;
-
-    for (auto &i : index_->GetKeyAttrs())
-      key_values.push_back(deleted_tuple.GetValue(schema_, i));
-    Tuple key(key_values, index_->GetKeySchema());
-    index_->DeleteEntry(key, GetTransaction());
+    index_->DeleteEntry(IndexKey(deleted_tuple), GetTransaction());
   }
 
   // update table heap tuple
@@ -185,6 +207,15 @@ public:
   inline page_id_t GetFirstPageId() { return table_heap_->GetFirstPageId(); }
 
 private:
+  // construct indexed key tuple
+  inline Tuple IndexKey(const Tuple &tuple) {
+    std::vector<Value> key_values;
+
+    for (auto &i : index_->GetKeyAttrs())
+      key_values.push_back(tuple.GetValue(schema_, i));
+    return Tuple(key_values, index_->GetKeySchema());
+  }
+
   sqlite3_vtab base_;
   // virtual table schema
   Schema *schema_;
@@ -32,23 +32,33 @@ bool BPLUSTREE_TYPE::IsEmpty() const {
 /*
  * Return the only value that associated with input key
  * This method is used for point query
+ * No latch is taken: the leaf is read optimistically and read again if it
+ * changed meanwhile
  * @return : true means key exists
  */
 INDEX_TEMPLATE_ARGUMENTS
 bool BPLUSTREE_TYPE::GetValue(const KeyType &key,
                               std::vector<ValueType> &result,
                               Transaction *transaction) {
-  assert(transaction == nullptr || (transaction->GetPageSet()->empty() && transaction->GetPageSet()->size() == 0));
-  auto leaf = GetLeafPage(key, transaction, 0);
-  result.resize(1);
-  auto ret = leaf->Lookup(key, result[0], comparator_);
-  if (transaction) {
-    clearTxnWorkSet(transaction, 0, false);
-  } else {
-    buffer_pool_manager_->UnpinPage(leaf->GetPageId(), false);
+  while (true) {
+    uint64_t version;
+    Page *page = FindLeafOptimistic(key, false, version);
+    if (page == nullptr) {
+      return false;
+    }
+    auto leaf = reinterpret_cast<B_PLUS_TREE_LEAF_PAGE_TYPE *>(page->GetData());
+    ValueType value;
+    auto ret = leaf->Lookup(key, value, comparator_);
+    bool valid = page->ValidateVersion(version);
+    buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+    if (valid) {
+      result.resize(1);
+      if (ret) {
+        result[0] = value;
+      }
+      return ret;
+    }
   }
-  assert(transaction == nullptr || (transaction->GetPageSet()->empty() && transaction->GetPageSet()->size() == 0));
-  return ret;
 }
 
 /*****************************************************************************
@@ -84,12 +94,13 @@ INDEX_TEMPLATE_ARGUMENTS
 void BPLUSTREE_TYPE::StartNewTree(const KeyType &key, const ValueType &value, Transaction *transaction) {
 //  assert(IsEmpty());
   page_id_t page_id;
-  Page *page = buffer_pool_manager_->NewPage(page_id);
+  // the tree grows in extents of its own
+  Page *page = buffer_pool_manager_->NewPage(page_id, INVALID_PAGE_ID);
   if (page == nullptr) {
     throw std::bad_alloc{};
   }
   B_PLUS_TREE_LEAF_PAGE_TYPE *lp = reinterpret_cast<B_PLUS_TREE_LEAF_PAGE_TYPE *>(page->GetData());
-  lp->Init(page_id, INVALID_PAGE_ID);
+  lp->Init(page_id, INVALID_PAGE_ID, page->GetPageSize());
   buffer_pool_manager_->UnpinPage(page_id, true);
 
   page_id_t ex = INVALID_PAGE_ID;
@@ -106,14 +117,44 @@ void BPLUSTREE_TYPE::StartNewTree(const KeyType &key, const ValueType &value, Tr
  * User needs to first find the right leaf page as insertion target, then look
  * through leaf page to see whether insert key exist or not. If exist, return
  * immediately, otherwise insert entry. Remember to deal with split if necessary.
+ * Optimistically first: if the leaf found without latches is still the same
+ * once latched and has room, it is the only page latched. Otherwise the insert
+ * crabs down from the deepest page with room on the way.
  * @return: since we only support unique key, if user try to insert duplicate
  * keys return false, otherwise return true.
  */
 INDEX_TEMPLATE_ARGUMENTS
 bool BPLUSTREE_TYPE::InsertIntoLeaf(const KeyType &key, const ValueType &value,
                                     Transaction *transaction) {
-  assert(transaction == nullptr || (transaction->GetPageSet()->empty() && transaction->GetPageSet()->size() == 0));
-  B_PLUS_TREE_LEAF_PAGE_TYPE *lp = GetLeafPage(key, transaction, 1);
+  uint64_t version;
+  SafePage safe;
+  Page *page = FindLeafOptimistic(key, false, version, 1, &safe);
+  if (page == nullptr) {
+    return false;
+  }
+  if (page->UpgradeToWLatch(version)) {
+    auto leaf = reinterpret_cast<B_PLUS_TREE_LEAF_PAGE_TYPE *>(page->GetData());
+    if (leaf->GetSize() < leaf->GetMaxSize()) {
+      auto originalSize = leaf->GetSize();
+      auto inserted = leaf->Insert(key, value, comparator_) != originalSize;
+      page->WUnlatch();
+      buffer_pool_manager_->UnpinPage(page->GetPageId(), inserted);
+      if (safe.page != nullptr) {
+        buffer_pool_manager_->UnpinPage(safe.page->GetPageId(), false);
+      }
+      return inserted;
+    }
+    page->WUnlatch();
+  }
+  buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+
+  // the pages latched on the way down are kept in a transaction
+  Transaction local(INVALID_TXN_ID);
+  if (transaction == nullptr) {
+    transaction = &local;
+  }
+  assert(transaction->GetPageSet()->empty());
+  B_PLUS_TREE_LEAF_PAGE_TYPE *lp = GetLeafPage(key, transaction, 1, safe);
   if (lp == nullptr) { return false; }
 
   auto originalSize = lp->GetSize();
@@ -128,13 +169,9 @@ bool BPLUSTREE_TYPE::InsertIntoLeaf(const KeyType &key, const ValueType &value,
 
     buffer_pool_manager_->UnpinPage(newlp->GetPageId(), true);
   }
-  if (transaction) {
-    clearTxnWorkSet(transaction, 1, true);
-  } else {
-    buffer_pool_manager_->UnpinPage(lp->GetPageId(), true);
-  }
+  clearTxnWorkSet(transaction, 1, true);
 
-  assert(transaction == nullptr || (transaction->GetPageSet()->empty() && transaction->GetPageSet()->size() == 0));
+  assert(transaction->GetPageSet()->empty());
   return originalSize != newSize;
 }
 
@@ -149,13 +186,14 @@ INDEX_TEMPLATE_ARGUMENTS
 template<typename N>
 N *BPLUSTREE_TYPE::Split(N *node) {
   page_id_t page_id;
-  Page *newPage = buffer_pool_manager_->NewPage(page_id);
+  // next to node, so that sibling leaves are contiguous for range scans
+  Page *newPage = buffer_pool_manager_->NewPage(page_id, node->GetPageId());
   if (newPage == nullptr) {
     throw std::bad_alloc();
   }
   typedef typename std::remove_pointer<N>::type *PagePtr;
   PagePtr ptr = reinterpret_cast<PagePtr>(newPage->GetData());
-  ptr->Init(page_id, node->GetParentPageId());
+  ptr->Init(page_id, node->GetParentPageId(), newPage->GetPageSize());
 
   //this is different between leaf node and internal node.
   node->MoveHalfTo(ptr, buffer_pool_manager_);
@@ -178,17 +216,19 @@ void BPLUSTREE_TYPE::InsertIntoParent(BPlusTreePage *old_node,
                                       Transaction *transaction) {
   page_id_t parentPageId = old_node->GetParentPageId();
   if (parentPageId == INVALID_PAGE_ID) {
-    Page *newPage = buffer_pool_manager_->NewPage(parentPageId);
+    Page *newPage =
+        buffer_pool_manager_->NewPage(parentPageId, old_node->GetPageId());
     if (newPage == nullptr) {
       throw std::bad_alloc();
     }
     auto ip = reinterpret_cast<BPInternalPage *>(newPage->GetData());
-    ip->Init(parentPageId, INVALID_PAGE_ID);
-    root_page_id_ = parentPageId;
-    UpdateRootPageId(false);
+    ip->Init(parentPageId, INVALID_PAGE_ID, newPage->GetPageSize());
     old_node->SetParentPageId(parentPageId);
     new_node->SetParentPageId(parentPageId);
     ip->PopulateNewRoot(old_node->GetPageId(), key, new_node->GetPageId());
+    //readers may go down from the new root right away
+    root_page_id_ = parentPageId;
+    UpdateRootPageId(false);
 
     buffer_pool_manager_->UnpinPage(parentPageId, true);
     return;
@@ -220,39 +260,56 @@ void BPLUSTREE_TYPE::InsertIntoParent(BPlusTreePage *old_node,
  * If not, User needs to first find the right leaf page as deletion target, then
  * delete entry from leaf page. Remember to deal with redistribute or merge if
  * necessary.
+ * Like insertion, only the leaf is latched as long as it cannot underflow.
  */
 INDEX_TEMPLATE_ARGUMENTS
 void BPLUSTREE_TYPE::Remove(const KeyType &key, Transaction *transaction) {
 //  std::lock_guard<std::mutex> guard(mtx);
-  if (IsEmpty()) {
+  uint64_t version;
+  SafePage safe;
+  Page *page = FindLeafOptimistic(key, false, version, 2, &safe);
+  if (page == nullptr) {
+    return;
+  }
+  if (page->UpgradeToWLatch(version)) {
+    auto leaf = reinterpret_cast<B_PLUS_TREE_LEAF_PAGE_TYPE *>(page->GetData());
+    if (leaf->GetSize() > leaf->GetMinSize()) {
+      auto originalSize = leaf->GetSize();
+      auto removed = leaf->RemoveAndDeleteRecord(key, comparator_) != originalSize;
+      page->WUnlatch();
+      buffer_pool_manager_->UnpinPage(page->GetPageId(), removed);
+      if (safe.page != nullptr) {
+        buffer_pool_manager_->UnpinPage(safe.page->GetPageId(), false);
+      }
+      return;
+    }
+    page->WUnlatch();
+  }
+  buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+
+  Transaction local(INVALID_TXN_ID);
+  if (transaction == nullptr) {
+    transaction = &local;
+  }
+  assert(transaction->GetPageSet()->empty());
+  B_PLUS_TREE_LEAF_PAGE_TYPE *lp = GetLeafPage(key, transaction, 2, safe);
+  if (lp == nullptr) {
     return;
   }
-  assert(transaction == nullptr || (transaction->GetPageSet()->empty() && transaction->GetPageSet()->size() == 0));
-  B_PLUS_TREE_LEAF_PAGE_TYPE *lp = GetLeafPage(key, transaction, 2);
-  assert(lp != nullptr);
 
   auto shouldRemovePage = false;
   auto sizeAfterRemove = lp->RemoveAndDeleteRecord(key, comparator_);
   if (sizeAfterRemove < lp->GetMinSize()) {
     shouldRemovePage = CoalesceOrRedistribute(lp, transaction);
+    //optimistic descents that may have seen the pages before must start over
+    shrink_epoch_++;
   }
 
   if (shouldRemovePage) {
-    if (transaction) {
-      transaction->GetDeletedPageSet()->insert(lp->GetPageId());
-    } else {
-      buffer_pool_manager_->UnpinPage(lp->GetPageId(), true);
-      auto deletePage = buffer_pool_manager_->DeletePage(lp->GetPageId());
-      assert(deletePage);
-      return;
-    }
+    transaction->GetDeletedPageSet()->insert(lp->GetPageId());
   }
-  if (transaction) {
-    clearTxnWorkSet(transaction, 2, true);
-  } else {
-    buffer_pool_manager_->UnpinPage(lp->GetPageId(), true);
-  }
-  assert(transaction == nullptr || (transaction->GetPageSet()->empty() && transaction->GetPageSet()->size() == 0));
+  clearTxnWorkSet(transaction, 2, true);
+  assert(transaction->GetPageSet()->empty());
 }
 
 /*
@@ -260,7 +317,7 @@ void BPLUSTREE_TYPE::Remove(const KeyType &key, Transaction *transaction) {
  * page's size > page's max size, then redistribute. Otherwise, merge.
  * Using template N to represent either internal page or leaf page.
  * @return: true means target leaf page should be deleted, false means no
- * deletion happens
+ * deletion happens (a right sibling merged into it is deleted here)
  */
 INDEX_TEMPLATE_ARGUMENTS
 template<typename N>
@@ -336,10 +393,13 @@ bool BPLUSTREE_TYPE::CoalesceOrRedistribute(N *node, Transaction *transaction) {
       }
     }
   } else {
-    //merge with right sibling node
+    //merge with right sibling node, which is deleted instead of node
     Coalesce(rightSibling, node, parent, 1, transaction);
-    if (!transaction) {
+    if (transaction) {
+      transaction->GetDeletedPageSet()->insert(rightSiblingPageId);
+    } else {
       buffer_pool_manager_->UnpinPage(rightSiblingPageId, true);
+      DeleteTreePage(rightSiblingPageId);
     }
   }
 
@@ -349,11 +409,10 @@ bool BPLUSTREE_TYPE::CoalesceOrRedistribute(N *node, Transaction *transaction) {
     if (transaction) {
       transaction->GetDeletedPageSet()->insert(parent->GetPageId());
     } else {
-      auto ret = buffer_pool_manager_->DeletePage(parent->GetPageId());
-      assert(ret);
+      DeleteTreePage(parent->GetPageId());
     }
   }
-  return true;
+  return leftSibling != nullptr;
 }
 
 /*
@@ -362,6 +421,8 @@ bool BPLUSTREE_TYPE::CoalesceOrRedistribute(N *node, Transaction *transaction) {
  * take info of deletion into account. Remember to deal with coalesce or
  * redistribute recursively if necessary.
  * Using template N to represent either internal page or leaf page.
+ * The page on the right is always the one emptied: with index == 1 the
+ * neighbor is moved into node.
  * @param   neighbor_node      sibling page of input "node"
  * @param   node               input from method coalesceOrRedistribute()
  * @param   parent             parent page of input "node"
@@ -382,13 +443,12 @@ bool BPLUSTREE_TYPE::Coalesce(
     int index = parent->ValueIndex(node->GetPageId());
     parent->Remove(index);
   } else {
-    node->MoveAllTo(neighbor_node, parent->ValueIndex(neighbor_node->GetPageId()), buffer_pool_manager_, comparator_);
+    //the right sibling goes into node rather than the other way round: only
+    //a left page can take over the right link of the page that disappears
+    neighbor_node->MoveAllTo(node, parent->ValueIndex(neighbor_node->GetPageId()), buffer_pool_manager_, comparator_);
     //remove kv points to neighbor
     int index = parent->ValueIndex(neighbor_node->GetPageId());
     parent->Remove(index);
-    //set kv originally points to node to neighbor
-    index = parent->ValueIndex(node->GetPageId());
-    parent->SetValueAt(index, neighbor_node->GetPageId());
   }
 
   auto ret = parent->GetSize() < parent->GetMinSize();
@@ -456,6 +516,253 @@ bool BPLUSTREE_TYPE::AdjustRoot(BPlusTreePage *old_root_node) {
   return false;
 }
 
+/*****************************************************************************
+ * BULK LOAD
+ *****************************************************************************/
+/*
+ * Build the tree bottom-up from sorted pairs, without searching it once.
+ * Each level keeps its last two pages pinned (BulkLevel): a leaf that is full
+ * starts the next one, which sends the one before it up to the level above,
+ * and so on up. When the input ends, the last page of each level may be less
+ * than half full; it is evened out with the page before it (BulkEvenOut),
+ * then the level is sent up, bottom-up. The first level left with a single
+ * page has the root.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::BulkLoad(const std::function<bool(KeyType &, ValueType &)> &next,
+                              double fill_factor) {
+  if (!IsEmpty()) {
+    throw Exception(EXCEPTION_TYPE_INDEX, "bulk load into a tree that is not empty");
+  }
+  BulkState state;
+  state.fill_factor = std::min(std::max(fill_factor, 0.5), 1.0);
+  state.levels.emplace_back();
+  BulkLevel &leaves = state.levels.front();
+  KeyType key;
+  ValueType value;
+  while (next(key, value)) {
+    B_PLUS_TREE_LEAF_PAGE_TYPE *leaf = nullptr;
+    if (leaves.cur != nullptr) {
+      int cmp = comparator_(key, leaves.cur_max);
+      if (cmp < 0) {
+        BulkAbort(state);
+        throw Exception(EXCEPTION_TYPE_INDEX, "bulk load input is not sorted");
+      }
+      if (cmp == 0) {
+        continue;
+      }
+      leaf = reinterpret_cast<B_PLUS_TREE_LEAF_PAGE_TYPE *>(leaves.cur->GetData());
+    }
+    if (leaf == nullptr || leaf->GetSize() >= BulkFill(leaf, state.fill_factor)) {
+      leaf = reinterpret_cast<B_PLUS_TREE_LEAF_PAGE_TYPE *>(BulkNewPage(state, 0)->GetData());
+    }
+    leaf->Insert(key, value, comparator_);
+    leaves.cur_max = key;
+  }
+  if (leaves.cur == nullptr) {
+    return;
+  }
+
+  for (size_t level = 0;; level++) {
+    BulkLevel &l = state.levels[level];
+    BulkEvenOut(state, level);
+    if (l.prev == nullptr && !l.has_parent) {
+      root_page_id_ = l.cur->GetPageId();
+      buffer_pool_manager_->UnpinPage(l.cur->GetPageId(), true);
+      break;
+    }
+    if (l.prev != nullptr) {
+      BulkPushUp(state, level);
+    }
+    l.prev = l.cur;
+    l.prev_max = l.cur_max;
+    l.cur = nullptr;
+    BulkPushUp(state, level);
+  }
+  UpdateRootPageId(true);
+}
+
+/*
+ * Start the next page of a level, right after the one before it on disk, and
+ * link the two. The page before that one is complete now and goes up
+ */
+INDEX_TEMPLATE_ARGUMENTS
+Page *BPLUSTREE_TYPE::BulkNewPage(BulkState &state, size_t level) {
+  BulkLevel &l = state.levels[level];
+  page_id_t page_id;
+  Page *page = buffer_pool_manager_->NewPage(
+      page_id, l.cur != nullptr ? l.cur->GetPageId() : INVALID_PAGE_ID);
+  if (page == nullptr) {
+    throw std::bad_alloc();
+  }
+  state.pages.push_back(page_id);
+  if (level == 0) {
+    auto leaf = reinterpret_cast<B_PLUS_TREE_LEAF_PAGE_TYPE *>(page->GetData());
+    leaf->Init(page_id, INVALID_PAGE_ID, page->GetPageSize());
+    if (l.cur != nullptr) {
+      leaf->SetPreviousPageId(l.cur->GetPageId());
+      reinterpret_cast<B_PLUS_TREE_LEAF_PAGE_TYPE *>(l.cur->GetData())->SetNextPageId(page_id);
+    }
+  } else {
+    auto ip = reinterpret_cast<BPInternalPage *>(page->GetData());
+    ip->Init(page_id, INVALID_PAGE_ID, page->GetPageSize());
+    if (l.cur != nullptr) {
+      reinterpret_cast<BPInternalPage *>(l.cur->GetData())->SetNextPageId(page_id);
+    }
+  }
+  if (l.cur != nullptr) {
+    if (l.prev != nullptr) {
+      BulkPushUp(state, level);
+    }
+    l.prev = l.cur;
+    l.prev_max = l.cur_max;
+  }
+  l.cur = page;
+  return page;
+}
+
+/*
+ * Append child to the page being filled on level. The key in front of a child
+ * is the largest key under the child before it, even in slot 0 of a page,
+ * where lookups ignore it: that way BulkEvenOut can move entries as they are
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::BulkAddChild(BulkState &state, size_t level, Page *child,
+                                  const KeyType &child_max) {
+  if (state.levels.size() == level) {
+    state.levels.emplace_back();
+  }
+  BulkLevel &l = state.levels[level];
+  BPInternalPage *ip = nullptr;
+  if (l.cur != nullptr) {
+    ip = reinterpret_cast<BPInternalPage *>(l.cur->GetData());
+  }
+  if (ip == nullptr || ip->GetSize() >= BulkFill(ip, state.fill_factor)) {
+    ip = reinterpret_cast<BPInternalPage *>(BulkNewPage(state, level)->GetData());
+  }
+  ip->IncreaseSize(1);
+  ip->SetKVAt(l.cur_max, child->GetPageId(), ip->GetSize() - 1);
+  reinterpret_cast<BPlusTreePage *>(child->GetData())->SetParentPageId(ip->GetPageId());
+  l.cur_max = child_max;
+}
+
+/*
+ * The page before the last one of level is complete: its high key is the
+ * largest key under it, and it goes to its parent
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::BulkPushUp(BulkState &state, size_t level) {
+  BulkLevel &l = state.levels[level];
+  if (level == 0) {
+    reinterpret_cast<B_PLUS_TREE_LEAF_PAGE_TYPE *>(l.prev->GetData())->SetHighKey(l.prev_max);
+  } else {
+    reinterpret_cast<BPInternalPage *>(l.prev->GetData())->SetHighKey(l.prev_max);
+  }
+  BulkAddChild(state, level + 1, l.prev, l.prev_max);
+  l.has_parent = true;
+  buffer_pool_manager_->UnpinPage(l.prev->GetPageId(), true);
+  l.prev = nullptr;
+}
+
+/*
+ * The last page of a level may be less than half full. If it fits into the
+ * page before it, it is merged into that one, otherwise the page before it
+ * hands over entries from its end until both are at least half full
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::BulkEvenOut(BulkState &state, size_t level) {
+  BulkLevel &l = state.levels[level];
+  if (l.prev == nullptr) {
+    return;
+  }
+  auto left = reinterpret_cast<BPlusTreePage *>(l.prev->GetData());
+  auto right = reinterpret_cast<BPlusTreePage *>(l.cur->GetData());
+  if (right->GetSize() >= right->GetMaxSize() / 2) {
+    return;
+  }
+  int total = left->GetSize() + right->GetSize();
+  bool merge = total <= left->GetMaxSize();
+  int moved = merge ? right->GetSize() : total / 2 - right->GetSize();
+  if (level == 0) {
+    auto lleaf = reinterpret_cast<B_PLUS_TREE_LEAF_PAGE_TYPE *>(left);
+    auto rleaf = reinterpret_cast<B_PLUS_TREE_LEAF_PAGE_TYPE *>(right);
+    if (merge) {
+      for (int i = 0; i < rleaf->GetSize(); i++) {
+        lleaf->Insert(rleaf->KeyAt(i), rleaf->GetItem(i).second, comparator_);
+      }
+      lleaf->SetNextPageId(INVALID_PAGE_ID);
+    } else {
+      for (int i = lleaf->GetSize() - 1; i >= lleaf->GetSize() - moved; i--) {
+        rleaf->Insert(lleaf->KeyAt(i), lleaf->GetItem(i).second, comparator_);
+      }
+      lleaf->IncreaseSize(-moved);
+      l.prev_max = lleaf->KeyAt(lleaf->GetSize() - 1);
+    }
+  } else {
+    auto lip = reinterpret_cast<BPInternalPage *>(left);
+    auto rip = reinterpret_cast<BPInternalPage *>(right);
+    // entries move as they are, slot 0 of the right page keeps its key
+    std::vector<std::pair<KeyType, page_id_t>> entries;
+    BPInternalPage *to;
+    if (merge) {
+      for (int i = 0; i < lip->GetSize(); i++) {
+        entries.emplace_back(lip->KeyAt(i), lip->ValueAt(i));
+      }
+      for (int i = 0; i < rip->GetSize(); i++) {
+        entries.emplace_back(rip->KeyAt(i), rip->ValueAt(i));
+      }
+      lip->SetNextPageId(INVALID_PAGE_ID);
+      to = lip;
+    } else {
+      int from = lip->GetSize() - moved;
+      for (int i = from; i < lip->GetSize(); i++) {
+        entries.emplace_back(lip->KeyAt(i), lip->ValueAt(i));
+      }
+      for (int i = 0; i < rip->GetSize(); i++) {
+        entries.emplace_back(rip->KeyAt(i), rip->ValueAt(i));
+      }
+      l.prev_max = lip->KeyAt(from);
+      lip->SetSize(from);
+      to = rip;
+    }
+    to->SetSize(static_cast<int>(entries.size()));
+    for (size_t i = 0; i < entries.size(); i++) {
+      to->SetKVAt(entries[i].first, entries[i].second, static_cast<int>(i));
+    }
+    // the pages below are all unpinned by now
+    int first = merge ? lip->GetSize() - moved : 0;
+    for (int i = first; i < first + moved; i++) {
+      auto child = GetPage(to->ValueAt(i));
+      child->SetParentPageId(to->GetPageId());
+      buffer_pool_manager_->UnpinPage(child->GetPageId(), true);
+    }
+  }
+  if (merge) {
+    page_id_t page_id = l.cur->GetPageId();
+    buffer_pool_manager_->UnpinPage(page_id, false);
+    DeleteTreePage(page_id);
+    l.cur = l.prev;
+    l.prev = nullptr;
+  }
+}
+
+/*
+ * The input turned out to be unsorted: give back every page taken
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::BulkAbort(BulkState &state) {
+  for (auto &l : state.levels) {
+    for (Page *page : {l.prev, l.cur}) {
+      if (page != nullptr) {
+        buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+      }
+    }
+  }
+  for (page_id_t page_id : state.pages) {
+    DeleteTreePage(page_id);
+  }
+}
+
 /*****************************************************************************
  * INDEX ITERATOR
  *****************************************************************************/
@@ -466,14 +773,13 @@ bool BPLUSTREE_TYPE::AdjustRoot(BPlusTreePage *old_root_node) {
  */
 INDEX_TEMPLATE_ARGUMENTS
 INDEXITERATOR_TYPE BPLUSTREE_TYPE::Begin() {
-  page_id_t page_id = root_page_id_;
-  BPlusTreePage *page = GetPage(page_id);
-  while (!page->IsLeafPage()) {
-    BPInternalPage *ip = reinterpret_cast<BPInternalPage *>(page);
-    page_id = ip->ValueAt(0);
-    page = GetPage(page_id);
-  }
-  return INDEXITERATOR_TYPE(page->GetPageId(), 0, *buffer_pool_manager_);
+  uint64_t version;
+  Page *page = FindLeafOptimistic(KeyType{}, true, version);
+  page_id_t page_id = page == nullptr ? INVALID_PAGE_ID : page->GetPageId();
+  if (page != nullptr) {
+    buffer_pool_manager_->UnpinPage(page_id, false);
+  }
+  return INDEXITERATOR_TYPE(page_id, 0, *buffer_pool_manager_);
 }
 
 /*
@@ -483,9 +789,20 @@ INDEXITERATOR_TYPE BPLUSTREE_TYPE::Begin() {
  */
 INDEX_TEMPLATE_ARGUMENTS
 INDEXITERATOR_TYPE BPLUSTREE_TYPE::Begin(const KeyType &key) {
-  auto leaf = GetLeafPage(key);
-  buffer_pool_manager_->UnpinPage(leaf->GetPageId(), false);
-  return INDEXITERATOR_TYPE(leaf->GetPageId(), leaf->KeyIndex(key, comparator_), *buffer_pool_manager_);
+  while (true) {
+    uint64_t version;
+    Page *page = FindLeafOptimistic(key, false, version);
+    if (page == nullptr) {
+      return INDEXITERATOR_TYPE(INVALID_PAGE_ID, 0, *buffer_pool_manager_);
+    }
+    auto leaf = reinterpret_cast<B_PLUS_TREE_LEAF_PAGE_TYPE *>(page->GetData());
+    int index = leaf->KeyIndex(key, comparator_);
+    bool valid = page->ValidateVersion(version);
+    buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+    if (valid) {
+      return INDEXITERATOR_TYPE(page->GetPageId(), index, *buffer_pool_manager_);
+    }
+  }
 }
 
 /*****************************************************************************
@@ -494,11 +811,18 @@ INDEXITERATOR_TYPE BPLUSTREE_TYPE::Begin(const KeyType &key) {
 /*
  * Find leaf page containing particular key, if leftMost flag == true, find
  * the left most leaf page
+ * The page is not pinned any more, only use it while nothing else happens
  */
 INDEX_TEMPLATE_ARGUMENTS
 B_PLUS_TREE_LEAF_PAGE_TYPE *BPLUSTREE_TYPE::FindLeafPage(const KeyType &key,
                                                          bool leftMost) {
-  return nullptr;
+  uint64_t version;
+  Page *page = FindLeafOptimistic(key, leftMost, version);
+  if (page == nullptr) {
+    return nullptr;
+  }
+  buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+  return reinterpret_cast<B_PLUS_TREE_LEAF_PAGE_TYPE *>(page->GetData());
 }
 
 /*
@@ -513,10 +837,9 @@ INDEX_TEMPLATE_ARGUMENTS
 void BPLUSTREE_TYPE::UpdateRootPageId(int insert_record) {
   HeaderPage *header_page = static_cast<HeaderPage *>(
       buffer_pool_manager_->FetchPage(HEADER_PAGE_ID));
-  if (insert_record)
-    // create a new record<index_name + root_page_id> in header_page
-    header_page->InsertRecord(index_name_, root_page_id_);
-  else
+  // create a new record<index_name + root_page_id> in header_page, unless
+  // the tree had one before
+  if (!insert_record || !header_page->InsertRecord(index_name_, root_page_id_))
     // update root_page_id in header_page
     header_page->UpdateRecord(index_name_, root_page_id_);
   buffer_pool_manager_->UnpinPage(HEADER_PAGE_ID, true);
@@ -605,65 +928,128 @@ void BPLUSTREE_TYPE::RemoveFromFile(const std::string &file_name,
   }
 }
 
+/*
+ * Crab down, write latching every page on the way. The latches above a page
+ * are released as soon as it is safe, i.e. the insert (1) or the remove (2)
+ * cannot reach above it; the rest stay in the transaction's page set.
+ * A safe page that did not change since the optimistic descent saw it is as
+ * good a start as the root: the key still falls into it, and nothing above it
+ * can change
+ */
 INDEX_TEMPLATE_ARGUMENTS
 B_PLUS_TREE_LEAF_PAGE_TYPE *BPLUSTREE_TYPE::GetLeafPage(const KeyType &key,
                                                         Transaction *transaction,
-                                                        int findInsertDelete) {
-  if (IsEmpty()) { return nullptr; }
-  assert(transaction == nullptr || (transaction->GetPageSet()->empty() && transaction->GetDeletedPageSet()->empty()));
-  page_id_t page_id = root_page_id_;
-
-  BPlusTreePage *btp = GetPage(page_id);
-  if (transaction) {
-    lockFor(findInsertDelete, btp);
-    while(page_id != root_page_id_){
-      unlockFor(findInsertDelete, btp);
+                                                        int findInsertDelete,
+                                                        SafePage &start) {
+  assert(transaction->GetPageSet()->empty() && transaction->GetDeletedPageSet()->empty());
+  page_id_t page_id;
+  Page *page = start.page;
+  start.page = nullptr;
+  if (page != nullptr && !page->UpgradeToWLatch(start.version)) {
+    buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+    page = nullptr;
+  }
+  while (page == nullptr) {
+    page_id = root_page_id_;
+    if (page_id == INVALID_PAGE_ID) { return nullptr; }
+    page = buffer_pool_manager_->FetchPage(page_id);
+    lockFor(findInsertDelete, page);
+    if (page_id != root_page_id_) {
+      unlockFor(findInsertDelete, page);
       buffer_pool_manager_->UnpinPage(page_id, false);
-      page_id = root_page_id_;
-      btp = GetPage(page_id);
-      lockFor(findInsertDelete, btp);
+      page = nullptr;
     }
-    transaction->AddIntoPageSet(BPlusTreePageToPage(btp));
   }
+  transaction->AddIntoPageSet(page);
 
+  BPlusTreePage *btp = reinterpret_cast<BPlusTreePage *>(page->GetData());
   while (!btp->IsLeafPage()) {
     BPInternalPage *ip = reinterpret_cast<BPInternalPage *>(btp);
-    page_id_t next = ip->Lookup(key, comparator_);
-    page_id_t unpin = page_id;
+    page_id = ip->Lookup(key, comparator_);
+    page = buffer_pool_manager_->FetchPage(page_id);
+    lockFor(findInsertDelete, page);
+    btp = reinterpret_cast<BPlusTreePage *>(page->GetData());
+    assert(findInsertDelete == 1 || findInsertDelete == 2);
+    //release upper level locks only if current node can not split or underflow
+    if (IsSafe(btp, findInsertDelete)) {
+      clearTxnWorkSet(transaction, findInsertDelete, false);
+    }
+    transaction->AddIntoPageSet(page);
+  }
 
-    page_id = next;
-    btp = GetPage(page_id);
-    if (transaction) {
-      lockFor(findInsertDelete, btp);
-      if (findInsertDelete == 0) {
-        //search
-        //as soon as the next level is locked, release previous level's lock
-//        Page *toUnlock = transaction->GetPageSet()->front();
-//        transaction->GetPageSet()->pop_front();
-//        unlockFor(findInsertDelete, toUnlock);
-//        buffer_pool_manager_->UnpinPage(toUnlock->GetPageId(), false);
-        clearTxnWorkSet(transaction, findInsertDelete, false);
-      } else if (findInsertDelete == 1) {
-        //insert
-        //release upper level locks only if current node is not full
-        if (btp->GetMaxSize() > btp->GetSize()) {
-          //release all locks
-          clearTxnWorkSet(transaction, findInsertDelete, false);
-        }
-      } else if (findInsertDelete == 2) {
-        if (btp->GetMinSize() < btp->GetSize()) {
-          clearTxnWorkSet(transaction, findInsertDelete, false);
-        }
+  return reinterpret_cast<B_PLUS_TREE_LEAF_PAGE_TYPE *>(btp);
+}
+
+/*
+ * Descend without latching anything. A page is read between StableVersion and
+ * ValidateVersion; a key beyond its high key leads to its right sibling, and
+ * otherwise the child is looked up. Once the next page is pinned the one it
+ * was found in may change at will: a split only moves keys right, where the
+ * high keys lead. Merges and redistributions are caught by shrink_epoch_, the
+ * descent starts over from the root then. The caller validates the leaf's
+ * version after reading it.
+ * @return: the leaf, pinned; nullptr if the tree is empty
+ */
+INDEX_TEMPLATE_ARGUMENTS
+Page *BPLUSTREE_TYPE::FindLeafOptimistic(const KeyType &key, bool leftMost,
+                                         uint64_t &version,
+                                         int findInsertDelete,
+                                         SafePage *safe) {
+  while (true) {
+    uint64_t epoch = shrink_epoch_;
+    page_id_t page_id = root_page_id_;
+    if (page_id == INVALID_PAGE_ID) { return nullptr; }
+    Page *page = buffer_pool_manager_->FetchPage(page_id);
+    version = page->StableVersion();
+    if (epoch != shrink_epoch_) {
+      buffer_pool_manager_->UnpinPage(page_id, false);
+      continue;
+    }
+
+    while (page != nullptr) {
+      auto btp = reinterpret_cast<BPlusTreePage *>(page->GetData());
+      page_id_t next_id;
+      if (!leftMost && PastHighKey(btp, key)) {
+        next_id = btp->IsLeafPage()
+                  ? reinterpret_cast<B_PLUS_TREE_LEAF_PAGE_TYPE *>(btp)->GetNextPageId()
+                  : reinterpret_cast<BPInternalPage *>(btp)->GetNextPageId();
+      } else if (btp->IsLeafPage()) {
+        break;
       } else {
-        assert(false);
+        BPInternalPage *ip = reinterpret_cast<BPInternalPage *>(btp);
+        next_id = leftMost ? ip->ValueAt(0) : ip->Lookup(key, comparator_);
+        if (safe != nullptr && IsSafe(btp, findInsertDelete) &&
+            page->ValidateVersion(version)) {
+          //keep the pin on the deepest safe page
+          if (safe->page != nullptr) {
+            buffer_pool_manager_->UnpinPage(safe->page->GetPageId(), false);
+          }
+          buffer_pool_manager_->FetchPage(page->GetPageId());
+          safe->page = page;
+          safe->version = version;
+        }
+      }
+      bool valid = page->ValidateVersion(version);
+      buffer_pool_manager_->UnpinPage(page->GetPageId(), false);
+      page = nullptr;
+      if (!valid) {
+        break;
+      }
+      page = buffer_pool_manager_->FetchPage(next_id);
+      version = page->StableVersion();
+      if (epoch != shrink_epoch_) {
+        buffer_pool_manager_->UnpinPage(next_id, false);
+        page = nullptr;
       }
-      transaction->AddIntoPageSet(BPlusTreePageToPage(btp));
-    } else {
-      buffer_pool_manager_->UnpinPage(unpin, false);
+    }
+    if (page != nullptr) {
+      return page;
+    }
+    if (safe != nullptr && safe->page != nullptr) {
+      buffer_pool_manager_->UnpinPage(safe->page->GetPageId(), false);
+      safe->page = nullptr;
     }
   }
-
-  return reinterpret_cast<B_PLUS_TREE_LEAF_PAGE_TYPE *>(btp);
 }
 
 template
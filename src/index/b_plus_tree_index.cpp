@@ -45,6 +45,29 @@ void BPLUSTREE_INDEX_TYPE::ScanKey(const Tuple &key, std::vector<RID> &result,
 
   container_.GetValue(index_key, result, transaction);
 }
+/*
+ * Sort the entries by key first, on disk if they do not fit in memory, then
+ * build the tree bottom-up from them
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_INDEX_TYPE::BulkLoad(
+    const std::function<bool(Tuple &key, RID &rid)> &next,
+    Transaction *transaction) {
+  ExternalSorter<KeyType, ValueType, KeyComparator> sorter(comparator_);
+  Tuple key;
+  RID rid;
+  while (next(key, rid)) {
+    KeyType index_key;
+    index_key.SetFromKey(key);
+    sorter.Add(index_key, rid);
+  }
+  sorter.Finish();
+
+  container_.BulkLoad([&sorter](KeyType &index_key, ValueType &value) {
+    return sorter.Next(index_key, value);
+  });
+}
+
 template class BPlusTreeIndex<GenericKey<4>, RID, GenericComparator<4>>;
 template class BPlusTreeIndex<GenericKey<8>, RID, GenericComparator<8>>;
 template class BPlusTreeIndex<GenericKey<16>, RID, GenericComparator<16>>;
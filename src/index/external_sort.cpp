@@ -0,0 +1,155 @@
+/**
+ * external_sort.cpp
+ */
+#include <algorithm>
+#include <cassert>
+
+#include "common/exception.h"
+#include "common/rid.h"
+#include "index/external_sort.h"
+#include "index/generic_key.h"
+
+namespace cmudb {
+
+INDEX_TEMPLATE_ARGUMENTS
+EXTERNALSORTER_TYPE::ExternalSorter(const KeyComparator &comparator,
+                                    size_t memory_limit)
+    : comparator_(comparator),
+      capacity_(std::max<size_t>(memory_limit / sizeof(MappingType), 1)) {}
+
+INDEX_TEMPLATE_ARGUMENTS
+EXTERNALSORTER_TYPE::~ExternalSorter() {
+  for (auto &run : runs_) {
+    if (run.file != nullptr) {
+      fclose(run.file);
+    }
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void EXTERNALSORTER_TYPE::Add(const KeyType &key, const ValueType &value) {
+  assert(!finished_);
+  buffer_.emplace_back(key, value);
+  if (buffer_.size() >= capacity_) {
+    SpillRun();
+  }
+}
+
+/*
+ * Sort the buffer and write it out as a run of its own; stable, so that of
+ * equal keys the one added first stays first
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void EXTERNALSORTER_TYPE::SpillRun() {
+  std::stable_sort(buffer_.begin(), buffer_.end(),
+                   [this](const MappingType &a, const MappingType &b) {
+                     return comparator_(a.first, b.first) < 0;
+                   });
+  Run run;
+  run.file = std::tmpfile();
+  if (run.file == nullptr) {
+    throw Exception(EXCEPTION_TYPE_IO, "cannot create a file for a sort run");
+  }
+  runs_.push_back(std::move(run));
+  if (fwrite(buffer_.data(), sizeof(MappingType), buffer_.size(),
+             runs_.back().file) != buffer_.size()) {
+    throw Exception(EXCEPTION_TYPE_IO, "cannot write a sort run");
+  }
+  spilled_++;
+  buffer_.clear();
+}
+
+/*
+ * Once runs were written, what is left in the buffer goes out as the last run
+ * too, and the memory is shared among the windows of all runs. Otherwise the
+ * buffer is the only run
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void EXTERNALSORTER_TYPE::Finish() {
+  assert(!finished_);
+  finished_ = true;
+  if (runs_.empty()) {
+    std::stable_sort(buffer_.begin(), buffer_.end(),
+                     [this](const MappingType &a, const MappingType &b) {
+                       return comparator_(a.first, b.first) < 0;
+                     });
+    Run run;
+    run.window.swap(buffer_);
+    runs_.push_back(std::move(run));
+  } else {
+    if (!buffer_.empty()) {
+      SpillRun();
+    }
+    std::vector<MappingType>().swap(buffer_);
+    window_size_ = std::max<size_t>(capacity_ / runs_.size(), 1);
+    for (auto &run : runs_) {
+      rewind(run.file);
+      Refill(run);
+    }
+  }
+  auto after = [this](size_t a, size_t b) { return Before(b, a); };
+  for (size_t i = 0; i < runs_.size(); i++) {
+    if (!runs_[i].window.empty()) {
+      heap_.push_back(i);
+      std::push_heap(heap_.begin(), heap_.end(), after);
+    }
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+bool EXTERNALSORTER_TYPE::Next(KeyType &key, ValueType &value) {
+  assert(finished_);
+  if (heap_.empty()) {
+    return false;
+  }
+  auto after = [this](size_t a, size_t b) { return Before(b, a); };
+  std::pop_heap(heap_.begin(), heap_.end(), after);
+  Run &run = runs_[heap_.back()];
+  key = run.window[run.pos].first;
+  value = run.window[run.pos].second;
+  if (++run.pos < run.window.size() || Refill(run)) {
+    std::push_heap(heap_.begin(), heap_.end(), after);
+  } else {
+    heap_.pop_back();
+  }
+  return true;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+bool EXTERNALSORTER_TYPE::Refill(Run &run) {
+  if (run.file == nullptr) {
+    return false;
+  }
+  run.window.resize(window_size_);
+  size_t count = fread(run.window.data(), sizeof(MappingType), window_size_,
+                       run.file);
+  if (count < window_size_ && ferror(run.file)) {
+    throw Exception(EXCEPTION_TYPE_IO, "cannot read a sort run");
+  }
+  run.window.resize(count);
+  run.pos = 0;
+  return count > 0;
+}
+
+/*
+ * Runs are numbered in the order they were added, so equal keys stay in order
+ */
+INDEX_TEMPLATE_ARGUMENTS
+bool EXTERNALSORTER_TYPE::Before(size_t a, size_t b) const {
+  const Run &x = runs_[a], &y = runs_[b];
+  int cmp = comparator_(x.window[x.pos].first, y.window[y.pos].first);
+  return cmp < 0 || (cmp == 0 && a < b);
+}
+
+template
+class ExternalSorter<GenericKey<4>, RID, GenericComparator<4>>;
+template
+class ExternalSorter<GenericKey<8>, RID, GenericComparator<8>>;
+template
+class ExternalSorter<GenericKey<16>, RID, GenericComparator<16>>;
+template
+class ExternalSorter<GenericKey<32>, RID, GenericComparator<32>>;
+template
+class ExternalSorter<GenericKey<64>, RID, GenericComparator<64>>;
+
+} // namespace cmudb
@@ -16,7 +16,9 @@ namespace cmudb {
 
 INDEX_TEMPLATE_ARGUMENTS
 INDEXITERATOR_TYPE::~IndexIterator() {
-  bufferPoolManager.UnpinPage(leafPage->GetPageId(), false);
+  if (leafPage != nullptr) {
+    bufferPoolManager.UnpinPage(leafPage->GetPageId(), false);
+  }
 }
 
 template
@@ -0,0 +1,139 @@
+/**
+ * checkpoint_manager.cpp
+ */
+
+#include "logging/checkpoint_manager.h"
+#include "page/header_page.h"
+
+namespace cmudb {
+/*
+ * 1. append BEGIN_CHECKPOINT
+ * 2. append END_CHECKPOINT with the active transactions and dirty pages as
+ *    they are now, nothing is stopped or flushed for it; tables too large
+ *    for one record are split across several
+ * 3. force the log and sync the db file, so that the pages written before
+ *    the dirty page table was taken are durable; then record the begin LSN
+ *    in the header page, write that page and sync again. A crash before this
+ *    leaves the previous checkpoint in charge
+ * 4. drop the log segments recovery from this checkpoint can't need: those
+ *    before the redo start point and before the BEGIN of every transaction
+ *    it may have to undo
+ * A db file without a header page gets the records but no master record, and
+ * keeps its whole log.
+ */
+lsn_t CheckpointManager::Checkpoint() {
+  std::lock_guard<std::mutex> guard(checkpoint_latch_);
+  if (!ENABLE_LOGGING) {
+    return INVALID_LSN;
+  }
+  LogRecord begin(INVALID_TXN_ID, INVALID_LSN,
+                  LogRecordType::BEGIN_CHECKPOINT);
+  lsn_t begin_lsn = log_manager_->AppendLogRecord(begin);
+
+  DirtyPageTable dirty_pages = buffer_pool_manager_->GetDirtyPageTable();
+  lsn_t keep_lsn = begin_lsn;
+  for (auto &page : dirty_pages) {
+    keep_lsn = std::min(keep_lsn, page.second);
+  }
+  lsn_t oldest_begin_lsn = transaction_manager_->GetOldestBeginLSN();
+  if (oldest_begin_lsn != INVALID_LSN) {
+    keep_lsn = std::min(keep_lsn, oldest_begin_lsn);
+  }
+  lsn_t end_lsn = AppendEndCheckpoint(
+      begin_lsn, transaction_manager_->GetActiveTxnTable(), dirty_pages);
+  log_manager_->WaitForLSN(end_lsn);
+
+  if (!disk_manager_->IsAllocated(HEADER_PAGE_ID) ||
+      !disk_manager_->SyncData()) {
+    return begin_lsn;
+  }
+  auto header_page = static_cast<HeaderPage *>(
+      buffer_pool_manager_->FetchPage(HEADER_PAGE_ID));
+  if (header_page == nullptr) {
+    return begin_lsn;
+  }
+  bool is_header_page = header_page->IsHeaderPage();
+  if (is_header_page) {
+    header_page->SetCheckpointLSN(begin_lsn);
+  }
+  buffer_pool_manager_->UnpinPage(HEADER_PAGE_ID, is_header_page);
+  if (is_header_page) {
+    buffer_pool_manager_->FlushPage(HEADER_PAGE_ID);
+    if (disk_manager_->SyncData()) {
+      disk_manager_->TruncateLog(keep_lsn);
+    }
+  }
+  return begin_lsn;
+}
+
+/*
+ * A record has to fit in a log buffer, so the tables go out in as many
+ * END_CHECKPOINT records as that takes, all pointing at the same begin record.
+ * Recovery merges them; it only trusts a checkpoint the master record points
+ * at, and that happens after all of them are on disk.
+ * @return: LSN of the last one
+ */
+lsn_t CheckpointManager::AppendEndCheckpoint(lsn_t begin_lsn,
+                                             const ActiveTxnTable &active_txns,
+                                             const DirtyPageTable &dirty_pages) {
+  const size_t txn_size = sizeof(txn_id_t) + sizeof(lsn_t);
+  const size_t page_size = sizeof(page_id_t) + sizeof(lsn_t);
+  size_t capacity = log_manager_->GetBufferCapacity();
+  // size of one with empty tables
+  size_t empty_size =
+      LogRecord(begin_lsn, LogRecordType::END_CHECKPOINT, {}, {}).GetSize();
+  size_t next_txn = 0, next_page = 0;
+  lsn_t end_lsn;
+  do {
+    ActiveTxnTable txn_part;
+    DirtyPageTable page_part;
+    size_t size = empty_size;
+    while (next_txn < active_txns.size() && size + txn_size <= capacity) {
+      txn_part.push_back(active_txns[next_txn++]);
+      size += txn_size;
+    }
+    while (next_page < dirty_pages.size() && size + page_size <= capacity) {
+      page_part.push_back(dirty_pages[next_page++]);
+      size += page_size;
+    }
+    LogRecord end(begin_lsn, LogRecordType::END_CHECKPOINT, txn_part,
+                  page_part);
+    end_lsn = log_manager_->AppendLogRecord(end);
+  } while (next_txn < active_txns.size() || next_page < dirty_pages.size());
+  return end_lsn;
+}
+
+void CheckpointManager::RunCheckpointThread() {
+  std::lock_guard<std::mutex> guard(thread_latch_);
+  if (!checkpoint_thread_on_) {
+    checkpoint_thread_on_ = true;
+    checkpoint_thread_ =
+        new std::thread(&CheckpointManager::CheckpointPeriodically, this);
+  }
+}
+
+void CheckpointManager::StopCheckpointThread() {
+  {
+    std::lock_guard<std::mutex> guard(thread_latch_);
+    if (!checkpoint_thread_on_) {
+      return;
+    }
+    checkpoint_thread_on_ = false;
+  }
+  thread_cv_.notify_all();
+  checkpoint_thread_->join();
+  delete checkpoint_thread_;
+  checkpoint_thread_ = nullptr;
+}
+
+void CheckpointManager::CheckpointPeriodically() {
+  std::unique_lock<std::mutex> lock(thread_latch_);
+  while (!thread_cv_.wait_for(lock, CHECKPOINT_TIMEOUT,
+                              [&] { return !checkpoint_thread_on_; })) {
+    lock.unlock();
+    Checkpoint();
+    lock.lock();
+  }
+}
+
+} // namespace cmudb
@@ -22,53 +22,65 @@ void LogManager::RunFlushThread() {
 }
 
 /**
- * case 1. : periodical wake up. write out flush_buffer and swap flush_buffer with log_buffer
- *           (I mean swap ptr and idx by swap ptrs)
- * case 2. : be waken up on 1)log_buffer is full 2)something in log_buffer need to be flushed
- *              1) empty flush_buffer first and swap ptrs, it's done
- *              2) empty flush_buffer and swap ptrs and write flush_buffers out, return after
- *              these <- this is triggered in another function 'flushnowblocking'
- * wake-up is implemented by a condition variable.
- * <del>need more info on which scenario is going on with case 2. i.e. to flush both buffers.</del>
- * <del>seems that a single bool value is suffice.</del>
- * <del>marked means flushing both, not marked means no.</del>
- * using another cond to info completion (named : flushed)
+ * The flush thread sleeps until somebody waits for a record that is not on
+ * disk yet, an appender finds the buffer full, the thread is stopped or
+ * LOG_TIMEOUT passes. A waiting committer opens the group window: for up to
+ * GROUP_COMMIT_WINDOW other committers may still append and join the same
+ * write, unless the buffer fills up first.
  *
- * that is :
- * while bg thread running:
- *      wait for time out or blocking
- *      if time out or waken up:
- *          1.write flush_buffer
- *          2.swap pointers
- *          3.signal completion
- *
- *
- * check flush_buffer_size to deal with superfluous wake up
+ * Whatever is left in the buffers is written before the thread ends.
  */
 void LogManager::bgFsync() {
+  std::unique_lock<std::mutex> lock(latch_);
   while (flush_thread_on) {
-    {
-      std::unique_lock<std::mutex> lock(latch_);
-      while (log_buffer_size_ == 0) {
-        auto ret = cv_.wait_for(lock, LOG_TIMEOUT);
-//        std::cout <<( (ret == std::cv_status::no_timeout) ? "no time out" : "time out" )<< std::endl;
-        if (ret == std::cv_status::no_timeout || flush_thread_on == false) {
-          //required for force flushing
-          break;
-        }
-      }
-      SwapBuffer();
+    cv_.wait_for(lock, LOG_TIMEOUT, [this] {
+      return !flush_thread_on || buffer_full_ || wait_lsn_ > persistent_lsn_;
+    });
+    if (flush_thread_on && !buffer_full_ && wait_lsn_ > persistent_lsn_ &&
+        GROUP_COMMIT_WINDOW.count() > 0) {
+      cv_.wait_for(lock, GROUP_COMMIT_WINDOW,
+                   [this] { return !flush_thread_on || buffer_full_; });
     }
-    disk_manager_->WriteLog(flush_buffer_, flush_buffer_size_);
-    std::unique_lock<std::mutex> lock(latch_);
-    auto lsn = lastLsn(flush_buffer_, flush_buffer_size_);
-    if (lsn != INVALID_LSN) {
-      persistent_lsn_ = lsn;
+    Flush(lock);
+  }
+  Flush(lock);
+}
+
+/*
+ * Seal the buffer being filled, switching appenders to the other one, and
+ * write out what was reserved in it once all of that is serialized. Appenders
+ * go on filling the other buffer meanwhile
+ */
+void LogManager::Flush(std::unique_lock<std::mutex> &lock) {
+  uint64_t state = reserve_state_;
+  uint64_t generation = Generation(state);
+  int cur = generation & 1, next = cur ^ 1;
+  int size;
+  do {
+    size = Reserved(state);
+    if (size == 0) {
+      return;
     }
-    flush_buffer_size_ = 0;
-    flushed.notify_all();
+    // nobody reads the next base before the switch publishes it
+    base_lsn_[next] = base_lsn_[cur] + size;
+  } while (!reserve_state_.compare_exchange_weak(
+      state, MakeState(generation + 1, 0)));
+  buffer_full_ = false;
+  flushed.notify_all();
+
+  lock.unlock();
+  // the contiguous prefix: records reserved before the switch, still being
+  // copied by their appenders
+  while (filled_[cur] != size) {
+    std::this_thread::yield();
   }
+  disk_manager_->WriteLog(log_buffers_[cur], size);
+  filled_[cur] = 0;
+  lock.lock();
+  persistent_lsn_ = base_lsn_[next] - 1;
+  flushed.notify_all();
 }
+
 /*
  * Stop and join the flush thread, set ENABLE_LOGGING = false
  */
@@ -77,12 +89,10 @@ void LogManager::StopFlushThread() {
   if (flush_thread_on == true) {
     flush_thread_on = false;
     ENABLE_LOGGING = false;
-    {
-      lock.unlock();
-      //wake up working thread, or it may take a long time waiting before it's been joined
-      cv_.notify_all();
-
-    }
+    //wake up working thread, or it may take a long time waiting before it's been joined
+    cv_.notify_all();
+    flushed.notify_all();
+    lock.unlock();
     assert(flush_thread_->joinable());
     flush_thread_->join();
     lock.lock();
@@ -90,50 +100,60 @@ void LogManager::StopFlushThread() {
   }
 }
 
-void LogManager::FlushNowBlocking() {
-  //write out current flush buffer
-  {
-    GetBgTaskToWork();
-    WaitUntilBgTaskFinish();
+/*
+ * Concurrent waiters share one write: each only asks for its own LSN, and the
+ * flush thread writes everything appended by then. Without the flush thread
+ * nothing gets written, so there is nothing to wait for
+ */
+void LogManager::WaitForLSN(lsn_t lsn) {
+  // nothing beyond the reserved bytes can become persistent
+  lsn = std::min(lsn, GetNextLSN() - 1);
+  std::unique_lock<std::mutex> lock(latch_);
+  if (persistent_lsn_ >= lsn) {
+    return;
   }
-  //write out flush buffer which is previous log buffer
-  {
-    GetBgTaskToWork();
-    WaitUntilBgTaskFinish();
+  if (wait_lsn_ < lsn) {
+    wait_lsn_ = lsn;
+    cv_.notify_one();
   }
+  flushed.wait(lock, [this, lsn] {
+    return persistent_lsn_ >= lsn || !flush_thread_on;
+  });
 }
 
-void LogManager::SwapBuffer() {
-  using std::swap;
-  swap(flush_buffer_, log_buffer_);
-  flush_buffer_size_ = log_buffer_size_;
-  log_buffer_size_ = 0;
-}
-
-void LogManager::GetBgTaskToWork() {
-  cv_.notify_all();
+void LogManager::FlushNowBlocking() {
+  WaitForLSN(GetNextLSN() - 1);
 }
 
-void LogManager::WaitUntilBgTaskFinish() {
-  std::unique_lock<std::mutex> condWait(latch_);
-  while (flush_buffer_size_ != 0) {
-    flushed.wait(condWait);
+/*
+ * The base LSN of a generation is only rewritten two generations later, so
+ * it belongs to the state read if the generation did not change meanwhile
+ */
+lsn_t LogManager::GetNextLSN() {
+  uint64_t state = reserve_state_;
+  for (;;) {
+    lsn_t base = base_lsn_[Generation(state) & 1];
+    uint64_t again = reserve_state_;
+    if (Generation(again) == Generation(state)) {
+      return base + Reserved(again);
+    }
+    state = again;
   }
 }
 
-//it's also applicable that using two variables to tract last lsn in log buffer and flush buffer
-//this is method below is more helpful during debugging
-int LogManager::lastLsn(char *buff, int size) {
-  lsn_t cur = INVALID_LSN;
-  char *ptr = buff;
-  while (ptr < buff + size) {
-    auto rec = reinterpret_cast<LogRecord *>(ptr);
-    cur = rec->GetLSN();
-    auto len = rec->GetSize();
-    ptr = ptr + len;
-  }
-  return cur;
+/*
+ * Recovery found the end of the log: the records appended from now on go
+ * right after the last valid one, not after whatever is left behind it
+ */
+void LogManager::CutLog(lsn_t lsn) {
+  std::lock_guard<std::mutex> guard(latch_);
+  uint64_t state = reserve_state_;
+  assert(Reserved(state) == 0);
+  disk_manager_->CutLog(lsn);
+  base_lsn_[Generation(state) & 1] = lsn;
+  persistent_lsn_ = lsn - 1;
 }
+
 /*
  * append a log record into log buffer
  * you MUST set the log record's lsn within this method
@@ -156,64 +176,108 @@ int LogManager::lastLsn(char *buff, int size) {
  */
 /**
  * about concurrency.
- * in case there're many threads calling this method,
- * appending procedure must be done one after another.
- * latch_ is hold until the appending is done.
+ * appenders run in parallel: each reserves its bytes in the buffer being
+ * filled with a compare-and-swap on reserve_state_ and copies its record
+ * there without holding any latch.
  *
- * when log_buffer cannot hold the incoming record,
- * it needs the bg thread to write out flush_buffer and make swap of ptrs.
- * after that log_buffer is empty
+ * when the buffer cannot hold the incoming record, the appender asks the
+ * flush thread to seal it and waits for the next generation under latch_
  * @param log_record
  * @return
  */
 lsn_t LogManager::AppendLogRecord(LogRecord &log_record) {
   auto size = log_record.GetSize();
-  std::unique_lock<std::mutex> guard(log_mtx_);//this is used only to sync AppendLogRecord function call
-  std::unique_lock<std::mutex> guard2(latch_);
-  log_record.lsn_ = next_lsn_++;
-  if (size + log_buffer_size_ > LOG_BUFFER_SIZE) {
-    //1.make sure flush_buffer is written out
-    //wake up bg thread
-    GetBgTaskToWork();
-    guard2.unlock();
-    //wait until bg finish writing
-    WaitUntilBgTaskFinish();
-    assert(log_buffer_size_ == 0);
-    guard2.lock();
+  assert(size > 0 && size <= log_buffer_capacity_);
+  uint64_t state = reserve_state_;
+  for (;;) {
+    if (Reserved(state) + size <= log_buffer_capacity_) {
+      if (reserve_state_.compare_exchange_weak(
+              state, MakeState(Generation(state), Reserved(state) + size))) {
+        break;
+      }
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(latch_);
+    buffer_full_ = true;
+    cv_.notify_one();
+    flushed.wait(lock, [this, state] {
+      return Generation(reserve_state_) != Generation(state);
+    });
+    state = reserve_state_;
   }
-  int pos = log_buffer_size_;
-  memcpy(log_buffer_ + pos, &log_record, LogRecord::HEADER_SIZE);
+  int cur = Generation(state) & 1;
+  log_record.lsn_ = base_lsn_[cur] + Reserved(state);
+  SerializeLogRecord(log_buffers_[cur] + Reserved(state), log_record);
+  filled_[cur] += size;
+  return log_record.lsn_;
+}
+
+/*
+ * The checksum goes in last, once the whole record is in place
+ */
+void LogManager::SerializeLogRecord(char *data, LogRecord &log_record) {
+  int pos = 0;
+  memcpy(data + pos, &log_record, LogRecord::HEADER_SIZE);
   pos += LogRecord::HEADER_SIZE;
 
   if (log_record.log_record_type_ == LogRecordType::INSERT) {
-    memcpy(log_buffer_ + pos, &log_record.insert_rid_, sizeof(RID));
+    memcpy(data + pos, &log_record.insert_rid_, sizeof(RID));
     pos += sizeof(RID);
     // we have provided serialize function for tuple class
-    log_record.insert_tuple_.SerializeTo(log_buffer_ + pos);
-  } else if (log_record.log_record_type_ == LogRecordType::APPLYDELETE
-      || log_record.log_record_type_ == LogRecordType::MARKDELETE
+    log_record.insert_tuple_.SerializeTo(data + pos);
+  } else if (log_record.log_record_type_ == LogRecordType::MARKDELETE
+      || log_record.log_record_type_ == LogRecordType::APPLYDELETE
       || log_record.log_record_type_ == LogRecordType::ROLLBACKDELETE) {
-    memcpy(log_buffer_ + pos, &log_record.delete_rid_, sizeof(RID));
-    pos += sizeof(RID);
-    log_record.delete_tuple_.SerializeTo(log_buffer_ + pos);
+    memcpy(data + pos, &log_record.delete_rid_, sizeof(RID));
   } else if (log_record.log_record_type_ == LogRecordType::UPDATE) {
-//    RID update_rid_;
-//    Tuple old_tuple_;
-//    Tuple new_tuple_;
-    memcpy(log_buffer_ + pos, &log_record.update_rid_, sizeof(RID));
+    memcpy(data + pos, &log_record.update_rid_, sizeof(RID));
     pos += sizeof(RID);
-    log_record.old_tuple_.SerializeTo(log_buffer_ + pos);
-    pos += log_record.old_tuple_.GetLength() + sizeof(int32_t);
-    log_record.new_tuple_.SerializeTo(log_buffer_ + pos);
+    memcpy(data + pos, &log_record.update_prefix_, sizeof(int32_t));
+    memcpy(data + pos + sizeof(int32_t), &log_record.update_suffix_,
+           sizeof(int32_t));
+    pos += 2 * sizeof(int32_t);
+    for (auto bytes : {&log_record.old_bytes_, &log_record.new_bytes_}) {
+      int32_t size = static_cast<int32_t>(bytes->size());
+      memcpy(data + pos, &size, sizeof(int32_t));
+      pos += sizeof(int32_t);
+      std::copy(bytes->begin(), bytes->end(), data + pos);
+      pos += size;
+    }
   } else if (log_record.log_record_type_ == LogRecordType::NEWPAGE) {
 //    page_id_t prev_page_id_ = INVALID_PAGE_ID;
-    memcpy(log_buffer_ + pos, &log_record.prev_page_id_, sizeof(log_record.prev_page_id_));
+    memcpy(data + pos, &log_record.prev_page_id_, sizeof(log_record.prev_page_id_));
+  } else if (log_record.log_record_type_ == LogRecordType::CLR) {
+    int32_t undone_type = static_cast<int32_t>(log_record.undone_type_);
+    memcpy(data + pos, &log_record.undo_next_lsn_, sizeof(lsn_t));
+    pos += sizeof(lsn_t);
+    memcpy(data + pos, &undone_type, sizeof(int32_t));
+    pos += sizeof(int32_t);
+    memcpy(data + pos, &log_record.clr_rid_, sizeof(RID));
+    pos += sizeof(RID);
+    log_record.clr_tuple_.SerializeTo(data + pos);
+  } else if (log_record.log_record_type_ == LogRecordType::END_CHECKPOINT) {
+    int32_t count = static_cast<int32_t>(log_record.active_txns_.size());
+    memcpy(data + pos, &count, sizeof(int32_t));
+    pos += sizeof(int32_t);
+    for (auto &txn : log_record.active_txns_) {
+      memcpy(data + pos, &txn.first, sizeof(txn_id_t));
+      memcpy(data + pos + sizeof(txn_id_t), &txn.second, sizeof(lsn_t));
+      pos += sizeof(txn_id_t) + sizeof(lsn_t);
+    }
+    count = static_cast<int32_t>(log_record.dirty_pages_.size());
+    memcpy(data + pos, &count, sizeof(int32_t));
+    pos += sizeof(int32_t);
+    for (auto &page : log_record.dirty_pages_) {
+      memcpy(data + pos, &page.first, sizeof(page_id_t));
+      memcpy(data + pos + sizeof(page_id_t), &page.second, sizeof(lsn_t));
+      pos += sizeof(page_id_t) + sizeof(lsn_t);
+    }
   } else {
     //nothing
   }
-  log_buffer_size_ += log_record.GetSize();
+  uint32_t checksum = LogRecord::Checksum(data, log_record.size_);
+  memcpy(data + LogRecord::CHECKSUM_OFFSET, &checksum, sizeof(uint32_t));
 //  std::cout << "added log:" << log_record.ToString() << std::endl;
-  return log_record.lsn_;
 }
 
 } // namespace cmudb
@@ -2,8 +2,15 @@
  * log_recovey.cpp
  */
 
+#include <cinttypes>
+#include <memory>
+#include <queue>
+#include <string>
+#include <unordered_set>
+
+#include "common/exception.h"
 #include "logging/log_recovery.h"
-#include "page/table_page.h"
+#include "page/header_page.h"
 
 namespace cmudb {
 /*
@@ -23,25 +30,30 @@ bool LogRecovery::DeserializeLogRecord(const char *data, int size,
 //  lsn_t prev_lsn_ = INVALID_LSN;
 //  LogRecordType log_record_type_ = LogRecordType::INVALID;
 //
-//  // case1: for delete operation, delete_tuple_ for UNDO operation
+//  // case1: for delete operation
 //  RID delete_rid_;
-//  Tuple delete_tuple_;
 //
 //  // case2: for insert operation
 //  RID insert_rid_;
 //  Tuple insert_tuple_;
 //
-//  // case3: for update operation
+//  // case3: for update operation, the changed bytes of both tuples
 //  RID update_rid_;
-//  Tuple old_tuple_;
-//  Tuple new_tuple_;
+//  int32_t update_prefix_, update_suffix_;
+//  std::vector<char> old_bytes_, new_bytes_;
 //
 //  // case4: for new page operation
 //  page_id_t prev_page_id_ = INVALID_PAGE_ID;
-  if (size < 4) { return false; }
+  if (size < LogRecord::HEADER_SIZE) { return false; }
   LogRecord *ptr = reinterpret_cast<LogRecord *>(const_cast<char *>(data));
   log_record.size_ = ptr->GetSize();
-  if (log_record.size_ > size || log_record.size_ <= 0) {
+  if (log_record.size_ > size || log_record.size_ < LogRecord::HEADER_SIZE) {
+    return false;
+  }
+  // a torn or garbage record ends the log
+  uint32_t checksum;
+  memcpy(&checksum, data + LogRecord::CHECKSUM_OFFSET, sizeof(uint32_t));
+  if (checksum != LogRecord::Checksum(data, log_record.size_)) {
     return false;
   }
   log_record.lsn_ = ptr->GetLSN();
@@ -50,171 +62,464 @@ bool LogRecovery::DeserializeLogRecord(const char *data, int size,
   log_record.log_record_type_ = ptr->GetLogRecordType();
   char *pos = const_cast<char *>(data) + LogRecord::HEADER_SIZE;
   if (log_record.log_record_type_ == LogRecordType::MARKDELETE
-      || log_record.log_record_type_ == LogRecordType::ROLLBACKDELETE
-      || log_record.log_record_type_ == LogRecordType::APPLYDELETE) {
+      || log_record.log_record_type_ == LogRecordType::APPLYDELETE
+      || log_record.log_record_type_ == LogRecordType::ROLLBACKDELETE) {
     log_record.delete_rid_ = *reinterpret_cast<RID *>(pos);
-    log_record.delete_tuple_.DeserializeFrom(pos + sizeof(RID));
   } else if (log_record.log_record_type_ == LogRecordType::INSERT) {
     log_record.insert_rid_ = *reinterpret_cast<RID *>(pos);
     log_record.insert_tuple_.DeserializeFrom(pos + sizeof(RID));
   } else if (log_record.log_record_type_ == LogRecordType::UPDATE) {
     log_record.update_rid_ = *reinterpret_cast<RID *>(pos);
-    log_record.old_tuple_.DeserializeFrom(pos + sizeof(RID));
-    log_record.new_tuple_.DeserializeFrom(pos + sizeof(RID) + log_record.old_tuple_.GetLength());
+    pos += sizeof(RID);
+    log_record.update_prefix_ = *reinterpret_cast<int32_t *>(pos);
+    log_record.update_suffix_ =
+        *reinterpret_cast<int32_t *>(pos + sizeof(int32_t));
+    pos += 2 * sizeof(int32_t);
+    for (auto bytes : {&log_record.old_bytes_, &log_record.new_bytes_}) {
+      int32_t count = *reinterpret_cast<int32_t *>(pos);
+      pos += sizeof(int32_t);
+      bytes->assign(pos, pos + count);
+      pos += count;
+    }
   } else if (log_record.log_record_type_ == LogRecordType::NEWPAGE) {
     log_record.prev_page_id_ = *reinterpret_cast<page_id_t *>(pos);
+  } else if (log_record.log_record_type_ == LogRecordType::CLR) {
+    log_record.undo_next_lsn_ = *reinterpret_cast<lsn_t *>(pos);
+    pos += sizeof(lsn_t);
+    log_record.undone_type_ =
+        static_cast<LogRecordType>(*reinterpret_cast<int32_t *>(pos));
+    pos += sizeof(int32_t);
+    log_record.clr_rid_ = *reinterpret_cast<RID *>(pos);
+    log_record.clr_tuple_.DeserializeFrom(pos + sizeof(RID));
+  } else if (log_record.log_record_type_ == LogRecordType::END_CHECKPOINT) {
+    int32_t count = *reinterpret_cast<int32_t *>(pos);
+    pos += sizeof(int32_t);
+    log_record.active_txns_.clear();
+    for (int32_t i = 0; i < count; ++i) {
+      log_record.active_txns_.emplace_back(
+          *reinterpret_cast<txn_id_t *>(pos),
+          *reinterpret_cast<lsn_t *>(pos + sizeof(txn_id_t)));
+      pos += sizeof(txn_id_t) + sizeof(lsn_t);
+    }
+    count = *reinterpret_cast<int32_t *>(pos);
+    pos += sizeof(int32_t);
+    log_record.dirty_pages_.clear();
+    for (int32_t i = 0; i < count; ++i) {
+      log_record.dirty_pages_.emplace_back(
+          *reinterpret_cast<page_id_t *>(pos),
+          *reinterpret_cast<lsn_t *>(pos + sizeof(page_id_t)));
+      pos += sizeof(page_id_t) + sizeof(lsn_t);
+    }
   }
   return true;
 }
 
 /*
- *redo phase on TABLE PAGE level(table/table_page.h)
- *read log file from the beginning to end (you must prefetch log records into
- *log buffer to reduce unnecessary I/O operations), remember to compare page's
- *LSN with log_record's sequence number, and also build active_txn_ table &
- *lsn_mapping_ table
+ * Analysis and redo. Records of pages missing from the dirty page table, or
+ * older than the page's recovery LSN there, are on disk and not even fetched.
+ * Otherwise the page LSN decides, as usual
  */
 void LogRecovery::Redo() {
   ENABLE_LOGGING = false;
-  int fetchCnt = 0;
-  auto retReadLog = disk_manager_->ReadLog(log_buffer_, LOG_BUFFER_SIZE, offset_);
-  while (retReadLog) {
-    int size = LOG_BUFFER_SIZE;
-    LogRecord record;
-    auto data = log_buffer_;
-    while (size > 0) {
-      auto retDeserial = DeserializeLogRecord(data, size, record);
-      if (!retDeserial) {
-        ENABLE_LOGGING = true;
+  lsn_t lsn = Analyze();
+  std::vector<std::unique_ptr<RedoQueue>> queues;
+  std::vector<std::thread> workers;
+  if (redo_threads_ > 1) {
+    for (size_t i = 0; i < redo_threads_; ++i) {
+      queues.emplace_back(new RedoQueue);
+      workers.emplace_back(&LogRecovery::RedoWorker, this, queues[i].get());
+    }
+  }
+  std::vector<std::vector<LogRecord>> batches(queues.size());
+
+  auto hand_off = [&](size_t worker, bool close) {
+    RedoQueue *queue = queues[worker].get();
+    std::unique_lock<std::mutex> lock(queue->latch);
+    queue->cv.wait(lock,
+                   [&] { return queue->batches.size() < 2 || queue->stopped; });
+    if (!batches[worker].empty()) {
+      queue->batches.push_back(std::move(batches[worker]));
+      batches[worker].clear();
+    }
+    queue->closed = close;
+    queue->cv.notify_all();
+  };
+
+  LogRecord record;
+  redo_failed_ = false;
+  while (lsn != INVALID_LSN && !redo_failed_ && ReadLogRecord(lsn, record)) {
+    lsn += record.size_;
+    auto dirty = dirty_pages_.find(GetPageId(record));
+    if (dirty == dirty_pages_.end() || record.lsn_ < dirty->second) {
+      continue;
+    }
+    if (workers.empty()) {
+      RedoPage(dirty->first, record);
+      continue;
+    }
+    size_t worker = static_cast<size_t>(dirty->first) % workers.size();
+    batches[worker].push_back(record);
+    if (batches[worker].size() >= REDO_BATCH_SIZE) {
+      hand_off(worker, false);
+    }
+  }
+  for (size_t i = 0; i < workers.size(); ++i) {
+    hand_off(i, true);
+  }
+  for (auto &worker : workers) {
+    worker.join();
+  }
+  for (auto &queue : queues) {
+    if (queue->error) {
+      std::rethrow_exception(queue->error);
+    }
+  }
+  ENABLE_LOGGING = true;
+}
+
+/*
+ * Apply the records handed to this worker until Redo closes its queue. The
+ * first failure is kept for Redo to rethrow, and stops this worker and the
+ * others
+ */
+void LogRecovery::RedoWorker(RedoQueue *queue) {
+  std::vector<LogRecord> batch;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(queue->latch);
+      queue->cv.wait(lock, [&] {
+        return !queue->batches.empty() || queue->closed || redo_failed_;
+      });
+      if (queue->batches.empty() || redo_failed_) {
+        queue->stopped = true;
+        queue->cv.notify_all();
         return;
       }
-//      std::cout << "redo:" << record.ToString() << std::endl;
-
-      auto type = record.log_record_type_;
-      if (type == LogRecordType::BEGIN) {
-        active_txn_[record.GetTxnId()] = record.GetLSN();
-      } else if (type == LogRecordType::COMMIT || type == LogRecordType::ABORT) {
-        active_txn_.erase(record.GetTxnId());
-      } else {
-        active_txn_[record.GetTxnId()] = record.GetLSN();
+      batch = std::move(queue->batches.front());
+      queue->batches.pop_front();
+      queue->cv.notify_all();
+    }
+    for (auto &record : batch) {
+      if (redo_failed_) {
+        break;
       }
-
-      if (type == LogRecordType::NEWPAGE) {
-        auto pageId = record.prev_page_id_;
-        TablePage* tp = reinterpret_cast<TablePage*>(buffer_pool_manager_->FetchPage(pageId));
-        tp->Init(pageId, PAGE_SIZE, INVALID_PAGE_ID, nullptr, nullptr);
-        buffer_pool_manager_->UnpinPage(pageId, true);
-      } else if (type == LogRecordType::UPDATE) {
-        auto rid = record.update_rid_;
-        auto page = buffer_pool_manager_->FetchPage(rid.GetPageId());
-        if (page->GetLSN() >= record.GetLSN()) {
-          continue;
-        }
-        TablePage *tablePage = reinterpret_cast<TablePage *>(page);
-        tablePage->UpdateTuple(record.new_tuple_, record.old_tuple_, rid, nullptr, nullptr, nullptr);
-        buffer_pool_manager_->UnpinPage(rid.GetPageId(), true);
-
-      } else if (type == LogRecordType::INSERT) {
-        auto rid = record.insert_rid_;
-        auto page = buffer_pool_manager_->FetchPage(rid.GetPageId());
-        if (page->GetLSN() >= record.GetLSN()) {
-          continue;
-        }
-        TablePage *tablePage = reinterpret_cast<TablePage *>(page);
-        tablePage->InsertTuple(record.insert_tuple_, rid, nullptr, nullptr, nullptr);
-        buffer_pool_manager_->UnpinPage(rid.GetPageId(), true);
-      } else if (type == LogRecordType::MARKDELETE) {
-        auto rid = record.delete_rid_;
-        auto page = buffer_pool_manager_->FetchPage(rid.GetPageId());
-        if (page->GetLSN() >= record.GetLSN()) {
-          continue;
-        }
-        TablePage *tablePage = reinterpret_cast<TablePage *>(page);
-        tablePage->MarkDelete(rid, nullptr, nullptr, nullptr);
-        buffer_pool_manager_->UnpinPage(rid.GetPageId(), true);
-      } else if (type == LogRecordType::ROLLBACKDELETE) {
-        auto rid = record.delete_rid_;
-        auto page = buffer_pool_manager_->FetchPage(rid.GetPageId());
-        if (page->GetLSN() >= record.GetLSN()) {
-          continue;
-        }
-        TablePage *tablePage = reinterpret_cast<TablePage *>(page);
-        tablePage->RollbackDelete(rid, nullptr, nullptr);
-        buffer_pool_manager_->UnpinPage(rid.GetPageId(), true);
-      } else if (type == LogRecordType::APPLYDELETE) {
-        auto rid = record.delete_rid_;
-        auto page = buffer_pool_manager_->FetchPage(rid.GetPageId());
-        if (page->GetLSN() >= record.GetLSN()) {
-          continue;
-        }
-        TablePage *tablePage = reinterpret_cast<TablePage *>(page);
-        tablePage->ApplyDelete(rid, nullptr, nullptr);
-        buffer_pool_manager_->UnpinPage(rid.GetPageId(), true);
+      try {
+        RedoPage(GetPageId(record), record);
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(queue->latch);
+        queue->error = std::current_exception();
+        redo_failed_ = true;
       }
+    }
+  }
+}
+
+// redo a record unless its page has it already
+void LogRecovery::RedoPage(page_id_t page_id, LogRecord &record) {
+  TablePage *page = nullptr;
+  try {
+    page = static_cast<TablePage *>(buffer_pool_manager_->FetchPage(page_id));
+  } catch (Exception &) {
+  }
+  if (page == nullptr) {
+    throw Exception(EXCEPTION_TYPE_IO,
+                    "redo can't fetch page " + std::to_string(page_id));
+  }
+  page->WLatch();
+  bool redo = page->GetLSN() < record.lsn_;
+  if (redo) {
+    RedoRecord(page, record);
+    page->SetLSN(record.lsn_);
+  }
+  page->WUnlatch();
+  buffer_pool_manager_->UnpinPage(page_id, redo);
+}
 
-      lsn_mapping_[record.GetLSN()] = static_cast<int> (data - log_buffer_ + fetchCnt++ * LOG_BUFFER_SIZE);
-      data += record.size_;
-      size -= record.size_;
+/*
+ * Analysis from the last checkpoint, if the header page has a master record,
+ * otherwise (or if the checkpoint never ended) from the start of the log.
+ * @return: where redo has to start, the smallest LSN of the dirty page table,
+ * INVALID_LSN if there is nothing to redo
+ */
+lsn_t LogRecovery::Analyze() {
+  lsn_t checkpoint_lsn = INVALID_LSN;
+  if (disk_manager_->IsAllocated(HEADER_PAGE_ID)) {
+    auto header_page = static_cast<HeaderPage *>(
+        buffer_pool_manager_->FetchPage(HEADER_PAGE_ID));
+    if (header_page != nullptr) {
+      if (header_page->IsHeaderPage()) {
+        checkpoint_lsn = header_page->GetCheckpointLSN();
+      }
+      buffer_pool_manager_->UnpinPage(HEADER_PAGE_ID, false);
     }
+  }
+  if (!ScanLog(checkpoint_lsn)) {
+    LOG_DEBUG("checkpoint %" PRId64
+              " has no end record, analysing the whole log",
+              checkpoint_lsn);
+    ScanLog(INVALID_LSN);
+  }
+  if (log_end_ < disk_manager_->GetLogSize()) {
+    LOG_DEBUG("log ends at %" PRId64 ", cutting off %" PRId64 " bytes",
+              log_end_, disk_manager_->GetLogSize() - log_end_);
+    log_manager_->CutLog(log_end_);
+  }
 
-    offset_ += LOG_BUFFER_SIZE;
-    retReadLog = disk_manager_->ReadLog(log_buffer_, LOG_BUFFER_SIZE, offset_);
+  lsn_t redo_lsn = INVALID_LSN;
+  for (auto &page : dirty_pages_) {
+    if (redo_lsn == INVALID_LSN || page.second < redo_lsn) {
+      redo_lsn = page.second;
+    }
   }
-  ENABLE_LOGGING = true;
+  return redo_lsn;
 }
 
 /*
- *undo phase on TABLE PAGE level(table/table_page.h)
- *iterate through active txn map and undo each operation
+ * Rebuild active_txn_ and dirty_pages_ from the log after checkpoint_lsn,
+ * merging in the tables of its END_CHECKPOINT, and set log_end_.
+ * @return: false if there is a checkpoint but its END_CHECKPOINT is missing
  */
-void LogRecovery::Undo() {
-  ENABLE_LOGGING = false;
-  for (auto item : active_txn_) {
-    auto lastLsn = item.second;
-    while (true) {
-      auto offset = lsn_mapping_[lastLsn];
-      auto retRead = disk_manager_->ReadLog(log_buffer_, LOG_BUFFER_SIZE, offset);
-      assert(retRead);
-      LogRecord record;
-      auto retDeserial = DeserializeLogRecord(log_buffer_, LOG_BUFFER_SIZE, record);
-      assert(retDeserial);
-      auto type = record.GetLogRecordType();
-      if (type == LogRecordType::BEGIN) {
-        break;
+bool LogRecovery::ScanLog(lsn_t checkpoint_lsn) {
+  active_txn_.clear();
+  dirty_pages_.clear();
+  // the checkpoint's tables were taken after its begin: a transaction that
+  // ended since then must not come back from them
+  std::unordered_set<txn_id_t> ended_txn;
+  bool end_found = checkpoint_lsn == INVALID_LSN;
+  lsn_t lsn = end_found ? disk_manager_->GetLogStart() : checkpoint_lsn;
+  LogRecord record;
+  while (ReadLogRecord(lsn, record)) {
+    lsn += record.size_;
+    auto type = record.log_record_type_;
+    if (type == LogRecordType::BEGIN_CHECKPOINT) {
+      // nothing to do, not part of any transaction
+    } else if (type == LogRecordType::END_CHECKPOINT) {
+      if (record.prev_lsn_ != checkpoint_lsn) {
+        continue;
       }
-      assert(type == LogRecordType::UPDATE || type == LogRecordType::INSERT || type == LogRecordType::MARKDELETE);
-      if (type == LogRecordType::MARKDELETE) {
-        auto rid = record.delete_rid_;
-        auto page = buffer_pool_manager_->FetchPage(rid.GetPageId());
-        if (page->GetLSN() >= record.GetLSN()) {
-          continue;
-        }
-        TablePage *tablePage = reinterpret_cast<TablePage *>(page);
-        tablePage->RollbackDelete(rid, nullptr, nullptr);
-        buffer_pool_manager_->UnpinPage(rid.GetPageId(), true);
-      } else if (type == LogRecordType::INSERT) {
-        auto rid = record.GetInsertRID();
-        auto page = buffer_pool_manager_->FetchPage(rid.GetPageId());
-        if (page->GetLSN() >= record.GetLSN()) {
-          continue;
-        }
-        TablePage *tablePage = reinterpret_cast<TablePage *>(page);
-        tablePage->ApplyDelete(rid, nullptr, nullptr);
-        buffer_pool_manager_->UnpinPage(rid.GetPageId(), true);
-      } else if (type == LogRecordType::UPDATE) {
-        auto rid = record.update_rid_;
-        auto page = buffer_pool_manager_->FetchPage(rid.GetPageId());
-        if (page->GetLSN() >= record.GetLSN()) {
-          continue;
+      end_found = true;
+      for (auto &txn : record.active_txns_) {
+        if (ended_txn.count(txn.first) == 0) {
+          // the scan has the newer last LSN of transactions it has seen
+          active_txn_.emplace(txn.first, txn.second);
         }
-        TablePage *tablePage = reinterpret_cast<TablePage *>(page);
-        tablePage->UpdateTuple(record.old_tuple_, record.new_tuple_, rid, nullptr, nullptr, nullptr);
-        buffer_pool_manager_->UnpinPage(rid.GetPageId(), true);
       }
-      lastLsn = record.GetPrevLSN();
-    }//end of while
+      for (auto &page : record.dirty_pages_) {
+        auto dirty = dirty_pages_.emplace(page.first, page.second);
+        dirty.first->second = std::min(dirty.first->second, page.second);
+      }
+    } else if (type == LogRecordType::COMMIT ||
+               type == LogRecordType::ABORT) {
+      active_txn_.erase(record.txn_id_);
+      ended_txn.insert(record.txn_id_);
+    } else {
+      // the cleanup after a COMMIT leaves the transaction ended
+      if (type != LogRecordType::APPLYDELETE) {
+        active_txn_[record.txn_id_] = record.lsn_;
+        ended_txn.erase(record.txn_id_);
+      }
+      page_id_t page_id = GetPageId(record);
+      if (page_id != INVALID_PAGE_ID) {
+        // the first change since the checkpoint
+        dirty_pages_.emplace(page_id, record.lsn_);
+      }
+    }
+  }
+  log_end_ = lsn;
+  return end_found;
+}
+
+/*
+ * Undo all losers at once, largest LSN first. A CLR is only followed to its
+ * undo next LSN, BEGIN or the end of the prevLSN chain finishes the loser
+ */
+void LogRecovery::Undo() {
+  // the CLRs and ABORTs go through the log as for any transaction
+  log_manager_->RunFlushThread();
+  std::unordered_map<txn_id_t, std::unique_ptr<Transaction>> losers;
+  std::priority_queue<std::pair<lsn_t, txn_id_t>> to_undo;
+  for (auto &item : active_txn_) {
+    Transaction *txn = new Transaction(item.first);
+    // the rollback of an aborted transaction writes CLRs
+    txn->SetState(TransactionState::ABORTED);
+    txn->SetPrevLSN(item.second);
+    losers[item.first].reset(txn);
+    to_undo.emplace(item.second, item.first);
+  }
+
+  LogRecord record;
+  lsn_t last_lsn = INVALID_LSN;
+  while (!to_undo.empty()) {
+    lsn_t lsn = to_undo.top().first;
+    Transaction *txn = losers[to_undo.top().second].get();
+    to_undo.pop();
+    lsn_t next_lsn = INVALID_LSN;
+    if (!ReadLogRecord(lsn, record)) {
+      LOG_DEBUG("cannot read log record %" PRId64 " of loser %d", lsn,
+                txn->GetTransactionId());
+    } else if (record.log_record_type_ == LogRecordType::CLR) {
+      next_lsn = record.undo_next_lsn_;
+    } else if (record.log_record_type_ != LogRecordType::BEGIN) {
+      UndoRecord(txn, record);
+      next_lsn = record.prev_lsn_;
+    }
+
+    if (next_lsn != INVALID_LSN) {
+      to_undo.emplace(next_lsn, txn->GetTransactionId());
+    } else {
+      LogRecord abort(txn->GetTransactionId(), txn->GetPrevLSN(),
+                      LogRecordType::ABORT);
+      last_lsn = log_manager_->AppendLogRecord(abort);
+    }
+  }
+  active_txn_.clear();
+  // the losers are gone for good once their ABORTs are on disk
+  log_manager_->WaitForLSN(last_lsn);
+}
+
+/*
+ * Apply the change of a log record to its page again, without logging
+ */
+void LogRecovery::RedoRecord(TablePage *page, LogRecord &record) {
+  Tuple old_tuple;
+  switch (record.log_record_type_) {
+  case LogRecordType::NEWPAGE:
+    page->Init(record.prev_page_id_, page->GetPageSize(), INVALID_PAGE_ID,
+               nullptr, nullptr);
+    break;
+  case LogRecordType::INSERT:
+    page->InsertTuple(record.insert_tuple_, record.insert_rid_, nullptr,
+                      nullptr, nullptr);
+    break;
+  case LogRecordType::MARKDELETE:
+    page->MarkDelete(record.delete_rid_, nullptr, nullptr, nullptr);
+    break;
+  case LogRecordType::APPLYDELETE:
+    page->ApplyDelete(record.delete_rid_, nullptr, nullptr);
+    break;
+  case LogRecordType::ROLLBACKDELETE:
+    page->RollbackDelete(record.delete_rid_, nullptr, nullptr);
+    break;
+  case LogRecordType::UPDATE:
+    // the page is from before the update, so the slot holds the old tuple
+    if (page->GetTuple(record.update_rid_, old_tuple, nullptr, nullptr)) {
+      page->UpdateTuple(record.GetNewTuple(old_tuple), old_tuple,
+                        record.update_rid_, nullptr, nullptr, nullptr);
+    }
+    break;
+  case LogRecordType::CLR:
+    // the rollback of undone_type_
+    if (record.undone_type_ == LogRecordType::INSERT) {
+      page->ApplyDelete(record.clr_rid_, nullptr, nullptr);
+    } else if (record.undone_type_ == LogRecordType::MARKDELETE) {
+      page->RollbackDelete(record.clr_rid_, nullptr, nullptr);
+    } else if (record.undone_type_ == LogRecordType::UPDATE) {
+      page->UpdateTuple(record.clr_tuple_, old_tuple, record.clr_rid_,
+                        nullptr, nullptr, nullptr);
+    }
+    break;
+  default:
+    break;
+  }
+}
+
+/*
+ * Roll back the change of a loser's log record, logging the CLR. Unlike redo
+ * this does not depend on the page LSN: after redo every change in the log is
+ * on the page
+ */
+void LogRecovery::UndoRecord(Transaction *txn, LogRecord &record) {
+  RID rid;
+  auto type = record.log_record_type_;
+  if (type == LogRecordType::INSERT) {
+    rid = record.insert_rid_;
+  } else if (type == LogRecordType::MARKDELETE) {
+    rid = record.delete_rid_;
+  } else if (type == LogRecordType::UPDATE) {
+    rid = record.update_rid_;
+  } else {
+    // new pages stay, nothing else a loser wrote changes tuples
+    return;
+  }
+  // the loser held the lock on the tuple until the crash
+  txn->InsertIntoExclusiveLockSet(rid);
+  txn->SetUndoNextLSN(record.prev_lsn_);
+
+  auto page = static_cast<TablePage *>(
+      buffer_pool_manager_->FetchPage(rid.GetPageId()));
+  page->WLatch();
+  if (type == LogRecordType::INSERT) {
+    page->ApplyDelete(rid, txn, log_manager_);
+  } else if (type == LogRecordType::MARKDELETE) {
+    page->RollbackDelete(rid, txn, log_manager_);
+  } else {
+    // and so the slot holds the new tuple
+    Tuple new_tuple;
+    if (page->GetTuple(rid, new_tuple, txn, nullptr)) {
+      page->UpdateTuple(record.GetOldTuple(new_tuple), new_tuple, rid, txn,
+                        nullptr, log_manager_);
+    }
+  }
+  page->WUnlatch();
+  buffer_pool_manager_->UnpinPage(rid.GetPageId(), true);
+}
+
+/*
+ * read the log record at lsn, through log_buffer_. Scanning forward, the
+ * window starts at the record; walking backwards it ends a bit after it, so
+ * the records undone next are in it too
+ * @return: false past the end of the log (or before its start)
+ */
+bool LogRecovery::ReadLogRecord(lsn_t lsn, LogRecord &record) {
+  if (BufferedLogRecord(lsn, record)) {
+    return true;
+  }
+  if (buffer_size_ > 0 && lsn < buffer_offset_) {
+    buffer_offset_ = std::max(disk_manager_->GetLogStart(),
+                              lsn - log_buffer_size_ * 3 / 4);
+    buffer_size_ =
+        disk_manager_->ReadLog(log_buffer_, log_buffer_size_, buffer_offset_)
+            ? log_buffer_size_
+            : 0;
+    if (BufferedLogRecord(lsn, record)) {
+      return true;
+    }
+  }
+  // a record cut off at the end of the window is read again from its start
+  buffer_offset_ = lsn;
+  buffer_size_ = disk_manager_->ReadLog(log_buffer_, log_buffer_size_, lsn)
+                     ? log_buffer_size_
+                     : 0;
+  return BufferedLogRecord(lsn, record);
+}
+
+// the record at lsn if log_buffer_ holds all of it
+bool LogRecovery::BufferedLogRecord(lsn_t lsn, LogRecord &record) {
+  if (lsn < buffer_offset_ || lsn - buffer_offset_ >= buffer_size_) {
+    return false;
+  }
+  int pos = static_cast<int>(lsn - buffer_offset_);
+  return DeserializeLogRecord(log_buffer_ + pos, buffer_size_ - pos, record);
+}
+
+// the page a log record changes, INVALID_PAGE_ID if none
+page_id_t LogRecovery::GetPageId(LogRecord &record) {
+  switch (record.log_record_type_) {
+  case LogRecordType::INSERT:
+    return record.insert_rid_.GetPageId();
+  case LogRecordType::MARKDELETE:
+  case LogRecordType::APPLYDELETE:
+  case LogRecordType::ROLLBACKDELETE:
+    return record.delete_rid_.GetPageId();
+  case LogRecordType::UPDATE:
+    return record.update_rid_.GetPageId();
+  case LogRecordType::NEWPAGE:
+    return record.prev_page_id_;
+  case LogRecordType::CLR:
+    return record.clr_rid_.GetPageId();
+  default:
+    return INVALID_PAGE_ID;
   }
-  ENABLE_LOGGING = false;
 }
 
 } // namespace cmudb
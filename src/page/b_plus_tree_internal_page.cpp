@@ -18,20 +18,23 @@ namespace cmudb {
  */
 INDEX_TEMPLATE_ARGUMENTS
 void B_PLUS_TREE_INTERNAL_PAGE_TYPE::Init(page_id_t page_id,
-                                          page_id_t parent_id) {
+                                          page_id_t parent_id,
+                                          size_t page_size) {
 
   SetPageType(IndexPageType::INTERNAL_PAGE);
   SetSize(0);
   SetPageId(page_id);
   SetParentPageId(parent_id);
-  assert(sizeof(BPlusTreeInternalPage) == 24);
+  SetNextPageId(INVALID_PAGE_ID);
+  assert(reinterpret_cast<char *>(array) - reinterpret_cast<char *>(this) ==
+         32 + sizeof(KeyType));
   //this is real keys which equals to branching factor - 1.
   //not counting the fake key related to the left most link.
   //leave a slot for ease of insertion
   //well, size should be all kv pairs include the one index 0, which has no key
   //real key's count are GetSize - 1
   //that is to say, for internal node, this is branching factor
-  int size = (PAGE_SIZE - sizeof(BPlusTreeInternalPage)) / sizeof(MappingType) - 1;
+  int size = (page_size - PAGE_CHECKSUM_SIZE - sizeof(BPlusTreeInternalPage)) / sizeof(MappingType) - 1;
   size &= ~(1);
   SetMaxSize(size);
 }
@@ -176,13 +179,18 @@ void B_PLUS_TREE_INTERNAL_PAGE_TYPE::MoveHalfTo(
   }
   SetSize(start);
   recipient->IncreaseSize(length - start);
+  //the new page goes right of this one, above the key pushed upward
+  recipient->SetNextPageId(next_page_id_);
+  recipient->SetHighKey(high_key_);
+  next_page_id_ = recipient->GetPageId();
+  high_key_ = recipient->array[0].first;
 
   //update recipient's parent id
   for (int i = 0; i < recipient->GetSize(); i++) {
     page_id_t page_id = recipient->ValueAt(i);
     auto page = buffer_pool_manager->FetchPage(page_id);
     assert(page);
-    BPlusTreePage *bp = reinterpret_cast<BPlusTreePage *>(page);
+    BPlusTreePage *bp = reinterpret_cast<BPlusTreePage *>(page->GetData());
     bp->SetParentPageId(recipient->GetPageId());
     buffer_pool_manager->UnpinPage(page_id, true);
   }
@@ -225,6 +233,8 @@ ValueType B_PLUS_TREE_INTERNAL_PAGE_TYPE::RemoveAndReturnOnlyChild() {
 /*
  * Remove all of key & value pairs from this page to "recipient" page, then
  * update relevant key & value pair in its parent page.
+ * The recipient is the left sibling: it takes over the right link, so no other
+ * page links to this one any more.
  *
  * altering parent node is not taken care of here but in coalesce of b tree class
  */
@@ -234,30 +244,20 @@ void B_PLUS_TREE_INTERNAL_PAGE_TYPE::MoveAllTo(
     BufferPoolManager *buffer_pool_manager, const KeyComparator &comparator) {
   assert(recipient->GetParentPageId() == GetParentPageId());
   assert(recipient->GetParentPageId() != INVALID_PAGE_ID);
+  assert(recipient->GetNextPageId() == GetPageId());
 
-  int len = GetSize() + recipient->GetSize();
   auto parent = GetInternalPagePtr(GetParentPageId(), *buffer_pool_manager);
   assert(parent);
   KeyType keyType = parent->KeyAt(index_in_parent);
 
-  if (comparator(firstKey(), recipient->firstKey()) == -1) {
-    for (int i = len - 1; i >= GetSize(); i--) {
-      recipient->array[i].first = recipient->array[i - GetSize()].first;
-      recipient->array[i].second = recipient->array[i - GetSize()].second;
-    }
-    recipient->array[GetSize()].first = keyType;
-    for (int i = 0; i < GetSize(); i++) {
-      recipient->array[i].first = array[i].first;
-      recipient->array[i].second = array[i].second;
-    }
-  } else {
-    for (int i = 0; i < GetSize(); i++) {
-      recipient->array[recipient->GetSize() + i].first = array[i].first;
-      recipient->array[recipient->GetSize() + i].second = array[i].second;
-    }
-    recipient->array[recipient->GetSize()].first = keyType;
+  for (int i = 0; i < GetSize(); i++) {
+    recipient->array[recipient->GetSize() + i].first = array[i].first;
+    recipient->array[recipient->GetSize() + i].second = array[i].second;
   }
+  recipient->array[recipient->GetSize()].first = keyType;
   recipient->IncreaseSize(GetSize());
+  recipient->SetNextPageId(next_page_id_);
+  recipient->SetHighKey(high_key_);
 
   for (int i = 0; i < GetSize(); i++) {
     auto bp = GetPageSmartPtr<BPlusTreePage>(array[i].second, *buffer_pool_manager);
@@ -300,6 +300,7 @@ void B_PLUS_TREE_INTERNAL_PAGE_TYPE::MoveFirstToEndOf(
   assert(index != -1);
   recipient->SetKeyAt(recipient->GetSize() - 1, parent->KeyAt(index));
   parent->SetKeyAt(index, KeyAt(0));
+  recipient->SetHighKey(KeyAt(0));
 
   page_id_t newNodePageId = recipient->ValueAt(recipient->GetSize() - 1);
   auto newNode = GetInternalPagePtr(newNodePageId, *buffer_pool_manager);
@@ -337,6 +338,7 @@ void B_PLUS_TREE_INTERNAL_PAGE_TYPE::MoveLastToFrontOf(
   assert(index != -1);
   recipient->SetKeyAt(1, parent->KeyAt(index));
   parent->SetKeyAt(index, recipient->KeyAt(0));
+  high_key_ = recipient->KeyAt(0);
 
   page_id_t newNodePageId = recipient->ValueAt(0);
   auto newNode = GetInternalPagePtr(newNodePageId, *buffer_pool_manager);
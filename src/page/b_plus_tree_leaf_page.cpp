@@ -21,16 +21,18 @@ namespace cmudb {
  * next page id and set max size
  */
 INDEX_TEMPLATE_ARGUMENTS
-void B_PLUS_TREE_LEAF_PAGE_TYPE::Init(page_id_t page_id, page_id_t parent_id) {
+void B_PLUS_TREE_LEAF_PAGE_TYPE::Init(page_id_t page_id, page_id_t parent_id,
+                                      size_t page_size) {
   SetPageType(IndexPageType::LEAF_PAGE);
   SetSize(0);
   SetPageId(page_id);
   SetParentPageId(parent_id);
   SetNextPageId(INVALID_PAGE_ID);
   SetPreviousPageId(INVALID_PAGE_ID);
-  assert(sizeof(BPlusTreeLeafPage) == 32);
+  assert(reinterpret_cast<char *>(array) - reinterpret_cast<char *>(this) ==
+         36 + sizeof(KeyType));
   int size =
-      (PAGE_SIZE - sizeof(BPlusTreeLeafPage)) / sizeof(MappingType) - 1;//leave a always available slot for insertion
+      (page_size - PAGE_CHECKSUM_SIZE - sizeof(BPlusTreeLeafPage)) / sizeof(MappingType) - 1;//leave a always available slot for insertion
   assert(size >= 2);
   size &= ~(1);
   SetMaxSize(size);
@@ -165,6 +167,9 @@ void B_PLUS_TREE_LEAF_PAGE_TYPE::MoveHalfTo(
   //maintain size:
   SetSize(count);
   recipient->SetSize(length + 1 - count);
+  //the last key that stays is the one pushed upward
+  recipient->SetHighKey(high_key_);
+  high_key_ = array[count - 1].first;
 }
 
 INDEX_TEMPLATE_ARGUMENTS
@@ -221,48 +226,29 @@ int B_PLUS_TREE_LEAF_PAGE_TYPE::RemoveAndDeleteRecord(
 /*
  * Remove all of key & value pairs from this page to "recipient" page, then
  * update next page id
+ * The recipient is the previous leaf, so this one drops out of the list
  */
 INDEX_TEMPLATE_ARGUMENTS
 void B_PLUS_TREE_LEAF_PAGE_TYPE::MoveAllTo(BPlusTreeLeafPage *recipient,
                                            int, BufferPoolManager *bufferPoolManager, const KeyComparator &comparator) {
   assert(recipient->GetParentPageId() == GetParentPageId());
   assert(recipient->GetParentPageId() != INVALID_PAGE_ID);
-  if (comparator(recipient->array[0].first, array[0].first) == -1) {
-    for (int i = 0; i < GetSize(); i++) {
-      recipient->array[recipient->GetSize() + i].first = array[i].first;
-      recipient->array[recipient->GetSize() + i].second = array[i].second;
-    }
-    recipient->IncreaseSize(GetSize());
-    IncreaseSize(-1 * GetSize());
-    recipient->SetNextPageId(GetNextPageId());
-
-    if (GetNextPageId() != INVALID_PAGE_ID) {
-      Page *page = bufferPoolManager->FetchPage(GetNextPageId());
-      assert(page);
-      auto link = reinterpret_cast<B_PLUS_TREE_LEAF_PAGE_TYPE *>(page->GetData());
-      link->SetPreviousPageId(recipient->GetPageId());
-      bufferPoolManager->UnpinPage(GetNextPageId(), true);
-    }
-  } else {
-    for (int i = GetSize() + recipient->GetSize() - 1; i >= GetSize(); i--) {
-      recipient->array[i].first = recipient->array[i - GetSize()].first;
-      recipient->array[i].second = recipient->array[i - GetSize()].second;
-    }
-    for (int i = 0; i < GetSize(); i++) {
-      recipient->array[i].first = array[i].first;
-      recipient->array[i].second = array[i].second;
-    }
-    recipient->IncreaseSize(GetSize());
-    IncreaseSize(-1 * GetSize());
+  assert(recipient->GetNextPageId() == GetPageId());
+  for (int i = 0; i < GetSize(); i++) {
+    recipient->array[recipient->GetSize() + i].first = array[i].first;
+    recipient->array[recipient->GetSize() + i].second = array[i].second;
+  }
+  recipient->IncreaseSize(GetSize());
+  IncreaseSize(-1 * GetSize());
+  recipient->SetNextPageId(GetNextPageId());
+  recipient->SetHighKey(high_key_);
 
-    recipient->SetPreviousPageId(GetPreviousPageId());
-    if (GetPreviousPageId() != INVALID_PAGE_ID) {
-      Page *page = bufferPoolManager->FetchPage(GetPreviousPageId());
-      assert(page);
-      auto link = reinterpret_cast<B_PLUS_TREE_LEAF_PAGE_TYPE *>(page->GetData());
-      link->SetNextPageId(recipient->GetPageId());
-      bufferPoolManager->UnpinPage(GetPreviousPageId(), true);
-    }
+  if (GetNextPageId() != INVALID_PAGE_ID) {
+    Page *page = bufferPoolManager->FetchPage(GetNextPageId());
+    assert(page);
+    auto link = reinterpret_cast<B_PLUS_TREE_LEAF_PAGE_TYPE *>(page->GetData());
+    link->SetPreviousPageId(recipient->GetPageId());
+    bufferPoolManager->UnpinPage(GetNextPageId(), true);
   }
 }
 INDEX_TEMPLATE_ARGUMENTS
@@ -292,6 +278,7 @@ void B_PLUS_TREE_LEAF_PAGE_TYPE::MoveFirstToEndOf(
   assert(parent);
   auto idx = parent->ValueIndex(GetPageId());
   parent->SetKeyAt(idx, item.first);
+  recipient->SetHighKey(item.first);
 
   recipient->array[recipient->GetSize()].first = item.first;
   recipient->array[recipient->GetSize()].second = item.second;
@@ -325,6 +312,7 @@ void B_PLUS_TREE_LEAF_PAGE_TYPE::MoveLastToFrontOf(
   IncreaseSize(-1);
   int index = parent->ValueIndex(recipient->GetPageId());
   parent->SetKeyAt(index, KeyAt(GetSize() - 1));
+  high_key_ = KeyAt(GetSize() - 1);
   for (int i = recipient->GetSize(); i >= 1; i--) {
     recipient->array[i].first = recipient->array[i - 1].first;
     recipient->array[i].second = recipient->array[i - 1].second;
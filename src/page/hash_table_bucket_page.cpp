@@ -0,0 +1,129 @@
+/**
+ * hash_table_bucket_page.cpp
+ */
+
+#include <cassert>
+#include <sstream>
+
+#include "common/rid.h"
+#include "page/hash_table_bucket_page.h"
+
+namespace cmudb {
+
+/**
+ * Init method after creating a new bucket page
+ * Including set page id, set current size to zero and set max size
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void HASH_TABLE_BUCKET_TYPE::Init(page_id_t page_id, size_t page_size) {
+  assert(sizeof(HashTableBucketPage) == 24);
+  page_id_ = page_id;
+  lsn_ = INVALID_LSN;
+  size_ = 0;
+  max_size_ = (page_size - PAGE_CHECKSUM_SIZE - sizeof(HashTableBucketPage)) / sizeof(MappingType);
+  assert(max_size_ >= 2);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+page_id_t HASH_TABLE_BUCKET_TYPE::GetPageId() const { return page_id_; }
+
+INDEX_TEMPLATE_ARGUMENTS
+int HASH_TABLE_BUCKET_TYPE::GetSize() const { return size_; }
+
+INDEX_TEMPLATE_ARGUMENTS
+int HASH_TABLE_BUCKET_TYPE::GetMaxSize() const { return max_size_; }
+
+INDEX_TEMPLATE_ARGUMENTS
+bool HASH_TABLE_BUCKET_TYPE::IsFull() const { return size_ == max_size_; }
+
+INDEX_TEMPLATE_ARGUMENTS
+bool HASH_TABLE_BUCKET_TYPE::IsEmpty() const { return size_ == 0; }
+
+INDEX_TEMPLATE_ARGUMENTS
+KeyType HASH_TABLE_BUCKET_TYPE::KeyAt(int index) const {
+  assert(index >= 0 && index < size_);
+  return array_[index].first;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+ValueType HASH_TABLE_BUCKET_TYPE::ValueAt(int index) const {
+  assert(index >= 0 && index < size_);
+  return array_[index].second;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+const MappingType &HASH_TABLE_BUCKET_TYPE::GetItem(int index) const {
+  assert(index >= 0 && index < size_);
+  return array_[index];
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+int HASH_TABLE_BUCKET_TYPE::KeyIndex(const KeyType &key,
+                                     const KeyComparator &comparator) const {
+  for (int i = 0; i < size_; i++) {
+    if (comparator(array_[i].first, key) == 0) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+bool HASH_TABLE_BUCKET_TYPE::Lookup(const KeyType &key, ValueType &value,
+                                    const KeyComparator &comparator) const {
+  int index = KeyIndex(key, comparator);
+  if (index == -1) {
+    return false;
+  }
+  value = array_[index].second;
+  return true;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+bool HASH_TABLE_BUCKET_TYPE::Insert(const KeyType &key, const ValueType &value,
+                                    const KeyComparator &comparator) {
+  if (IsFull() || KeyIndex(key, comparator) != -1) {
+    return false;
+  }
+  array_[size_].first = key;
+  array_[size_].second = value;
+  size_++;
+  return true;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+bool HASH_TABLE_BUCKET_TYPE::Remove(const KeyType &key,
+                                    const KeyComparator &comparator) {
+  int index = KeyIndex(key, comparator);
+  if (index == -1) {
+    return false;
+  }
+  RemoveAt(index);
+  return true;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void HASH_TABLE_BUCKET_TYPE::RemoveAt(int index) {
+  assert(index >= 0 && index < size_);
+  size_--;
+  array_[index] = array_[size_];
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+std::string HASH_TABLE_BUCKET_TYPE::ToString() const {
+  std::stringstream os;
+  os << "[pageId: " << page_id_ << " size: " << size_ << "]<";
+  for (int i = 0; i < size_; i++) {
+    os << array_[i].first << ",";
+  }
+  os << ">";
+  return os.str();
+}
+
+template class HashTableBucketPage<GenericKey<4>, RID, GenericComparator<4>>;
+template class HashTableBucketPage<GenericKey<8>, RID, GenericComparator<8>>;
+template class HashTableBucketPage<GenericKey<16>, RID, GenericComparator<16>>;
+template class HashTableBucketPage<GenericKey<32>, RID, GenericComparator<32>>;
+template class HashTableBucketPage<GenericKey<64>, RID, GenericComparator<64>>;
+
+} // namespace cmudb
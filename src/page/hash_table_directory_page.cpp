@@ -0,0 +1,123 @@
+/**
+ * hash_table_directory_page.cpp
+ */
+
+#include <cassert>
+#include <unordered_map>
+
+#include "page/hash_table_directory_page.h"
+
+namespace cmudb {
+
+/**
+ * Init method after creating a new directory page: a single slot pointing at
+ * bucket_page_id, global and local depth zero, and as many slots as fit in
+ * page_size
+ */
+void HashTableDirectoryPage::Init(page_id_t page_id, page_id_t bucket_page_id,
+                                  size_t page_size) {
+  assert(sizeof(HashTableDirectoryPage) == 24);
+  size_t room = page_size - PAGE_CHECKSUM_SIZE - sizeof(HashTableDirectoryPage);
+  page_id_ = page_id;
+  lsn_ = INVALID_LSN;
+  global_depth_ = 0;
+  max_depth_ = 0;
+  while ((2U << max_depth_) * (sizeof(page_id_t) + 1) <= room) {
+    max_depth_++;
+  }
+  LocalDepths()[0] = 0;
+  BucketPageIds()[0] = bucket_page_id;
+}
+
+page_id_t HashTableDirectoryPage::GetPageId() const { return page_id_; }
+
+uint32_t HashTableDirectoryPage::GetGlobalDepth() const {
+  return global_depth_;
+}
+
+uint32_t HashTableDirectoryPage::GetGlobalDepthMask() const {
+  return Size() - 1;
+}
+
+uint32_t HashTableDirectoryPage::GetMaxDepth() const { return max_depth_; }
+
+uint32_t HashTableDirectoryPage::Size() const { return 1U << global_depth_; }
+
+page_id_t HashTableDirectoryPage::GetBucketPageId(uint32_t bucket_idx) const {
+  assert(bucket_idx < Size());
+  return BucketPageIds()[bucket_idx];
+}
+
+void HashTableDirectoryPage::SetBucketPageId(uint32_t bucket_idx,
+                                             page_id_t bucket_page_id) {
+  assert(bucket_idx < Size());
+  BucketPageIds()[bucket_idx] = bucket_page_id;
+}
+
+uint32_t HashTableDirectoryPage::GetLocalDepth(uint32_t bucket_idx) const {
+  assert(bucket_idx < Size());
+  return LocalDepths()[bucket_idx];
+}
+
+void HashTableDirectoryPage::SetLocalDepth(uint32_t bucket_idx,
+                                           uint32_t local_depth) {
+  assert(bucket_idx < Size() && local_depth <= global_depth_);
+  LocalDepths()[bucket_idx] = static_cast<uint8_t>(local_depth);
+}
+
+uint32_t HashTableDirectoryPage::GetSplitImageIndex(uint32_t bucket_idx) const {
+  uint32_t local_depth = GetLocalDepth(bucket_idx);
+  assert(local_depth > 0);
+  return bucket_idx ^ (1U << (local_depth - 1));
+}
+
+void HashTableDirectoryPage::IncrGlobalDepth() {
+  assert(global_depth_ < GetMaxDepth());
+  uint32_t size = Size();
+  for (uint32_t i = 0; i < size; i++) {
+    LocalDepths()[size + i] = LocalDepths()[i];
+    BucketPageIds()[size + i] = BucketPageIds()[i];
+  }
+  global_depth_++;
+}
+
+void HashTableDirectoryPage::DecrGlobalDepth() {
+  assert(CanShrink());
+  global_depth_--;
+}
+
+/*
+ * A bucket at full global depth sits in one slot of each half (its split
+ * image is in the other), so looking at the lower half is enough
+ */
+bool HashTableDirectoryPage::CanShrink() const {
+  if (global_depth_ == 0) {
+    return false;
+  }
+  for (uint32_t i = 0; i < Size() / 2; i++) {
+    if (LocalDepths()[i] == global_depth_) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void HashTableDirectoryPage::VerifyIntegrity() const {
+  std::unordered_map<page_id_t, uint32_t> pointers;
+  std::unordered_map<page_id_t, uint32_t> depths;
+  for (uint32_t i = 0; i < Size(); i++) {
+    page_id_t bucket_page_id = BucketPageIds()[i];
+    assert(LocalDepths()[i] <= global_depth_);
+    pointers[bucket_page_id]++;
+    if (depths.find(bucket_page_id) == depths.end()) {
+      depths[bucket_page_id] = LocalDepths()[i];
+    }
+    assert(depths[bucket_page_id] == LocalDepths()[i]);
+  }
+  for (auto &entry : pointers) {
+    (void)entry;
+    assert(entry.second == 1U << (global_depth_ - depths[entry.first]));
+  }
+}
+
+} // namespace cmudb
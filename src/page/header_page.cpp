@@ -8,8 +8,22 @@
 
 namespace cmudb {
 
+/**
+ * Init method after creating the header page: no records, no checkpoint, and
+ * the page size of the buffer pool it lives in
+ */
+void HeaderPage::Init() {
+  SetRecordCount(0);
+  uint32_t magic = MAGIC;
+  uint32_t page_size = static_cast<uint32_t>(GetPageSize());
+  memcpy(GetData() + 4, &magic, 4);
+  memcpy(GetData() + 16, &page_size, 4);
+  SetCheckpointLSN(INVALID_LSN);
+}
+
 /**
  * Record related
+ * @return: false if the name exists already or the page is full
  */
 bool HeaderPage::InsertRecord(const std::string &name,
                               const page_id_t root_id) {
@@ -17,10 +31,13 @@ bool HeaderPage::InsertRecord(const std::string &name,
   assert(root_id > INVALID_PAGE_ID);
 
   int record_num = GetRecordCount();
-  int offset = 4 + record_num * 36;
+  int offset = RECORDS_OFFSET + record_num * RECORD_SIZE;
   // check for duplicate name
   if (FindRecord(name) != -1)
     return false;
+  if (offset + RECORD_SIZE >
+      static_cast<int>(GetPageSize() - PAGE_CHECKSUM_SIZE))
+    return false;
   // copy record content
   memcpy(GetData() + offset, name.c_str(), (name.length() + 1));
   memcpy((GetData() + offset + 32), &root_id, 4);
@@ -37,9 +54,9 @@ bool HeaderPage::DeleteRecord(const std::string &name) {
   // record does not exsit
   if (index == -1)
     return false;
-  int offset = index * 36 + 4;
-  memmove(GetData() + offset, GetData() + offset + 36,
-          (record_num - index - 1) * 36);
+  int offset = RECORDS_OFFSET + index * RECORD_SIZE;
+  memmove(GetData() + offset, GetData() + offset + RECORD_SIZE,
+          (record_num - index - 1) * RECORD_SIZE);
 
   SetRecordCount(record_num - 1);
   return true;
@@ -53,7 +70,7 @@ bool HeaderPage::UpdateRecord(const std::string &name,
   // record does not exsit
   if (index == -1)
     return false;
-  int offset = index * 36 + 4;
+  int offset = RECORDS_OFFSET + index * RECORD_SIZE;
   // update record content, only root_id
   memcpy((GetData() + offset + 32), &root_id, 4);
 
@@ -67,7 +84,7 @@ bool HeaderPage::GetRootId(const std::string &name, page_id_t &root_id) {
   // record does not exsit
   if (index == -1)
     return false;
-  int offset = (index + 1) * 36;
+  int offset = RECORDS_OFFSET + index * RECORD_SIZE + 32;
   root_id = *reinterpret_cast<page_id_t *>(GetData() + offset);
 
   return true;
@@ -83,14 +100,41 @@ void HeaderPage::SetRecordCount(int record_count) {
   memcpy(GetData(), &record_count, 4);
 }
 
+lsn_t HeaderPage::GetCheckpointLSN() {
+  lsn_t lsn;
+  memcpy(&lsn, GetData() + CHECKPOINT_LSN_OFFSET, sizeof(lsn_t));
+  return lsn;
+}
+
+void HeaderPage::SetCheckpointLSN(lsn_t lsn) {
+  memcpy(GetData() + CHECKPOINT_LSN_OFFSET, &lsn, sizeof(lsn_t));
+}
+
+bool HeaderPage::IsHeaderPage() {
+  size_t page_size;
+  return ReadPageSize(GetData(), page_size);
+}
+
 int HeaderPage::FindRecord(const std::string &name) {
   int record_num = GetRecordCount();
 
   for (int i = 0; i < record_num; i++) {
-    char *raw_name = reinterpret_cast<char *>(GetData() + (4 + i * 36));
+    char *raw_name =
+        reinterpret_cast<char *>(GetData() + RECORDS_OFFSET + i * RECORD_SIZE);
     if (strcmp(raw_name, name.c_str()) == 0)
       return i;
   }
   return -1;
 }
+
+bool HeaderPage::ReadPageSize(const char *data, size_t &page_size) {
+  uint32_t magic, size;
+  memcpy(&magic, data + 4, 4);
+  memcpy(&size, data + 16, 4);
+  if (magic != MAGIC) {
+    return false;
+  }
+  page_size = size;
+  return true;
+}
 } // namespace cmudb
@@ -35,7 +35,7 @@ void TablePage::Init(page_id_t page_id, size_t page_size,
   }
   SetPrevPageId(prev_page_id);
   SetNextPageId(INVALID_PAGE_ID);
-  SetFreeSpacePointer(page_size);
+  SetFreeSpacePointer(page_size - PAGE_CHECKSUM_SIZE);
   SetTupleCount(0);
 }
 
@@ -44,19 +44,19 @@ page_id_t TablePage::GetPageId() {
 }
 
 page_id_t TablePage::GetPrevPageId() {
-  return *reinterpret_cast<page_id_t *>(GetData() + 8);
+  return *reinterpret_cast<page_id_t *>(GetData() + 4);
 }
 
 page_id_t TablePage::GetNextPageId() {
-  return *reinterpret_cast<page_id_t *>(GetData() + 12);
+  return *reinterpret_cast<page_id_t *>(GetData() + 16);
 }
 
 void TablePage::SetPrevPageId(page_id_t prev_page_id) {
-  memcpy(GetData() + 8, &prev_page_id, 4);
+  memcpy(GetData() + 4, &prev_page_id, 4);
 }
 
 void TablePage::SetNextPageId(page_id_t next_page_id) {
-  memcpy(GetData() + 12, &next_page_id, 4);
+  memcpy(GetData() + 16, &next_page_id, 4);
 }
 
 /**
@@ -149,11 +149,7 @@ bool TablePage::MarkDelete(const RID &rid, Transaction *txn,
       return false;
     }
     //  add your logging logic here
-    Tuple tmp;
-    auto ret = GetTuple(rid, tmp, txn, lock_manager);
-    assert(ret);
-
-    LogRecord deleteRecord(txn->GetTransactionId(), txn->GetPrevLSN(), LogRecordType::MARKDELETE, rid, tmp);
+    LogRecord deleteRecord(txn->GetTransactionId(), txn->GetPrevLSN(), LogRecordType::MARKDELETE, rid);
     log_manager->AppendLogRecord(deleteRecord);
     txn->SetPrevLSN(deleteRecord.GetLSN());
     SetLSN(deleteRecord.GetLSN());
@@ -211,11 +207,22 @@ bool TablePage::UpdateTuple(const Tuple &new_tuple, Tuple &old_tuple,
       return false;
     }
     // add your logging logic here
-    LogRecord
-        updateRecord(txn->GetTransactionId(), txn->GetPrevLSN(), LogRecordType::UPDATE, rid, old_tuple, new_tuple);
-    log_manager->AppendLogRecord(updateRecord);
-    txn->SetPrevLSN(updateRecord.GetLSN());
-    SetLSN(updateRecord.GetLSN());
+    if (txn->GetState() == TransactionState::ABORTED) {
+      // rolling back an update
+      LogRecord clr(txn->GetTransactionId(), txn->GetPrevLSN(),
+                    LogRecordType::CLR, txn->GetUndoNextLSN(),
+                    LogRecordType::UPDATE, rid, new_tuple);
+      log_manager->AppendLogRecord(clr);
+      txn->SetPrevLSN(clr.GetLSN());
+      SetLSN(clr.GetLSN());
+    } else {
+      LogRecord updateRecord(txn->GetTransactionId(), txn->GetPrevLSN(),
+                             LogRecordType::UPDATE, rid, old_tuple,
+                             new_tuple);
+      log_manager->AppendLogRecord(updateRecord);
+      txn->SetPrevLSN(updateRecord.GetLSN());
+      SetLSN(updateRecord.GetLSN());
+    }
   }
 
   // update
@@ -232,7 +239,8 @@ bool TablePage::UpdateTuple(const Tuple &new_tuple, Tuple &old_tuple,
   for (int i = 0; i < GetTupleCount();
        ++i) { // update tuple offsets (including the updated one)
     int32_t tuple_offset_i = GetTupleOffset(i);
-    if (GetTupleSize(i) > 0 && tuple_offset_i < tuple_offset + tuple_size) {
+    // tuples marked deleted have moved as well
+    if (GetTupleSize(i) != 0 && tuple_offset_i < tuple_offset + tuple_size) {
       SetTupleOffset(i, tuple_offset_i + tuple_size - new_tuple.size_);
     }
   }
@@ -255,23 +263,27 @@ void TablePage::ApplyDelete(const RID &rid, Transaction *txn,
     tuple_size = -tuple_size;
   } // else: rollback insert op
 
-  // copy out delete value, for undo purpose
-  Tuple delete_tuple;
-  delete_tuple.size_ = tuple_size;
-  delete_tuple.data_ = new char[delete_tuple.size_];
-  memcpy(delete_tuple.data_, GetData() + tuple_offset, delete_tuple.size_);
-  delete_tuple.rid_ = rid;
-  delete_tuple.allocated_ = true;
-
   if (ENABLE_LOGGING) {
     // must already grab the exclusive lock
     assert(txn->GetExclusiveLockSet()->find(rid) !=
         txn->GetExclusiveLockSet()->end());
     // add your logging logic here
-    LogRecord appDelete(txn->GetTransactionId(), txn->GetPrevLSN(), LogRecordType::APPLYDELETE);
-    log_manager->AppendLogRecord(appDelete);
-    txn->SetPrevLSN(appDelete.GetLSN());
-    SetLSN(appDelete.GetLSN());
+    if (txn->GetState() == TransactionState::ABORTED) {
+      // rolling back an insert
+      LogRecord clr(txn->GetTransactionId(), txn->GetPrevLSN(),
+                    LogRecordType::CLR, txn->GetUndoNextLSN(),
+                    LogRecordType::INSERT, rid, Tuple{});
+      log_manager->AppendLogRecord(clr);
+      txn->SetPrevLSN(clr.GetLSN());
+      SetLSN(clr.GetLSN());
+    } else {
+      // after the COMMIT, so only ever redone
+      LogRecord appDelete(txn->GetTransactionId(), txn->GetPrevLSN(),
+                          LogRecordType::APPLYDELETE, rid);
+      log_manager->AppendLogRecord(appDelete);
+      txn->SetPrevLSN(appDelete.GetLSN());
+      SetLSN(appDelete.GetLSN());
+    }
   }
 
   int32_t free_space_pointer =
@@ -303,11 +315,13 @@ void TablePage::RollbackDelete(const RID &rid, Transaction *txn,
     assert(txn->GetExclusiveLockSet()->find(rid) !=
         txn->GetExclusiveLockSet()->end());
 
-    // add your logging logic here
-    LogRecord rbDelete(txn->GetTransactionId(), txn->GetPrevLSN(), LogRecordType::ROLLBACKDELETE);
-    log_manager->AppendLogRecord(rbDelete);
-    txn->SetPrevLSN(rbDelete.GetLSN());
-    SetLSN(rbDelete.GetLSN());
+    // add your logging logic here, only a rollback gets here
+    LogRecord clr(txn->GetTransactionId(), txn->GetPrevLSN(),
+                  LogRecordType::CLR, txn->GetUndoNextLSN(),
+                  LogRecordType::MARKDELETE, rid, Tuple{});
+    log_manager->AppendLogRecord(clr);
+    txn->SetPrevLSN(clr.GetLSN());
+    SetLSN(clr.GetLSN());
   }
 
   int slot_num = rid.GetSlotNum();
@@ -387,41 +401,41 @@ bool TablePage::GetNextTupleRid(const RID &cur_rid, RID &next_rid) {
 
 // tuple slots
 int32_t TablePage::GetTupleOffset(int slot_num) {
-  return *reinterpret_cast<int32_t *>(GetData() + 24 + 8 * slot_num);
+  return *reinterpret_cast<int32_t *>(GetData() + 28 + 8 * slot_num);
 }
 
 int32_t TablePage::GetTupleSize(int slot_num) {
-  return *reinterpret_cast<int32_t *>(GetData() + 28 + 8 * slot_num);
+  return *reinterpret_cast<int32_t *>(GetData() + 32 + 8 * slot_num);
 }
 
 void TablePage::SetTupleOffset(int slot_num, int32_t offset) {
-  memcpy(GetData() + 24 + 8 * slot_num, &offset, 4);
+  memcpy(GetData() + 28 + 8 * slot_num, &offset, 4);
 }
 
 void TablePage::SetTupleSize(int slot_num, int32_t offset) {
-  memcpy(GetData() + 28 + 8 * slot_num, &offset, 4);
+  memcpy(GetData() + 32 + 8 * slot_num, &offset, 4);
 }
 
 // free space
 int32_t TablePage::GetFreeSpacePointer() {
-  return *reinterpret_cast<int32_t *>(GetData() + 16);
+  return *reinterpret_cast<int32_t *>(GetData() + 20);
 }
 
 void TablePage::SetFreeSpacePointer(int32_t free_space_pointer) {
-  memcpy(GetData() + 16, &free_space_pointer, 4);
+  memcpy(GetData() + 20, &free_space_pointer, 4);
 }
 
 // tuple count
 int32_t TablePage::GetTupleCount() {
-  return *reinterpret_cast<int32_t *>(GetData() + 20);
+  return *reinterpret_cast<int32_t *>(GetData() + 24);
 }
 
 void TablePage::SetTupleCount(int32_t tuple_count) {
-  memcpy(GetData() + 20, &tuple_count, 4);
+  memcpy(GetData() + 24, &tuple_count, 4);
 }
 
 // for free space calculation
 int32_t TablePage::GetFreeSpaceSize() {
-  return GetFreeSpacePointer() - 24 - GetTupleCount() * 8;
+  return GetFreeSpacePointer() - 28 - GetTupleCount() * 8;
 }
 } // namespace cmudb
@@ -22,19 +22,24 @@ TableHeap::TableHeap(BufferPoolManager *buffer_pool_manager,
                      Transaction *txn)
     : buffer_pool_manager_(buffer_pool_manager), lock_manager_(lock_manager),
       log_manager_(log_manager) {
-  auto first_page =
-      static_cast<TablePage *>(buffer_pool_manager_->NewPage(first_page_id_));
+  // the heap starts an extent of its own
+  auto first_page = static_cast<TablePage *>(
+      buffer_pool_manager_->NewPage(first_page_id_, INVALID_PAGE_ID));
   assert(first_page != nullptr); // todo: abort table creation?
   first_page->WLatch();
   LOG_DEBUG("new table page created %d", first_page_id_);
 
-  first_page->Init(first_page_id_, PAGE_SIZE, INVALID_PAGE_ID, log_manager_, txn);
+  first_page->Init(first_page_id_, first_page->GetPageSize(), INVALID_PAGE_ID,
+                   log_manager_, txn);
   first_page->WUnlatch();
   buffer_pool_manager_->UnpinPage(first_page_id_, true);
 }
 
 bool TableHeap::InsertTuple(const Tuple &tuple, RID &rid, Transaction *txn) {
-  if (tuple.size_ + 32 > PAGE_SIZE) { // larger than one page size
+  lsn_t undo_next_lsn = txn->GetPrevLSN();
+  // larger than one page size
+  if (static_cast<size_t>(tuple.size_) + 32 >
+      buffer_pool_manager_->GetPageSize()) {
     txn->SetState(TransactionState::ABORTED);
     return false;
   }
@@ -58,8 +63,9 @@ bool TableHeap::InsertTuple(const Tuple &tuple, RID &rid, Transaction *txn) {
           buffer_pool_manager_->FetchPage(next_page_id));
       cur_page->WLatch();
     } else { // create new page
-      auto new_page =
-          static_cast<TablePage *>(buffer_pool_manager_->NewPage(next_page_id));
+      // next to the last page, so that a scan reads the heap in order
+      auto new_page = static_cast<TablePage *>(
+          buffer_pool_manager_->NewPage(next_page_id, cur_page->GetPageId()));
       if (new_page == nullptr) {
         cur_page->WUnlatch();
         buffer_pool_manager_->UnpinPage(cur_page->GetPageId(), false);
@@ -70,8 +76,8 @@ bool TableHeap::InsertTuple(const Tuple &tuple, RID &rid, Transaction *txn) {
       // std::cout << "new table page " << next_page_id << " created" <<
       // std::endl;
       cur_page->SetNextPageId(next_page_id);
-      new_page->Init(next_page_id, PAGE_SIZE, cur_page->GetPageId(),
-                     log_manager_, txn);
+      new_page->Init(next_page_id, new_page->GetPageSize(),
+                     cur_page->GetPageId(), log_manager_, txn);
       cur_page->WUnlatch();
       buffer_pool_manager_->UnpinPage(cur_page->GetPageId(), true);
       cur_page = new_page;
@@ -79,12 +85,14 @@ bool TableHeap::InsertTuple(const Tuple &tuple, RID &rid, Transaction *txn) {
   }
   cur_page->WUnlatch();
   buffer_pool_manager_->UnpinPage(cur_page->GetPageId(), true);
-  txn->GetWriteSet()->emplace_back(rid, WType::INSERT, Tuple{}, this);
+  txn->GetWriteSet()->emplace_back(rid, WType::INSERT, Tuple{}, this,
+                                   undo_next_lsn);
   return true;
 }
 
 bool TableHeap::MarkDelete(const RID &rid, Transaction *txn) {
   // todo: remove empty page
+  lsn_t undo_next_lsn = txn->GetPrevLSN();
   auto page = reinterpret_cast<TablePage *>(
       buffer_pool_manager_->FetchPage(rid.GetPageId()));
   if (page == nullptr) {
@@ -95,12 +103,14 @@ bool TableHeap::MarkDelete(const RID &rid, Transaction *txn) {
   page->MarkDelete(rid, txn, lock_manager_, log_manager_);
   page->WUnlatch();
   buffer_pool_manager_->UnpinPage(page->GetPageId(), true);
-  txn->GetWriteSet()->emplace_back(rid, WType::DELETE, Tuple{}, this);
+  txn->GetWriteSet()->emplace_back(rid, WType::DELETE, Tuple{}, this,
+                                   undo_next_lsn);
   return true;
 }
 
 bool TableHeap::UpdateTuple(const Tuple &tuple, const RID &rid,
                             Transaction *txn) {
+  lsn_t undo_next_lsn = txn->GetPrevLSN();
   auto page = reinterpret_cast<TablePage *>(
       buffer_pool_manager_->FetchPage(rid.GetPageId()));
   if (page == nullptr) {
@@ -114,7 +124,8 @@ bool TableHeap::UpdateTuple(const Tuple &tuple, const RID &rid,
   page->WUnlatch();
   buffer_pool_manager_->UnpinPage(page->GetPageId(), is_updated);
   if (is_updated && txn->GetState() != TransactionState::ABORTED)
-    txn->GetWriteSet()->emplace_back(rid, WType::UPDATE, old_tuple, this);
+    txn->GetWriteSet()->emplace_back(rid, WType::UPDATE, old_tuple, this,
+                                     undo_next_lsn);
   return is_updated;
 }
 
@@ -154,8 +165,28 @@ bool TableHeap::GetTuple(const RID &rid, Tuple &tuple, Transaction *txn) {
   return res;
 }
 
+/**
+ * Hand every page of the table back to the buffer pool manager, which frees
+ * them on disk. false if one of them is still pinned
+ */
 bool TableHeap::DeleteTableHeap() {
-  // todo: real delete
+  page_id_t page_id = first_page_id_;
+  while (page_id != INVALID_PAGE_ID) {
+    auto page =
+        static_cast<TablePage *>(buffer_pool_manager_->FetchPage(page_id));
+    if (page == nullptr) {
+      return false;
+    }
+    page->RLatch();
+    page_id_t next_page_id = page->GetNextPageId();
+    page->RUnlatch();
+    buffer_pool_manager_->UnpinPage(page_id, false);
+    if (!buffer_pool_manager_->DeletePage(page_id)) {
+      return false;
+    }
+    page_id = next_page_id;
+  }
+  first_page_id_ = INVALID_PAGE_ID;
   return true;
 }
 
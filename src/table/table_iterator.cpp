@@ -9,7 +9,8 @@
 namespace cmudb {
 
 TableIterator::TableIterator(TableHeap *table_heap, RID rid, Transaction *txn)
-    : table_heap_(table_heap), tuple_(new Tuple(rid)), txn_(txn) {
+    : table_heap_(table_heap), tuple_(new Tuple(rid)), txn_(txn),
+      read_ahead_(table_heap->buffer_pool_manager_) {
   if (rid.GetPageId() != INVALID_PAGE_ID) {
     table_heap_->GetTuple(tuple_->rid_, *tuple_, txn_);
   }
@@ -31,6 +32,7 @@ TableIterator &TableIterator::operator++() {
       buffer_pool_manager->FetchPage(tuple_->rid_.GetPageId()));
   cur_page->RLatch();
   assert(cur_page != nullptr); // all pages are pinned
+  read_ahead_.Advance(cur_page->GetPageId(), cur_page->GetNextPageId());
 
   RID next_tuple_rid;
   if (!cur_page->GetNextTupleRid(tuple_->rid_,
@@ -42,6 +44,7 @@ TableIterator &TableIterator::operator++() {
       buffer_pool_manager->UnpinPage(cur_page->GetPageId(), false);
       cur_page = next_page;
       cur_page->RLatch();
+      read_ahead_.Advance(cur_page->GetPageId(), cur_page->GetNextPageId());
       if (cur_page->GetFirstTupleRid(next_tuple_rid))
         break;
     }
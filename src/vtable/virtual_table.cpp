@@ -83,20 +83,26 @@ int VtabConnect(sqlite3 *db, void *pAux, int argc, const char *const *argv,
   header_page->GetRootId(std::string(argv[2]), table_root_id);
   // parse arg[4](string that defines table index)
   Index *index = nullptr;
+  bool build_index = false;
   if (argc > 4) {
     std::string index_string(argv[4]);
     index_string = index_string.substr(1, (index_string.size() - 2));
     // create index object, allocate memory space
     IndexMetadata *index_metadata =
         ParseIndexStatement(index_string, std::string(argv[2]), schema);
-    // Retrieve index root page info from header page
-    page_id_t index_root_id;
-    header_page->GetRootId(index_metadata->GetName(), index_root_id);
+    // Retrieve index root page info from header page; an index that has
+    // none yet is built from the rows of the table
+    page_id_t index_root_id = INVALID_PAGE_ID;
+    build_index =
+        !header_page->GetRootId(index_metadata->GetName(), index_root_id);
     index = ConstructIndex(index_metadata, buffer_pool_manager, index_root_id);
   }
   VirtualTable *table =
       new VirtualTable(schema, buffer_pool_manager, lock_manager, log_manager,
                        index, table_root_id);
+  if (build_index) {
+    table->BuildIndex();
+  }
 
   // register virtual table within sqlite system
   schema_string = "CREATE TABLE X(" + schema_string + ");";
@@ -365,11 +371,14 @@ __declspec(dllexport)
   // create header page from BufferPoolManager if necessary
   if (!is_file_exist) {
     page_id_t header_page_id;
-    storage_engine_->buffer_pool_manager_->NewPage(header_page_id);
+    auto header_page = static_cast<HeaderPage *>(
+        storage_engine_->buffer_pool_manager_->NewPage(header_page_id));
 
     assert(header_page_id == HEADER_PAGE_ID);
+    header_page->Init();
     storage_engine_->buffer_pool_manager_->UnpinPage(header_page_id, true);
   }
+  storage_engine_->checkpoint_manager_->RunCheckpointThread();
 
   int rc = sqlite3_create_module(db, "vtable", &VtableModule, nullptr);
   return rc;
@@ -2,9 +2,17 @@
  * buffer_pool_manager_test.cpp
  */
 
+#include <algorithm>
+#include <cstdint>
 #include <cstdio>
+#include <future>
+#include <string>
+#include <thread>
+#include <vector>
 
 #include "buffer/buffer_pool_manager.h"
+#include "common/exception.h"
+#include "logging/log_manager.h"
 #include "gtest/gtest.h"
 
 namespace cmudb {
@@ -48,4 +56,438 @@ TEST(BufferPoolManagerTest, SampleTest) {
   remove("test.db");
 }
 
+TEST(BufferPoolManagerTest, PartitionedConcurrentTest) {
+  const int num_threads = 4;
+  const int pages_per_thread = 50;
+  DiskManager *disk_manager = new DiskManager("test.db");
+  // fewer frames than pages so that every instance has to evict
+  BufferPoolManager bpm(20, disk_manager, nullptr, 4);
+  EXPECT_EQ(4, bpm.GetNumInstances());
+
+  std::vector<std::thread> threads;
+  for (int tid = 0; tid < num_threads; tid++) {
+    threads.push_back(std::thread([tid, &bpm]() {
+      std::vector<page_id_t> page_ids;
+      for (int i = 0; i < pages_per_thread; i++) {
+        page_id_t page_id;
+        Page *page = bpm.NewPage(page_id);
+        if (page == nullptr) {
+          continue;
+        }
+        snprintf(page->GetData(), 32, "%d-%d", tid, page_id);
+        bpm.UnpinPage(page_id, true);
+        page_ids.push_back(page_id);
+      }
+      EXPECT_LT(0, page_ids.size());
+      for (auto page_id : page_ids) {
+        Page *page = bpm.FetchPage(page_id);
+        ASSERT_NE(nullptr, page);
+        char expected[32];
+        snprintf(expected, 32, "%d-%d", tid, page_id);
+        EXPECT_EQ(0, strcmp(page->GetData(), expected));
+        bpm.UnpinPage(page_id, false);
+      }
+    }));
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  delete disk_manager;
+  remove("test.db");
+}
+
+TEST(BufferPoolManagerTest, ConcurrentFetchWhileEvictingTest) {
+  const int num_threads = 4;
+  const int num_pages = 8;
+  const int num_rounds = 200;
+  DiskManager *disk_manager = new DiskManager("test.db");
+  // two frames for eight pages: almost every fetch evicts a dirty page
+  BufferPoolManager bpm(2, disk_manager);
+
+  for (int i = 0; i < num_pages; i++) {
+    page_id_t page_id;
+    Page *page = bpm.NewPage(page_id);
+    ASSERT_NE(nullptr, page);
+    EXPECT_EQ(i, page_id);
+    snprintf(page->GetData(), 32, "page-%d", page_id);
+    bpm.UnpinPage(page_id, true);
+  }
+
+  std::vector<std::thread> threads;
+  for (int tid = 0; tid < num_threads; tid++) {
+    threads.push_back(std::thread([tid, &bpm]() {
+      for (int round = 0; round < num_rounds; round++) {
+        page_id_t page_id = (tid + round) % num_pages;
+        Page *page = bpm.FetchPage(page_id);
+        if (page == nullptr) {
+          // both frames are pinned by other threads
+          continue;
+        }
+        char expected[32];
+        snprintf(expected, 32, "page-%d", page_id);
+        EXPECT_EQ(0, strcmp(page->GetData(), expected));
+        bpm.UnpinPage(page_id, round % 2 == 0);
+      }
+    }));
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  delete disk_manager;
+  remove("test.db");
+}
+
+// page ids are freed and reused while their old content may still be on its
+// way to disk from an eviction; that write must not win over the new one
+TEST(BufferPoolManagerTest, DeleteWhileEvictingTest) {
+  const int num_threads = 4;
+  const int num_rounds = 200;
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager bpm(4, disk_manager);
+
+  std::vector<std::thread> threads;
+  for (int tid = 0; tid < num_threads; tid++) {
+    threads.push_back(std::thread([tid, &bpm]() {
+      char expected[32];
+      for (int round = 0; round < num_rounds; round++) {
+        page_id_t page_id;
+        Page *page = bpm.NewPage(page_id);
+        if (page == nullptr) {
+          continue;
+        }
+        snprintf(expected, 32, "page-%d-%d", tid, round);
+        snprintf(page->GetData(), 32, "%s", expected);
+        bpm.UnpinPage(page_id, true);
+        // let the other threads push it out
+        std::this_thread::yield();
+        page = bpm.FetchPage(page_id);
+        if (page == nullptr) {
+          continue;
+        }
+        EXPECT_EQ(0, strcmp(page->GetData(), expected));
+        bpm.UnpinPage(page_id, false);
+        bpm.DeletePage(page_id);
+      }
+    }));
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  delete disk_manager;
+  remove("test.db");
+}
+
+// a new page whose instance is full takes a page id of another instance
+TEST(BufferPoolManagerTest, NewPageFullInstanceTest) {
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager bpm(4, disk_manager, nullptr, 2);
+  page_id_t page_id;
+  for (page_id_t i = 0; i < 4; ++i) {
+    ASSERT_NE(nullptr, bpm.NewPage(page_id));
+    EXPECT_EQ(i, page_id);
+  }
+  // page 4 would go to the full instance 0
+  EXPECT_TRUE(bpm.UnpinPage(1, true));
+  ASSERT_NE(nullptr, bpm.NewPage(page_id));
+  EXPECT_EQ(5, page_id);
+  EXPECT_FALSE(disk_manager->IsAllocated(4));
+
+  // every frame pinned: no page, and no page id left allocated
+  EXPECT_EQ(nullptr, bpm.NewPage(page_id));
+  EXPECT_FALSE(disk_manager->IsAllocated(4));
+  EXPECT_FALSE(disk_manager->IsAllocated(6));
+
+  // one instance per hardware thread, with enough frames each
+  BufferPoolManager auto_bpm(2 * INSTANCE_MIN_FRAMES, disk_manager, nullptr,
+                             0);
+  EXPECT_LE(1, auto_bpm.GetNumInstances());
+  EXPECT_GE(2, auto_bpm.GetNumInstances());
+
+  delete disk_manager;
+  remove("test.db");
+}
+
+TEST(BufferPoolManagerTest, DirectIOTest) {
+  DiskManager *disk_manager =
+      new DiskManager("test.db", AsyncIOType::AUTO, true);
+  BufferPoolManager bpm(10, disk_manager, nullptr, 3);
+  page_id_t page_id;
+  for (int i = 0; i < 30; ++i) {
+    Page *page = bpm.NewPage(page_id);
+    ASSERT_NE(nullptr, page);
+    // every frame can be handed to O_DIRECT as is
+    EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(page->GetData()) %
+                      DIRECT_IO_ALIGNMENT);
+    snprintf(page->GetData(), DEFAULT_PAGE_SIZE, "page %d", page_id);
+    EXPECT_TRUE(bpm.UnpinPage(page_id, true));
+  }
+  char expected[DEFAULT_PAGE_SIZE];
+  for (int i = 0; i < 30; ++i) {
+    Page *page = bpm.FetchPage(i);
+    ASSERT_NE(nullptr, page);
+    snprintf(expected, DEFAULT_PAGE_SIZE, "page %d", i);
+    EXPECT_EQ(0, strcmp(page->GetData(), expected));
+    EXPECT_TRUE(bpm.UnpinPage(i, false));
+  }
+
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(BufferPoolManagerTest, PrefetchTest) {
+  DiskManager *disk_manager = new DiskManager("test.db");
+  char data[DEFAULT_PAGE_SIZE];
+  for (page_id_t i = 0; i < 40; ++i) {
+    EXPECT_EQ(i, disk_manager->AllocatePage());
+    memset(data, 0, DEFAULT_PAGE_SIZE);
+    snprintf(data, DEFAULT_PAGE_SIZE, "page %d", i);
+    disk_manager->WritePage(i, data);
+  }
+
+  BufferPoolManager *bpm = new BufferPoolManager(10, disk_manager, nullptr, 2);
+  // pinned pages stay, prefetches only take up to half of the pool
+  Page *pinned = bpm->FetchPage(0);
+  ASSERT_NE(nullptr, pinned);
+  bpm->PrefetchRange(1, 30);
+  bpm->PrefetchPage(0);
+  for (page_id_t i = 0; i < 40; ++i) {
+    Page *page = bpm->FetchPage(i);
+    ASSERT_NE(nullptr, page);
+    snprintf(data, DEFAULT_PAGE_SIZE, "page %d", i);
+    EXPECT_EQ(0, strcmp(data, page->GetData()));
+    EXPECT_TRUE(bpm->UnpinPage(i, false));
+    // keep prefetching behind the reader, the last ones reach past the
+    // allocated pages and are dropped
+    bpm->PrefetchRange(i + 1, 4);
+  }
+  EXPECT_TRUE(bpm->UnpinPage(0, false));
+  EXPECT_EQ(0, strcmp("page 0", pinned->GetData()));
+
+  // every frame is usable again once the reads are done
+  page_id_t page_id;
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_NE(nullptr, bpm->NewPage(page_id));
+  }
+
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+// a page failing its checksum is never handed out, whether it comes in
+// through a prefetch or a fetch, and its frame is not lost
+TEST(BufferPoolManagerTest, CorruptPageTest) {
+  DiskManager *disk_manager = new DiskManager("test.db");
+  char data[DEFAULT_PAGE_SIZE];
+  for (page_id_t i = 0; i < 4; ++i) {
+    EXPECT_EQ(i, disk_manager->AllocatePage());
+    memset(data, 0, DEFAULT_PAGE_SIZE);
+    snprintf(data, DEFAULT_PAGE_SIZE, "page %d", i);
+    disk_manager->WritePage(i, data);
+  }
+  FILE *file = fopen("test.db", "r+b");
+  ASSERT_NE(nullptr, file);
+  std::vector<char> content(DEFAULT_PAGE_SIZE * 8);
+  content.resize(fread(content.data(), 1, content.size(), file));
+  std::string marker = "page 2";
+  auto found = std::search(content.begin(), content.end(), marker.begin(),
+                           marker.end());
+  ASSERT_NE(content.end(), found);
+  fseek(file, found - content.begin(), SEEK_SET);
+  fputc('P', file);
+  fclose(file);
+
+  // prefetches take up to half of the pool, page 2 among them
+  BufferPoolManager *bpm = new BufferPoolManager(8, disk_manager, nullptr, 1);
+  bpm->PrefetchRange(0, 4);
+  for (int round = 0; round < 2; ++round) {
+    for (page_id_t i = 0; i < 4; ++i) {
+      if (i == 2) {
+        EXPECT_THROW(bpm->FetchPage(i), Exception);
+        continue;
+      }
+      Page *page = bpm->FetchPage(i);
+      ASSERT_NE(nullptr, page);
+      EXPECT_TRUE(bpm->UnpinPage(i, false));
+    }
+  }
+  page_id_t page_id;
+  for (int i = 0; i < 8; ++i) {
+    EXPECT_NE(nullptr, bpm->NewPage(page_id));
+  }
+
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(BufferPoolManagerTest, PageCleanerTest) {
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(10, disk_manager, nullptr, 2);
+  char data[DEFAULT_PAGE_SIZE];
+  page_id_t page_id;
+  for (page_id_t i = 0; i < 10; ++i) {
+    Page *page = bpm->NewPage(page_id);
+    ASSERT_NE(nullptr, page);
+    EXPECT_EQ(i, page_id);
+    snprintf(page->GetData(), DEFAULT_PAGE_SIZE, "page %d", i);
+  }
+  for (page_id_t i = 0; i < 5; ++i) {
+    EXPECT_TRUE(bpm->UnpinPage(i, true));
+  }
+
+  // the cleaner writes the unpinned pages back on its own
+  bpm->RunPageCleaner();
+  auto on_disk = [&](page_id_t i) {
+    disk_manager->ReadPage(i, data);
+    char expected[DEFAULT_PAGE_SIZE];
+    snprintf(expected, DEFAULT_PAGE_SIZE, "page %d", i);
+    return strcmp(expected, data) == 0;
+  };
+  for (page_id_t i = 0; i < 5; ++i) {
+    for (int wait = 0; wait < 100 && !on_disk(i); ++wait) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+    EXPECT_TRUE(on_disk(i));
+  }
+  bpm->StopPageCleaner();
+  for (page_id_t i = 5; i < 10; ++i) {
+    EXPECT_FALSE(on_disk(i));
+  }
+
+  // FlushAllPages takes the pinned ones as well
+  bpm->FlushAllPages();
+  for (page_id_t i = 0; i < 10; ++i) {
+    EXPECT_TRUE(on_disk(i));
+  }
+
+  // clean victims, nothing lost on the way
+  for (page_id_t i = 10; i < 15; ++i) {
+    EXPECT_NE(nullptr, bpm->NewPage(page_id));
+    EXPECT_TRUE(bpm->UnpinPage(page_id, false));
+  }
+  for (page_id_t i = 0; i < 5; ++i) {
+    Page *page = bpm->FetchPage(i);
+    ASSERT_NE(nullptr, page);
+    snprintf(data, DEFAULT_PAGE_SIZE, "page %d", i);
+    EXPECT_EQ(0, strcmp(data, page->GetData()));
+    EXPECT_TRUE(bpm->UnpinPage(i, false));
+  }
+
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+/*
+ * FlushAllPages writes what the page held under its latch, and not a change
+ * whose log record is not on disk yet
+ */
+TEST(BufferPoolManagerTest, FlushLatchedPageTest) {
+  DiskManager *disk_manager = new DiskManager("test.db");
+  LogManager *log_manager = new LogManager(disk_manager);
+  BufferPoolManager *bpm = new BufferPoolManager(10, disk_manager, log_manager);
+  ENABLE_LOGGING = true;
+  log_manager->SetPersistentLSN(100);
+  char data[DEFAULT_PAGE_SIZE];
+  page_id_t page_id;
+  Page *page = bpm->NewPage(page_id);
+  ASSERT_NE(nullptr, page);
+  page->SetLSN(50);
+  snprintf(page->GetData() + 16, DEFAULT_PAGE_SIZE - 16, "logged");
+
+  // a writer holds the page while the flush picks it up
+  page->WLatch();
+  std::thread flusher([bpm] { bpm->FlushAllPages(); });
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  page->SetLSN(200);
+  snprintf(page->GetData() + 16, DEFAULT_PAGE_SIZE - 16, "not logged");
+  page->WUnlatch();
+  flusher.join();
+  disk_manager->ReadPage(page_id, data);
+  EXPECT_NE(0, strcmp("not logged", data + 16));
+
+  // once the log caught up, the page is still dirty and goes out
+  log_manager->SetPersistentLSN(200);
+  bpm->FlushAllPages();
+  disk_manager->ReadPage(page_id, data);
+  EXPECT_EQ(0, strcmp("not logged", data + 16));
+  EXPECT_EQ(200, Page::GetLSN(data));
+  EXPECT_TRUE(bpm->UnpinPage(page_id, false));
+
+  ENABLE_LOGGING = false;
+  delete bpm;
+  delete log_manager;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+/*
+ * A DiskManager whose first WritePage waits until the test lets it go
+ */
+class GatedDiskManager : public DiskManager {
+public:
+  explicit GatedDiskManager(const std::string &db_file)
+      : DiskManager(db_file) {}
+
+  void WritePage(page_id_t page_id, const char *page_data) override {
+    if (!gated_.exchange(true)) {
+      entered_.set_value();
+      release_.get_future().wait();
+    }
+    DiskManager::WritePage(page_id, page_data);
+  }
+
+  std::atomic<bool> gated_{false};
+  std::promise<void> entered_;
+  std::promise<void> release_;
+};
+
+/*
+ * A FlushAllPages during a FlushPage of the same page leaves the write in
+ * flight alone: the page keeps its older recovery LSN until that is done
+ */
+TEST(BufferPoolManagerTest, ConcurrentFlushTest) {
+  GatedDiskManager *disk_manager = new GatedDiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(10, disk_manager);
+  page_id_t page_id;
+  Page *page = bpm->NewPage(page_id);
+  ASSERT_NE(nullptr, page);
+  page->SetLSN(10);
+  EXPECT_TRUE(bpm->UnpinPage(page_id, true));
+
+  auto entered = disk_manager->entered_.get_future();
+  std::thread flusher([bpm, page_id] { EXPECT_TRUE(bpm->FlushPage(page_id)); });
+  entered.wait();
+  page = bpm->FetchPage(page_id);
+  ASSERT_NE(nullptr, page);
+  page->SetLSN(20);
+  EXPECT_TRUE(bpm->UnpinPage(page_id, true));
+  bpm->FlushAllPages();
+  DirtyPageTable dirty_pages = bpm->GetDirtyPageTable();
+  ASSERT_EQ(1, dirty_pages.size());
+  EXPECT_EQ(page_id, dirty_pages[0].first);
+  EXPECT_EQ(10, dirty_pages[0].second);
+
+  disk_manager->release_.set_value();
+  flusher.join();
+  dirty_pages = bpm->GetDirtyPageTable();
+  ASSERT_EQ(1, dirty_pages.size());
+  EXPECT_EQ(20, dirty_pages[0].second);
+  bpm->FlushAllPages();
+  EXPECT_TRUE(bpm->GetDirtyPageTable().empty());
+
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+}
+
 } // namespace cmudb
@@ -0,0 +1,128 @@
+/**
+ * clock_replacer_test.cpp
+ */
+
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include "buffer/buffer_pool_manager.h"
+#include "buffer/clock_replacer.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+TEST(ClockReplacerTest, SampleTest) {
+  ClockReplacer<int> clock_replacer(7, [](const int &value) {
+    return static_cast<size_t>(value);
+  });
+
+  // push element into replacer
+  clock_replacer.Insert(1);
+  clock_replacer.Insert(2);
+  clock_replacer.Insert(3);
+  clock_replacer.Insert(4);
+  clock_replacer.Insert(5);
+  clock_replacer.Insert(6);
+  clock_replacer.Insert(1);
+  EXPECT_EQ(6, clock_replacer.Size());
+
+  // every frame is referenced, the hand goes all the way round once
+  int value;
+  EXPECT_EQ(true, clock_replacer.Victim(value));
+  EXPECT_EQ(1, value);
+  // 3 is referenced again and gets a second chance
+  clock_replacer.Insert(3);
+  clock_replacer.Victim(value);
+  EXPECT_EQ(2, value);
+  clock_replacer.Victim(value);
+  EXPECT_EQ(4, value);
+
+  // remove element from replacer
+  EXPECT_EQ(false, clock_replacer.Erase(4));
+  EXPECT_EQ(true, clock_replacer.Erase(6));
+  EXPECT_EQ(2, clock_replacer.Size());
+
+  // pop element from replacer after removal
+  clock_replacer.Victim(value);
+  EXPECT_EQ(5, value);
+  clock_replacer.Victim(value);
+  EXPECT_EQ(3, value);
+  EXPECT_EQ(false, clock_replacer.Victim(value));
+  EXPECT_EQ(0, clock_replacer.Size());
+}
+
+TEST(ClockReplacerTest, ConcurrentTest) {
+  const int num_threads = 4;
+  const int frames_per_thread = 64;
+  ClockReplacer<int> clock_replacer(num_threads * frames_per_thread,
+                                    [](const int &value) {
+                                      return static_cast<size_t>(value);
+                                    });
+
+  // every thread owns its frames and keeps inserting and erasing them while
+  // the others are evicting
+  std::vector<std::thread> threads;
+  for (int tid = 0; tid < num_threads; tid++) {
+    threads.push_back(std::thread([tid, &clock_replacer]() {
+      for (int round = 0; round < 100; round++) {
+        for (int i = 0; i < frames_per_thread; i++) {
+          clock_replacer.Insert(tid * frames_per_thread + i);
+        }
+        int value;
+        clock_replacer.Victim(value);
+        for (int i = 0; i < frames_per_thread; i += 2) {
+          clock_replacer.Erase(tid * frames_per_thread + i);
+        }
+      }
+    }));
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  // whatever is left can be evicted exactly once
+  size_t size = clock_replacer.Size();
+  std::vector<bool> seen(num_threads * frames_per_thread, false);
+  int value;
+  for (size_t i = 0; i < size; i++) {
+    EXPECT_EQ(true, clock_replacer.Victim(value));
+    EXPECT_EQ(false, seen[value]);
+    seen[value] = true;
+  }
+  EXPECT_EQ(false, clock_replacer.Victim(value));
+}
+
+TEST(ClockReplacerTest, BufferPoolTest) {
+  page_id_t temp_page_id;
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager bpm(10, disk_manager, nullptr, 2, ReplacerType::CLOCK);
+
+  for (int i = 0; i < 10; ++i) {
+    Page *page = bpm.NewPage(temp_page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), 32, "page-%d", temp_page_id);
+  }
+  EXPECT_EQ(nullptr, bpm.NewPage(temp_page_id));
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_EQ(true, bpm.UnpinPage(i, true));
+  }
+  // evict every page at least once
+  for (int i = 10; i < 30; ++i) {
+    ASSERT_NE(nullptr, bpm.NewPage(temp_page_id));
+    bpm.UnpinPage(temp_page_id, false);
+  }
+  for (int i = 0; i < 10; ++i) {
+    Page *page = bpm.FetchPage(i);
+    ASSERT_NE(nullptr, page);
+    char expected[32];
+    snprintf(expected, 32, "page-%d", i);
+    EXPECT_EQ(0, strcmp(page->GetData(), expected));
+    bpm.UnpinPage(i, false);
+  }
+
+  delete disk_manager;
+  remove("test.db");
+}
+
+} // namespace cmudb
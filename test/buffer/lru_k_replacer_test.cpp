@@ -0,0 +1,135 @@
+/**
+ * lru_k_replacer_test.cpp
+ */
+
+#include <cstdio>
+
+#include "buffer/buffer_pool_manager.h"
+#include "buffer/lru_k_replacer.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+TEST(LRUKReplacerTest, SampleTest) {
+  LRUKReplacer<int> lru_k_replacer(2);
+
+  // 1 and 2 are referenced twice, 3..6 only once (a scan)
+  lru_k_replacer.RecordAccess(1);
+  lru_k_replacer.RecordAccess(2);
+  lru_k_replacer.RecordAccess(1);
+  lru_k_replacer.RecordAccess(2);
+  for (int i = 3; i <= 6; ++i) {
+    lru_k_replacer.RecordAccess(i);
+  }
+  for (int i = 1; i <= 6; ++i) {
+    lru_k_replacer.Insert(i);
+  }
+  EXPECT_EQ(6, lru_k_replacer.Size());
+
+  // infinite backward 2-distance first, oldest reference first
+  int value;
+  lru_k_replacer.Victim(value);
+  EXPECT_EQ(3, value);
+  lru_k_replacer.Victim(value);
+  EXPECT_EQ(4, value);
+
+  // pinning keeps the history, 5 now has two references
+  EXPECT_EQ(true, lru_k_replacer.Erase(5));
+  EXPECT_EQ(false, lru_k_replacer.Erase(5));
+  lru_k_replacer.RecordAccess(5);
+  lru_k_replacer.Insert(5);
+  EXPECT_EQ(4, lru_k_replacer.Size());
+
+  lru_k_replacer.Victim(value);
+  EXPECT_EQ(6, value);
+  // 1's second most recent reference is the oldest
+  lru_k_replacer.Victim(value);
+  EXPECT_EQ(1, value);
+  lru_k_replacer.Victim(value);
+  EXPECT_EQ(2, value);
+  lru_k_replacer.Victim(value);
+  EXPECT_EQ(5, value);
+  EXPECT_EQ(false, lru_k_replacer.Victim(value));
+}
+
+TEST(LRUKReplacerTest, CorrelatedReferenceTest) {
+  LRUKReplacer<int> lru_k_replacer(2, 3);
+
+  // a burst of references (a scan walking the tuples of one page) is one
+  // reference
+  lru_k_replacer.RecordAccess(1);
+  lru_k_replacer.RecordAccess(1);
+  lru_k_replacer.RecordAccess(1);
+  lru_k_replacer.RecordAccess(1);
+  // 2 is referenced twice, far enough apart
+  lru_k_replacer.RecordAccess(2);
+  lru_k_replacer.RecordAccess(3);
+  lru_k_replacer.RecordAccess(3);
+  lru_k_replacer.RecordAccess(3);
+  lru_k_replacer.RecordAccess(3);
+  lru_k_replacer.RecordAccess(2);
+  lru_k_replacer.Insert(1);
+  lru_k_replacer.Insert(2);
+  lru_k_replacer.Insert(3);
+
+  int value;
+  lru_k_replacer.Victim(value);
+  EXPECT_EQ(1, value);
+  lru_k_replacer.Victim(value);
+  EXPECT_EQ(3, value);
+  lru_k_replacer.Victim(value);
+  EXPECT_EQ(2, value);
+
+  // a victim's history is forgotten, so is a reset one's
+  lru_k_replacer.RecordAccess(4);
+  lru_k_replacer.RecordAccess(2);
+  lru_k_replacer.Insert(2);
+  lru_k_replacer.Reset(4);
+  lru_k_replacer.Insert(4);
+  lru_k_replacer.Victim(value);
+  EXPECT_EQ(2, value);
+}
+
+TEST(LRUKReplacerTest, ScanResistanceTest) {
+  page_id_t temp_page_id;
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager bpm(4, disk_manager, nullptr, 1, ReplacerType::LRU_K);
+
+  // two hot pages, referenced again and again
+  for (int i = 0; i < 2; ++i) {
+    Page *page = bpm.NewPage(temp_page_id);
+    ASSERT_NE(nullptr, page);
+    strcpy(page->GetData(), "pool");
+    bpm.UnpinPage(temp_page_id, true);
+  }
+  for (int round = 0; round < 3; ++round) {
+    for (int i = 0; i < 2; ++i) {
+      ASSERT_NE(nullptr, bpm.FetchPage(i));
+      bpm.UnpinPage(i, false);
+      // keep references to the same page out of the correlated window
+      for (int pad = 0; pad < LRUK_CORRELATED_PERIOD; ++pad) {
+        ASSERT_NE(nullptr, bpm.FetchPage(1 - i));
+        bpm.UnpinPage(1 - i, false);
+      }
+    }
+  }
+  // a scan over many pages touched once each only cycles the other frames
+  for (int i = 2; i < 20; ++i) {
+    ASSERT_NE(nullptr, bpm.NewPage(temp_page_id));
+    bpm.UnpinPage(temp_page_id, true);
+  }
+  // the hot pages are still in the pool: what is on disk is not read back
+  char disk_data[DEFAULT_PAGE_SIZE] = "disk";
+  for (int i = 0; i < 2; ++i) {
+    disk_manager->WritePage(i, disk_data);
+    Page *page = bpm.FetchPage(i);
+    ASSERT_NE(nullptr, page);
+    EXPECT_EQ(0, strcmp(page->GetData(), "pool"));
+    bpm.UnpinPage(i, false);
+  }
+
+  delete disk_manager;
+  remove("test.db");
+}
+
+} // namespace cmudb
@@ -0,0 +1,108 @@
+/**
+ * page_table_test.cpp
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+#include "buffer/page_table.h"
+#include "hash/extendible_hash.h"
+#include "page/page.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+TEST(PageTableTest, SampleTest) {
+  PageTable page_table(10);
+  EXPECT_EQ(32, page_table.GetCapacity());
+
+  size_t frame_id;
+  EXPECT_EQ(false, page_table.Find(0, frame_id));
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_EQ(true, page_table.Insert(i * 7, i));
+  }
+  EXPECT_EQ(false, page_table.Insert(14, 5));
+  EXPECT_EQ(10, page_table.GetSize());
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_EQ(true, page_table.Find(i * 7, frame_id));
+    EXPECT_EQ(i, frame_id);
+  }
+
+  EXPECT_EQ(true, page_table.Remove(14));
+  EXPECT_EQ(false, page_table.Remove(14));
+  EXPECT_EQ(false, page_table.Find(14, frame_id));
+  EXPECT_EQ(9, page_table.GetSize());
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_EQ(i != 2, page_table.Find(i * 7, frame_id));
+  }
+}
+
+TEST(PageTableTest, RandomTest) {
+  // collisions and backward shifts on a crowded table, checked against a map
+  const size_t num_frames = 64;
+  PageTable page_table(num_frames);
+  std::unordered_map<page_id_t, size_t> expected;
+  std::mt19937 rng(15445);
+
+  for (int op = 0; op < 100000; ++op) {
+    page_id_t page_id = rng() % 1000;
+    size_t frame_id;
+    if (expected.size() < num_frames && rng() % 2 == 0) {
+      bool inserted = expected.find(page_id) == expected.end();
+      EXPECT_EQ(inserted, page_table.Insert(page_id, op % num_frames));
+      if (inserted) {
+        expected[page_id] = op % num_frames;
+      }
+    } else {
+      EXPECT_EQ(expected.erase(page_id) == 1, page_table.Remove(page_id));
+    }
+    EXPECT_EQ(expected.size(), page_table.GetSize());
+    if (op % 1000 == 0) {
+      for (auto &entry : expected) {
+        EXPECT_EQ(true, page_table.Find(entry.first, frame_id));
+        EXPECT_EQ(entry.second, frame_id);
+      }
+    }
+  }
+}
+
+/*
+ * Find throughput of the page table against the ExtendibleHash it replaced,
+ * for a full buffer pool of 1024 frames. Both are looked up under the
+ * instance latch, so one thread is what counts
+ */
+TEST(PageTableTest, FindThroughputBenchmark) {
+  const size_t num_frames = 1024;
+  const size_t total_finds = 1 << 20;
+  PageTable page_table(num_frames);
+  ExtendibleHash<page_id_t, Page *> extendible_hash(BUCKET_SIZE);
+  std::vector<Page> pages(num_frames);
+  for (size_t i = 0; i < num_frames; ++i) {
+    page_table.Insert(i, i);
+    extendible_hash.Insert(i, &pages[i]);
+  }
+
+  auto run = [&](bool use_page_table) {
+    auto start = std::chrono::steady_clock::now();
+    size_t frame_id;
+    Page *page;
+    size_t hits = 0;
+    for (size_t i = 0; i < total_finds; i++) {
+      page_id_t page_id = (i * 7) % num_frames;
+      hits += use_page_table ? page_table.Find(page_id, frame_id)
+                             : extendible_hash.Find(page_id, page);
+    }
+    EXPECT_EQ(total_finds, hits);
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    return total_finds / elapsed.count() / 1e6;
+  };
+
+  printf("%22s %22s\n", "PageTable Mfind/s", "ExtendibleHash Mfind/s");
+  printf("%22.2f %22.2f\n", run(true), run(false));
+}
+
+} // namespace cmudb
@@ -0,0 +1,88 @@
+/**
+ * crc32c_test.cpp
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "common/config.h"
+#include "common/crc32c.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+TEST(Crc32cTest, KnownValuesTest) {
+  // test vectors of RFC 3720, B.4
+  char buf[32];
+  memset(buf, 0, sizeof(buf));
+  EXPECT_EQ(0x8a9136aa, Crc32c(buf, sizeof(buf)));
+  memset(buf, 0xff, sizeof(buf));
+  EXPECT_EQ(0x62a8ab43, Crc32c(buf, sizeof(buf)));
+  for (int i = 0; i < 32; i++) {
+    buf[i] = static_cast<char>(i);
+  }
+  EXPECT_EQ(0x46dd794e, Crc32c(buf, sizeof(buf)));
+
+  std::string check = "123456789";
+  EXPECT_EQ(0xe3069283, Crc32c(check.data(), check.size()));
+  EXPECT_EQ(0xe3069283, Crc32cSoftware(check.data(), check.size()));
+  EXPECT_EQ(0, Crc32c(check.data(), 0));
+}
+
+TEST(Crc32cTest, SoftwareMatchTest) {
+  std::mt19937 gen(7);
+  std::vector<char> data(2 * DEFAULT_PAGE_SIZE);
+  for (auto &c : data) {
+    c = static_cast<char>(gen());
+  }
+  for (int i = 0; i < 200; i++) {
+    size_t offset = gen() % 64;
+    size_t size = gen() % (data.size() - offset);
+    uint32_t crc = Crc32c(data.data() + offset, size);
+    EXPECT_EQ(Crc32cSoftware(data.data() + offset, size), crc);
+    // going on from the checksum of a prefix
+    size_t split = size / 3;
+    EXPECT_EQ(crc, Crc32c(data.data() + offset + split, size - split,
+                          Crc32c(data.data() + offset, split)));
+  }
+}
+
+/*
+ * What a checksum costs per page write/read, hardware against the table
+ */
+TEST(Crc32cTest, BenchmarkTest) {
+  const int page_size = 4096;
+  const int num_pages = 4096;
+  const int rounds = 20;
+  std::mt19937 gen(11);
+  std::vector<char> pages(static_cast<size_t>(num_pages) * page_size);
+  for (auto &c : pages) {
+    c = static_cast<char>(gen());
+  }
+
+  // keeps the checksums from being optimized away
+  volatile uint32_t sink = 0;
+  auto measure = [&](uint32_t (*crc)(const char *, size_t, uint32_t)) {
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; r++) {
+      for (int i = 0; i < num_pages; i++) {
+        sink = crc(pages.data() + static_cast<size_t>(i) * page_size,
+                   page_size, 0);
+      }
+    }
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    return rounds * static_cast<double>(pages.size()) / elapsed.count() / 1e9;
+  };
+  double hardware = measure(Crc32c);
+  double software = measure(Crc32cSoftware);
+
+  printf("%12s %12s %12s\n", "page size", "Crc32c GB/s", "table GB/s");
+  printf("%12d %12.2f %12.2f\n", page_size, hardware, software);
+}
+
+} // namespace cmudb
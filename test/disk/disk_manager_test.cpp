@@ -0,0 +1,386 @@
+/**
+ * disk_manager_test.cpp
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <future>
+#include <sys/stat.h>
+#include <thread>
+#include <vector>
+
+#include "disk/disk_manager.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+TEST(DiskManagerTest, ReadWritePageTest) {
+  char buf[DEFAULT_PAGE_SIZE] = {0};
+  char data[DEFAULT_PAGE_SIZE] = {0};
+  DiskManager disk_manager("test.db");
+  strcpy(data, "A test string.");
+
+  // reading past the end of the file gives a zeroed page
+  memset(buf, 1, DEFAULT_PAGE_SIZE);
+  disk_manager.ReadPage(0, buf);
+  EXPECT_EQ(0, buf[0]);
+  EXPECT_EQ(0, buf[DEFAULT_PAGE_SIZE - 1]);
+
+  disk_manager.WritePage(0, data);
+  disk_manager.ReadPage(0, buf);
+  EXPECT_EQ(0, memcmp(buf, data, DEFAULT_PAGE_SIZE - PAGE_CHECKSUM_SIZE));
+
+  memset(buf, 0, DEFAULT_PAGE_SIZE);
+  disk_manager.WritePage(5, data);
+  disk_manager.ReadPage(5, buf);
+  EXPECT_EQ(0, memcmp(buf, data, DEFAULT_PAGE_SIZE - PAGE_CHECKSUM_SIZE));
+
+  remove("test.db");
+  remove("test.log");
+}
+
+// flip a byte of the first occurrence of marker in the file, as a torn or
+// rotten write would
+static void CorruptFile(const char *file_name, const char *marker) {
+  FILE *file = fopen(file_name, "r+b");
+  ASSERT_NE(nullptr, file);
+  std::vector<char> content;
+  char chunk[DEFAULT_PAGE_SIZE];
+  size_t n;
+  while ((n = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+    content.insert(content.end(), chunk, chunk + n);
+  }
+  auto found = std::search(content.begin(), content.end(), marker,
+                           marker + strlen(marker));
+  ASSERT_NE(content.end(), found);
+  long offset = found - content.begin();
+  char c = static_cast<char>(*found ^ 0x20);
+  fseek(file, offset, SEEK_SET);
+  fwrite(&c, 1, 1, file);
+  fclose(file);
+}
+
+TEST(DiskManagerTest, ChecksumTest) {
+  char buf[DEFAULT_PAGE_SIZE] = {0};
+  char data[DEFAULT_PAGE_SIZE] = {0};
+  DiskManager disk_manager("test.db");
+  strcpy(data, "checksummed page");
+  disk_manager.WritePage(2, data);
+  // the trailer is stamped into the copy written, not the caller's page
+  EXPECT_TRUE(std::all_of(data + DEFAULT_PAGE_SIZE - PAGE_CHECKSUM_SIZE,
+                          data + DEFAULT_PAGE_SIZE,
+                          [](char c) { return c == 0; }));
+  EXPECT_TRUE(disk_manager.ReadPage(2, buf));
+  EXPECT_TRUE(std::any_of(buf + DEFAULT_PAGE_SIZE - PAGE_CHECKSUM_SIZE,
+                          buf + DEFAULT_PAGE_SIZE,
+                          [](char c) { return c != 0; }));
+  // never written, all zeros
+  EXPECT_TRUE(disk_manager.ReadPage(1, buf));
+
+  CorruptFile("test.db", "checksummed page");
+  EXPECT_FALSE(disk_manager.ReadPage(2, buf));
+  EXPECT_FALSE(disk_manager.ReadPageAsync(2, buf).get());
+
+  // rewriting the page heals it
+  disk_manager.WritePage(2, data);
+  EXPECT_TRUE(disk_manager.ReadPage(2, buf));
+  EXPECT_EQ(0, memcmp(buf, data, DEFAULT_PAGE_SIZE - PAGE_CHECKSUM_SIZE));
+
+  // an asynchronous write copies the page when it is submitted: changing the
+  // page afterwards changes neither what is written nor its checksum
+  std::future<bool> written = disk_manager.WritePageAsync(3, data);
+  strcpy(data, "changed in flight");
+  EXPECT_TRUE(written.get());
+  EXPECT_TRUE(disk_manager.ReadPage(3, buf));
+  EXPECT_STREQ("checksummed page", buf);
+
+  remove("test.db");
+  remove("test.log");
+}
+
+// run the same batch through both backends
+static void BatchTest(AsyncIOType type) {
+  const int num_pages = 200; // more than the io_uring ring holds at once
+  DiskManager disk_manager("test.db", type);
+  if (type == AsyncIOType::THREAD_POOL) {
+    EXPECT_EQ(AsyncIOType::THREAD_POOL, disk_manager.GetAsyncIOType());
+  }
+
+  std::vector<std::vector<char>> pages(num_pages,
+                                       std::vector<char>(DEFAULT_PAGE_SIZE));
+  std::vector<DiskRequest> writes;
+  std::atomic<int> written(0);
+  for (int i = 0; i < num_pages; i++) {
+    snprintf(pages[i].data(), DEFAULT_PAGE_SIZE, "page %d", i);
+    writes.push_back(DiskRequest{true, i, pages[i].data(),
+                                 [&written](bool ok) {
+                                   EXPECT_TRUE(ok);
+                                   written++;
+                                 }});
+  }
+  disk_manager.SubmitBatch(writes).wait();
+  EXPECT_EQ(num_pages, written);
+
+  std::vector<std::vector<char>> reads(num_pages,
+                                       std::vector<char>(DEFAULT_PAGE_SIZE));
+  std::vector<DiskRequest> requests;
+  for (int i = num_pages - 1; i >= 0; i--) {
+    requests.push_back(DiskRequest{false, i, reads[i].data(), nullptr});
+  }
+  disk_manager.SubmitBatch(requests).wait();
+  for (int i = 0; i < num_pages; i++) {
+    EXPECT_EQ(0, memcmp(pages[i].data(), reads[i].data(),
+                        DEFAULT_PAGE_SIZE - PAGE_CHECKSUM_SIZE));
+  }
+
+  // single page futures, also past the end of the file
+  char buf[DEFAULT_PAGE_SIZE];
+  EXPECT_TRUE(disk_manager.ReadPageAsync(7, buf).get());
+  EXPECT_EQ(0, strcmp(buf, "page 7"));
+  EXPECT_TRUE(disk_manager.WritePageAsync(7, pages[8].data()).get());
+  disk_manager.ReadPage(7, buf);
+  EXPECT_EQ(0, strcmp(buf, "page 8"));
+  EXPECT_TRUE(disk_manager.ReadPageAsync(num_pages + 10, buf).get());
+  EXPECT_EQ(0, buf[0]);
+
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(DiskManagerTest, ThreadPoolBatchTest) { BatchTest(AsyncIOType::THREAD_POOL); }
+
+// io_uring if the kernel offers it, the thread pool otherwise
+TEST(DiskManagerTest, IoUringBatchTest) { BatchTest(AsyncIOType::IO_URING); }
+
+TEST(DiskManagerTest, ConcurrentSubmitTest) {
+  const int num_threads = 4;
+  const int pages_per_thread = 100;
+  DiskManager disk_manager("test.db");
+  std::vector<std::thread> threads;
+  for (int tid = 0; tid < num_threads; tid++) {
+    threads.push_back(std::thread([tid, &disk_manager]() {
+      std::vector<std::vector<char>> pages(
+          pages_per_thread, std::vector<char>(DEFAULT_PAGE_SIZE));
+      std::vector<std::future<bool>> futures;
+      for (int i = 0; i < pages_per_thread; i++) {
+        page_id_t page_id = i * num_threads + tid;
+        snprintf(pages[i].data(), DEFAULT_PAGE_SIZE, "page %d", page_id);
+        futures.push_back(disk_manager.WritePageAsync(page_id, pages[i].data()));
+      }
+      for (auto &future : futures) {
+        EXPECT_TRUE(future.get());
+      }
+      char buf[DEFAULT_PAGE_SIZE];
+      for (int i = 0; i < pages_per_thread; i++) {
+        disk_manager.ReadPage(i * num_threads + tid, buf);
+        EXPECT_EQ(0, memcmp(buf, pages[i].data(),
+                            DEFAULT_PAGE_SIZE - PAGE_CHECKSUM_SIZE));
+      }
+    }));
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  remove("test.db");
+  remove("test.log");
+}
+
+// falls back to buffered I/O where the file system has no O_DIRECT, the data
+// must come back the same either way
+TEST(DiskManagerTest, DirectIOTest) {
+  DiskManager disk_manager("test.db", AsyncIOType::AUTO, true);
+  // deliberately misaligned caller buffers go through bounce pages
+  std::vector<char> storage(DEFAULT_PAGE_SIZE * 2 + 1);
+  char *data = storage.data() + 1;
+  char *buf = data + DEFAULT_PAGE_SIZE;
+  strcpy(data, "A direct string.");
+  disk_manager.WritePage(3, data);
+  disk_manager.ReadPage(3, buf);
+  EXPECT_EQ(0, memcmp(buf, data, DEFAULT_PAGE_SIZE - PAGE_CHECKSUM_SIZE));
+  disk_manager.ReadPage(4, buf);
+  EXPECT_EQ(0, buf[0]);
+
+  const int num_pages = 20;
+  std::vector<char> pages(num_pages * DEFAULT_PAGE_SIZE + 1);
+  std::vector<char> reads(num_pages * DEFAULT_PAGE_SIZE + 1);
+  std::vector<DiskRequest> writes;
+  std::vector<DiskRequest> requests;
+  for (int i = 0; i < num_pages; i++) {
+    char *page = pages.data() + 1 + i * DEFAULT_PAGE_SIZE;
+    snprintf(page, DEFAULT_PAGE_SIZE, "page %d", i);
+    writes.push_back(DiskRequest{true, i, page, nullptr});
+    requests.push_back(
+        DiskRequest{false, i, reads.data() + 1 + i * DEFAULT_PAGE_SIZE,
+                    nullptr});
+  }
+  disk_manager.SubmitBatch(writes).wait();
+  disk_manager.SubmitBatch(requests).wait();
+  for (int i = 0; i < num_pages; i++) {
+    EXPECT_EQ(0, memcmp(pages.data() + 1 + i * DEFAULT_PAGE_SIZE,
+                        reads.data() + 1 + i * DEFAULT_PAGE_SIZE,
+                        DEFAULT_PAGE_SIZE - PAGE_CHECKSUM_SIZE));
+  }
+
+  EXPECT_TRUE(disk_manager.WritePageAsync(num_pages, data).get());
+  EXPECT_TRUE(disk_manager.ReadPageAsync(num_pages, buf).get());
+  EXPECT_EQ(0, strcmp(buf, "A direct string."));
+
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(DiskManagerTest, AllocatePageTest) {
+  DiskManager *disk_manager = new DiskManager("test.db");
+  for (page_id_t i = 0; i < 10; i++) {
+    EXPECT_EQ(i, disk_manager->AllocatePage());
+  }
+  // freed pages are reused lowest first before the file grows
+  disk_manager->DeallocatePage(5);
+  disk_manager->DeallocatePage(3);
+  EXPECT_FALSE(disk_manager->IsAllocated(3));
+  EXPECT_EQ(3, disk_manager->AllocatePage());
+  EXPECT_EQ(5, disk_manager->AllocatePage());
+  EXPECT_EQ(10, disk_manager->AllocatePage());
+  EXPECT_TRUE(disk_manager->IsAllocated(3));
+
+  // the bitmap survives a restart
+  disk_manager->DeallocatePage(7);
+  delete disk_manager;
+  disk_manager = new DiskManager("test.db");
+  EXPECT_TRUE(disk_manager->IsAllocated(6));
+  EXPECT_FALSE(disk_manager->IsAllocated(7));
+  EXPECT_EQ(7, disk_manager->AllocatePage());
+  EXPECT_EQ(11, disk_manager->AllocatePage());
+
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+// page ids past the first bitmap page map around it
+TEST(DiskManagerTest, ManyBitmapsTest) {
+  const page_id_t num_pages = DEFAULT_PAGE_SIZE * 8 * 2 + 100;
+  DiskManager *disk_manager = new DiskManager("test.db");
+  char data[DEFAULT_PAGE_SIZE];
+  char buf[DEFAULT_PAGE_SIZE];
+  for (page_id_t i = 0; i < num_pages; i++) {
+    EXPECT_EQ(i, disk_manager->AllocatePage());
+  }
+  for (page_id_t i = 0; i < num_pages; i += 97) {
+    memset(data, 0, DEFAULT_PAGE_SIZE);
+    snprintf(data, DEFAULT_PAGE_SIZE, "page %d", i);
+    disk_manager->WritePage(i, data);
+  }
+  disk_manager->DeallocatePage(DEFAULT_PAGE_SIZE * 8 + 1);
+  delete disk_manager;
+
+  disk_manager = new DiskManager("test.db");
+  for (page_id_t i = 0; i < num_pages; i += 97) {
+    snprintf(data, DEFAULT_PAGE_SIZE, "page %d", i);
+    disk_manager->ReadPage(i, buf);
+    EXPECT_EQ(0, strcmp(data, buf));
+  }
+  EXPECT_EQ(DEFAULT_PAGE_SIZE * 8 + 1, disk_manager->AllocatePage());
+  EXPECT_EQ(num_pages, disk_manager->AllocatePage());
+
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(DiskManagerTest, ExtentTest) {
+  DiskManager *disk_manager = new DiskManager("test.db");
+  EXPECT_EQ(0, disk_manager->AllocateExtent());
+  // plain allocations stay out of reserved extents
+  EXPECT_EQ(EXTENT_SIZE, disk_manager->AllocatePage());
+  EXPECT_EQ(2 * EXTENT_SIZE, disk_manager->AllocateExtent());
+  EXPECT_EQ(1, disk_manager->AllocatePage(0));
+  EXPECT_EQ(2 * EXTENT_SIZE + 1, disk_manager->AllocatePage(2 * EXTENT_SIZE));
+  EXPECT_EQ(EXTENT_SIZE + 1, disk_manager->AllocatePage());
+
+  // a full extent continues in a new one
+  for (page_id_t i = 2; i < EXTENT_SIZE; i++) {
+    EXPECT_EQ(i, disk_manager->AllocatePage(i - 1));
+  }
+  EXPECT_EQ(3 * EXTENT_SIZE, disk_manager->AllocatePage(EXTENT_SIZE - 1));
+
+  // an emptied extent is available to everybody again
+  disk_manager->DeallocatePage(2 * EXTENT_SIZE);
+  disk_manager->DeallocatePage(2 * EXTENT_SIZE + 1);
+  for (page_id_t i = EXTENT_SIZE + 2; i < 2 * EXTENT_SIZE; i++) {
+    EXPECT_EQ(i, disk_manager->AllocatePage());
+  }
+  EXPECT_EQ(2 * EXTENT_SIZE, disk_manager->AllocatePage());
+  EXPECT_EQ(4 * EXTENT_SIZE, disk_manager->AllocateExtent());
+
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(DiskManagerTest, LogSegmentTest) {
+  const int segment_size = 100;
+  char log[1000];
+  for (int i = 0; i < 1000; ++i) {
+    log[i] = static_cast<char>(i % 251);
+  }
+  char buffers[2][300];
+  DiskManager *disk_manager = new DiskManager(
+      "test.db", AsyncIOType::AUTO, false, DEFAULT_PAGE_SIZE, segment_size);
+  EXPECT_EQ(0, disk_manager->GetLogSize());
+  // writes of odd sizes straddle segments, buffers alternate as LogManager's
+  int written = 0, turn = 0;
+  for (int size : {30, 120, 50, 300, 150}) {
+    memcpy(buffers[turn], log + written, size);
+    disk_manager->WriteLog(buffers[turn], size);
+    turn = 1 - turn;
+    written += size;
+  }
+  EXPECT_EQ(650, disk_manager->GetLogSize());
+  struct stat st;
+  EXPECT_EQ(0, stat("test.log", &st));
+  EXPECT_EQ(0, stat("test.log.6", &st));
+  EXPECT_EQ(50, st.st_size);
+
+  char data[300];
+  EXPECT_TRUE(disk_manager->ReadLog(data, 300, 90));
+  EXPECT_EQ(0, memcmp(log + 90, data, 300));
+  // past the end is zero filled
+  EXPECT_TRUE(disk_manager->ReadLog(data, 100, 600));
+  EXPECT_EQ(0, memcmp(log + 600, data, 50));
+  EXPECT_EQ(0, data[50]);
+  EXPECT_FALSE(disk_manager->ReadLog(data, 100, 650));
+
+  // only whole segments below the offset go, offsets stay as they were
+  disk_manager->TruncateLog(250);
+  EXPECT_EQ(200, disk_manager->GetLogStart());
+  EXPECT_NE(0, stat("test.log", &st));
+  EXPECT_NE(0, stat("test.log.1", &st));
+  EXPECT_FALSE(disk_manager->ReadLog(data, 100, 150));
+  EXPECT_TRUE(disk_manager->ReadLog(data, 100, 250));
+  EXPECT_EQ(0, memcmp(log + 250, data, 100));
+  // the segment being written stays
+  disk_manager->TruncateLog(1000);
+  EXPECT_EQ(600, disk_manager->GetLogStart());
+  delete disk_manager;
+
+  // reopened, the log goes on where it ended
+  disk_manager = new DiskManager("test.db", AsyncIOType::AUTO, false,
+                                 DEFAULT_PAGE_SIZE, segment_size);
+  EXPECT_EQ(600, disk_manager->GetLogStart());
+  EXPECT_EQ(650, disk_manager->GetLogSize());
+  memcpy(buffers[0], log + 650, 100);
+  disk_manager->WriteLog(buffers[0], 100);
+  EXPECT_TRUE(disk_manager->ReadLog(data, 150, 600));
+  EXPECT_EQ(0, memcmp(log + 600, data, 150));
+  delete disk_manager;
+
+  remove("test.db");
+  remove("test.log.6");
+  remove("test.log.7");
+}
+
+} // namespace cmudb
@@ -0,0 +1,236 @@
+/**
+ * disk_extendible_hash_test.cpp
+ */
+
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include "buffer/buffer_pool_manager.h"
+#include "hash/disk_extendible_hash.h"
+#include "page/header_page.h"
+#include "vtable/virtual_table.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+TEST(DiskExtendibleHashTest, SampleTest) {
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema);
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(50, disk_manager);
+  page_id_t page_id;
+  auto header_page = static_cast<HeaderPage *>(bpm->NewPage(page_id));
+  header_page->Init();
+  bpm->UnpinPage(page_id, true);
+
+  DiskExtendibleHash<GenericKey<8>, RID, GenericComparator<8>> table(
+      "foo_hash", bpm, comparator);
+  EXPECT_TRUE(table.IsEmpty());
+  GenericKey<8> index_key;
+  RID rid;
+  std::vector<RID> rids;
+
+  const int64_t num_keys = 500;
+  for (int64_t key = 0; key < num_keys; key++) {
+    rid.Set(static_cast<int32_t>(key >> 32), static_cast<int32_t>(key));
+    index_key.SetFromInteger(key);
+    EXPECT_TRUE(table.Insert(index_key, rid));
+  }
+  EXPECT_FALSE(table.IsEmpty());
+  EXPECT_LT(0, table.GetGlobalDepth());
+  table.VerifyIntegrity();
+
+  // unique keys only
+  index_key.SetFromInteger(7);
+  EXPECT_FALSE(table.Insert(index_key, rid));
+
+  for (int64_t key = 0; key < num_keys; key++) {
+    rids.clear();
+    index_key.SetFromInteger(key);
+    EXPECT_TRUE(table.GetValue(index_key, rids));
+    ASSERT_EQ(1, rids.size());
+    EXPECT_EQ(key, rids[0].GetSlotNum());
+  }
+  rids.clear();
+  index_key.SetFromInteger(num_keys);
+  EXPECT_FALSE(table.GetValue(index_key, rids));
+  EXPECT_EQ(0, rids.size());
+
+  // remove the odd keys
+  for (int64_t key = 1; key < num_keys; key += 2) {
+    index_key.SetFromInteger(key);
+    EXPECT_TRUE(table.Remove(index_key));
+  }
+  index_key.SetFromInteger(1);
+  EXPECT_FALSE(table.Remove(index_key));
+  table.VerifyIntegrity();
+  for (int64_t key = 0; key < num_keys; key++) {
+    rids.clear();
+    index_key.SetFromInteger(key);
+    EXPECT_EQ(key % 2 == 0, table.GetValue(index_key, rids));
+  }
+
+  // emptied buckets are merged until a single one is left
+  for (int64_t key = 0; key < num_keys; key += 2) {
+    index_key.SetFromInteger(key);
+    EXPECT_TRUE(table.Remove(index_key));
+  }
+  EXPECT_EQ(0, table.GetGlobalDepth());
+  table.VerifyIntegrity();
+
+  delete key_schema;
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+}
+
+TEST(DiskExtendibleHashTest, ReopenTest) {
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema);
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  // a small pool, so pages really go through the disk
+  BufferPoolManager *bpm = new BufferPoolManager(5, disk_manager);
+  page_id_t page_id;
+  auto header_page = static_cast<HeaderPage *>(bpm->NewPage(page_id));
+  header_page->Init();
+  bpm->UnpinPage(page_id, true);
+
+  GenericKey<8> index_key;
+  RID rid;
+  {
+    DiskExtendibleHash<GenericKey<8>, RID, GenericComparator<8>> table(
+        "foo_hash", bpm, comparator);
+    for (int64_t key = 0; key < 200; key++) {
+      rid.Set(0, static_cast<int32_t>(key));
+      index_key.SetFromInteger(key);
+      EXPECT_TRUE(table.Insert(index_key, rid));
+    }
+  }
+
+  // the directory page is found through the header page
+  page_id_t directory_page_id;
+  header_page = static_cast<HeaderPage *>(bpm->FetchPage(HEADER_PAGE_ID));
+  EXPECT_TRUE(header_page->GetRootId("foo_hash", directory_page_id));
+  bpm->UnpinPage(HEADER_PAGE_ID, false);
+
+  DiskExtendibleHash<GenericKey<8>, RID, GenericComparator<8>> table(
+      "foo_hash", bpm, comparator, directory_page_id);
+  std::vector<RID> rids;
+  for (int64_t key = 0; key < 200; key++) {
+    rids.clear();
+    index_key.SetFromInteger(key);
+    EXPECT_TRUE(table.GetValue(index_key, rids));
+    ASSERT_EQ(1, rids.size());
+    EXPECT_EQ(key, rids[0].GetSlotNum());
+  }
+
+  delete key_schema;
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+}
+
+// the directory has as many slots as fit in the page; once the bucket of a
+// key is full at its largest depth, the insert throws
+TEST(DiskExtendibleHashTest, DirectorySizeTest) {
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema);
+  GenericKey<8> index_key;
+  RID rid;
+
+  for (size_t page_size : {static_cast<size_t>(4096),
+                           static_cast<size_t>(MIN_PAGE_SIZE)}) {
+    DiskManager *disk_manager =
+        new DiskManager("test.db", AsyncIOType::AUTO, false, page_size);
+    BufferPoolManager *bpm = new BufferPoolManager(50, disk_manager);
+    page_id_t page_id;
+    auto header_page = static_cast<HeaderPage *>(bpm->NewPage(page_id));
+    header_page->Init();
+    bpm->UnpinPage(page_id, true);
+
+    DiskExtendibleHash<GenericKey<8>, RID, GenericComparator<8>> table(
+        "foo_hash", bpm, comparator);
+    auto insert = [&](int64_t key) {
+      rid.Set(0, static_cast<int32_t>(key));
+      index_key.SetFromInteger(key);
+      return table.Insert(index_key, rid);
+    };
+    if (page_size == 4096) {
+      // more keys than the 64 slots of a 512 byte page could point at
+      for (int64_t key = 0; key < 20000; key++) {
+        EXPECT_TRUE(insert(key));
+      }
+      EXPECT_LT(6, table.GetGlobalDepth());
+    } else {
+      EXPECT_THROW(
+          {
+            for (int64_t key = 0; key < 20000; key++) {
+              insert(key);
+            }
+          },
+          Exception);
+      EXPECT_EQ(6, table.GetGlobalDepth());
+    }
+    table.VerifyIntegrity();
+
+    delete bpm;
+    delete disk_manager;
+    remove("test.db");
+  }
+  delete key_schema;
+}
+
+TEST(DiskExtendibleHashTest, ConcurrentTest) {
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema);
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(50, disk_manager);
+  page_id_t page_id;
+  auto header_page = static_cast<HeaderPage *>(bpm->NewPage(page_id));
+  header_page->Init();
+  bpm->UnpinPage(page_id, true);
+
+  DiskExtendibleHash<GenericKey<8>, RID, GenericComparator<8>> table(
+      "foo_hash", bpm, comparator);
+  const int num_threads = 4;
+  const int64_t keys_per_thread = 100;
+  std::vector<std::thread> threads;
+  for (int tid = 0; tid < num_threads; tid++) {
+    threads.push_back(std::thread([tid, &table]() {
+      GenericKey<8> index_key;
+      RID rid;
+      std::vector<RID> rids;
+      for (int64_t i = 0; i < keys_per_thread; i++) {
+        int64_t key = i * num_threads + tid;
+        rid.Set(0, static_cast<int32_t>(key));
+        index_key.SetFromInteger(key);
+        EXPECT_TRUE(table.Insert(index_key, rid));
+      }
+      // drop the first half again while the others are splitting
+      for (int64_t i = 0; i < keys_per_thread / 2; i++) {
+        index_key.SetFromInteger(i * num_threads + tid);
+        EXPECT_TRUE(table.Remove(index_key));
+      }
+      for (int64_t i = 0; i < keys_per_thread; i++) {
+        rids.clear();
+        index_key.SetFromInteger(i * num_threads + tid);
+        EXPECT_EQ(i >= keys_per_thread / 2, table.GetValue(index_key, rids));
+      }
+    }));
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  table.VerifyIntegrity();
+
+  delete key_schema;
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+}
+
+} // namespace cmudb
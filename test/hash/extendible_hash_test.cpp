@@ -3,6 +3,7 @@
  */
 
 #include <thread>
+#include <vector>
 
 #include "hash/extendible_hash.h"
 #include "gtest/gtest.h"
@@ -92,7 +93,10 @@ TEST(ExtendibleHashTest, ConcurrentRemoveTest) {
     for (int i = 0; i < num_threads; i++) {
       threads[i].join();
     }
-    EXPECT_EQ(test->GetGlobalDepth(), 6);
+    // emptied buckets are merged back, how far the directory shrinks depends
+    // on the interleaving
+    EXPECT_GE(test->GetGlobalDepth(), 2);
+    EXPECT_LE(test->GetGlobalDepth(), 6);
     int val;
     EXPECT_EQ(0, test->Find(0, val));
     EXPECT_EQ(1, test->Find(8, val));
@@ -102,4 +106,70 @@ TEST(ExtendibleHashTest, ConcurrentRemoveTest) {
   }
 }
 
+TEST(ExtendibleHashTest, ShrinkTest) {
+  ExtendibleHash<int, int> test(2);
+  test.Insert(0, 0);
+  test.Insert(32, 32);
+  test.Insert(64, 64);
+  EXPECT_EQ(6, test.GetGlobalDepth());
+  EXPECT_EQ(64, test.GetNumBuckets());
+
+  // 0 and 64 share the bucket of depth 6, emptying it merges it with 32's
+  EXPECT_EQ(true, test.Remove(0));
+  EXPECT_EQ(6, test.GetGlobalDepth());
+  EXPECT_EQ(true, test.Remove(64));
+  EXPECT_EQ(0, test.GetGlobalDepth());
+  EXPECT_EQ(0, test.GetLocalDepth(0));
+  int val;
+  EXPECT_EQ(true, test.Find(32, val));
+  EXPECT_EQ(32, val);
+  EXPECT_EQ(true, test.Remove(32));
+  EXPECT_EQ(false, test.Find(32, val));
+
+  // the table splits again just as before
+  test.Insert(1, 1);
+  test.Insert(2, 2);
+  test.Insert(3, 3);
+  EXPECT_EQ(1, test.GetGlobalDepth());
+  EXPECT_EQ(true, test.Find(3, val));
+  EXPECT_EQ(3, val);
+}
+
+TEST(ExtendibleHashTest, ConcurrentMixedTest) {
+  const int num_threads = 4;
+  const int keys_per_thread = 500;
+  ExtendibleHash<int, int> test(4);
+  std::vector<std::thread> threads;
+  // every thread inserts its keys, removes the odd ones and looks them up,
+  // while the others split and merge buckets around it
+  for (int tid = 0; tid < num_threads; tid++) {
+    threads.push_back(std::thread([tid, &test]() {
+      for (int round = 0; round < 5; round++) {
+        for (int i = 0; i < keys_per_thread; i++) {
+          test.Insert(i * num_threads + tid, i);
+        }
+        for (int i = 1; i < keys_per_thread; i += 2) {
+          EXPECT_TRUE(test.Remove(i * num_threads + tid));
+        }
+        int val;
+        for (int i = 0; i < keys_per_thread; i++) {
+          EXPECT_EQ(i % 2 == 0, test.Find(i * num_threads + tid, val));
+        }
+        if (round < 4) {
+          for (int i = 0; i < keys_per_thread; i += 2) {
+            EXPECT_TRUE(test.Remove(i * num_threads + tid));
+          }
+        }
+      }
+    }));
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  int val;
+  for (int key = 0; key < keys_per_thread * num_threads; key++) {
+    EXPECT_EQ(key / num_threads % 2 == 0, test.Find(key, val));
+  }
+}
+
 } // namespace cmudb
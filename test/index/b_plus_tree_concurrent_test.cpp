@@ -3,6 +3,7 @@
  */
 
 #include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <cstdio>
 #include <functional>
@@ -350,4 +351,200 @@ TEST(BPlusTreeConcurrentTest, MixTest) {
   remove("test.log");
 }
 
+/*
+ * Readers look up keys nobody touches while writers split and merge the
+ * leaves around them; no lookup may miss
+ */
+TEST(BPlusTreeConcurrentTest, ReadWriteTest) {
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema);
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(500, disk_manager);
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm,
+                                                           comparator);
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(page_id);
+  (void) header_page;
+
+  const int64_t scale = 20000;
+  std::vector<int64_t> keys, odd_keys, remove_keys;
+  for (int64_t key = 0; key < scale; key++) {
+    if (key % 2 == 1) {
+      odd_keys.push_back(key);
+    } else {
+      keys.push_back(key);
+      if (key % 4 == 0) {
+        remove_keys.push_back(key);
+      }
+    }
+  }
+  InsertHelper(tree, keys);
+
+  std::atomic<int> missed{0};
+  std::atomic<bool> done{false};
+  auto reader = [&](uint64_t thread_itr) {
+    GenericKey<8> index_key;
+    std::vector<RID> result;
+    int64_t key = 2 + 4 * thread_itr;
+    while (!done) {
+      index_key.SetFromInteger(key);
+      if (!tree.GetValue(index_key, result) ||
+          result[0].GetSlotNum() != key) {
+        missed++;
+      }
+      key = (key + 4 * 7) % scale;
+    }
+  };
+  std::vector<std::thread> readers;
+  for (uint64_t i = 0; i < 2; i++) {
+    readers.emplace_back(reader, i);
+  }
+  std::thread inserter(InsertHelper, std::ref(tree), odd_keys, 0);
+  std::thread remover(DeleteHelper, std::ref(tree), remove_keys, 0);
+  inserter.join();
+  remover.join();
+  done = true;
+  for (auto &t : readers) {
+    t.join();
+  }
+  EXPECT_EQ(0, missed);
+
+  int64_t size = 0, last = -1;
+  for (auto iterator = tree.Begin(); iterator.isEnd() == false; ++iterator) {
+    int64_t key = (*iterator).first.ToString();
+    EXPECT_LT(last, key);
+    EXPECT_NE(0, key % 4);
+    last = key;
+    size++;
+  }
+  EXPECT_EQ(scale - static_cast<int64_t>(remove_keys.size()), size);
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete disk_manager;
+  delete bpm;
+  remove("test.db");
+  remove("test.log");
+}
+
+/*
+ * The same while two threads empty most of the tree, merging and
+ * redistributing pages at every level
+ */
+TEST(BPlusTreeConcurrentTest, RemoveReadTest) {
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema);
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(500, disk_manager);
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm,
+                                                           comparator);
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(page_id);
+  (void) header_page;
+
+  const int64_t scale = 20000;
+  std::vector<int64_t> keys, remove_keys;
+  for (int64_t key = 0; key < scale; key++) {
+    keys.push_back(key);
+    if (key % 8 != 0) {
+      remove_keys.push_back(key);
+    }
+  }
+  InsertHelper(tree, keys);
+
+  std::atomic<int> missed{0};
+  std::atomic<bool> done{false};
+  auto reader = [&](uint64_t thread_itr) {
+    GenericKey<8> index_key;
+    std::vector<RID> result;
+    int64_t key = 8 * thread_itr;
+    while (!done) {
+      index_key.SetFromInteger(key);
+      if (!tree.GetValue(index_key, result) ||
+          result[0].GetSlotNum() != key) {
+        missed++;
+      }
+      key = (key + 8 * 13) % scale;
+    }
+  };
+  std::vector<std::thread> readers;
+  for (uint64_t i = 0; i < 2; i++) {
+    readers.emplace_back(reader, i);
+  }
+  LaunchParallelTest(2, DeleteHelperSplit, std::ref(tree), remove_keys, 2);
+  done = true;
+  for (auto &t : readers) {
+    t.join();
+  }
+  EXPECT_EQ(0, missed);
+
+  int64_t size = 0;
+  for (auto iterator = tree.Begin(); iterator.isEnd() == false; ++iterator) {
+    EXPECT_EQ(0, (*iterator).first.ToString() % 8);
+    size++;
+  }
+  EXPECT_EQ(scale / 8, size);
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete disk_manager;
+  delete bpm;
+  remove("test.db");
+  remove("test.log");
+}
+
+/*
+ * Point lookups per second against the number of reader threads; readers
+ * take no latches, so they only compete for the buffer pool
+ */
+TEST(BPlusTreeConcurrentTest, LookupBenchmarkTest) {
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema);
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(2000, disk_manager);
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm,
+                                                           comparator);
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(page_id);
+  (void) header_page;
+
+  const int64_t scale = 100000;
+  const int lookups = 50000;
+  std::vector<int64_t> keys;
+  for (int64_t key = 0; key < scale; key++) {
+    keys.push_back(key);
+  }
+  InsertHelper(tree, keys);
+
+  printf("%8s %16s\n", "threads", "M lookups/s");
+  for (uint64_t num_threads : {1, 2, 4, 8}) {
+    std::atomic<int> found{0};
+    auto start = std::chrono::steady_clock::now();
+    LaunchParallelTest(num_threads, [&](uint64_t thread_itr) {
+      GenericKey<8> index_key;
+      std::vector<RID> result;
+      int64_t key = thread_itr * 7919;
+      int hits = 0;
+      for (int i = 0; i < lookups; i++) {
+        index_key.SetFromInteger(key);
+        hits += tree.GetValue(index_key, result);
+        key = (key + 104729) % scale;
+      }
+      found += hits;
+    });
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    EXPECT_EQ(num_threads * lookups, static_cast<uint64_t>(found));
+    printf("%8lu %16.2f\n", num_threads,
+           num_threads * lookups / elapsed.count() / 1e6);
+  }
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete disk_manager;
+  delete bpm;
+  remove("test.db");
+  remove("test.log");
+}
+
 } // namespace cmudb
@@ -3,6 +3,7 @@
  */
 
 #include <algorithm>
+#include <chrono>
 #include <cstdio>
 #include <iostream>
 #include <sstream>
@@ -10,6 +11,8 @@
 #include "buffer/buffer_pool_manager.h"
 #include "common/logger.h"
 #include "index/b_plus_tree.h"
+#include "index/external_sort.h"
+#include "page/header_page.h"
 #include "vtable/virtual_table.h"
 #include "gtest/gtest.h"
 
@@ -393,4 +396,363 @@ TEST(BPlusTreeTests, ScaleTest) {
   remove("test.db");
   remove("test.log");
 }
+
+// fan-out follows the page size of the db file
+TEST(BPlusTreeTests, LargePageTest) {
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema);
+
+  DiskManager *disk_manager =
+      new DiskManager("test.db", AsyncIOType::AUTO, false, 4096);
+  BufferPoolManager *bpm = new BufferPoolManager(10, disk_manager);
+  EXPECT_EQ(4096u, bpm->GetPageSize());
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm,
+                                                           comparator);
+  GenericKey<8> index_key;
+  RID rid;
+  Transaction *transaction = new Transaction(0);
+  page_id_t page_id;
+  auto header_page = static_cast<HeaderPage *>(bpm->NewPage(page_id));
+  header_page->Init();
+
+  int64_t scale = 10000;
+  for (int64_t key = 1; key < scale; key++) {
+    rid.Set(0, key);
+    index_key.SetFromInteger(key);
+    tree.Insert(index_key, rid, transaction);
+  }
+  std::vector<RID> rids;
+  for (int64_t key = 1; key < scale; key++) {
+    rids.clear();
+    index_key.SetFromInteger(key);
+    tree.GetValue(index_key, rids);
+    ASSERT_EQ(1u, rids.size());
+    EXPECT_EQ(key, rids[0].GetSlotNum());
+  }
+  int64_t count = 0;
+  index_key.SetFromInteger(1);
+  for (auto iterator = tree.Begin(index_key); iterator.isEnd() == false;
+       ++iterator) {
+    count++;
+  }
+  EXPECT_EQ(scale - 1, count);
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete transaction;
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+/*
+ * Every leaf's keys stay at or below its high key and the next leaf's above
+ * it, through splits, redistributions and merges
+ */
+TEST(BPlusTreeTests, RightLinkTest) {
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema);
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(50, disk_manager);
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm,
+                                                           comparator);
+  GenericKey<8> index_key;
+  RID rid;
+  Transaction *transaction = new Transaction(0);
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(page_id);
+  (void) header_page;
+
+  int64_t scale = 5000;
+  std::vector<int64_t> keys;
+  for (int64_t key = 1; key < scale; key++) {
+    keys.push_back(key);
+  }
+  std::random_shuffle(keys.begin(), keys.end());
+  for (auto key : keys) {
+    rid.Set(0, key);
+    index_key.SetFromInteger(key);
+    tree.Insert(index_key, rid, transaction);
+  }
+  // leave every fifth key
+  std::random_shuffle(keys.begin(), keys.end());
+  for (auto key : keys) {
+    if (key % 5 != 0) {
+      index_key.SetFromInteger(key);
+      tree.Remove(index_key, transaction);
+    }
+  }
+
+  int64_t count = 0;
+  auto leaf = tree.FindLeafPage(index_key, true);
+  ASSERT_NE(nullptr, leaf);
+  page_id_t next = leaf->GetPageId();
+  while (next != INVALID_PAGE_ID) {
+    auto page = bpm->FetchPage(next);
+    leaf = reinterpret_cast<BPlusTreeLeafPage<GenericKey<8>, RID,
+                                              GenericComparator<8>> *>(
+        page->GetData());
+    for (int i = 0; i < leaf->GetSize(); i++) {
+      EXPECT_EQ(0, leaf->KeyAt(i).ToString() % 5);
+      EXPECT_FALSE(leaf->PastHighKey(leaf->KeyAt(i), comparator));
+      count++;
+    }
+    next = leaf->GetNextPageId();
+    if (next != INVALID_PAGE_ID) {
+      auto right = reinterpret_cast<BPlusTreeLeafPage<GenericKey<8>, RID,
+                                                      GenericComparator<8>> *>(
+          bpm->FetchPage(next)->GetData());
+      EXPECT_EQ(1, comparator(right->KeyAt(0), leaf->GetHighKey()));
+      bpm->UnpinPage(next, false);
+    }
+    bpm->UnpinPage(page->GetPageId(), false);
+  }
+  EXPECT_EQ(scale / 5 - 1, count);
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete transaction;
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+// a leaf emptied and taken out of the tree under an open iterator is freed
+// when the iterator lets go of it, Remove does not wait for that
+TEST(BPlusTreeTests, RemoveUnderIteratorTest) {
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema);
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(50, disk_manager);
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm,
+                                                           comparator);
+  GenericKey<8> index_key;
+  RID rid;
+  Transaction *transaction = new Transaction(0);
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(page_id);
+  (void) header_page;
+
+  int64_t scale = 200;
+  for (int64_t key = 1; key <= scale; key++) {
+    rid.Set(0, key);
+    index_key.SetFromInteger(key);
+    tree.Insert(index_key, rid, transaction);
+  }
+
+  index_key.SetFromInteger(scale / 2);
+  page_id_t leaf_page_id = tree.FindLeafPage(index_key)->GetPageId();
+  {
+    auto iterator = tree.Begin(index_key);
+    ASSERT_FALSE(iterator.isEnd());
+    EXPECT_EQ(scale / 2, (*iterator).second.GetSlotNum());
+    // merging leaves into the first one takes the iterator's leaf out
+    for (int64_t key = 2; key < scale; key++) {
+      index_key.SetFromInteger(key);
+      tree.Remove(index_key, transaction);
+    }
+    EXPECT_TRUE(disk_manager->IsAllocated(leaf_page_id));
+  }
+  EXPECT_FALSE(disk_manager->IsAllocated(leaf_page_id));
+
+  int64_t count = 0;
+  for (auto iterator = tree.Begin(); !iterator.isEnd(); ++iterator) {
+    count++;
+  }
+  EXPECT_EQ(2, count);
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete transaction;
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(BPlusTreeTests, BulkLoadTest) {
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema);
+
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManager(50, disk_manager);
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm,
+                                                           comparator);
+  GenericKey<8> index_key;
+  RID rid;
+  Transaction *transaction = new Transaction(0);
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(page_id);
+  (void) header_page;
+
+  // even keys, each twice: the first one of a pair stays
+  int64_t scale = 10000;
+  std::vector<std::pair<GenericKey<8>, RID>> pairs;
+  for (int64_t key = 0; key < scale; key += 2) {
+    for (int32_t copy = 0; copy < 2; copy++) {
+      index_key.SetFromInteger(key);
+      pairs.emplace_back(index_key, RID(copy, key));
+    }
+  }
+  std::swap(pairs[100], pairs[102]);
+  EXPECT_THROW(tree.BulkLoad(pairs.begin(), pairs.end()), Exception);
+  EXPECT_TRUE(tree.IsEmpty());
+  std::swap(pairs[100], pairs[102]);
+  tree.BulkLoad(pairs.begin(), pairs.end());
+  EXPECT_FALSE(tree.IsEmpty());
+  // every page unpinned
+  tree.ToString();
+
+  // every page but the root at least half full, parents and high keys right
+  page_id_t root_id = tree.FindLeafPage(index_key, true)->GetPageId();
+  for (;;) {
+    auto node = reinterpret_cast<BPlusTreePage *>(
+        bpm->FetchPage(root_id)->GetData());
+    page_id_t parent_id = node->GetParentPageId();
+    bpm->UnpinPage(root_id, false);
+    if (parent_id == INVALID_PAGE_ID) {
+      break;
+    }
+    root_id = parent_id;
+  }
+  page_id_t recorded_root_id;
+  EXPECT_TRUE(static_cast<HeaderPage *>(header_page)
+                  ->GetRootId("foo_pk", recorded_root_id));
+  EXPECT_EQ(root_id, recorded_root_id);
+  std::vector<page_id_t> level{root_id};
+  while (!level.empty()) {
+    std::vector<page_id_t> below;
+    for (auto id : level) {
+      auto node = reinterpret_cast<BPlusTreeInternalPage<
+          GenericKey<8>, page_id_t, GenericComparator<8>> *>(
+          bpm->FetchPage(id)->GetData());
+      if (node->IsLeafPage()) {
+        bpm->UnpinPage(id, false);
+        continue;
+      }
+      EXPECT_GE(node->GetSize(), node->IsRootPage() ? 2 : node->GetMaxSize() / 2);
+      for (int i = 0; i < node->GetSize(); i++) {
+        auto child = reinterpret_cast<BPlusTreePage *>(
+            bpm->FetchPage(node->ValueAt(i))->GetData());
+        EXPECT_EQ(id, child->GetParentPageId());
+        EXPECT_GE(child->GetSize(), child->GetMaxSize() / 2);
+        bpm->UnpinPage(child->GetPageId(), false);
+        below.push_back(node->ValueAt(i));
+      }
+      bpm->UnpinPage(id, false);
+    }
+    swap(level, below);
+  }
+
+  std::vector<RID> rids;
+  for (int64_t key = 0; key < scale; key++) {
+    rids.clear();
+    index_key.SetFromInteger(key);
+    EXPECT_EQ(key % 2 == 0, tree.GetValue(index_key, rids));
+    if (key % 2 == 0) {
+      EXPECT_EQ(key, rids[0].GetSlotNum());
+      EXPECT_EQ(0, rids[0].GetPageId());
+    }
+  }
+  int64_t current_key = 0;
+  for (auto iterator = tree.Begin(); !iterator.isEnd(); ++iterator) {
+    EXPECT_EQ(current_key, (*iterator).first.ToString());
+    current_key += 2;
+  }
+  EXPECT_EQ(scale, current_key);
+
+  // the tree goes on as usual
+  for (int64_t key = 1; key < scale; key += 2) {
+    rid.Set(0, key);
+    index_key.SetFromInteger(key);
+    EXPECT_TRUE(tree.Insert(index_key, rid, transaction));
+  }
+  for (int64_t key = 0; key < scale; key += 3) {
+    index_key.SetFromInteger(key);
+    tree.Remove(index_key, transaction);
+  }
+  current_key = 1;
+  for (auto iterator = tree.Begin(); !iterator.isEnd(); ++iterator) {
+    EXPECT_EQ(current_key, (*iterator).first.ToString());
+    current_key += current_key % 3 == 2 ? 2 : 1;
+  }
+  EXPECT_EQ(scale, current_key);
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete transaction;
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(BPlusTreeTests, BulkLoadBenchmarkTest) {
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema);
+
+  const int64_t scale = 50000;
+  std::vector<int64_t> keys;
+  for (int64_t key = 0; key < scale; key++) {
+    keys.push_back(key);
+  }
+  std::random_shuffle(keys.begin(), keys.end());
+
+  printf("%12s %12s %12s\n", "build", "seconds", "leaves");
+  for (bool bulk : {false, true}) {
+    DiskManager *disk_manager = new DiskManager("test.db");
+    BufferPoolManager *bpm = new BufferPoolManager(2000, disk_manager);
+    BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm,
+                                                             comparator);
+    page_id_t header_page_id;
+    auto header_page = bpm->NewPage(header_page_id);
+    (void) header_page;
+
+    GenericKey<8> index_key;
+    auto start = std::chrono::steady_clock::now();
+    if (bulk) {
+      ExternalSorter<GenericKey<8>, RID, GenericComparator<8>> sorter(comparator);
+      for (auto key : keys) {
+        index_key.SetFromInteger(key);
+        sorter.Add(index_key, RID(key));
+      }
+      sorter.Finish();
+      tree.BulkLoad([&sorter](GenericKey<8> &key, RID &rid) {
+        return sorter.Next(key, rid);
+      });
+    } else {
+      for (auto key : keys) {
+        index_key.SetFromInteger(key);
+        tree.Insert(index_key, RID(key));
+      }
+    }
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    int leaves = 0;
+    for (page_id_t next = tree.FindLeafPage(index_key, true)->GetPageId();
+         next != INVALID_PAGE_ID; leaves++) {
+      auto leaf = reinterpret_cast<BPlusTreeLeafPage<GenericKey<8>, RID,
+                                                      GenericComparator<8>> *>(
+          bpm->FetchPage(next)->GetData());
+      page_id_t page_id = next;
+      next = leaf->GetNextPageId();
+      bpm->UnpinPage(page_id, false);
+    }
+    printf("%12s %12.3f %12d\n", bulk ? "bulk load" : "inserts",
+           elapsed.count(), leaves);
+
+    int64_t count = 0;
+    for (auto iterator = tree.Begin(); !iterator.isEnd(); ++iterator) {
+      EXPECT_EQ(count++, (*iterator).first.ToString());
+    }
+    EXPECT_EQ(scale, count);
+
+    bpm->UnpinPage(HEADER_PAGE_ID, true);
+    delete bpm;
+    delete disk_manager;
+    remove("test.db");
+    remove("test.log");
+  }
+}
+
 } // namespace cmudb
@@ -0,0 +1,80 @@
+/**
+ * external_sort_test.cpp
+ */
+
+#include <algorithm>
+#include <cstdio>
+
+#include "common/rid.h"
+#include "index/external_sort.h"
+#include "index/generic_key.h"
+#include "vtable/virtual_table.h"
+#include "gtest/gtest.h"
+
+namespace cmudb {
+
+TEST(ExternalSortTest, InMemoryTest) {
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema);
+  ExternalSorter<GenericKey<8>, RID, GenericComparator<8>> sorter(comparator);
+
+  std::vector<int64_t> keys;
+  for (int64_t key = 0; key < 1000; key++) {
+    keys.push_back(key);
+  }
+  std::random_shuffle(keys.begin(), keys.end());
+  GenericKey<8> index_key;
+  for (auto key : keys) {
+    index_key.SetFromInteger(key);
+    sorter.Add(index_key, RID(key));
+  }
+  sorter.Finish();
+  EXPECT_EQ(0, sorter.GetRunCount());
+
+  RID rid;
+  int64_t count = 0;
+  while (sorter.Next(index_key, rid)) {
+    EXPECT_EQ(count, index_key.ToString());
+    EXPECT_EQ(count, rid.GetSlotNum());
+    count++;
+  }
+  EXPECT_EQ(1000, count);
+  EXPECT_FALSE(sorter.Next(index_key, rid));
+}
+
+TEST(ExternalSortTest, SpillTest) {
+  Schema *key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema);
+  // 100 pairs fit in memory
+  ExternalSorter<GenericKey<8>, RID, GenericComparator<8>> sorter(
+      comparator, 100 * sizeof(std::pair<GenericKey<8>, RID>));
+
+  // every key four times, the copies in order of their slot numbers
+  const int64_t scale = 2500;
+  std::vector<int64_t> keys;
+  for (int64_t key = 0; key < scale; key++) {
+    keys.push_back(key);
+  }
+  GenericKey<8> index_key;
+  for (int32_t copy = 0; copy < 4; copy++) {
+    std::random_shuffle(keys.begin(), keys.end());
+    for (auto key : keys) {
+      index_key.SetFromInteger(key);
+      sorter.Add(index_key, RID(copy, key));
+    }
+  }
+  sorter.Finish();
+  EXPECT_EQ(100, sorter.GetRunCount());
+
+  RID rid;
+  int64_t count = 0;
+  while (sorter.Next(index_key, rid)) {
+    EXPECT_EQ(count / 4, index_key.ToString());
+    EXPECT_EQ(count % 4, rid.GetPageId());
+    EXPECT_EQ(count / 4, rid.GetSlotNum());
+    count++;
+  }
+  EXPECT_EQ(4 * scale, count);
+}
+
+} // namespace cmudb
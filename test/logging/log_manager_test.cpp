@@ -1,9 +1,16 @@
+#include <algorithm>
 #include <chrono>
 #include <cstdio>
 #include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <thread>
+#include <unordered_map>
+#include <unistd.h>
 
 #include "logging/common.h"
 #include "logging/log_recovery.h"
+#include "page/header_page.h"
 #include "vtable/virtual_table.h"
 #include "gtest/gtest.h"
 
@@ -41,11 +48,11 @@ TEST(LogManagerTest, BasicLogging) {
   LOG_DEBUG("Turning off flushing thread");
 
   // some basic manually checking here
-  char buffer[PAGE_SIZE];
-  storage_engine->disk_manager_->ReadLog(buffer, PAGE_SIZE, 0);
+  char buffer[DEFAULT_PAGE_SIZE];
+  storage_engine->disk_manager_->ReadLog(buffer, DEFAULT_PAGE_SIZE, 0);
   int32_t size = *reinterpret_cast<int32_t *>(buffer);
   LOG_DEBUG("size  = %d", size);
-  size = *reinterpret_cast<int32_t *>(buffer + 20);
+  size = *reinterpret_cast<int32_t *>(buffer + 24);
   LOG_DEBUG("size  = %d", size);
   size = *reinterpret_cast<int32_t *>(buffer + 44);
   LOG_DEBUG("size  = %d", size);
@@ -57,6 +64,24 @@ TEST(LogManagerTest, BasicLogging) {
   remove("test.log");
 }
 
+// the engine's default pool is large enough to be split across threads
+TEST(LogManagerTest, PoolInstancesTest) {
+  StorageEngine *storage_engine = new StorageEngine("test.db");
+  BufferPoolManager *bpm = storage_engine->buffer_pool_manager_;
+
+  EXPECT_GE(BUFFER_POOL_SIZE / INSTANCE_MIN_FRAMES, 4);
+  EXPECT_EQ(BUFFER_POOL_SIZE, bpm->GetPoolSize());
+  size_t expected = std::max<size_t>(
+      std::min<size_t>(std::thread::hardware_concurrency(),
+                       BUFFER_POOL_SIZE / INSTANCE_MIN_FRAMES),
+      1);
+  EXPECT_EQ(expected, bpm->GetNumInstances());
+
+  delete storage_engine;
+  remove("test.db");
+  remove("test.log");
+}
+
 // actually LogRecovery
 TEST(LogManagerTest, RedoTestWithOneTxn) {
   StorageEngine *storage_engine = new StorageEngine("test.db");
@@ -101,7 +126,8 @@ TEST(LogManagerTest, RedoTestWithOneTxn) {
   // restart system
   storage_engine = new StorageEngine("test.db");
   LogRecovery *log_recovery = new LogRecovery(
-      storage_engine->disk_manager_, storage_engine->buffer_pool_manager_);
+      storage_engine->disk_manager_, storage_engine->buffer_pool_manager_,
+      storage_engine->log_manager_);
 
   log_recovery->Redo();
   log_recovery->Undo();
@@ -124,4 +150,973 @@ TEST(LogManagerTest, RedoTestWithOneTxn) {
   remove("test.log");
 }
 
+// redo starts at the checkpoint's smallest recovery LSN, the log before it is
+// not even read
+TEST(LogManagerTest, CheckpointTest) {
+  StorageEngine *storage_engine = new StorageEngine("test.db");
+  BufferPoolManager *bpm = storage_engine->buffer_pool_manager_;
+  LogManager *log_manager = storage_engine->log_manager_;
+  // pages only reach disk when this test says so
+  bpm->StopPageCleaner();
+  page_id_t header_page_id;
+  auto header_page = static_cast<HeaderPage *>(bpm->NewPage(header_page_id));
+  ASSERT_EQ(HEADER_PAGE_ID, header_page_id);
+  header_page->Init();
+  bpm->UnpinPage(header_page_id, true);
+  log_manager->RunFlushThread();
+
+  std::string createStmt =
+      "a varchar, b smallint, c bigint, d bool, e varchar(16)";
+  Schema *schema = ParseCreateStatement(createStmt);
+  Tuple tuple = ConstructTuple(schema);
+  RID rid, rid1, rid2;
+
+  Transaction *txn = storage_engine->transaction_manager_->Begin();
+  TableHeap *test_table = new TableHeap(bpm, storage_engine->lock_manager_,
+                                        log_manager, txn);
+  page_id_t first_page_id = test_table->GetFirstPageId();
+  EXPECT_TRUE(test_table->InsertTuple(tuple, rid, txn));
+  storage_engine->transaction_manager_->Commit(txn);
+  delete txn;
+
+  // everything so far is on disk
+  Page *page = bpm->FetchPage(first_page_id);
+  lsn_t page_lsn = page->GetLSN();
+  bpm->UnpinPage(first_page_id, false);
+  log_manager->WaitForLSN(page_lsn);
+  bpm->FlushAllPages();
+  EXPECT_TRUE(bpm->GetDirtyPageTable().empty());
+
+  // a change before the checkpoint whose page is not written
+  txn = storage_engine->transaction_manager_->Begin();
+  EXPECT_TRUE(test_table->InsertTuple(tuple, rid1, txn));
+  page = bpm->FetchPage(first_page_id);
+  lsn_t rec_lsn = page->GetLSN();
+  bpm->UnpinPage(first_page_id, false);
+  DirtyPageTable dirty_pages = bpm->GetDirtyPageTable();
+  ASSERT_EQ(1u, dirty_pages.size());
+  EXPECT_EQ(first_page_id, dirty_pages[0].first);
+  EXPECT_EQ(rec_lsn, dirty_pages[0].second);
+
+  lsn_t checkpoint_lsn = storage_engine->checkpoint_manager_->Checkpoint();
+  EXPECT_LT(rec_lsn, checkpoint_lsn);
+  storage_engine->transaction_manager_->Commit(txn);
+  delete txn;
+
+  // and one after it
+  txn = storage_engine->transaction_manager_->Begin();
+  EXPECT_TRUE(test_table->InsertTuple(tuple, rid2, txn));
+  storage_engine->transaction_manager_->Commit(txn);
+  delete txn;
+  delete test_table;
+  log_manager->FlushNowBlocking();
+  delete storage_engine;
+
+  // wipe the log up to the recovery LSN
+  {
+    std::fstream log_file("test.log",
+                          std::ios::binary | std::ios::in | std::ios::out);
+    std::vector<char> zeros(rec_lsn, 0);
+    log_file.write(zeros.data(), zeros.size());
+  }
+
+  storage_engine = new StorageEngine("test.db");
+  bpm = storage_engine->buffer_pool_manager_;
+  header_page = static_cast<HeaderPage *>(bpm->FetchPage(HEADER_PAGE_ID));
+  EXPECT_EQ(checkpoint_lsn, header_page->GetCheckpointLSN());
+  bpm->UnpinPage(HEADER_PAGE_ID, false);
+  LogRecovery *log_recovery = new LogRecovery(
+      storage_engine->disk_manager_, bpm, storage_engine->log_manager_);
+  log_recovery->Redo();
+  log_recovery->Undo();
+
+  txn = storage_engine->transaction_manager_->Begin();
+  test_table = new TableHeap(bpm, storage_engine->lock_manager_,
+                             storage_engine->log_manager_, first_page_id);
+  Tuple old_tuple;
+  for (RID r : {rid, rid1, rid2}) {
+    EXPECT_TRUE(test_table->GetTuple(r, old_tuple, txn));
+    EXPECT_EQ(1, old_tuple.GetValue(schema, 4).CompareEquals(
+                     tuple.GetValue(schema, 4)));
+  }
+  storage_engine->transaction_manager_->Commit(txn);
+  delete txn;
+  delete test_table;
+  delete log_recovery;
+  delete schema;
+  delete storage_engine;
+  remove("test.db");
+  remove("test.log");
+}
+
+// records what a checkpoint writes, syncs and truncates, in order
+class SyncOrderDiskManager : public DiskManager {
+public:
+  explicit SyncOrderDiskManager(const std::string &db_file)
+      : DiskManager(db_file, AsyncIOType::AUTO, false, DEFAULT_PAGE_SIZE,
+                    4096) {}
+
+  void WritePage(page_id_t page_id, const char *page_data) override {
+    events_.push_back("write " + std::to_string(page_id));
+    DiskManager::WritePage(page_id, page_data);
+  }
+  bool SyncData() override {
+    events_.push_back("sync");
+    return DiskManager::SyncData();
+  }
+  void TruncateLog(int64_t offset) override {
+    events_.push_back("truncate");
+    DiskManager::TruncateLog(offset);
+  }
+
+  std::vector<std::string> events_;
+};
+
+// the log is only deleted once the pages it covers and the master record
+// pointing past it are synced
+TEST(LogManagerTest, CheckpointSyncTest) {
+  SyncOrderDiskManager *disk_manager = new SyncOrderDiskManager("test.db");
+  LogManager *log_manager = new LogManager(disk_manager);
+  BufferPoolManager *bpm = new BufferPoolManager(10, disk_manager, log_manager);
+  LockManager *lock_manager = new LockManager(true);
+  TransactionManager *transaction_manager =
+      new TransactionManager(lock_manager, log_manager);
+  CheckpointManager *checkpoint_manager = new CheckpointManager(
+      disk_manager, transaction_manager, log_manager, bpm);
+  page_id_t page_id;
+  auto header_page = static_cast<HeaderPage *>(bpm->NewPage(page_id));
+  ASSERT_EQ(HEADER_PAGE_ID, page_id);
+  header_page->Init();
+  bpm->UnpinPage(page_id, true);
+  log_manager->RunFlushThread();
+
+  // a few log segments of transactions
+  for (int i = 0; i < 200; ++i) {
+    Transaction *txn = transaction_manager->Begin();
+    transaction_manager->Commit(txn);
+    delete txn;
+  }
+  bpm->FlushAllPages();
+  disk_manager->events_.clear();
+  checkpoint_manager->Checkpoint();
+  std::vector<std::string> expected = {"sync", "write 0", "sync", "truncate"};
+  EXPECT_EQ(expected, disk_manager->events_);
+  EXPECT_LT(0, disk_manager->GetLogStart());
+
+  log_manager->StopFlushThread();
+  delete checkpoint_manager;
+  delete transaction_manager;
+  delete lock_manager;
+  delete bpm;
+  delete log_manager;
+  delete disk_manager;
+  remove("test.db");
+  for (const char *name : {"test.log", "test.log.1", "test.log.2",
+                           "test.log.3", "test.log.4"}) {
+    remove(name);
+  }
+}
+
+// a dirty page table too large for one log buffer is split across several
+// END_CHECKPOINT records, and recovery takes all of them
+TEST(LogManagerTest, LargeCheckpointTest) {
+  const int page_count = 1000;
+  StorageEngine *storage_engine = new StorageEngine("test.db", page_count + 10);
+  BufferPoolManager *bpm = storage_engine->buffer_pool_manager_;
+  LogManager *log_manager = storage_engine->log_manager_;
+  bpm->StopPageCleaner();
+  page_id_t page_id;
+  auto header_page = static_cast<HeaderPage *>(bpm->NewPage(page_id));
+  ASSERT_EQ(HEADER_PAGE_ID, page_id);
+  header_page->Init();
+  bpm->UnpinPage(page_id, true);
+  log_manager->RunFlushThread();
+
+  Transaction *txn = storage_engine->transaction_manager_->Begin();
+  for (int i = 0; i < page_count; ++i) {
+    Page *page = bpm->NewPage(page_id);
+    ASSERT_NE(nullptr, page);
+    page->SetLSN(txn->GetPrevLSN());
+    bpm->UnpinPage(page_id, true);
+  }
+  Schema *schema = ParseCreateStatement("a varchar, b smallint, c bigint");
+  Tuple tuple = ConstructTuple(schema);
+  RID rid;
+  TableHeap *test_table = new TableHeap(bpm, storage_engine->lock_manager_,
+                                        log_manager, txn);
+  page_id_t first_page_id = test_table->GetFirstPageId();
+  EXPECT_TRUE(test_table->InsertTuple(tuple, rid, txn));
+  storage_engine->transaction_manager_->Commit(txn);
+  delete txn;
+  delete test_table;
+  ASSERT_GT(bpm->GetDirtyPageTable().size() *
+                (sizeof(page_id_t) + sizeof(lsn_t)),
+            static_cast<size_t>(log_manager->GetBufferCapacity()));
+
+  lsn_t checkpoint_lsn = storage_engine->checkpoint_manager_->Checkpoint();
+  log_manager->FlushNowBlocking();
+  DiskManager *disk_manager = storage_engine->disk_manager_;
+  lsn_t log_size = disk_manager->GetLogSize();
+  std::vector<char> log(log_size - checkpoint_lsn);
+  ASSERT_TRUE(disk_manager->ReadLog(log.data(), log.size(), checkpoint_lsn));
+  LogRecovery *log_recovery = new LogRecovery(disk_manager, bpm, log_manager);
+  LogRecord record;
+  int end_count = 0;
+  size_t dirty_count = 0;
+  for (size_t pos = 0; pos < log.size(); pos += record.GetSize()) {
+    ASSERT_TRUE(log_recovery->DeserializeLogRecord(
+        log.data() + pos, log.size() - pos, record));
+    if (record.GetLogRecordType() == LogRecordType::END_CHECKPOINT) {
+      EXPECT_EQ(checkpoint_lsn, record.GetPrevLSN());
+      EXPECT_LE(record.GetSize(), log_manager->GetBufferCapacity());
+      dirty_count += record.GetDirtyPages().size();
+      end_count++;
+    }
+  }
+  delete log_recovery;
+  EXPECT_LT(1, end_count);
+  EXPECT_LE(static_cast<size_t>(page_count + 1), dirty_count);
+  // crash: none of the pages were written
+  delete storage_engine;
+
+  storage_engine = new StorageEngine("test.db", page_count + 10);
+  log_recovery = new LogRecovery(storage_engine->disk_manager_,
+                                 storage_engine->buffer_pool_manager_,
+                                 storage_engine->log_manager_);
+  log_recovery->Redo();
+  log_recovery->Undo();
+  txn = storage_engine->transaction_manager_->Begin();
+  test_table = new TableHeap(storage_engine->buffer_pool_manager_,
+                             storage_engine->lock_manager_,
+                             storage_engine->log_manager_, first_page_id);
+  Tuple result;
+  EXPECT_TRUE(test_table->GetTuple(rid, result, txn));
+  storage_engine->transaction_manager_->Commit(txn);
+  delete txn;
+  delete test_table;
+  delete log_recovery;
+  delete schema;
+  delete storage_engine;
+  remove("test.db");
+  remove("test.log");
+}
+
+// a loser is rolled back with CLRs; recovery crashing after the first of them
+// and running again goes on from there instead of undoing anything twice
+TEST(LogManagerTest, UndoTest) {
+  StorageEngine *storage_engine = new StorageEngine("test.db");
+  BufferPoolManager *bpm = storage_engine->buffer_pool_manager_;
+  storage_engine->log_manager_->RunFlushThread();
+
+  std::string createStmt =
+      "a varchar, b smallint, c bigint, d bool, e varchar(16)";
+  Schema *schema = ParseCreateStatement(createStmt);
+  Tuple tuple = ConstructTuple(schema);
+  Tuple tuple1 = ConstructTuple(schema);
+  RID rid, rid1, rid2;
+
+  Transaction *txn = storage_engine->transaction_manager_->Begin();
+  TableHeap *test_table = new TableHeap(bpm, storage_engine->lock_manager_,
+                                        storage_engine->log_manager_, txn);
+  page_id_t first_page_id = test_table->GetFirstPageId();
+  EXPECT_TRUE(test_table->InsertTuple(tuple, rid, txn));
+  EXPECT_TRUE(test_table->InsertTuple(tuple, rid1, txn));
+  storage_engine->transaction_manager_->Commit(txn);
+  delete txn;
+  // rolled back before the crash, with CLRs
+  txn = storage_engine->transaction_manager_->Begin();
+  EXPECT_TRUE(test_table->InsertTuple(tuple1, rid2, txn));
+  storage_engine->transaction_manager_->Abort(txn);
+  delete txn;
+
+  // the loser crashes before committing: its changes are on disk, its COMMIT
+  // record is not
+  txn = storage_engine->transaction_manager_->Begin();
+  EXPECT_TRUE(test_table->MarkDelete(rid, txn));
+  EXPECT_TRUE(test_table->UpdateTuple(tuple1, rid1, txn));
+  EXPECT_TRUE(test_table->InsertTuple(tuple1, rid2, txn));
+  storage_engine->log_manager_->WaitForLSN(txn->GetPrevLSN());
+  bpm->FlushAllPages();
+  delete txn;
+  delete test_table;
+  delete storage_engine;
+
+  auto check_tuples = [&](StorageEngine *storage_engine) {
+    Transaction *txn = storage_engine->transaction_manager_->Begin();
+    TableHeap test_table(storage_engine->buffer_pool_manager_,
+                         storage_engine->lock_manager_,
+                         storage_engine->log_manager_, first_page_id);
+    Tuple old_tuple;
+    for (RID r : {rid, rid1}) {
+      EXPECT_TRUE(test_table.GetTuple(r, old_tuple, txn));
+      EXPECT_EQ(1, old_tuple.GetValue(schema, 4).CompareEquals(
+                       tuple.GetValue(schema, 4)));
+    }
+    EXPECT_FALSE(test_table.GetTuple(rid2, old_tuple, txn));
+    storage_engine->transaction_manager_->Abort(txn);
+    delete txn;
+  };
+  // count the CLRs and ABORTs from offset on
+  auto count_records = [](StorageEngine *storage_engine,
+                          LogRecovery *log_recovery, lsn_t offset, int &clrs,
+                          int &aborts) {
+    clrs = aborts = 0;
+    char buffer[DEFAULT_PAGE_SIZE];
+    LogRecord record;
+    while (storage_engine->disk_manager_->ReadLog(buffer, DEFAULT_PAGE_SIZE,
+                                                  offset) &&
+           log_recovery->DeserializeLogRecord(buffer, DEFAULT_PAGE_SIZE,
+                                              record)) {
+      clrs += record.GetLogRecordType() == LogRecordType::CLR;
+      aborts += record.GetLogRecordType() == LogRecordType::ABORT;
+      offset += record.GetSize();
+    }
+  };
+
+  // pages only reach disk when this test says so
+  storage_engine = new StorageEngine("test.db");
+  storage_engine->buffer_pool_manager_->StopPageCleaner();
+  lsn_t log_size = storage_engine->disk_manager_->GetLogSize();
+  LogRecovery *log_recovery = new LogRecovery(
+      storage_engine->disk_manager_, storage_engine->buffer_pool_manager_,
+      storage_engine->log_manager_);
+  log_recovery->Redo();
+  log_recovery->Undo();
+  int clrs, aborts;
+  count_records(storage_engine, log_recovery, log_size, clrs, aborts);
+  EXPECT_EQ(3, clrs);
+  EXPECT_EQ(1, aborts);
+  check_tuples(storage_engine);
+
+  // crash with only the first CLR in the log
+  char buffer[DEFAULT_PAGE_SIZE];
+  LogRecord record;
+  ASSERT_TRUE(storage_engine->disk_manager_->ReadLog(buffer, DEFAULT_PAGE_SIZE,
+                                                     log_size));
+  ASSERT_TRUE(
+      log_recovery->DeserializeLogRecord(buffer, DEFAULT_PAGE_SIZE, record));
+  EXPECT_EQ(LogRecordType::CLR, record.GetLogRecordType());
+  delete log_recovery;
+  delete storage_engine;
+  ASSERT_EQ(0, truncate("test.log", log_size + record.GetSize()));
+
+  storage_engine = new StorageEngine("test.db");
+  storage_engine->buffer_pool_manager_->StopPageCleaner();
+  log_recovery = new LogRecovery(storage_engine->disk_manager_,
+                                 storage_engine->buffer_pool_manager_,
+                                 storage_engine->log_manager_);
+  log_recovery->Redo();
+  log_recovery->Undo();
+  count_records(storage_engine, log_recovery, log_size, clrs, aborts);
+  EXPECT_EQ(3, clrs);
+  EXPECT_EQ(1, aborts);
+  check_tuples(storage_engine);
+
+  delete log_recovery;
+  delete schema;
+  delete storage_engine;
+  remove("test.db");
+  remove("test.log");
+}
+
+// a delete is cleaned up after its COMMIT, so another transaction reusing the
+// freed slot is safe: recovery only redoes the cleanup, and has no loser
+TEST(LogManagerTest, CommitDeleteTest) {
+  StorageEngine *storage_engine = new StorageEngine("test.db");
+  BufferPoolManager *bpm = storage_engine->buffer_pool_manager_;
+  // pages only reach disk when this test says so
+  bpm->StopPageCleaner();
+  storage_engine->log_manager_->RunFlushThread();
+
+  std::string createStmt =
+      "a varchar, b smallint, c bigint, d bool, e varchar(16)";
+  Schema *schema = ParseCreateStatement(createStmt);
+  Tuple tuple = ConstructTuple(schema);
+  Tuple tuple1 = ConstructTuple(schema);
+  RID rid, rid1;
+
+  Transaction *txn = storage_engine->transaction_manager_->Begin();
+  TableHeap *test_table = new TableHeap(bpm, storage_engine->lock_manager_,
+                                        storage_engine->log_manager_, txn);
+  page_id_t first_page_id = test_table->GetFirstPageId();
+  EXPECT_TRUE(test_table->InsertTuple(tuple, rid, txn));
+  storage_engine->transaction_manager_->Commit(txn);
+  delete txn;
+  bpm->FlushAllPages();
+
+  txn = storage_engine->transaction_manager_->Begin();
+  txn_id_t delete_txn_id = txn->GetTransactionId();
+  EXPECT_TRUE(test_table->MarkDelete(rid, txn));
+  storage_engine->transaction_manager_->Commit(txn);
+  delete txn;
+  txn = storage_engine->transaction_manager_->Begin();
+  EXPECT_TRUE(test_table->InsertTuple(tuple1, rid1, txn));
+  EXPECT_EQ(rid, rid1);
+  storage_engine->transaction_manager_->Commit(txn);
+  delete txn;
+  delete test_table;
+  delete storage_engine;
+
+  storage_engine = new StorageEngine("test.db");
+  storage_engine->buffer_pool_manager_->StopPageCleaner();
+  LogRecovery *log_recovery = new LogRecovery(
+      storage_engine->disk_manager_, storage_engine->buffer_pool_manager_,
+      storage_engine->log_manager_);
+
+  // the deleting transaction's COMMIT comes before its APPLYDELETE
+  std::vector<LogRecordType> types;
+  char buffer[DEFAULT_PAGE_SIZE];
+  LogRecord record;
+  lsn_t offset = storage_engine->disk_manager_->GetLogStart();
+  while (storage_engine->disk_manager_->ReadLog(buffer, DEFAULT_PAGE_SIZE,
+                                                offset) &&
+         log_recovery->DeserializeLogRecord(buffer, DEFAULT_PAGE_SIZE,
+                                            record)) {
+    if (record.GetTxnId() == delete_txn_id) {
+      types.push_back(record.GetLogRecordType());
+    }
+    offset += record.GetSize();
+  }
+  EXPECT_EQ((std::vector<LogRecordType>{
+                LogRecordType::BEGIN, LogRecordType::MARKDELETE,
+                LogRecordType::COMMIT, LogRecordType::APPLYDELETE}),
+            types);
+
+  lsn_t log_size = storage_engine->disk_manager_->GetLogSize();
+  log_recovery->Redo();
+  log_recovery->Undo();
+  // no loser, so nothing is rolled back
+  EXPECT_EQ(log_size, storage_engine->disk_manager_->GetLogSize());
+
+  txn = storage_engine->transaction_manager_->Begin();
+  TableHeap table(storage_engine->buffer_pool_manager_,
+                  storage_engine->lock_manager_, storage_engine->log_manager_,
+                  first_page_id);
+  Tuple new_tuple;
+  EXPECT_TRUE(table.GetTuple(rid, new_tuple, txn));
+  EXPECT_EQ(1, new_tuple.GetValue(schema, 4).CompareEquals(
+                   tuple1.GetValue(schema, 4)));
+  storage_engine->transaction_manager_->Commit(txn);
+  delete txn;
+
+  delete log_recovery;
+  delete schema;
+  delete storage_engine;
+  remove("test.db");
+  remove("test.log");
+}
+
+// redo spread over several workers by page: the pages still see their records
+// in LSN order (an insert into a slot only after the delete that freed it).
+// The table spans more pages than there are workers; the log fits in one log
+// buffer
+TEST(LogManagerTest, ParallelRedoTest) {
+  StorageEngine *storage_engine = new StorageEngine("test.db");
+  // pages only reach disk when evicted
+  storage_engine->buffer_pool_manager_->StopPageCleaner();
+  storage_engine->log_manager_->RunFlushThread();
+
+  std::string createStmt =
+      "a varchar, b smallint, c bigint, d bool, e varchar(16)";
+  Schema *schema = ParseCreateStatement(createStmt);
+  std::unordered_map<RID, Tuple> expected;
+  std::vector<RID> deleted;
+
+  Transaction *txn = storage_engine->transaction_manager_->Begin();
+  TableHeap *test_table = new TableHeap(storage_engine->buffer_pool_manager_,
+                                        storage_engine->lock_manager_,
+                                        storage_engine->log_manager_, txn);
+  page_id_t first_page_id = test_table->GetFirstPageId();
+  RID rid;
+  // several log buffers worth of records
+  for (int i = 0; i < 300; ++i) {
+    Tuple tuple = ConstructTuple(schema);
+    EXPECT_TRUE(test_table->InsertTuple(tuple, rid, txn));
+    expected[rid] = tuple;
+  }
+  storage_engine->transaction_manager_->Commit(txn);
+  delete txn;
+
+  txn = storage_engine->transaction_manager_->Begin();
+  for (auto it = expected.begin(); it != expected.end();) {
+    EXPECT_TRUE(test_table->MarkDelete(it->first, txn));
+    deleted.push_back(it->first);
+    it = expected.erase(it);
+    for (int i = 0; i < 2 && it != expected.end(); ++i) {
+      ++it;
+    }
+  }
+  storage_engine->transaction_manager_->Commit(txn);
+  delete txn;
+
+  // into the slots just freed
+  txn = storage_engine->transaction_manager_->Begin();
+  for (int i = 0; i < 8; ++i) {
+    Tuple tuple = ConstructTuple(schema);
+    EXPECT_TRUE(test_table->InsertTuple(tuple, rid, txn));
+    expected[rid] = tuple;
+  }
+  storage_engine->transaction_manager_->Commit(txn);
+  storage_engine->log_manager_->WaitForLSN(txn->GetPrevLSN());
+  delete txn;
+  delete test_table;
+  delete storage_engine;
+
+  storage_engine = new StorageEngine("test.db");
+  LogRecovery *log_recovery = new LogRecovery(
+      storage_engine->disk_manager_, storage_engine->buffer_pool_manager_,
+      storage_engine->log_manager_, 4);
+  log_recovery->Redo();
+  log_recovery->Undo();
+
+  test_table = new TableHeap(storage_engine->buffer_pool_manager_,
+                             storage_engine->lock_manager_,
+                             storage_engine->log_manager_, first_page_id);
+  Tuple tuple;
+  for (auto &item : expected) {
+    txn = storage_engine->transaction_manager_->Begin();
+    ASSERT_TRUE(test_table->GetTuple(item.first, tuple, txn));
+    ASSERT_EQ(item.second.GetLength(), tuple.GetLength());
+    EXPECT_EQ(0, memcmp(item.second.GetData(), tuple.GetData(),
+                        tuple.GetLength()));
+    storage_engine->transaction_manager_->Commit(txn);
+    delete txn;
+  }
+  for (auto &r : deleted) {
+    if (expected.count(r) == 0) {
+      txn = storage_engine->transaction_manager_->Begin();
+      EXPECT_FALSE(test_table->GetTuple(r, tuple, txn));
+      storage_engine->transaction_manager_->Abort(txn);
+      delete txn;
+    }
+  }
+
+  delete test_table;
+  delete log_recovery;
+  delete schema;
+  delete storage_engine;
+  remove("test.db");
+  remove("test.log");
+}
+
+// a page failing its checksum stops redo, serial or parallel, and Redo
+// throws naming the page
+TEST(LogManagerTest, RedoCorruptPageTest) {
+  StorageEngine *storage_engine = new StorageEngine("test.db");
+  BufferPoolManager *bpm = storage_engine->buffer_pool_manager_;
+  // pages only reach disk when this test says so
+  bpm->StopPageCleaner();
+  page_id_t header_page_id;
+  auto header_page = static_cast<HeaderPage *>(bpm->NewPage(header_page_id));
+  ASSERT_EQ(HEADER_PAGE_ID, header_page_id);
+  header_page->Init();
+  bpm->UnpinPage(header_page_id, true);
+  storage_engine->log_manager_->RunFlushThread();
+
+  Schema *schema = ParseCreateStatement("a varchar");
+  std::string marker = "corrupt this page";
+  std::vector<Value> values;
+  values.emplace_back(TypeId::VARCHAR, marker.c_str(), marker.size() + 1,
+                      true);
+  Tuple tuple(values, schema);
+  RID rid;
+  Transaction *txn = storage_engine->transaction_manager_->Begin();
+  TableHeap *test_table = new TableHeap(bpm, storage_engine->lock_manager_,
+                                        storage_engine->log_manager_, txn);
+  page_id_t first_page_id = test_table->GetFirstPageId();
+  EXPECT_TRUE(test_table->InsertTuple(tuple, rid, txn));
+  storage_engine->transaction_manager_->Commit(txn);
+  delete txn;
+  bpm->FlushAllPages();
+  // a change redo has to apply to the page on disk
+  txn = storage_engine->transaction_manager_->Begin();
+  EXPECT_TRUE(test_table->InsertTuple(tuple, rid, txn));
+  storage_engine->transaction_manager_->Commit(txn);
+  storage_engine->log_manager_->WaitForLSN(txn->GetPrevLSN());
+  delete txn;
+  delete test_table;
+  delete storage_engine;
+
+  {
+    std::fstream db_file("test.db",
+                         std::ios::binary | std::ios::in | std::ios::out);
+    std::vector<char> content((std::istreambuf_iterator<char>(db_file)),
+                              std::istreambuf_iterator<char>());
+    auto found = std::search(content.begin(), content.end(), marker.begin(),
+                             marker.end());
+    ASSERT_NE(content.end(), found);
+    db_file.clear();
+    db_file.seekp(found - content.begin());
+    db_file.put('C');
+  }
+
+  for (size_t threads : {1, 4}) {
+    storage_engine = new StorageEngine("test.db");
+    LogRecovery *log_recovery = new LogRecovery(
+        storage_engine->disk_manager_, storage_engine->buffer_pool_manager_,
+        storage_engine->log_manager_, threads);
+    std::string error;
+    try {
+      log_recovery->Redo();
+    } catch (Exception &e) {
+      error = e.what();
+    }
+    EXPECT_NE(std::string::npos,
+              error.find("page " + std::to_string(first_page_id)))
+        << "threads: " << threads << ", error: " << error;
+    delete log_recovery;
+    delete storage_engine;
+  }
+
+  delete schema;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(LogManagerTest, GroupCommitTest) {
+  StorageEngine *storage_engine = new StorageEngine("test.db");
+  auto window = GROUP_COMMIT_WINDOW;
+  GROUP_COMMIT_WINDOW = std::chrono::milliseconds(50);
+  storage_engine->log_manager_->RunFlushThread();
+  int flushes = storage_engine->disk_manager_->GetNumFlushes();
+  auto sync_time = storage_engine->disk_manager_->GetLogSyncTime();
+
+  const int commits = 8;
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> threads;
+  for (int i = 0; i < commits; ++i) {
+    threads.emplace_back([storage_engine] {
+      Transaction *txn = storage_engine->transaction_manager_->Begin();
+      storage_engine->transaction_manager_->Commit(txn);
+      // on disk once Commit returns
+      EXPECT_LE(txn->GetPrevLSN(),
+                storage_engine->log_manager_->GetPersistentLSN());
+      delete txn;
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  // nobody waited for the periodic flush
+  EXPECT_LT(std::chrono::steady_clock::now() - start, LOG_TIMEOUT);
+  storage_engine->log_manager_->StopFlushThread();
+  GROUP_COMMIT_WINDOW = window;
+  // the commits shared their writes, and each write is synced once
+  int writes = storage_engine->disk_manager_->GetNumFlushes() - flushes;
+  EXPECT_LT(writes, commits);
+  sync_time = storage_engine->disk_manager_->GetLogSyncTime() - sync_time;
+  printf("%d commits, %d log writes, %.1f us fdatasync per write\n", commits,
+         writes,
+         std::chrono::duration<double, std::micro>(sync_time).count() / writes);
+
+  delete storage_engine;
+  remove("test.db");
+  remove("test.log");
+}
+
+TEST(LogManagerTest, ConcurrentAppendTest) {
+  StorageEngine *storage_engine = new StorageEngine("test.db");
+  LogManager *log_manager = storage_engine->log_manager_;
+  log_manager->RunFlushThread();
+
+  std::string createStmt =
+      "a varchar, b smallint, c bigint, d bool, e varchar(16)";
+  Schema *schema = ParseCreateStatement(createStmt);
+  const int threads = 4, records = 500;
+  std::vector<Tuple> tuples;
+  for (int i = 0; i < threads; ++i) {
+    tuples.push_back(ConstructTuple(schema));
+  }
+
+  // many log buffers, filled by all threads at once
+  std::vector<std::vector<lsn_t>> lsns(threads);
+  std::vector<std::thread> appenders;
+  for (int t = 0; t < threads; ++t) {
+    appenders.emplace_back([&, t] {
+      lsn_t prev_lsn = INVALID_LSN;
+      for (int i = 0; i < records; ++i) {
+        LogRecord record(t, prev_lsn, LogRecordType::INSERT, RID(t, i),
+                         tuples[t]);
+        prev_lsn = log_manager->AppendLogRecord(record);
+        lsns[t].push_back(prev_lsn);
+      }
+    });
+  }
+  for (auto &appender : appenders) {
+    appender.join();
+  }
+  log_manager->FlushNowBlocking();
+  log_manager->StopFlushThread();
+
+  // the log is every record back to back, each one intact at its LSN
+  DiskManager *disk_manager = storage_engine->disk_manager_;
+  int size = disk_manager->GetLogSize();
+  std::vector<char> log(size);
+  ASSERT_TRUE(disk_manager->ReadLog(log.data(), size, 0));
+  LogRecovery *log_recovery = new LogRecovery(
+      disk_manager, storage_engine->buffer_pool_manager_, log_manager);
+  std::vector<int> next(threads, 0);
+  int pos = 0;
+  while (pos < size) {
+    LogRecord record;
+    ASSERT_TRUE(
+        log_recovery->DeserializeLogRecord(log.data() + pos, size - pos, record));
+    EXPECT_EQ(pos, record.GetLSN());
+    int t = record.GetTxnId(), i = next[t]++;
+    ASSERT_LT(i, records);
+    EXPECT_EQ(lsns[t][i], record.GetLSN());
+    EXPECT_EQ(i == 0 ? INVALID_LSN : lsns[t][i - 1], record.GetPrevLSN());
+    EXPECT_EQ(RID(t, i), record.GetInsertRID());
+    EXPECT_EQ(0, memcmp(tuples[t].GetData(), record.GetInserteTuple().GetData(),
+                        tuples[t].GetLength()));
+    pos += record.GetSize();
+  }
+  EXPECT_EQ(size, pos);
+  for (int t = 0; t < threads; ++t) {
+    EXPECT_EQ(records, next[t]);
+  }
+
+  delete log_recovery;
+  delete schema;
+  delete storage_engine;
+  remove("test.db");
+  remove("test.log");
+}
+
+// a wide row with one column changed: only that goes into the log, and both
+// redo and undo rebuild the tuple from the one in the page
+TEST(LogManagerTest, UpdateDeltaTest) {
+  StorageEngine *storage_engine = new StorageEngine("test.db");
+  // pages only reach disk when evicted
+  storage_engine->buffer_pool_manager_->StopPageCleaner();
+  storage_engine->log_manager_->RunFlushThread();
+
+  std::string createStmt = "a varchar, b smallint, c bigint, e varchar";
+  Schema *schema = ParseCreateStatement(createStmt);
+  std::string wide(120, 'x');
+  auto make_tuple = [&](int32_t b, int64_t c) {
+    std::vector<Value> values;
+    values.emplace_back(TypeId::VARCHAR, wide.c_str(), wide.size() + 1, true);
+    values.emplace_back(TypeId::SMALLINT, b);
+    values.emplace_back(TypeId::BIGINT, c);
+    values.emplace_back(TypeId::VARCHAR, wide.c_str(), wide.size() + 1, true);
+    return Tuple(values, schema);
+  };
+  // the loser changes another column than the committed update
+  Tuple tuple = make_tuple(7, 1), tuple1 = make_tuple(7, 2),
+        tuple2 = make_tuple(8, 2);
+  RID rid;
+
+  Transaction *txn = storage_engine->transaction_manager_->Begin();
+  TableHeap *test_table = new TableHeap(storage_engine->buffer_pool_manager_,
+                                        storage_engine->lock_manager_,
+                                        storage_engine->log_manager_, txn);
+  page_id_t first_page_id = test_table->GetFirstPageId();
+  EXPECT_TRUE(test_table->InsertTuple(tuple, rid, txn));
+  storage_engine->transaction_manager_->Commit(txn);
+  delete txn;
+  txn = storage_engine->transaction_manager_->Begin();
+  EXPECT_TRUE(test_table->UpdateTuple(tuple1, rid, txn));
+  storage_engine->transaction_manager_->Commit(txn);
+  delete txn;
+  // the loser
+  txn = storage_engine->transaction_manager_->Begin();
+  EXPECT_TRUE(test_table->UpdateTuple(tuple2, rid, txn));
+  storage_engine->log_manager_->WaitForLSN(txn->GetPrevLSN());
+  delete txn;
+  delete test_table;
+  delete storage_engine;
+
+  storage_engine = new StorageEngine("test.db");
+  LogRecovery *log_recovery = new LogRecovery(
+      storage_engine->disk_manager_, storage_engine->buffer_pool_manager_,
+      storage_engine->log_manager_);
+  int updates = 0;
+  lsn_t offset = 0;
+  char buffer[DEFAULT_PAGE_SIZE];
+  LogRecord record;
+  while (storage_engine->disk_manager_->ReadLog(buffer, DEFAULT_PAGE_SIZE,
+                                                offset) &&
+         log_recovery->DeserializeLogRecord(buffer, DEFAULT_PAGE_SIZE,
+                                            record)) {
+    if (record.GetLogRecordType() == LogRecordType::UPDATE) {
+      updates++;
+      EXPECT_LT(record.GetSize(), tuple.GetLength() / 4);
+    }
+    offset += record.GetSize();
+  }
+  EXPECT_EQ(2, updates);
+  log_recovery->Redo();
+  log_recovery->Undo();
+
+  txn = storage_engine->transaction_manager_->Begin();
+  test_table = new TableHeap(storage_engine->buffer_pool_manager_,
+                             storage_engine->lock_manager_,
+                             storage_engine->log_manager_, first_page_id);
+  Tuple result;
+  ASSERT_TRUE(test_table->GetTuple(rid, result, txn));
+  ASSERT_EQ(tuple1.GetLength(), result.GetLength());
+  EXPECT_EQ(0, memcmp(tuple1.GetData(), result.GetData(), result.GetLength()));
+  storage_engine->transaction_manager_->Commit(txn);
+  delete txn;
+
+  delete test_table;
+  delete log_recovery;
+  delete schema;
+  delete storage_engine;
+  remove("test.db");
+  remove("test.log");
+}
+
+// a corrupted COMMIT ends the log: the transaction is rolled back, and the
+// records recovery logs go where the corrupted one was, so the next recovery
+// finds them
+TEST(LogManagerTest, ChecksumTest) {
+  StorageEngine *storage_engine = new StorageEngine("test.db");
+  storage_engine->log_manager_->RunFlushThread();
+
+  Transaction *txn = storage_engine->transaction_manager_->Begin();
+  TableHeap *test_table = new TableHeap(storage_engine->buffer_pool_manager_,
+                                        storage_engine->lock_manager_,
+                                        storage_engine->log_manager_, txn);
+  page_id_t first_page_id = test_table->GetFirstPageId();
+  Schema *schema = ParseCreateStatement("a varchar, b smallint, c bigint");
+  RID rid, rid1;
+  Tuple tuple = ConstructTuple(schema);
+  EXPECT_TRUE(test_table->InsertTuple(tuple, rid, txn));
+  storage_engine->transaction_manager_->Commit(txn);
+  delete txn;
+
+  txn = storage_engine->transaction_manager_->Begin();
+  EXPECT_TRUE(test_table->InsertTuple(ConstructTuple(schema), rid1, txn));
+  storage_engine->transaction_manager_->Commit(txn);
+  lsn_t commit_lsn = txn->GetPrevLSN();
+  delete txn;
+  delete test_table;
+  delete storage_engine;
+
+  // flip a bit of the COMMIT's txn id
+  {
+    std::fstream log_file("test.log",
+                          std::ios::binary | std::ios::in | std::ios::out);
+    char c;
+    log_file.seekg(commit_lsn + 4);
+    log_file.get(c);
+    log_file.seekp(commit_lsn + 4);
+    log_file.put(static_cast<char>(c ^ 1));
+  }
+
+  for (int restart = 0; restart < 2; ++restart) {
+    storage_engine = new StorageEngine("test.db");
+    LogRecovery *log_recovery = new LogRecovery(
+        storage_engine->disk_manager_, storage_engine->buffer_pool_manager_,
+        storage_engine->log_manager_);
+    log_recovery->Redo();
+    if (restart == 0) {
+      EXPECT_EQ(commit_lsn, storage_engine->disk_manager_->GetLogSize());
+    }
+    log_recovery->Undo();
+    // the rollback was logged: CLR and ABORT
+    EXPECT_GT(storage_engine->disk_manager_->GetLogSize(), commit_lsn);
+
+    Tuple result;
+    txn = storage_engine->transaction_manager_->Begin();
+    test_table = new TableHeap(storage_engine->buffer_pool_manager_,
+                               storage_engine->lock_manager_,
+                               storage_engine->log_manager_, first_page_id);
+    EXPECT_TRUE(test_table->GetTuple(rid, result, txn));
+    EXPECT_FALSE(test_table->GetTuple(rid1, result, txn));
+    storage_engine->transaction_manager_->Commit(txn);
+    delete txn;
+    delete test_table;
+    delete log_recovery;
+    delete storage_engine;
+  }
+
+  delete schema;
+  remove("test.db");
+  remove("test.log");
+}
+
+// LSNs are 64 bit log offsets: a log whose first segment starts at 4 GB is
+// written, recovered and truncated like any other
+TEST(LogManagerTest, LargeOffsetTest) {
+  const int first_segment = 1024;
+  const lsn_t base = static_cast<lsn_t>(first_segment) * LOG_SEGMENT_SIZE;
+  ASSERT_GT(base, static_cast<lsn_t>(INT32_MAX));
+  std::ofstream("test.log." + std::to_string(first_segment));
+
+  StorageEngine *storage_engine = new StorageEngine("test.db");
+  EXPECT_EQ(base, storage_engine->disk_manager_->GetLogStart());
+  EXPECT_EQ(base, storage_engine->disk_manager_->GetLogSize());
+  page_id_t header_page_id;
+  auto header_page = static_cast<HeaderPage *>(
+      storage_engine->buffer_pool_manager_->NewPage(header_page_id));
+  ASSERT_EQ(HEADER_PAGE_ID, header_page_id);
+  header_page->Init();
+  storage_engine->buffer_pool_manager_->UnpinPage(header_page_id, true);
+  storage_engine->log_manager_->RunFlushThread();
+
+  Transaction *txn = storage_engine->transaction_manager_->Begin();
+  TableHeap *test_table = new TableHeap(storage_engine->buffer_pool_manager_,
+                                        storage_engine->lock_manager_,
+                                        storage_engine->log_manager_, txn);
+  page_id_t first_page_id = test_table->GetFirstPageId();
+  Schema *schema = ParseCreateStatement("a varchar, b smallint, c bigint");
+  RID rid, rid1;
+  Tuple tuple = ConstructTuple(schema);
+  EXPECT_TRUE(test_table->InsertTuple(tuple, rid, txn));
+  storage_engine->transaction_manager_->Commit(txn);
+  lsn_t commit_lsn = txn->GetPrevLSN();
+  EXPECT_GT(commit_lsn, base);
+  delete txn;
+
+  // a loser, rolled back by recovery
+  txn = storage_engine->transaction_manager_->Begin();
+  EXPECT_TRUE(test_table->InsertTuple(ConstructTuple(schema), rid1, txn));
+  storage_engine->log_manager_->FlushNowBlocking();
+  delete txn;
+  delete test_table;
+  delete storage_engine;
+
+  storage_engine = new StorageEngine("test.db");
+  LogRecovery *log_recovery = new LogRecovery(
+      storage_engine->disk_manager_, storage_engine->buffer_pool_manager_,
+      storage_engine->log_manager_);
+  log_recovery->Redo();
+  log_recovery->Undo();
+  delete log_recovery;
+  storage_engine->log_manager_->RunFlushThread();
+
+  Page *page = storage_engine->buffer_pool_manager_->FetchPage(first_page_id);
+  ASSERT_NE(nullptr, page);
+  EXPECT_GT(page->GetLSN(), commit_lsn);
+  storage_engine->buffer_pool_manager_->UnpinPage(first_page_id, false);
+  Tuple result;
+  txn = storage_engine->transaction_manager_->Begin();
+  test_table = new TableHeap(storage_engine->buffer_pool_manager_,
+                             storage_engine->lock_manager_,
+                             storage_engine->log_manager_, first_page_id);
+  EXPECT_TRUE(test_table->GetTuple(rid, result, txn));
+  EXPECT_EQ(tuple.ToString(schema), result.ToString(schema));
+  EXPECT_FALSE(test_table->GetTuple(rid1, result, txn));
+  storage_engine->transaction_manager_->Commit(txn);
+  delete txn;
+  delete test_table;
+
+  // the master record keeps a checkpoint LSN above 4 GB
+  lsn_t checkpoint_lsn = storage_engine->checkpoint_manager_->Checkpoint();
+  EXPECT_GT(checkpoint_lsn, base);
+  header_page = static_cast<HeaderPage *>(
+      storage_engine->buffer_pool_manager_->FetchPage(HEADER_PAGE_ID));
+  ASSERT_NE(nullptr, header_page);
+  EXPECT_EQ(checkpoint_lsn, header_page->GetCheckpointLSN());
+  storage_engine->buffer_pool_manager_->UnpinPage(HEADER_PAGE_ID, false);
+
+  delete schema;
+  delete storage_engine;
+  remove("test.db");
+  remove(("test.log." + std::to_string(first_segment)).c_str());
+}
+
 } // namespace cmudb
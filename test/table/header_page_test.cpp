@@ -5,12 +5,12 @@
 #include "page/header_page.h"
 #include "gtest/gtest.h"
 
-// NOTE: when you running this test, make sure page size(config.h) is at least
-// 4096
 namespace cmudb {
 
 TEST(HeaderPageTest, UnitTest) {
-  DiskManager *disk_manager = new DiskManager("test.db");
+  // 27 records need more than the default page size
+  DiskManager *disk_manager =
+      new DiskManager("test.db", AsyncIOType::AUTO, false, 4096);
   BufferPoolManager *buffer_pool_manager =
       new BufferPoolManager(20, disk_manager);
   page_id_t header_page_id;
@@ -55,4 +55,70 @@ TEST(HeaderPageTest, UnitTest) {
   remove("test.db");
   remove("test.log");
 }
+
+TEST(HeaderPageTest, FullPageTest) {
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *buffer_pool_manager =
+      new BufferPoolManager(20, disk_manager);
+  page_id_t header_page_id;
+  HeaderPage *page =
+      static_cast<HeaderPage *>(buffer_pool_manager->NewPage(header_page_id));
+  ASSERT_NE(nullptr, page);
+  page->Init();
+
+  int capacity = (DEFAULT_PAGE_SIZE - 20) / 36;
+  for (int i = 0; i < capacity; i++) {
+    EXPECT_TRUE(page->InsertRecord(std::to_string(i), i));
+  }
+  EXPECT_FALSE(page->InsertRecord("full", 1));
+  EXPECT_EQ(capacity, page->GetRecordCount());
+
+  delete buffer_pool_manager;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+}
+
+// the page size of a db file is the one it was created with
+TEST(HeaderPageTest, PageSizeTest) {
+  DiskManager *disk_manager =
+      new DiskManager("test.db", AsyncIOType::AUTO, false, 8192);
+  EXPECT_EQ(8192u, disk_manager->GetPageSize());
+  BufferPoolManager *buffer_pool_manager =
+      new BufferPoolManager(20, disk_manager);
+  page_id_t header_page_id;
+  HeaderPage *page =
+      static_cast<HeaderPage *>(buffer_pool_manager->NewPage(header_page_id));
+  ASSERT_NE(nullptr, page);
+  page->Init();
+  EXPECT_TRUE(page->InsertRecord("foo", 7));
+  buffer_pool_manager->UnpinPage(header_page_id, true);
+  buffer_pool_manager->FlushPage(header_page_id);
+  delete buffer_pool_manager;
+  delete disk_manager;
+
+  // reopened with another page size asked for
+  disk_manager = new DiskManager("test.db");
+  EXPECT_EQ(8192u, disk_manager->GetPageSize());
+  buffer_pool_manager = new BufferPoolManager(20, disk_manager);
+  EXPECT_EQ(8192u, buffer_pool_manager->GetPageSize());
+  page = static_cast<HeaderPage *>(
+      buffer_pool_manager->FetchPage(HEADER_PAGE_ID));
+  ASSERT_NE(nullptr, page);
+  page_id_t root_id;
+  EXPECT_TRUE(page->GetRootId("foo", root_id));
+  EXPECT_EQ(7, root_id);
+  buffer_pool_manager->UnpinPage(HEADER_PAGE_ID, false);
+  delete buffer_pool_manager;
+  delete disk_manager;
+
+  // a file without a header page takes the page size asked for
+  remove("test.db");
+  disk_manager = new DiskManager("test.db", AsyncIOType::AUTO, false, 1024);
+  EXPECT_EQ(1024u, disk_manager->GetPageSize());
+  delete disk_manager;
+
+  remove("test.db");
+  remove("test.log");
+}
 } // namespace cmudb
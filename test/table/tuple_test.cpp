@@ -5,6 +5,7 @@
 #include <algorithm>
 #include <cstdio>
 #include <iostream>
+#include <set>
 #include <string>
 #include <vector>
 
@@ -61,4 +62,101 @@ TEST(TupleTest, TableHeapTest) {
   delete disk_manager;
 }
 
+TEST(TupleTest, DeleteTableHeapTest) {
+  std::string createStmt =
+      "a varchar, b smallint, c bigint, d bool, e varchar(16)";
+  Schema *schema = ParseCreateStatement(createStmt);
+  Tuple tuple = ConstructTuple(schema);
+
+  Transaction *transaction = new Transaction(0);
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *buffer_pool_manager =
+      new BufferPoolManager(50, disk_manager);
+  LockManager *lock_manager = new LockManager(true);
+  LogManager *log_manager = new LogManager(disk_manager);
+  TableHeap *table = new TableHeap(buffer_pool_manager, lock_manager,
+                                   log_manager, transaction);
+  page_id_t first_page_id = table->GetFirstPageId();
+
+  RID rid;
+  for (int i = 0; i < 1000; ++i) {
+    table->InsertTuple(tuple, rid, transaction);
+  }
+  page_id_t last_page_id = rid.GetPageId();
+  EXPECT_NE(first_page_id, last_page_id);
+
+  // the pages of a dropped table are reused by the next one
+  EXPECT_TRUE(table->DeleteTableHeap());
+  EXPECT_FALSE(disk_manager->IsAllocated(first_page_id));
+  EXPECT_FALSE(disk_manager->IsAllocated(last_page_id));
+  delete table;
+  table = new TableHeap(buffer_pool_manager, lock_manager, log_manager,
+                        transaction);
+  EXPECT_EQ(first_page_id, table->GetFirstPageId());
+
+  remove("test.db");
+  remove("test.log");
+  delete schema;
+  delete table;
+  delete transaction;
+  delete buffer_pool_manager;
+  delete log_manager;
+  delete lock_manager;
+  delete disk_manager;
+}
+
+// tables filled at the same time still get contiguous pages
+TEST(TupleTest, ExtentTest) {
+  std::string createStmt =
+      "a varchar, b smallint, c bigint, d bool, e varchar(16)";
+  Schema *schema = ParseCreateStatement(createStmt);
+  Tuple tuple = ConstructTuple(schema);
+
+  Transaction *transaction = new Transaction(0);
+  DiskManager *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *buffer_pool_manager =
+      new BufferPoolManager(50, disk_manager);
+  LockManager *lock_manager = new LockManager(true);
+  LogManager *log_manager = new LogManager(disk_manager);
+  TableHeap *tables[2];
+  std::set<page_id_t> pages[2];
+  for (int t = 0; t < 2; t++) {
+    tables[t] = new TableHeap(buffer_pool_manager, lock_manager, log_manager,
+                              transaction);
+  }
+  RID rid;
+  for (int i = 0; i < 3000; ++i) {
+    for (int t = 0; t < 2; t++) {
+      EXPECT_TRUE(tables[t]->InsertTuple(tuple, rid, transaction));
+      pages[t].insert(rid.GetPageId());
+    }
+  }
+  EXPECT_GT(pages[0].size(), static_cast<size_t>(EXTENT_SIZE));
+
+  std::set<page_id_t> extents[2];
+  for (int t = 0; t < 2; t++) {
+    for (auto page_id : pages[t]) {
+      extents[t].insert(page_id / EXTENT_SIZE);
+    }
+    // whole extents but the last one
+    EXPECT_EQ((pages[t].size() + EXTENT_SIZE - 1) / EXTENT_SIZE,
+              extents[t].size());
+  }
+  for (auto extent : extents[0]) {
+    EXPECT_EQ(0u, extents[1].count(extent));
+  }
+
+  remove("test.db");
+  remove("test.log");
+  delete schema;
+  for (int t = 0; t < 2; t++) {
+    delete tables[t];
+  }
+  delete transaction;
+  delete buffer_pool_manager;
+  delete log_manager;
+  delete lock_manager;
+  delete disk_manager;
+}
+
 } // namespace cmudb